@@ -7,6 +7,8 @@
 #include "../fileio/FileManager.h"
 #include "../utils/MyLinkList.h"
 #include <cstring>
+#include <mutex>
+#include <atomic>
 /*
  * BufPageManager
  * 实现了一个缓存的管理器
@@ -14,21 +16,46 @@
 struct BufPageManager {
 public:
 	int last;
+	/*
+	 * 缓存页面数组的容量，默认为 CAP
+	 */
+	int capacity;
 	FileManager* fileManager;
 	MyHashMap* hash;
 	FindReplace* replace;
 	//MyLinkList* bpl;
-	bool* dirty;
+	/*
+	 * 脏页标记，多线程模式下钉住页面的写者不取 latch 设置它
+	 */
+	std::atomic<bool>* dirty;
 	/*
 	 * 缓存页面数组
 	 */
 	BufType* addr;
+	/*
+	 * 多个线程共用缓存时：latch 保护哈希表和替换链表，pins 为各缓存页面的钉住计数，
+	 * versions 为各缓存页面上的版本锁（偶数为空闲，奇数为有线程正在改写页面）
+	 * 钉住的页面不会被替换出去：所有缓存页面都被钉住时 fetchPage 不等待，返回 NULL，
+	 * getPage / allocPage / pinPage 随之返回 NULL，由调用方放掉自己钉住的页面后重试；
+	 * 单线程的调用方不钉页面，不会遇到这种情况
+	 */
+	std::mutex latch;
+	std::atomic<int>* pins;
+	std::atomic<unsigned long long>* versions;
 	BufType allocMem() {
 		return new unsigned int[(PAGE_SIZE >> 2)];
 	}
 	BufType fetchPage(int typeID, int pageID, int& index) {
 		BufType b;
+		// 被钉住的页面还在使用，换下一个；转完一圈都被钉住时返回 NULL
 		index = replace->find();
+		for (int tries = 1; pins[index].load(std::memory_order_acquire) > 0; ++ tries) {
+			if (tries >= capacity) {
+				index = -1;
+				return NULL;
+			}
+			index = replace->find();
+		}
 		b = addr[index];
 		if (b == NULL) {
 			b = allocMem();
@@ -60,6 +87,9 @@ public:
 	 */
 	BufType allocPage(int fileID, int pageID, int& index, bool ifRead = false) {
 		BufType b = fetchPage(fileID, pageID, index);
+		if (b == NULL) {
+			return NULL;
+		}
 		if (ifRead) {
 			fileManager->readPage(fileID, pageID, b, 0);
 		} else {
@@ -88,9 +118,35 @@ public:
 			return addr[index];
 		}
 		BufType b = fetchPage(fileID, pageID, index);
+		if (b == NULL) {
+			return NULL;
+		}
 		fileManager->readPage(fileID, pageID, b, 0);
 		return b;
 	}
+	/*
+	 * @函数名pinPage
+	 * 功能:同 getPage，在 latch 保护下进行，并把页面钉住；用完后调用 unpinPage
+	 *           所有缓存页面都被钉住时返回 NULL，不钉任何页面
+	 */
+	BufType pinPage(int fileID, int pageID, int& index) {
+		std::lock_guard<std::mutex> guard(latch);
+		BufType b = getPage(fileID, pageID, index);
+		if (b != NULL) {
+			pins[index].fetch_add(1, std::memory_order_relaxed);
+		}
+		return b;
+	}
+	void unpinPage(int index) {
+		pins[index].fetch_sub(1, std::memory_order_release);
+	}
+	/*
+	 * @函数名markDirtyPinned
+	 * 功能:标记钉住的页面被写过；钉住期间页面不会被替换，不需要加锁
+	 */
+	void markDirtyPinned(int index) {
+		dirty[index].store(true, std::memory_order_relaxed);
+	}
 	/*
 	 * @函数名access
 	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
@@ -143,7 +199,7 @@ public:
 	 * 功能:将所有缓存页面归还给缓存管理器，归还前需要根据脏页标记决定是否写到对应的文件页面中
 	 */
 	void close() {
-		for (int i = 0; i < CAP; ++ i) {
+		for (int i = 0; i < capacity; ++ i) {
 			writeBack(i);
 		}
 	}
@@ -159,18 +215,21 @@ public:
 	/*
 	 * 构造函数
 	 * @参数fm:文件管理器，缓存管理器需要利用文件管理器与磁盘进行交互
+	 * @参数c:缓存页面的个数
 	 */
-	BufPageManager(FileManager* fm) {
-		int c = CAP;
+	BufPageManager(FileManager* fm, int c = CAP) {
 		int m = MOD;
 		last = -1;
+		capacity = c;
 		fileManager = fm;
 		//bpl = new MyLinkList(CAP, MAX_FILE_NUM);
-		dirty = new bool[CAP];
-		addr = new BufType[CAP];
+		dirty = new std::atomic<bool>[c];
+		addr = new BufType[c];
+		pins = new std::atomic<int>[c]();
+		versions = new std::atomic<unsigned long long>[c]();
 		hash = new MyHashMap(c, m);
 	    replace = new FindReplace(c);
-		for (int i = 0; i < CAP; ++ i) {
+		for (int i = 0; i < c; ++ i) {
 			dirty[i] = false;
 			addr[i] = NULL;
 		}
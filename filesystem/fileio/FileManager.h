@@ -83,6 +83,19 @@ public:
 		error = read(f, (void*) b, PAGE_SIZE);
 		return 0;
 	}
+	/*
+	 * @函数名prefetchPage
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 功能:提示操作系统异步预读指定的文件页，之后的readPage可以直接命中系统页缓存
+	 */
+	void prefetchPage(int fileID, int pageID) {
+#ifdef POSIX_FADV_WILLNEED
+		off_t offset = pageID;
+		offset = (offset << PAGE_SIZE_IDX);
+		posix_fadvise(fd[fileID], offset, PAGE_SIZE, POSIX_FADV_WILLNEED);
+#endif
+	}
 	/*
 	 * @函数名closeFile
 	 * @参数fileID:用于区别已经打开的文件
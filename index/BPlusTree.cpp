@@ -1,29 +1,154 @@
 #include "BPlusTree.h"
 #include <cmath>
 #include <queue>
+#include <thread>
 
+// 单列键的槽位比较，calculateLayout 按键类型取其中一个
+template <typename Traits>
+static int compareSlotsAs(const BPlusTree*, const unsigned int* a, const unsigned int* b, int) {
+    return Traits::compareSlots(a, b);
+}
 BPlusTree::BPlusTree(FileManager* fm, BufPageManager* bpm, int fid, KeyType kType, int kLen)
     : fileManager(fm), bufPageManager(bpm), fileID(fid), keyType(kType), keyLength(kLen),
-      rootPage(-1), firstLeaf(-1) {
-    order = calculateOrder();
+      unique(true), rootPage(-1), firstLeaf(-1), varKeys(false), counted(false), appendLeaf(-1),
+      rightAppend(false), concurrent(false), pinnedHeader(nullptr), pinnedHeaderIndex(-1),
+      structureVersion(0), bulkCount(0) {
+    calculateLayout();
+}
+BPlusTree::BPlusTree(FileManager* fm, BufPageManager* bpm, int fid, const std::vector<KeyPart>& parts)
+    : fileManager(fm), bufPageManager(bpm), fileID(fid), keyType(KeyType::COMPOSITE), keyLength(0),
+      keyParts(parts), unique(true), rootPage(-1), firstLeaf(-1), varKeys(false), counted(false), appendLeaf(-1),
+      rightAppend(false), concurrent(false), pinnedHeader(nullptr), pinnedHeaderIndex(-1),
+      structureVersion(0), bulkCount(0) {
+    calculateLayout();
+}
+BPlusTree::~BPlusTree() {
+    clearBulk();
+}
+int BPlusTree::partInts(const KeyPart& part) {
+    if (part.type == KeyType::VARCHAR) {
+        return (part.length + 3) / 4 + 1;
+    }
+    return 1;
+}
+int BPlusTree::partMaxBytes(const KeyPart& part) {
+    if (part.type == KeyType::VARCHAR) {
+        return NormalizedKey::maxStringBytes((part.length + 3) / 4 * 4);
+    }
+    return 4;
+}
+int BPlusTree::keyPartOffset(int part) const {
+    if (normalizedKeys()) {
+        // 这一列及前面各列按最坏情况编码仍放得下时才能解出
+        int bytes = 0;
+        for (int i = 0; i <= part && i < (int)keyParts.size(); i++) {
+            bytes += partMaxBytes(keyParts[i]);
+        }
+        return part < (int)keyParts.size() && bytes <= (keyInts - 1) * 4 ? 0 : -1;
+    }
+    if (keyType != KeyType::COMPOSITE) {
+        if (part != 0) return -1;
+        if (keyType == KeyType::VARCHAR && (keyLength + 3) / 4 + 1 > keyInts) return -1;
+        return 0;
+    }
+    int pos = 0;
+    for (int i = 0; i < (int)keyParts.size(); i++) {
+        int width = partInts(keyParts[i]);
+        if (pos + width > keyInts) return -1;
+        if (i == part) return pos;
+        pos += width;
+    }
+    return -1;
+}
+const unsigned int* BPlusTree::keyPart(const unsigned int* slot, int part, unsigned int* buf) const {
+    if (!normalizedKeys()) {
+        int offset = keyPartOffset(part);
+        return offset < 0 ? nullptr : slot + offset;
+    }
+    if (part < 0 || part >= (int)keyParts.size()) return nullptr;
+    const unsigned char* in = (const unsigned char*)(slot + 1);
+    int avail = slot[0];
+    int pos = 0;
+    for (int i = 0; i < part; i++) {
+        int used = keyParts[i].type == KeyType::VARCHAR ? NormalizedKey::skipString(in + pos, avail - pos) : 4;
+        if (used < 0 || pos + used > avail) return nullptr;
+        pos += used;
+    }
+    if (keyParts[part].type == KeyType::INT) {
+        int v;
+        if (NormalizedKey::getInt(in + pos, avail - pos, v) < 0) return nullptr;
+        buf[0] = static_cast<unsigned int>(v);
+    } else if (keyParts[part].type == KeyType::FLOAT) {
+        float f;
+        if (NormalizedKey::getFloat(in + pos, avail - pos, f) < 0) return nullptr;
+        memcpy(buf, &f, sizeof(float));
+    } else {
+        std::string v;
+        if (NormalizedKey::getString(in + pos, avail - pos, v) < 0) return nullptr;
+        buf[0] = v.length();
+        memcpy(buf + 1, v.data(), v.length());
+    }
+    return buf;
 }
-int BPlusTree::calculateOrder() {
+void BPlusTree::calculateLayout() {
     int availableInts = PAGE_INT_NUM - BP_HEADER_SIZE;
-    
-    int keySize = 1; 
+
+    keyInts = 1;
     if (keyType == KeyType::VARCHAR) {
-        keySize = (keyLength + 3) / 4 + 1; 
+        keyInts = std::min((keyLength + 3) / 4 + 1, BP_MAX_KEY_INTS);
+    } else if (keyType == KeyType::COMPOSITE) {
+        keyInts = 0;
+        if (varKeys) {
+            // memcmp 编码存成 [字节数][编码]，按各列最坏情况留足
+            int bytes = 0;
+            for (const auto& part : keyParts) {
+                bytes += partMaxBytes(part);
+            }
+            keyInts = (bytes + 3) / 4 + 1;
+        } else {
+            for (const auto& part : keyParts) {
+                keyInts += partInts(part);
+            }
+        }
+        keyInts = std::max(1, std::min(keyInts, BP_MAX_KEY_INTS));
+    }
+    int leafOrder = availableInts / (keyInts + 2);
+    int innerOrder = (availableInts - 1) / (keyInts + 1);
+    order = std::min(leafOrder, innerOrder);
+    internalOrder = order;
+    if (!unique) {
+        // 分隔键还要带上 2 个 int 的 RID
+        internalOrder = std::min(order, (availableInts - 1) / (keyInts + 3));
+    }
+    if (counted) {
+        // 每个子节点再带 1 个 int 的子树条目数
+        internalOrder = std::min(internalOrder, (availableInts - 2) / (keyInts + (unique ? 2 : 4)));
     }
-    int leafEntrySize = keySize + 2;
-    int internalEntrySize = keySize + 1;
-    int leafOrder = availableInts / leafEntrySize;
-    int internalOrder = (availableInts - 1) / internalEntrySize; 
-    return std::min(leafOrder, internalOrder);
+    leafValueBase = BP_HEADER_SIZE + order * keyInts;
+    internalValueBase = BP_HEADER_SIZE + internalOrder * keyInts;
+    switch (keyType) {
+        case KeyType::INT: slotCompare = compareSlotsAs<IntKeyTraits>; break;
+        case KeyType::FLOAT: slotCompare = compareSlotsAs<FloatKeyTraits>; break;
+        case KeyType::VARCHAR: slotCompare = compareSlotsAs<VarcharKeyTraits>; break;
+        default:
+            // memcmp 编码的组合键与 VARCHAR 一样按字节串比较
+            slotCompare = varKeys ? compareSlotsAs<VarcharKeyTraits> : compareCompositeSlots;
+            break;
+    }
+    sepRidBase = internalValueBase + internalOrder + 1;
+    internalCountBase = sepRidBase + (unique ? 0 : 2 * internalOrder);
 }
-bool BPlusTree::initialize() {
-    int index;
-    BufType headerPage = bufPageManager->allocPage(fileID, 0, index, false);
-    
+bool BPlusTree::initialize(bool uniqueKeys) {
+    unique = uniqueKeys;
+    varKeys = (keyType == KeyType::VARCHAR || keyType == KeyType::COMPOSITE);
+    counted = true;
+    appendLeaf = -1;
+    calculateLayout();
+    // 整理或重建时头页可能还在缓存里，此时直接改写，不能再为同一页分配一份缓存
+    int index = bufPageManager->hash->findIndex(fileID, 0);
+    BufType headerPage = (index != -1) ? bufPageManager->addr[index]
+                                       : bufPageManager->allocPage(fileID, 0, index, false);
+
     headerPage[0] = BP_MAGIC;
     headerPage[1] = -1;  // 根节点页号
     headerPage[2] = -1;  // 第一个叶子页号
@@ -31,781 +156,2519 @@ bool BPlusTree::initialize() {
     headerPage[4] = keyLength;
     headerPage[5] = 0;   // 节点总数
     headerPage[6] = 0;   // 记录总数
-    for (int i = 7; i < BP_HEADER_SIZE; i++) {
+    headerPage[7] = BP_FORMAT_VERSION;
+    headerPage[8] = unique ? 0 : 1;  // 是否允许重复键
+    for (int i = 9; i < BP_HEADER_SIZE; i++) {
         headerPage[i] = 0;
     }
+    headerPage[BP_LAYOUT_OFFSET] = varKeys ? BP_LAYOUT_VAR : 0;
+    headerPage[BP_COUNTS_OFFSET] = 1;
+    // 组合键的列定义
+    headerPage[9] = keyParts.size();
+    for (size_t i = 0; i < keyParts.size(); i++) {
+        headerPage[BP_SCHEMA_OFFSET + 2 * i] = static_cast<int>(keyParts[i].type);
+        headerPage[BP_SCHEMA_OFFSET + 2 * i + 1] = keyParts[i].length;
+    }
     bufPageManager->markDirty(index);
     rootPage = -1;
     firstLeaf = -1;
+    if (filter) filter->reset(0);
     return true;
 }
 bool BPlusTree::load() {
+    appendLeaf = -1;
     int index;
     BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    
-    if (headerPage[0] != BP_MAGIC) {
-        return false;  
+
+    if (headerPage[0] != BP_MAGIC && headerPage[0] != BP_MAGIC_V1) {
+        return false;
     }
-    
+
     rootPage = headerPage[1];
     firstLeaf = headerPage[2];
     keyType = static_cast<KeyType>(headerPage[3]);
     keyLength = headerPage[4];
-    order = calculateOrder();
+    unique = (headerPage[8] == 0);
+    keyParts.clear();
+    if (keyType == KeyType::COMPOSITE) {
+        int parts = std::min((int)headerPage[9], BP_MAX_KEY_PARTS);
+        for (int i = 0; i < parts; i++) {
+            keyParts.push_back(KeyPart(static_cast<KeyType>(headerPage[BP_SCHEMA_OFFSET + 2 * i]),
+                                       headerPage[BP_SCHEMA_OFFSET + 2 * i + 1]));
+        }
+    }
+    bool legacy = (headerPage[0] == BP_MAGIC_V1);
+    // 没有子树计数的旧索引照常使用，区间计数退化为沿叶子逐条数，整理后带上计数
+    counted = !legacy && headerPage[BP_COUNTS_OFFSET] == 1;
+    // 早先建的 VARCHAR 和组合键索引仍是定长槽位，OPTIMIZE INDEX 重建后换成变长布局
+    varKeys = !legacy && (keyType == KeyType::VARCHAR || keyType == KeyType::COMPOSITE) &&
+              headerPage[BP_LAYOUT_OFFSET] == BP_LAYOUT_VAR;
+    calculateLayout();
     bufPageManager->access(index);
+    if (legacy) {
+        return migrateLegacy();
+    }
     return true;
 }
 void BPlusTree::updateHeader() {
     int index;
     BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    
+
     headerPage[1] = rootPage;
     headerPage[2] = firstLeaf;
-    
+
+    bufPageManager->markDirty(index);
+}
+void BPlusTree::addRecordCount(int delta) {
+    int index;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    headerPage[6] += delta;
     bufPageManager->markDirty(index);
 }
 int BPlusTree::allocateNewPage() {
-
+    appendLeaf = -1;  // 树的形状变了，最右路径要重新找
     int index;
     BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    int freePage = headerPage[BP_FREE_LIST_OFFSET];
+    if (freePage > 0) {
+        int pageIndex;
+        BufType page = bufPageManager->getPage(fileID, freePage, pageIndex);
+        int next = page[BP_NEXT_OFFSET];
+        headerPage = bufPageManager->getPage(fileID, 0, index);
+        headerPage[BP_FREE_LIST_OFFSET] = next;
+        headerPage[BP_FREE_COUNT_OFFSET]--;
+        bufPageManager->markDirty(index);
+        return freePage;
+    }
     int nodeCount = headerPage[5];
     int newPageNum = nodeCount + 1;
     headerPage[5] = nodeCount + 1;
     bufPageManager->markDirty(index);
     return newPageNum;
 }
-BPlusTreeNode BPlusTree::readNode(int pageNum) {
-    BPlusTreeNode node;
-    node.pageNum = pageNum;
+void BPlusTree::freeNode(int pageNum) {
+    if (pageNum <= 0) return;
+    appendLeaf = -1;
     int index;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    int oldHead = headerPage[BP_FREE_LIST_OFFSET];
+    headerPage[BP_FREE_LIST_OFFSET] = pageNum;
+    headerPage[BP_FREE_COUNT_OFFSET]++;
+    bufPageManager->markDirty(index);
     BufType page = bufPageManager->getPage(fileID, pageNum, index);
-    int pageType = page[0];
-    node.isLeaf = (pageType == BP_PAGE_LEAF);
-    node.keyCount = page[1];
-    node.parent = page[2];
-    if (node.isLeaf) {
-        node.nextLeaf = page[3];
-        node.prevLeaf = page[4];
-    }
-    int pos = BP_HEADER_SIZE;
-    for (int i = 0; i < node.keyCount; i++) {
-        if (keyType == KeyType::INT) {
-            node.keys.push_back(static_cast<int>(page[pos++]));
-        } else if (keyType == KeyType::FLOAT) {
-            float f;
-            memcpy(&f, &page[pos++], sizeof(float));
-            node.floatKeys.push_back(f);
-        } else {
-            int len = page[pos++];
-            char* str = new char[len + 1];
-            int intCount = (len + 3) / 4;
-            memcpy(str, &page[pos], len);
-            str[len] = '\0';
-            pos += intCount;
-            node.strKeys.push_back(std::string(str));
-            delete[] str;
-        }
-        if (node.isLeaf) {
-            RID rid;
-            rid.pageNum = page[pos++];
-            rid.slotNum = page[pos++];
-            node.rids.push_back(rid);
-        } else {
-            node.children.push_back(page[pos++]);
-        }
-    }
-    if (!node.isLeaf && node.keyCount > 0) {
-        node.children.push_back(page[pos]);
-    }
-    bufPageManager->access(index);
+    memset(page, 0, BP_HEADER_SIZE * sizeof(unsigned int));
+    page[BP_TYPE_OFFSET] = BP_PAGE_FREE;
+    page[BP_NEXT_OFFSET] = oldHead;
+    bufPageManager->markDirty(index);
+}
+BPlusPage BPlusTree::getNode(int pageNum) {
+    BPlusPage node;
+    node.data = bufPageManager->getPage(fileID, pageNum, node.bufIndex);
+    node.pageNum = pageNum;
+    node.keyInts = keyInts;
+    setLayout(node);
     return node;
 }
-void BPlusTree::writeNode(const BPlusTreeNode& node) {
-    int index;
-    BufType page = bufPageManager->getPage(fileID, node.pageNum, index);
-    memset(page + BP_HEADER_SIZE, 0, (PAGE_INT_NUM - BP_HEADER_SIZE) * sizeof(unsigned int));
-    page[0] = node.isLeaf ? BP_PAGE_LEAF : BP_PAGE_INTERNAL;
-    page[1] = node.keyCount;
-    page[2] = node.parent;
-    if (node.isLeaf) {
-        page[3] = node.nextLeaf;
-        page[4] = node.prevLeaf;
-    }
-    int pos = BP_HEADER_SIZE;
-    for (int i = 0; i < node.keyCount; i++) {
-        if (keyType == KeyType::INT) {
-            page[pos++] = static_cast<unsigned int>(node.keys[i]);
-        } else if (keyType == KeyType::FLOAT) {
-            memcpy(&page[pos++], &node.floatKeys[i], sizeof(float));
-        } else {
-            const std::string& str = node.strKeys[i];
-            int len = str.length();
-            page[pos++] = len;
-            int intCount = (len + 3) / 4;
-            memcpy(&page[pos], str.c_str(), len);
-            pos += intCount;
-        }
-        if (node.isLeaf) {
-            page[pos++] = node.rids[i].pageNum;
-            page[pos++] = node.rids[i].slotNum;
-        } else {
-            page[pos++] = node.children[i];
-        }
-    }
-    if (!node.isLeaf && !node.children.empty()) {
-        page[pos] = node.children.back();
+// 按节点类型（变长布局还要看前缀长度）定出目录和值区的位置
+void BPlusTree::setLayout(BPlusPage& node) {
+    node.varKeys = varKeys;
+    if (!varKeys) {
+        node.valueBase = node.isLeaf() ? leafValueBase : internalValueBase;
+        node.valueStride = node.isLeaf() ? 2 : 1;
+        node.sepRidBase = sepRidBase;
+        node.sepStride = 2;
+        node.keyBase = 0;
+        node.countBase = internalCountBase;
+        node.countStride = 1;
+        return;
     }
-    bufPageManager->markDirty(index);
+    int dirBase = BP_HEADER_SIZE + (node.prefixLen() + 3) / 4;
+    int stride = varStride(node.isLeaf());
+    node.valueStride = stride;
+    node.sepStride = stride;
+    node.keyBase = node.isLeaf() ? dirBase : dirBase + 1;
+    node.valueBase = node.isLeaf() ? dirBase + 1 : dirBase;
+    node.sepRidBase = dirBase + 2;
+    node.countBase = dirBase + (unique ? 2 : 4);
+    node.countStride = stride;
 }
-int BPlusTree::compareKeys(int key1, int key2) {
-    if (key1 < key2) return -1;
-    if (key1 > key2) return 1;
-    return 0;
+BPlusPage BPlusTree::newNode(bool leaf) {
+    BPlusPage node = getNode(allocateNewPage());
+    memset(node.data, 0, BP_HEADER_SIZE * sizeof(unsigned int));
+    node.data[BP_TYPE_OFFSET] = leaf ? BP_PAGE_LEAF : BP_PAGE_INTERNAL;
+    node.data[BP_HEAP_OFFSET] = PAGE_INT_NUM;
+    setLayout(node);
+    node.setKeyCount(0);
+    node.setNextLeaf(-1);
+    node.setPrevLeaf(-1);
+    bufPageManager->markDirty(node.bufIndex);
+    return node;
 }
-int BPlusTree::findLeaf(int key) {
-    if (rootPage == -1) return -1;
-    int currentPage = rootPage;
-    BPlusTreeNode node = readNode(currentPage);
-    while (!node.isLeaf) {
-        int i = 0;
-        while (i < node.keyCount && key >= node.keys[i]) {
-            i++;
-        }
-        currentPage = node.children[i];
-        node = readNode(currentPage);
-    }
-    return currentPage;
+void BPlusTree::storeKey(unsigned int* slot, int key) {
+    slot[0] = static_cast<unsigned int>(key);
 }
-void BPlusTree::insertIntoLeaf(BPlusTreeNode& leaf, int key, const RID& rid) {
-    int i = 0;
-    while (i < leaf.keyCount && leaf.keys[i] < key) {
-        i++;
-    }
-    leaf.keys.insert(leaf.keys.begin() + i, key);
-    leaf.rids.insert(leaf.rids.begin() + i, rid);
-    leaf.keyCount++;
-}
-void BPlusTree::insertIntoParent(BPlusTreeNode& left, int key, BPlusTreeNode& right) {
-    if (left.parent == -1) {
-        int newRootPage = allocateNewPage();       
-        BPlusTreeNode newRoot;
-        newRoot.pageNum = newRootPage;
-        newRoot.isLeaf = false;
-        newRoot.keyCount = 1;
-        newRoot.parent = -1;
-        newRoot.keys.push_back(key);
-        newRoot.children.push_back(left.pageNum);
-        newRoot.children.push_back(right.pageNum);     
-        writeNode(newRoot); 
-        left.parent = newRootPage;
-        right.parent = newRootPage;
-        writeNode(left);
-        writeNode(right);
-        rootPage = newRootPage;
-        updateHeader();
+void BPlusTree::storeKey(unsigned int* slot, float key) {
+    memcpy(slot, &key, sizeof(float));
+}
+void BPlusTree::storeKey(unsigned int* slot, const std::string& key) {
+    int len = std::min((int)key.length(), (keyInts - 1) * 4);
+    memset(slot, 0, keyInts * sizeof(unsigned int));
+    slot[0] = len;
+    memcpy(slot + 1, key.data(), len);
+}
+void BPlusTree::storeKey(unsigned int* slot, const CompositeKey& key) {
+    memset(slot, 0, keyInts * sizeof(unsigned int));
+    if (normalizedKeys()) {
+        slot[0] = normalize(key, (unsigned char*)(slot + 1));
         return;
     }
-    BPlusTreeNode parent = readNode(left.parent);
-    int i = 0;
-    while (i < (int)parent.children.size() && parent.children[i] != left.pageNum) {
-        i++;
+    int pos = 0;
+    int kpos = 0;
+    for (int i = 0; i < key.partCount() && i < (int)keyParts.size(); i++) {
+        int width = partInts(keyParts[i]);
+        if (pos + width > keyInts) break;
+        if (keyParts[i].type == KeyType::VARCHAR) {
+            int klen = key.words[kpos];
+            int len = std::min(klen, (width - 1) * 4);
+            slot[pos] = len;
+            memcpy(slot + pos + 1, &key.words[kpos + 1], len);
+            kpos += 1 + (klen + 3) / 4;
+        } else {
+            slot[pos] = key.words[kpos++];
+        }
+        pos += width;
     }
-    // 插入新键和子指针
-    parent.keys.insert(parent.keys.begin() + i, key);
-    parent.children.insert(parent.children.begin() + i + 1, right.pageNum);
-    parent.keyCount++;
-    right.parent = parent.pageNum;
-    writeNode(right);
-    // 检查是否需要分裂
-    if (parent.keyCount >= order) {
-        splitInternal(parent);
-    } else {
-        writeNode(parent);
-    }
-}
-void BPlusTree::splitLeaf(BPlusTreeNode& leaf) {
-    int mid = leaf.keyCount / 2;
-    int newPageNum = allocateNewPage();
-    BPlusTreeNode newLeaf;
-    newLeaf.pageNum = newPageNum;
-    newLeaf.isLeaf = true;
-    newLeaf.parent = leaf.parent;
-    newLeaf.nextLeaf = leaf.nextLeaf;
-    newLeaf.prevLeaf = leaf.pageNum;
-    for (int i = mid; i < leaf.keyCount; i++) {
-        newLeaf.keys.push_back(leaf.keys[i]);
-        newLeaf.rids.push_back(leaf.rids[i]);
-        newLeaf.keyCount++;
-    }
-    leaf.keys.resize(mid);
-    leaf.rids.resize(mid);
-    leaf.keyCount = mid;
-    leaf.nextLeaf = newPageNum;
-    if (newLeaf.nextLeaf != -1) {
-        BPlusTreeNode nextNode = readNode(newLeaf.nextLeaf);
-        nextNode.prevLeaf = newPageNum;
-        writeNode(nextNode);
-    }
-    writeNode(leaf);
-    writeNode(newLeaf);
-    int newKey = newLeaf.keys[0];
-    insertIntoParent(leaf, newKey, newLeaf);
-}
-void BPlusTree::splitInternal(BPlusTreeNode& node) {
-    int mid = node.keyCount / 2;
-    int midKey = node.keys[mid];
-    int newPageNum = allocateNewPage();
-    BPlusTreeNode newNode;
-    newNode.pageNum = newPageNum;
-    newNode.isLeaf = false;
-    newNode.parent = node.parent;
-    for (int i = mid + 1; i < node.keyCount; i++) {
-        newNode.keys.push_back(node.keys[i]);
-        newNode.children.push_back(node.children[i]);
-        newNode.keyCount++;
-    }
-    newNode.children.push_back(node.children.back());
-    for (int childPage : newNode.children) {
-        BPlusTreeNode child = readNode(childPage);
-        child.parent = newPageNum;
-        writeNode(child);
-    }
-    node.keys.resize(mid);
-    node.children.resize(mid + 1);
-    node.keyCount = mid;
-    writeNode(node);
-    writeNode(newNode);
-    insertIntoParent(node, midKey, newNode);
 }
-bool BPlusTree::insert(int key, const RID& rid) {
-    if (keyType != KeyType::INT) return false;
-    if (rootPage == -1) {
-        int newPageNum = allocateNewPage();
-        BPlusTreeNode leaf;
-        leaf.pageNum = newPageNum;
-        leaf.isLeaf = true;
-        leaf.keyCount = 1;
-        leaf.parent = -1;
-        leaf.nextLeaf = -1;
-        leaf.prevLeaf = -1;
-        leaf.keys.push_back(key);
-        leaf.rids.push_back(rid);   
-        writeNode(leaf);
-        rootPage = newPageNum;
-        firstLeaf = newPageNum;
-        updateHeader();
-        int index;
-        BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-        headerPage[6]++;
-        bufPageManager->markDirty(index);
-        return true;
-    }
-    int leafPage = findLeaf(key);
-    BPlusTreeNode leaf = readNode(leafPage);
-    for (int i = 0; i < leaf.keyCount; i++) {
-        if (leaf.keys[i] == key) {
-            return false;  // 键已存在
+int BPlusTree::normalize(const CompositeKey& key, unsigned char* out) {
+    int cap = (keyInts - 1) * 4;
+    int n = 0;
+    int kpos = 0;
+    for (int i = 0; i < key.partCount() && i < (int)keyParts.size() && n < cap; i++) {
+        const KeyPart& part = keyParts[i];
+        if (part.type == KeyType::VARCHAR) {
+            // 与定长槽位一样截到列宽（按 int 补齐）
+            int klen = key.words[kpos];
+            int len = std::min(klen, (part.length + 3) / 4 * 4);
+            const unsigned int* data = &key.words[kpos + 1];
+            kpos += 1 + (klen + 3) / 4;
+            if (cap - n >= NormalizedKey::maxStringBytes(len)) {
+                n += NormalizedKey::putString(out + n, data, len);
+            } else {
+                std::vector<unsigned char> tmp(NormalizedKey::maxStringBytes(len));
+                int m = NormalizedKey::putString(tmp.data(), data, len);
+                memcpy(out + n, tmp.data(), std::min(m, cap - n));
+                n += std::min(m, cap - n);
+            }
+            continue;
         }
+        unsigned char word[4];
+        if (part.type == KeyType::INT) {
+            NormalizedKey::putInt(word, static_cast<int>(key.words[kpos]));
+        } else {
+            float f;
+            memcpy(&f, &key.words[kpos], sizeof(float));
+            NormalizedKey::putFloat(word, f);
+        }
+        kpos++;
+        memcpy(out + n, word, std::min(4, cap - n));
+        n += std::min(4, cap - n);
     }
-    insertIntoLeaf(leaf, key, rid);
-    int index;
-    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    headerPage[6]++;
-    bufPageManager->markDirty(index);
-    if (leaf.keyCount >= order) {
-        splitLeaf(leaf);
-    } else {
-        writeNode(leaf);
-    }
-    return true;
+    return n;
 }
-bool BPlusTree::search(int key, RID& rid) {
-    if (keyType != KeyType::INT || rootPage == -1) return false;
-    int leafPage = findLeaf(key);
-    if (leafPage == -1) return false;
-    BPlusTreeNode leaf = readNode(leafPage);
-    for (int i = 0; i < leaf.keyCount; i++) {
-        if (leaf.keys[i] == key) {
-            rid = leaf.rids[i];
-            return true;
+CompositeKey BPlusTree::slotToComposite(const unsigned int* slot) {
+    CompositeKey key;
+    int pos = 0;
+    for (const auto& part : keyParts) {
+        int width = partInts(part);
+        // 槽位放不下的列原本就不参与比较，补成同一个值，键序和唯一性都不变
+        bool stored = pos + width <= keyInts;
+        if (!stored) {
+            if (part.type == KeyType::INT) key.addInt(0);
+            else if (part.type == KeyType::FLOAT) key.addFloat(0.0f);
+            else key.addString("");
+        } else if (part.type == KeyType::INT) {
+            key.addInt(static_cast<int>(slot[pos]));
+        } else if (part.type == KeyType::FLOAT) {
+            float f;
+            memcpy(&f, slot + pos, sizeof(float));
+            key.addFloat(f);
+        } else {
+            key.addString(std::string((const char*)(slot + pos + 1), slot[pos]));
         }
+        pos += width;
     }
-    return false;
+    return key;
 }
-std::vector<RID> BPlusTree::rangeSearch(int lowKey, int highKey, bool includeLow, bool includeHigh) {
-    std::vector<RID> result;
-    if (keyType != KeyType::INT || rootPage == -1) return result;
-    int leafPage = findLeaf(lowKey);
-    if (leafPage == -1) return result;
-    BPlusTreeNode leaf = readNode(leafPage);
-    bool done = false;
-    while (!done && leaf.pageNum != -1) {
-        for (int i = 0; i < leaf.keyCount; i++) {
-            int k = leaf.keys[i];
-            bool aboveLow = includeLow ? (k >= lowKey) : (k > lowKey);
-            bool belowHigh = includeHigh ? (k <= highKey) : (k < highKey);
-            if (!belowHigh) {
-                done = true;
-                break;
-            }
-            if (aboveLow && belowHigh) {
-                result.push_back(leaf.rids[i]);
-            }
+int BPlusTree::compareRid(const RID& a, const RID& b) {
+    if (a.pageNum != b.pageNum) return a.pageNum < b.pageNum ? -1 : 1;
+    if (a.slotNum != b.slotNum) return a.slotNum < b.slotNum ? -1 : 1;
+    return 0;
+}
+int BPlusTree::compareCompositeSlots(const BPlusTree* tree, const unsigned int* a, const unsigned int* b,
+                                     int parts) {
+    return tree->compareParts(a, b, parts);
+}
+// 组合键的各列按类型对应的比较逐段进行，只比较前 parts 列
+int BPlusTree::compareParts(const unsigned int* a, const unsigned int* b, int parts) const {
+    int n = std::min(parts, (int)keyParts.size());
+    int pos = 0;
+    for (int i = 0; i < n; i++) {
+        KeyType t = keyParts[i].type;
+        int width = partInts(keyParts[i]);
+        if (pos + width > keyInts) break;
+        int c;
+        if (t == KeyType::INT) {
+            c = IntKeyTraits::compareSlots(a + pos, b + pos);
+        } else if (t == KeyType::FLOAT) {
+            c = FloatKeyTraits::compareSlots(a + pos, b + pos);
+        } else {
+            c = VarcharKeyTraits::compareSlots(a + pos, b + pos);
         }
-        if (!done && leaf.nextLeaf != -1) {
-            leaf = readNode(leaf.nextLeaf);
+        if (c != 0) return c;
+        pos += width;
+    }
+    return 0;
+}
+// 逐列比较；key 的列数少于索引定义时只比较前缀，前缀相同即视为相等
+int BPlusTree::compareKey(const unsigned int* slot, const CompositeKey& key) {
+    int pos = 0;
+    int kpos = 0;
+    for (int i = 0; i < key.partCount() && i < (int)keyParts.size(); i++) {
+        int width = partInts(keyParts[i]);
+        if (pos + width > keyInts) break;
+        int c;
+        if (keyParts[i].type == KeyType::INT) {
+            c = compareKey(slot + pos, static_cast<int>(key.words[kpos]));
+            kpos++;
+        } else if (keyParts[i].type == KeyType::FLOAT) {
+            float f;
+            memcpy(&f, &key.words[kpos], sizeof(float));
+            c = compareKey(slot + pos, f);
+            kpos++;
         } else {
-            break;
+            int len = slot[pos];
+            int klen = std::min((int)key.words[kpos], (width - 1) * 4);
+            c = memcmp(slot + pos + 1, &key.words[kpos + 1], std::min(len, klen));
+            if (c == 0) c = len - klen;
+            kpos += 1 + ((int)key.words[kpos] + 3) / 4;
         }
+        if (c != 0) return c < 0 ? -1 : 1;
+        pos += width;
     }
-    return result;
+    return 0;
+}
+int BPlusTree::searchNode(const BPlusPage& node, int key, bool upper) {
+    return KeySearch::searchInt(reinterpret_cast<const int*>(node.key(0)), node.keyCount(), key, upper);
+}
+int BPlusTree::searchNode(const BPlusPage& node, float key, bool upper) {
+    return KeySearch::searchFloat(reinterpret_cast<const float*>(node.key(0)), node.keyCount(), key, upper);
+}
+int BPlusTree::searchNode(const BPlusPage& node, const std::string& key, bool upper) {
+    if (node.varKeys) {
+        return searchVarNode(node, (const unsigned char*)key.data(), (int)key.length(), upper);
+    }
+    return binarySearch(node, key, upper);
+}
+int BPlusTree::searchNode(const BPlusPage& node, const CompositeKey& key, bool upper) {
+    if (node.varKeys) {
+        unsigned char bytes[BP_MAX_KEY_INTS * 4];
+        int len = normalize(key, bytes);
+        return searchVarNode(node, bytes, len, upper);
+    }
+    return binarySearch(node, key, upper);
 }
-void BPlusTree::deleteFromLeaf(BPlusTreeNode& leaf, int key) {
+// 两个 VARCHAR 槽位的公共前缀字节数
+static int slotPrefix(const unsigned int* a, const unsigned int* b) {
+    const unsigned char* x = (const unsigned char*)(a + 1);
+    const unsigned char* y = (const unsigned char*)(b + 1);
+    int n = std::min((int)a[0], (int)b[0]);
     int i = 0;
-    while (i < leaf.keyCount && leaf.keys[i] != key) {
-        i++;
+    while (i < n && x[i] == y[i]) i++;
+    return i;
+}
+// 键去掉节点前缀后的部分与 key 比较；prefixMatch 时 key 是它的前缀即视为相等
+static int compareSuffix(const unsigned int* suffix, const unsigned char* key, int len, bool prefixMatch) {
+    int slen = suffix[0];
+    if (prefixMatch && slen > len) slen = len;
+    return VarcharKeyTraits::compareBytes((const unsigned char*)(suffix + 1), slen, key, len);
+}
+// 变长节点的第 i 个键与 key 比较：先比公共前缀，再比去掉前缀后的部分
+int BPlusTree::compareVarEntry(const BPlusPage& node, int i, const unsigned char* key, int len) {
+    int plen = node.prefixLen();
+    int c = memcmp(node.prefix(), key, std::min(plen, len));
+    if (c != 0) return c < 0 ? -1 : 1;
+    // key 比节点前缀还短：VARCHAR 键小于所有条目，组合键的前缀与所有条目相等
+    if (len < plen) return normalizedKeys() ? 0 : 1;
+    return compareSuffix(node.suffix(i), key + plen, len - plen, normalizedKeys());
+}
+// 节点内所有键共用前缀，key 与前缀不同时直接落在节点的一端
+int BPlusTree::searchVarNode(const BPlusPage& node, const unsigned char* key, int len, bool upper) {
+    int n = node.keyCount();
+    int plen = node.prefixLen();
+    int c = memcmp(node.prefix(), key, std::min(plen, len));
+    bool prefixMatch = normalizedKeys();
+    if (c == 0 && len < plen) return prefixMatch && upper ? n : 0;
+    if (c > 0) return 0;
+    if (c < 0) return n;
+    const unsigned char* rest = key + plen;
+    int restLen = len - plen;
+    int lo = 0;
+    int hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int r = compareSuffix(node.suffix(mid), rest, restLen, prefixMatch);
+        if (r < 0 || (upper && r == 0)) lo = mid + 1;
+        else hi = mid;
     }
-    if (i < leaf.keyCount) {
-        leaf.keys.erase(leaf.keys.begin() + i);
-        leaf.rids.erase(leaf.rids.begin() + i);
-        leaf.keyCount--;
+    return lo;
+}
+int BPlusTree::compareEntry(const BPlusPage& node, int i, const std::string& key) {
+    if (node.varKeys) {
+        return compareVarEntry(node, i, (const unsigned char*)key.data(), (int)key.length());
     }
+    return compareKey(node.key(i), key);
 }
-bool BPlusTree::remove(int key) {
-    if (keyType != KeyType::INT || rootPage == -1) return false;
-    int leafPage = findLeaf(key);
-    if (leafPage == -1) return false;
-    BPlusTreeNode leaf = readNode(leafPage);
-    bool found = false;
-    for (int i = 0; i < leaf.keyCount; i++) {
-        if (leaf.keys[i] == key) {
-            found = true;
-            break;
-        }
+int BPlusTree::compareEntry(const BPlusPage& node, int i, const CompositeKey& key) {
+    if (node.varKeys) {
+        unsigned char bytes[BP_MAX_KEY_INTS * 4];
+        int len = normalize(key, bytes);
+        return compareVarEntry(node, i, bytes, len);
     }
-    if (!found) return false;
-    deleteFromLeaf(leaf, key);
-    int index;
-    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    headerPage[6]--;
-    bufPageManager->markDirty(index);
-    if (leaf.keyCount == 0) {
-        if (leaf.pageNum == rootPage) {
-            rootPage = -1;
-            firstLeaf = -1;
-            updateHeader();
-        } else {
-            redistributeOrMerge(leaf);
-        }
-    } else {
-        writeNode(leaf);
-        if (leaf.parent != -1) {
-        }
+    return compareKey(node.key(i), key);
+}
+int BPlusTree::compareEntrySlot(const BPlusPage& node, int i, const unsigned int* slot, int parts) {
+    if (node.varKeys) {
+        return compareVarEntry(node, i, (const unsigned char*)(slot + 1), (int)slot[0]);
     }
-    return true;
+    return compareSlots(node.key(i), slot, parts);
 }
-void BPlusTree::redistributeOrMerge(BPlusTreeNode& node) {
-    if (node.keyCount > 0) {
-        writeNode(node);
+const unsigned int* BPlusTree::entryKey(const BPlusPage& node, int i, unsigned int* buf) {
+    if (!node.varKeys) {
+        return node.key(i);
     }
+    int plen = node.prefixLen();
+    const unsigned int* suffix = node.suffix(i);
+    memset(buf, 0, keyInts * sizeof(unsigned int));
+    buf[0] = plen + suffix[0];
+    memcpy(buf + 1, node.prefix(), plen);
+    memcpy((unsigned char*)(buf + 1) + plen, suffix + 1, suffix[0]);
+    return buf;
 }
-void BPlusTree::mergeNodes(BPlusTreeNode& left, BPlusTreeNode& right) {
-    for (int i = 0; i < right.keyCount; i++) {
-        if (keyType == KeyType::INT) {
-            left.keys.push_back(right.keys[i]);
-        } else if (keyType == KeyType::FLOAT) {
-            left.floatKeys.push_back(right.floatKeys[i]);
-        } else {
-            left.strKeys.push_back(right.strKeys[i]);
-        }
-        if (left.isLeaf) {
-            left.rids.push_back(right.rids[i]);
-        } else {
-            left.children.push_back(right.children[i]);
-        }
-        left.keyCount++;
+template <typename K>
+int BPlusTree::binarySearch(const BPlusPage& node, const K& key, bool upper) {
+    int lo = 0;
+    int hi = node.keyCount();
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = compareKey(node.key(mid), key);
+        if (c < 0 || (upper && c == 0)) lo = mid + 1;
+        else hi = mid;
     }
-    if (!left.isLeaf && !right.children.empty()) {
-        left.children.push_back(right.children.back());
+    return lo;
+}
+template <typename K>
+int BPlusTree::searchEntry(const BPlusPage& node, const K& key, const RID& rid, bool upper) {
+    int lo = lowerBound(node, key);
+    int hi = upperBound(node, key);
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int c = compareRid(node.entryRid(mid), rid);
+        if (c < 0 || (upper && c == 0)) lo = mid + 1;
+        else hi = mid;
     }
-    if (left.isLeaf) {
-        left.nextLeaf = right.nextLeaf;
+    return lo;
+}
+template <typename K>
+int BPlusTree::childFor(const BPlusPage& node, const K& key, const RID* rid) {
+    if (rid != nullptr && !unique) {
+        return node.child(searchEntry(node, key, *rid, true));
     }
-    writeNode(left);
+    // 重复键可能跨越分隔键落在左侧子树，非唯一树和前缀查找从最左的候选子树开始
+    return node.child(leftmostDescent(key) ? lowerBound(node, key) : upperBound(node, key));
 }
-
-void BPlusTree::redistributeNodes(BPlusTreeNode& left, BPlusTreeNode& right, bool leftToRight) {
+template <typename K>
+int BPlusTree::findLeaf(const K& key) {
+    if (rootPage == -1) return -1;
+    int currentPage = rootPage;
+    BPlusPage node = getNode(currentPage);
+    path.clear();
+    while (!node.isLeaf()) {
+        path.push_back(currentPage);
+        currentPage = childFor(node, key, nullptr);
+        node = getNode(currentPage);
+    }
+    return currentPage;
 }
-int BPlusTree::compareKeys(float key1, float key2) {
-    if (key1 < key2) return -1;
-    if (key1 > key2) return 1;
-    return 0;
+template <typename K>
+int BPlusTree::findLeaf(const K& key, const RID& rid) {
+    if (unique) return findLeaf(key);
+    if (rootPage == -1) return -1;
+    int currentPage = rootPage;
+    BPlusPage node = getNode(currentPage);
+    path.clear();
+    while (!node.isLeaf()) {
+        path.push_back(currentPage);
+        currentPage = childFor(node, key, &rid);
+        node = getNode(currentPage);
+    }
+    return currentPage;
 }
-int BPlusTree::findLeaf(float key) {
+template <typename K>
+int BPlusTree::findLastLeaf(const K& key) {
     if (rootPage == -1) return -1;
     int currentPage = rootPage;
-    BPlusTreeNode node = readNode(currentPage);
-    while (!node.isLeaf) {
-        int i = 0;
-        while (i < node.keyCount && key >= node.floatKeys[i]) {
-            i++;
-        }
-        currentPage = node.children[i];
-        node = readNode(currentPage);
+    BPlusPage node = getNode(currentPage);
+    while (!node.isLeaf()) {
+        currentPage = node.child(upperBound(node, key));
+        node = getNode(currentPage);
     }
     return currentPage;
 }
-void BPlusTree::insertIntoLeaf(BPlusTreeNode& leaf, float key, const RID& rid) {
-    int i = 0;
-    while (i < leaf.keyCount && leaf.floatKeys[i] < key) {
-        i++;
+int BPlusTree::lastLeaf() {
+    if (rootPage == -1) return -1;
+    int currentPage = rootPage;
+    BPlusPage node = getNode(currentPage);
+    while (!node.isLeaf()) {
+        currentPage = node.child(node.keyCount());
+        node = getNode(currentPage);
+    }
+    return currentPage;
+}
+void BPlusTree::insertIntoParent(BPlusPage& left, const unsigned int* sepKey, const RID& sepRid,
+                                 BPlusPage& right) {
+    if (varKeys) {
+        varInsertIntoParent(left, sepKey, sepRid, right);
+        return;
     }
-    leaf.floatKeys.insert(leaf.floatKeys.begin() + i, key);
-    leaf.rids.insert(leaf.rids.begin() + i, rid);
-    leaf.keyCount++;
-}
-void BPlusTree::insertIntoParent(BPlusTreeNode& left, float key, BPlusTreeNode& right) {
-    if (left.parent == -1) {
-        int newRootPage = allocateNewPage();
-        BPlusTreeNode newRoot;
-        newRoot.pageNum = newRootPage;
-        newRoot.isLeaf = false;
-        newRoot.keyCount = 1;
-        newRoot.parent = -1;
-        newRoot.floatKeys.push_back(key);
-        newRoot.children.push_back(left.pageNum);
-        newRoot.children.push_back(right.pageNum);
-        writeNode(newRoot);
-        left.parent = newRootPage;
-        right.parent = newRootPage;
-        writeNode(left);
-        writeNode(right);
-        rootPage = newRootPage;
+    if (path.empty()) {
+        BPlusPage newRoot = newNode(false);
+        memcpy(newRoot.key(0), sepKey, keyInts * sizeof(unsigned int));
+        if (!unique) {
+            newRoot.setSepRid(0, sepRid);
+        }
+        newRoot.setChild(0, left.pageNum);
+        newRoot.setChild(1, right.pageNum);
+        newRoot.setKeyCount(1);
+        if (counted) {
+            newRoot.setSubtreeCount(0, nodeTotal(left));
+            newRoot.setSubtreeCount(1, nodeTotal(right));
+        }
+        rootPage = newRoot.pageNum;
         updateHeader();
         return;
     }
-    BPlusTreeNode parent = readNode(left.parent);
+    BPlusPage parent = getNode(path.back());
+    int n = parent.keyCount();
     int i = 0;
-    while (i < (int)parent.children.size() && parent.children[i] != left.pageNum) {
+    while (i <= n && parent.child(i) != left.pageNum) {
         i++;
     }
-    parent.floatKeys.insert(parent.floatKeys.begin() + i, key);
-    parent.children.insert(parent.children.begin() + i + 1, right.pageNum);
-    parent.keyCount++;
-    right.parent = parent.pageNum;
-    writeNode(right);
-    if (parent.keyCount >= order) {
-        writeNode(parent);
-    } else {
-        writeNode(parent);
+    // 插入新键和子指针
+    memmove(parent.key(i + 1), parent.key(i), (n - i) * keyInts * sizeof(unsigned int));
+    memcpy(parent.key(i), sepKey, keyInts * sizeof(unsigned int));
+    memmove(parent.data + internalValueBase + i + 2, parent.data + internalValueBase + i + 1,
+            (n - i) * sizeof(unsigned int));
+    parent.setChild(i + 1, right.pageNum);
+    if (!unique) {
+        memmove(parent.data + sepRidBase + 2 * (i + 1), parent.data + sepRidBase + 2 * i,
+                (n - i) * 2 * sizeof(unsigned int));
+        parent.setSepRid(i, sepRid);
+    }
+    if (counted) {
+        memmove(parent.data + internalCountBase + i + 2, parent.data + internalCountBase + i + 1,
+                (n - i) * sizeof(unsigned int));
+        parent.setSubtreeCount(i, nodeTotal(left));
+        parent.setSubtreeCount(i + 1, nodeTotal(right));
+    }
+    parent.setKeyCount(n + 1);
+    bufPageManager->markDirty(parent.bufIndex);
+    // 检查是否需要分裂，父节点的分隔键插到路径上的上一层
+    if (parent.keyCount() >= internalOrder) {
+        path.pop_back();
+        splitInternal(parent);
     }
 }
-bool BPlusTree::insert(float key, const RID& rid) {
-    if (keyType != KeyType::FLOAT) return false;
+void BPlusTree::splitLeaf(BPlusPage& leaf) {
+    int n = leaf.keyCount();
+    // 顺序追加时左页按 BP_BULK_FILL 装满，只把末尾几项分给新的最右叶子
+    int mid = rightAppend ? std::max(1, std::min(n - 1, n * BP_BULK_FILL / 100)) : n / 2;
+    BPlusPage newLeaf = newNode(true);
+    newLeaf.setNextLeaf(leaf.nextLeaf());
+    newLeaf.setPrevLeaf(leaf.pageNum);
+    memcpy(newLeaf.key(0), leaf.key(mid), (n - mid) * keyInts * sizeof(unsigned int));
+    memcpy(newLeaf.data + leafValueBase, leaf.data + leafValueBase + 2 * mid,
+           (n - mid) * 2 * sizeof(unsigned int));
+    newLeaf.setKeyCount(n - mid);
+    leaf.setKeyCount(mid);
+    leaf.setNextLeaf(newLeaf.pageNum);
+    if (newLeaf.nextLeaf() != -1) {
+        BPlusPage nextNode = getNode(newLeaf.nextLeaf());
+        nextNode.setPrevLeaf(newLeaf.pageNum);
+        bufPageManager->markDirty(nextNode.bufIndex);
+    }
+    bufPageManager->markDirty(leaf.bufIndex);
+    bufPageManager->markDirty(newLeaf.bufIndex);
+    unsigned int sepKey[BP_MAX_KEY_INTS];
+    memcpy(sepKey, newLeaf.key(0), keyInts * sizeof(unsigned int));
+    insertIntoParent(leaf, sepKey, newLeaf.rid(0), newLeaf);
+}
+void BPlusTree::splitInternal(BPlusPage& node) {
+    int n = node.keyCount();
+    int mid = rightAppend ? std::max(1, std::min(n - 2, n * BP_BULK_FILL / 100)) : n / 2;
+    unsigned int midKey[BP_MAX_KEY_INTS];
+    memcpy(midKey, node.key(mid), keyInts * sizeof(unsigned int));
+    RID midRid = unique ? RID() : node.sepRid(mid);
+    BPlusPage newInternal = newNode(false);
+    int moved = n - mid - 1;
+    memcpy(newInternal.key(0), node.key(mid + 1), moved * keyInts * sizeof(unsigned int));
+    memcpy(newInternal.data + internalValueBase, node.data + internalValueBase + mid + 1,
+           (moved + 1) * sizeof(unsigned int));
+    if (!unique) {
+        memcpy(newInternal.data + sepRidBase, node.data + sepRidBase + 2 * (mid + 1),
+               moved * 2 * sizeof(unsigned int));
+    }
+    if (counted) {
+        memcpy(newInternal.data + internalCountBase, node.data + internalCountBase + mid + 1,
+               (moved + 1) * sizeof(unsigned int));
+    }
+    newInternal.setKeyCount(moved);
+    node.setKeyCount(mid);
+    bufPageManager->markDirty(node.bufIndex);
+    bufPageManager->markDirty(newInternal.bufIndex);
+    insertIntoParent(node, midKey, midRid, newInternal);
+}
+template <typename K>
+bool BPlusTree::insertImpl(const K& key, const RID& rid) {
+    if (!matchesType(keyType, key)) return false;
     if (rootPage == -1) {
-        int newPageNum = allocateNewPage();
-        BPlusTreeNode leaf;
-        leaf.pageNum = newPageNum;
-        leaf.isLeaf = true;
-        leaf.keyCount = 1;
-        leaf.parent = -1;
-        leaf.nextLeaf = -1;
-        leaf.prevLeaf = -1;
-        leaf.floatKeys.push_back(key);
-        leaf.rids.push_back(rid);
-        writeNode(leaf);
-        rootPage = newPageNum;
-        firstLeaf = newPageNum;
+        BPlusPage leaf = newNode(true);
+        rootPage = leaf.pageNum;
+        firstLeaf = leaf.pageNum;
+        if (varKeys) {
+            unsigned int slot[BP_MAX_KEY_INTS];
+            storeKey(slot, key);
+            varInsertLeaf(leaf, 0, slot, rid);
+        } else {
+            storeKey(leaf.key(0), key);
+            leaf.setRid(0, rid);
+            leaf.setKeyCount(1);
+        }
         updateHeader();
-        int index;
-        BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-        headerPage[6]++;
-        bufPageManager->markDirty(index);
+        addRecordCount(1);
         return true;
     }
-    int leafPage = findLeaf(key);
-    BPlusTreeNode leaf = readNode(leafPage);
-    insertIntoLeaf(leaf, key, rid);
-    int index;
-    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    headerPage[6]++;
-    bufPageManager->markDirty(index);
-    if (leaf.keyCount >= order) {
-        writeNode(leaf);
+    BPlusPage leaf;
+    int n;
+    int i;
+    if (appendsAtEnd(key, rid, leaf)) {
+        // 大于最右叶子的最后一项，不必从根下降
+        path = appendPath;
+        n = leaf.keyCount();
+        i = n;
     } else {
-        writeNode(leaf);
+        leaf = getNode(findLeaf(key, rid));
+        n = leaf.keyCount();
+        if (unique) {
+            i = lowerBound(leaf, key);
+            if (i < n && compareEntry(leaf, i, key) == 0) {
+                return false;  // 键已存在
+            }
+        } else {
+            i = searchEntry(leaf, key, rid, false);
+            if (i < n && compareEntry(leaf, i, key) == 0 && leaf.rid(i) == rid) {
+                return false;  // 同一条目已存在
+            }
+        }
+        // 落在最右叶子的末尾时记下这条路径，之后递增的键直接追加
+        if (i == n && leaf.nextLeaf() == -1) {
+            appendLeaf = leaf.pageNum;
+            appendPath = path;
+        }
+    }
+    rightAppend = (i == n && leaf.nextLeaf() == -1);
+    addPathCount(leaf.pageNum, 1);
+    if (varKeys) {
+        unsigned int slot[BP_MAX_KEY_INTS];
+        storeKey(slot, key);
+        addRecordCount(1);
+        varInsertLeaf(leaf, i, slot, rid);
+        rightAppend = false;
+        return true;
     }
+    placeInLeaf(leaf, i, key, rid);
+    bufPageManager->markDirty(leaf.bufIndex);
+    addRecordCount(1);
+    if (leaf.keyCount() >= order) {
+        splitLeaf(leaf);
+    }
+    rightAppend = false;
     return true;
 }
-
-bool BPlusTree::search(float key, RID& rid) {
-    if (keyType != KeyType::FLOAT || rootPage == -1) return false;
+// 定长布局：把条目放到叶子的第 i 项，不检查是否需要分裂
+template <typename K>
+void BPlusTree::placeInLeaf(BPlusPage& leaf, int i, const K& key, const RID& rid) {
+    int n = leaf.keyCount();
+    memmove(leaf.key(i + 1), leaf.key(i), (n - i) * keyInts * sizeof(unsigned int));
+    memmove(leaf.data + leafValueBase + 2 * (i + 1), leaf.data + leafValueBase + 2 * i,
+            (n - i) * 2 * sizeof(unsigned int));
+    storeKey(leaf.key(i), key);
+    leaf.setRid(i, rid);
+    leaf.setKeyCount(n + 1);
+}
+template <typename K>
+bool BPlusTree::appendsAtEnd(const K& key, const RID& rid, BPlusPage& leaf) {
+    if (appendLeaf == -1) return false;
+    leaf = getNode(appendLeaf);
+    int n = leaf.keyCount();
+    if (!leaf.isLeaf() || leaf.nextLeaf() != -1 || n == 0) {
+        appendLeaf = -1;
+        return false;
+    }
+    int c = compareEntry(leaf, n - 1, key);
+    return c < 0 || (c == 0 && !unique && compareRid(leaf.rid(n - 1), rid) < 0);
+}
+template <typename K>
+bool BPlusTree::searchImpl(const K& key, RID& rid) {
+    if (!matchesType(keyType, key) || rootPage == -1) return false;
     int leafPage = findLeaf(key);
     if (leafPage == -1) return false;
-    BPlusTreeNode leaf = readNode(leafPage);
-    for (int i = 0; i < leaf.keyCount; i++) {
-        if (leaf.floatKeys[i] == key) {
-            rid = leaf.rids[i];
-            return true;
-        }
+    BPlusPage leaf = getNode(leafPage);
+    int i = lowerBound(leaf, key);
+    // 从最左候选叶子开始时，第一个匹配项可能在后继叶子里
+    while (leftmostDescent(key) && i >= leaf.keyCount() && leaf.nextLeaf() != -1) {
+        leaf = getNode(leaf.nextLeaf());
+        i = lowerBound(leaf, key);
+    }
+    if (i < leaf.keyCount() && compareEntry(leaf, i, key) == 0) {
+        rid = leaf.rid(i);
+        return true;
     }
     return false;
 }
-std::vector<RID> BPlusTree::rangeSearch(float lowKey, float highKey, bool includeLow, bool includeHigh) {
+template <typename K>
+std::vector<RID> BPlusTree::rangeSearchImpl(const K& lowKey, const K& highKey,
+                                            bool includeLow, bool includeHigh) {
     std::vector<RID> result;
-    if (keyType != KeyType::FLOAT || rootPage == -1) return result;
-    int leafPage = findLeaf(lowKey);
-    if (leafPage == -1) return result;
-    BPlusTreeNode leaf = readNode(leafPage);
-    bool done = false;
-    while (!done && leaf.pageNum != -1) {
-        for (int i = 0; i < leaf.keyCount; i++) {
-            float k = leaf.floatKeys[i];
-            bool aboveLow = includeLow ? (k >= lowKey) : (k > lowKey);
-            bool belowHigh = includeHigh ? (k <= highKey) : (k < highKey);
-            if (!belowHigh) {
-                done = true;
-                break;
-            }
-            if (aboveLow && belowHigh) {
-                result.push_back(leaf.rids[i]);
-            }
-        }
-        if (!done && leaf.nextLeaf != -1) {
-            leaf = readNode(leaf.nextLeaf);
-        } else {
-            break;
-        }
+    for (BPlusCursor c = openCursor(&lowKey, &highKey, includeLow, includeHigh); c.valid(); c.next()) {
+        result.push_back(c.rid());
     }
     return result;
 }
-void BPlusTree::deleteFromLeaf(BPlusTreeNode& leaf, float key) {
-    int i = 0;
-    while (i < leaf.keyCount && leaf.floatKeys[i] != key) {
-        i++;
+template <typename K>
+BPlusCursor BPlusTree::openCursor(const K* lowKey, const K* highKey, bool includeLow, bool includeHigh,
+                                  bool backward) {
+    BPlusCursor cursor;
+    cursor.tree = this;
+    cursor.backward = backward;
+    cursor.includeLow = includeLow;
+    cursor.includeHigh = includeHigh;
+    if (rootPage == -1 || (lowKey && !matchesType(keyType, *lowKey)) ||
+        (highKey && !matchesType(keyType, *highKey))) {
+        return cursor;
     }
-    if (i < leaf.keyCount) {
-        leaf.floatKeys.erase(leaf.floatKeys.begin() + i);
-        leaf.rids.erase(leaf.rids.begin() + i);
-        leaf.keyCount--;
+    cursor.boundParts = BP_MAX_KEY_PARTS;
+    if (lowKey) {
+        cursor.hasLow = true;
+        cursor.low.resize(keyInts);
+        storeKey(cursor.low.data(), *lowKey);
+        cursor.boundParts = partCount(*lowKey);
     }
-}
-bool BPlusTree::remove(float key) {
-    if (keyType != KeyType::FLOAT || rootPage == -1) return false;
-    int leafPage = findLeaf(key);
-    if (leafPage == -1) return false;
-    BPlusTreeNode leaf = readNode(leafPage);
-    bool found = false;
-    for (int i = 0; i < leaf.keyCount; i++) {
-        if (leaf.floatKeys[i] == key) {
-            found = true;
-            break;
-        }
+    if (highKey) {
+        cursor.hasHigh = true;
+        cursor.high.resize(keyInts);
+        storeKey(cursor.high.data(), *highKey);
+        cursor.boundParts = std::min(cursor.boundParts, partCount(*highKey));
     }
-    if (!found) return false;
-    deleteFromLeaf(leaf, key);
-    int index;
-    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    headerPage[6]--;
-    bufPageManager->markDirty(index);
-    writeNode(leaf);
-    return true;
+    if (!backward) {
+        cursor.page = lowKey ? findLeaf(*lowKey) : firstLeaf;
+        BPlusPage leaf = getNode(cursor.page);
+        cursor.pos = !lowKey ? 0 : (includeLow ? lowerBound(leaf, *lowKey) : upperBound(leaf, *lowKey));
+    } else {
+        cursor.page = highKey ? findLastLeaf(*highKey) : lastLeaf();
+        BPlusPage leaf = getNode(cursor.page);
+        cursor.pos = (!highKey ? leaf.keyCount() : (includeHigh ? upperBound(leaf, *highKey)
+                                                                : lowerBound(leaf, *highKey))) - 1;
+    }
+    prefetchLeaf(cursor.page);
+    // 起点一侧是开区间时，与界相等的条目可能跨越多个叶子，先整体跳过再判界
+    bool skipLow = !backward && lowKey && !includeLow;
+    bool skipHigh = backward && highKey && !includeHigh;
+    cursor.hasLow = cursor.hasLow && !skipLow;
+    cursor.hasHigh = cursor.hasHigh && !skipHigh;
+    while (settleCursor(cursor) && (skipLow || skipHigh)) {
+        int c = compareEntrySlot(cursorLeaf(cursor), cursor.pos,
+                                 skipLow ? cursor.low.data() : cursor.high.data(), cursor.boundParts);
+        if (c != 0) break;
+        cursor.pos += backward ? -1 : 1;
+    }
+    cursor.hasLow = (lowKey != nullptr);
+    cursor.hasHigh = (highKey != nullptr);
+    cursor.checkedPage = -1;
+    return cursor;
 }
-int BPlusTree::compareKeys(const std::string& key1, const std::string& key2) {
-    return key1.compare(key2);
+template BPlusCursor BPlusTree::openCursor<int>(const int*, const int*, bool, bool, bool);
+template BPlusCursor BPlusTree::openCursor<float>(const float*, const float*, bool, bool, bool);
+template BPlusCursor BPlusTree::openCursor<std::string>(const std::string*, const std::string*, bool, bool, bool);
+template BPlusCursor BPlusTree::openCursor<CompositeKey>(const CompositeKey*, const CompositeKey*, bool, bool, bool);
+BPlusCursor BPlusTree::openCursor(bool backward) {
+    return openCursor<int>(nullptr, nullptr, true, true, backward);
 }
-int BPlusTree::findLeaf(const std::string& key) {
-    if (rootPage == -1) return -1;
-    int currentPage = rootPage;
-    BPlusTreeNode node = readNode(currentPage);
-    while (!node.isLeaf) {
-        int i = 0;
-        while (i < node.keyCount && key >= node.strKeys[i]) {
-            i++;
+template <typename K>
+long long BPlusTree::rankOf(const K& key, bool upper) {
+    long long rank = 0;
+    BPlusPage node = getNode(rootPage);
+    while (!node.isLeaf()) {
+        // 第 i 个子树左边的子树里全是小于 key（upper 时为不大于 key）的条目
+        int i = upper ? upperBound(node, key) : lowerBound(node, key);
+        for (int j = 0; j < i; j++) {
+            rank += node.subtreeCount(j);
         }
-        currentPage = node.children[i];
-        node = readNode(currentPage);
+        node = getNode(node.child(i));
     }
-    return currentPage;
+    return rank + (upper ? upperBound(node, key) : lowerBound(node, key));
 }
-void BPlusTree::insertIntoLeaf(BPlusTreeNode& leaf, const std::string& key, const RID& rid) {
-    int i = 0;
-    while (i < leaf.keyCount && leaf.strKeys[i] < key) {
-        i++;
-    }
-    leaf.strKeys.insert(leaf.strKeys.begin() + i, key);
-    leaf.rids.insert(leaf.rids.begin() + i, rid);
-    leaf.keyCount++;
-}
-void BPlusTree::insertIntoParent(BPlusTreeNode& left, const std::string& key, BPlusTreeNode& right) {
-    if (left.parent == -1) {
-        int newRootPage = allocateNewPage();    
-        BPlusTreeNode newRoot;
-        newRoot.pageNum = newRootPage;
-        newRoot.isLeaf = false;
-        newRoot.keyCount = 1;
-        newRoot.parent = -1;
-        newRoot.strKeys.push_back(key);
-        newRoot.children.push_back(left.pageNum);
-        newRoot.children.push_back(right.pageNum);
-        writeNode(newRoot);
-        left.parent = newRootPage;
-        right.parent = newRootPage;
-        writeNode(left);
-        writeNode(right);
-        rootPage = newRootPage;
-        updateHeader();
-        return;
+template <typename K>
+long long BPlusTree::countRange(const K* lowKey, const K* highKey, bool includeLow, bool includeHigh) {
+    if (rootPage == -1 || (lowKey && !matchesType(keyType, *lowKey)) ||
+        (highKey && !matchesType(keyType, *highKey))) {
+        return 0;
     }
-    BPlusTreeNode parent = readNode(left.parent);
-    int i = 0;
-    while (i < (int)parent.children.size() && parent.children[i] != left.pageNum) {
-        i++;
+    if (!counted) {
+        long long count = 0;
+        for (BPlusCursor cursor = openCursor(lowKey, highKey, includeLow, includeHigh); cursor.valid();
+             cursor.next()) {
+            count++;
+        }
+        return count;
     }
-    parent.strKeys.insert(parent.strKeys.begin() + i, key);
-    parent.children.insert(parent.children.begin() + i + 1, right.pageNum);
-    parent.keyCount++;
-    right.parent = parent.pageNum;
-    writeNode(right);
-    writeNode(parent);
+    long long high = highKey ? rankOf(*highKey, includeHigh) : nodeTotal(getNode(rootPage));
+    long long low = lowKey ? rankOf(*lowKey, !includeLow) : 0;
+    return std::max(0LL, high - low);
 }
-bool BPlusTree::insert(const std::string& key, const RID& rid) {
-    if (keyType != KeyType::VARCHAR) return false;
-    if (rootPage == -1) {
-        int newPageNum = allocateNewPage();
-        BPlusTreeNode leaf;
-        leaf.pageNum = newPageNum;
-        leaf.isLeaf = true;
-        leaf.keyCount = 1;
-        leaf.parent = -1;
-        leaf.nextLeaf = -1;
-        leaf.prevLeaf = -1;
-        leaf.strKeys.push_back(key);
-        leaf.rids.push_back(rid);
-        writeNode(leaf);
-        rootPage = newPageNum;
-        firstLeaf = newPageNum;
-        updateHeader();
-        int index;
-        BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-        headerPage[6]++;
-        bufPageManager->markDirty(index);
+template long long BPlusTree::countRange<int>(const int*, const int*, bool, bool);
+template long long BPlusTree::countRange<float>(const float*, const float*, bool, bool);
+template long long BPlusTree::countRange<std::string>(const std::string*, const std::string*, bool, bool);
+template long long BPlusTree::countRange<CompositeKey>(const CompositeKey*, const CompositeKey*, bool, bool);
+// 位置越出当前叶子时沿叶子链移到相邻叶子，再检查是否越过范围的界
+bool BPlusTree::settleCursor(BPlusCursor& cursor) {
+    if (cursor.page == -1) return false;
+    BPlusPage leaf = cursorLeaf(cursor);
+    while (cursor.pos >= leaf.keyCount() || cursor.pos < 0) {
+        int next = (cursor.pos < 0) ? leaf.prevLeaf() : leaf.nextLeaf();
+        if (next == -1) {
+            cursor.page = -1;
+            return false;
+        }
+        bool forward = cursor.pos >= 0;
+        leaf = getNode(next);
+        cursor.leaf = leaf;
+        cursor.page = next;
+        cursor.pos = forward ? 0 : leaf.keyCount() - 1;
+        prefetchLeaf(forward ? leaf.nextLeaf() : leaf.prevLeaf());
+    }
+    // 叶子首尾两项都在界内时整个叶子都在界内，在这个叶子里不再逐条判界
+    if (cursor.checkedPage != cursor.page || cursor.checkedCount != leaf.keyCount()) {
+        cursor.checkedPage = cursor.page;
+        cursor.checkedCount = leaf.keyCount();
+        cursor.wholeLeaf = withinBounds(cursor, leaf, 0) && withinBounds(cursor, leaf, leaf.keyCount() - 1);
+    }
+    if (cursor.wholeLeaf || withinBounds(cursor, leaf, cursor.pos)) {
         return true;
     }
-    int leafPage = findLeaf(key);
-    BPlusTreeNode leaf = readNode(leafPage);
-    insertIntoLeaf(leaf, key, rid);
-    int index;
-    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    headerPage[6]++;
-    bufPageManager->markDirty(index);
-    writeNode(leaf);
+    cursor.page = -1;
+    return false;
+}
+bool BPlusTree::withinBounds(const BPlusCursor& cursor, const BPlusPage& leaf, int i) {
+    if (cursor.hasHigh) {
+        int c = compareEntrySlot(leaf, i, cursor.high.data(), cursor.boundParts);
+        if (c > 0 || (c == 0 && !cursor.includeHigh)) return false;
+    }
+    if (cursor.hasLow) {
+        int c = compareEntrySlot(leaf, i, cursor.low.data(), cursor.boundParts);
+        if (c < 0 || (c == 0 && !cursor.includeLow)) return false;
+    }
     return true;
 }
-bool BPlusTree::search(const std::string& key, RID& rid) {
-    if (keyType != KeyType::VARCHAR || rootPage == -1) return false;
+const BPlusPage& BPlusTree::cursorLeaf(const BPlusCursor& cursor) {
+    if (cursor.leaf.data) {
+        int f, p;
+        bufPageManager->getKey(cursor.leaf.bufIndex, f, p);
+        if (f == fileID && p == cursor.page) return cursor.leaf;
+    }
+    cursor.leaf = getNode(cursor.page);
+    return cursor.leaf;
+}
+// 叶子不在缓存中时让系统先异步读入，等游标走到时直接命中页缓存
+void BPlusTree::prefetchLeaf(int pageNum) {
+    if (pageNum <= 0 || bufPageManager->hash->findIndex(fileID, pageNum) != -1) return;
+    fileManager->prefetchPage(fileID, pageNum);
+}
+RID BPlusCursor::rid() const {
+    return tree->cursorLeaf(*this).rid(pos);
+}
+const unsigned int* BPlusCursor::key() const {
+    keyBuf.resize(tree->keyInts);
+    return tree->entryKey(tree->cursorLeaf(*this), pos, keyBuf.data());
+}
+// 在已判定整体在界内的叶子里移动时不用取页、不用判界
+bool BPlusCursor::next() {
+    if (page == -1) return false;
+    pos++;
+    if (wholeLeaf && checkedPage == page && pos < checkedCount) return true;
+    return tree->settleCursor(*this);
+}
+bool BPlusCursor::prev() {
+    if (page == -1) return false;
+    pos--;
+    if (wholeLeaf && checkedPage == page && pos >= 0) return true;
+    return tree->settleCursor(*this);
+}
+template <typename K>
+bool BPlusTree::removeImpl(const K& key) {
+    if (!matchesType(keyType, key) || rootPage == -1) return false;
+    if (!unique) {
+        // 删除第一个匹配的条目
+        RID rid;
+        if (!searchImpl(key, rid)) return false;
+        return removeImpl(key, rid);
+    }
     int leafPage = findLeaf(key);
     if (leafPage == -1) return false;
-    BPlusTreeNode leaf = readNode(leafPage);
-    for (int i = 0; i < leaf.keyCount; i++) {
-        if (leaf.strKeys[i] == key) {
-            rid = leaf.rids[i];
-            return true;
+    BPlusPage leaf = getNode(leafPage);
+    int i = lowerBound(leaf, key);
+    if (i >= leaf.keyCount() || compareEntry(leaf, i, key) != 0) return false;
+    eraseFromLeaf(leaf, i);
+    return true;
+}
+template <typename K>
+bool BPlusTree::removeImpl(const K& key, const RID& rid) {
+    if (unique) return removeImpl(key);
+    if (!matchesType(keyType, key) || rootPage == -1) return false;
+    int leafPage = findLeaf(key, rid);
+    if (leafPage == -1) return false;
+    BPlusPage leaf = getNode(leafPage);
+    int i = searchEntry(leaf, key, rid, false);
+    if (i >= leaf.keyCount() || compareEntry(leaf, i, key) != 0 || leaf.rid(i) != rid) {
+        return false;
+    }
+    eraseFromLeaf(leaf, i);
+    return true;
+}
+void BPlusTree::eraseFromLeaf(BPlusPage& leaf, int i) {
+    addPathCount(leaf.pageNum, -1);
+    if (varKeys) {
+        varEraseFromLeaf(leaf, i);
+        return;
+    }
+    int n = leaf.keyCount();
+    dropFromLeaf(leaf, i);
+    bufPageManager->markDirty(leaf.bufIndex);
+    addRecordCount(-1);
+    if (leaf.pageNum == rootPage) {
+        if (n - 1 == 0) {
+            freeNode(leaf.pageNum);
+            rootPage = -1;
+            firstLeaf = -1;
+            updateHeader();
         }
+        return;
+    }
+    if (n - 1 < (order - 1) / 2) {
+        rebalanceLeaf(leaf);
     }
-    return false;
 }
-std::vector<RID> BPlusTree::rangeSearch(const std::string& lowKey, const std::string& highKey,
-                                         bool includeLow, bool includeHigh) {
-    std::vector<RID> result;
-    if (keyType != KeyType::VARCHAR || rootPage == -1) return result;
-    int leafPage = findLeaf(lowKey);
-    if (leafPage == -1) return result;
-    BPlusTreeNode leaf = readNode(leafPage);
-    bool done = false;
-    while (!done && leaf.pageNum != -1) {
-        for (int i = 0; i < leaf.keyCount; i++) {
-            const std::string& k = leaf.strKeys[i];
-            bool aboveLow = includeLow ? (k >= lowKey) : (k > lowKey);
-            bool belowHigh = includeHigh ? (k <= highKey) : (k < highKey);
-            if (!belowHigh) {
-                done = true;
+void BPlusTree::dropFromLeaf(BPlusPage& leaf, int i) {
+    int n = leaf.keyCount();
+    if (varKeys) {
+        const unsigned int* suffix = leaf.suffix(i);
+        leaf.data[BP_GARBAGE_OFFSET] += 1 + (suffix[0] + 3) / 4;
+        memmove(leaf.data + leaf.keyBase + 3 * i, leaf.data + leaf.keyBase + 3 * (i + 1),
+                3 * (n - i - 1) * sizeof(unsigned int));
+    } else {
+        memmove(leaf.key(i), leaf.key(i + 1), (n - i - 1) * keyInts * sizeof(unsigned int));
+        memmove(leaf.data + leafValueBase + 2 * i, leaf.data + leafValueBase + 2 * (i + 1),
+                (n - i - 1) * 2 * sizeof(unsigned int));
+    }
+    leaf.setKeyCount(n - 1);
+}
+// 删去第 i 项后是否要借、合并，或者根叶子被删空要回收，条件同 eraseFromLeaf / varEraseFromLeaf
+bool BPlusTree::underflowsAfterErase(const BPlusPage& leaf, int i) {
+    int n = leaf.keyCount();
+    if (leaf.pageNum == rootPage) return n == 1;
+    if (!varKeys) return n - 1 < (order - 1) / 2;
+    int freed = 3 + 1 + ((int)leaf.suffix(i)[0] + 3) / 4;
+    return varUsedInts(leaf) - freed < PAGE_INT_NUM * BP_VAR_MIN_FILL / 100;
+}
+int BPlusTree::childIndex(const BPlusPage& parent, int childPage) {
+    int n = parent.keyCount();
+    int i = 0;
+    while (i < n && parent.child(i) != childPage) {
+        i++;
+    }
+    return i;
+}
+long long BPlusTree::nodeTotal(const BPlusPage& node) {
+    if (node.isLeaf()) return node.keyCount();
+    long long total = 0;
+    for (int i = 0; i <= node.keyCount(); i++) {
+        total += node.subtreeCount(i);
+    }
+    return total;
+}
+void BPlusTree::addPathCount(int leafPage, int delta) {
+    if (!counted) return;
+    int child = leafPage;
+    for (int j = (int)path.size() - 1; j >= 0; j--) {
+        BPlusPage parent = getNode(path[j]);
+        int i = childIndex(parent, child);
+        parent.setSubtreeCount(i, parent.subtreeCount(i) + delta);
+        bufPageManager->markDirty(parent.bufIndex);
+        child = parent.pageNum;
+    }
+}
+void BPlusTree::refreshCount(BPlusPage& parent, int i) {
+    if (!counted) return;
+    BPlusPage child = getNode(parent.child(i));
+    parent.setSubtreeCount(i, nodeTotal(child));
+    bufPageManager->markDirty(parent.bufIndex);
+}
+void BPlusTree::rebalanceLeaf(BPlusPage& leaf) {
+    BPlusPage parent = getNode(path.back());
+    int idx = childIndex(parent, leaf.pageNum);
+    int minKeys = (order - 1) / 2;
+    if (idx > 0) {
+        // 向左兄弟借最后一项，分隔键改为本节点新的第一项
+        BPlusPage left = getNode(parent.child(idx - 1));
+        int ln = left.keyCount();
+        if (ln > minKeys) {
+            int n = leaf.keyCount();
+            memmove(leaf.key(1), leaf.key(0), n * keyInts * sizeof(unsigned int));
+            memmove(leaf.data + leafValueBase + 2, leaf.data + leafValueBase, n * 2 * sizeof(unsigned int));
+            memcpy(leaf.key(0), left.key(ln - 1), keyInts * sizeof(unsigned int));
+            leaf.setRid(0, left.rid(ln - 1));
+            leaf.setKeyCount(n + 1);
+            left.setKeyCount(ln - 1);
+            memcpy(parent.key(idx - 1), leaf.key(0), keyInts * sizeof(unsigned int));
+            if (!unique) {
+                parent.setSepRid(idx - 1, leaf.rid(0));
+            }
+            refreshCount(parent, idx - 1);
+            refreshCount(parent, idx);
+            bufPageManager->markDirty(left.bufIndex);
+            bufPageManager->markDirty(leaf.bufIndex);
+            bufPageManager->markDirty(parent.bufIndex);
+            return;
+        }
+    }
+    if (idx < parent.keyCount()) {
+        // 向右兄弟借第一项，分隔键改为右兄弟新的第一项
+        BPlusPage right = getNode(parent.child(idx + 1));
+        int rn = right.keyCount();
+        if (rn > minKeys) {
+            int n = leaf.keyCount();
+            memcpy(leaf.key(n), right.key(0), keyInts * sizeof(unsigned int));
+            leaf.setRid(n, right.rid(0));
+            leaf.setKeyCount(n + 1);
+            memmove(right.key(0), right.key(1), (rn - 1) * keyInts * sizeof(unsigned int));
+            memmove(right.data + leafValueBase, right.data + leafValueBase + 2, (rn - 1) * 2 * sizeof(unsigned int));
+            right.setKeyCount(rn - 1);
+            memcpy(parent.key(idx), right.key(0), keyInts * sizeof(unsigned int));
+            if (!unique) {
+                parent.setSepRid(idx, right.rid(0));
+            }
+            refreshCount(parent, idx);
+            refreshCount(parent, idx + 1);
+            bufPageManager->markDirty(right.bufIndex);
+            bufPageManager->markDirty(leaf.bufIndex);
+            bufPageManager->markDirty(parent.bufIndex);
+            return;
+        }
+    }
+    // 两边都借不到，说明兄弟也只有下限个数，合并后一定放得下
+    if (idx > 0) {
+        BPlusPage left = getNode(parent.child(idx - 1));
+        mergeLeaves(left, leaf, parent, idx - 1);
+    } else if (idx < parent.keyCount()) {
+        BPlusPage right = getNode(parent.child(idx + 1));
+        mergeLeaves(leaf, right, parent, idx);
+    }
+}
+void BPlusTree::rebalanceInternal(BPlusPage& node) {
+    BPlusPage parent = getNode(path.back());
+    int idx = childIndex(parent, node.pageNum);
+    int minKeys = (internalOrder - 1) / 2;
+    if (idx > 0) {
+        // 右旋：父节点的分隔键下移到本节点最前，左兄弟的最后一个键上移
+        BPlusPage left = getNode(parent.child(idx - 1));
+        int ln = left.keyCount();
+        if (ln > minKeys) {
+            int n = node.keyCount();
+            memmove(node.key(1), node.key(0), n * keyInts * sizeof(unsigned int));
+            memmove(node.data + internalValueBase + 1, node.data + internalValueBase, (n + 1) * sizeof(unsigned int));
+            memcpy(node.key(0), parent.key(idx - 1), keyInts * sizeof(unsigned int));
+            node.setChild(0, left.child(ln));
+            memcpy(parent.key(idx - 1), left.key(ln - 1), keyInts * sizeof(unsigned int));
+            if (!unique) {
+                memmove(node.data + sepRidBase + 2, node.data + sepRidBase, n * 2 * sizeof(unsigned int));
+                node.setSepRid(0, parent.sepRid(idx - 1));
+                parent.setSepRid(idx - 1, left.sepRid(ln - 1));
+            }
+            if (counted) {
+                memmove(node.data + internalCountBase + 1, node.data + internalCountBase,
+                        (n + 1) * sizeof(unsigned int));
+                node.setSubtreeCount(0, left.subtreeCount(ln));
+            }
+            node.setKeyCount(n + 1);
+            left.setKeyCount(ln - 1);
+            refreshCount(parent, idx - 1);
+            refreshCount(parent, idx);
+            bufPageManager->markDirty(left.bufIndex);
+            bufPageManager->markDirty(node.bufIndex);
+            bufPageManager->markDirty(parent.bufIndex);
+            return;
+        }
+    }
+    if (idx < parent.keyCount()) {
+        // 左旋：父节点的分隔键下移到本节点末尾，右兄弟的第一个键上移
+        BPlusPage right = getNode(parent.child(idx + 1));
+        int rn = right.keyCount();
+        if (rn > minKeys) {
+            int n = node.keyCount();
+            memcpy(node.key(n), parent.key(idx), keyInts * sizeof(unsigned int));
+            node.setChild(n + 1, right.child(0));
+            memcpy(parent.key(idx), right.key(0), keyInts * sizeof(unsigned int));
+            if (!unique) {
+                node.setSepRid(n, parent.sepRid(idx));
+                parent.setSepRid(idx, right.sepRid(0));
+                memmove(right.data + sepRidBase, right.data + sepRidBase + 2, (rn - 1) * 2 * sizeof(unsigned int));
+            }
+            memmove(right.key(0), right.key(1), (rn - 1) * keyInts * sizeof(unsigned int));
+            memmove(right.data + internalValueBase, right.data + internalValueBase + 1, rn * sizeof(unsigned int));
+            if (counted) {
+                node.setSubtreeCount(n + 1, right.subtreeCount(0));
+                memmove(right.data + internalCountBase, right.data + internalCountBase + 1, rn * sizeof(unsigned int));
+            }
+            node.setKeyCount(n + 1);
+            right.setKeyCount(rn - 1);
+            refreshCount(parent, idx);
+            refreshCount(parent, idx + 1);
+            bufPageManager->markDirty(right.bufIndex);
+            bufPageManager->markDirty(node.bufIndex);
+            bufPageManager->markDirty(parent.bufIndex);
+            return;
+        }
+    }
+    if (idx > 0) {
+        BPlusPage left = getNode(parent.child(idx - 1));
+        mergeInternal(left, node, parent, idx - 1);
+    } else if (idx < parent.keyCount()) {
+        BPlusPage right = getNode(parent.child(idx + 1));
+        mergeInternal(node, right, parent, idx);
+    }
+}
+// right 的条目接到 left 之后，right 从叶子链上摘下并回收
+void BPlusTree::mergeLeaves(BPlusPage& left, BPlusPage& right, BPlusPage& parent, int sepIdx) {
+    int ln = left.keyCount();
+    int rn = right.keyCount();
+    memcpy(left.key(ln), right.key(0), rn * keyInts * sizeof(unsigned int));
+    memcpy(left.data + leafValueBase + 2 * ln, right.data + leafValueBase, rn * 2 * sizeof(unsigned int));
+    left.setKeyCount(ln + rn);
+    left.setNextLeaf(right.nextLeaf());
+    bufPageManager->markDirty(left.bufIndex);
+    if (right.nextLeaf() != -1) {
+        BPlusPage next = getNode(right.nextLeaf());
+        next.setPrevLeaf(left.pageNum);
+        bufPageManager->markDirty(next.bufIndex);
+    }
+    refreshCount(parent, sepIdx);
+    freeNode(right.pageNum);
+    removeSeparator(parent, sepIdx);
+}
+// 父节点的分隔键下移，与 right 的键和子节点一起接到 left 之后
+void BPlusTree::mergeInternal(BPlusPage& left, BPlusPage& right, BPlusPage& parent, int sepIdx) {
+    int ln = left.keyCount();
+    int rn = right.keyCount();
+    memcpy(left.key(ln), parent.key(sepIdx), keyInts * sizeof(unsigned int));
+    memcpy(left.key(ln + 1), right.key(0), rn * keyInts * sizeof(unsigned int));
+    memcpy(left.data + internalValueBase + ln + 1, right.data + internalValueBase, (rn + 1) * sizeof(unsigned int));
+    if (!unique) {
+        left.setSepRid(ln, parent.sepRid(sepIdx));
+        memcpy(left.data + sepRidBase + 2 * (ln + 1), right.data + sepRidBase, rn * 2 * sizeof(unsigned int));
+    }
+    if (counted) {
+        memcpy(left.data + internalCountBase + ln + 1, right.data + internalCountBase,
+               (rn + 1) * sizeof(unsigned int));
+    }
+    left.setKeyCount(ln + 1 + rn);
+    bufPageManager->markDirty(left.bufIndex);
+    refreshCount(parent, sepIdx);
+    freeNode(right.pageNum);
+    removeSeparator(parent, sepIdx);
+}
+// 删去父节点的第 sepIdx 个分隔键及其右侧子指针；根变空时树降低一层
+void BPlusTree::removeSeparator(BPlusPage& parent, int sepIdx) {
+    int n = parent.keyCount();
+    memmove(parent.key(sepIdx), parent.key(sepIdx + 1), (n - sepIdx - 1) * keyInts * sizeof(unsigned int));
+    memmove(parent.data + internalValueBase + sepIdx + 1, parent.data + internalValueBase + sepIdx + 2,
+            (n - sepIdx - 1) * sizeof(unsigned int));
+    if (!unique) {
+        memmove(parent.data + sepRidBase + 2 * sepIdx, parent.data + sepRidBase + 2 * (sepIdx + 1),
+                (n - sepIdx - 1) * 2 * sizeof(unsigned int));
+    }
+    if (counted) {
+        memmove(parent.data + internalCountBase + sepIdx + 1, parent.data + internalCountBase + sepIdx + 2,
+                (n - sepIdx - 1) * sizeof(unsigned int));
+    }
+    parent.setKeyCount(n - 1);
+    bufPageManager->markDirty(parent.bufIndex);
+    if (parent.pageNum == rootPage) {
+        if (n - 1 == 0) {
+            rootPage = parent.child(0);
+            freeNode(parent.pageNum);
+            updateHeader();
+        }
+        return;
+    }
+    if (n - 1 < (internalOrder - 1) / 2) {
+        path.pop_back();
+        rebalanceInternal(parent);
+    }
+}
+// 解码后的变长节点：每个键一个完整槽位；内部节点的子页号比键多一个
+struct BPlusTree::VarImage {
+    bool leaf;
+    int keyInts;
+    std::vector<unsigned int> keys;
+    std::vector<RID> rids;          // 叶子的 RID / 内部节点分隔键的 RID
+    std::vector<int> children;
+    std::vector<unsigned int> counts;   // 与 children 一一对应的子树条目数
+
+    int count() const { return (int)rids.size(); }
+    long long total() const {
+        if (leaf) return count();
+        long long sum = 0;
+        for (unsigned int c : counts) sum += c;
+        return sum;
+    }
+    const unsigned int* key(int i) const { return &keys[(size_t)i * keyInts]; }
+    void insert(int i, const unsigned int* slot, const RID& rid) {
+        keys.insert(keys.begin() + (size_t)i * keyInts, slot, slot + keyInts);
+        rids.insert(rids.begin() + i, rid);
+    }
+    void erase(int i) {
+        keys.erase(keys.begin() + (size_t)i * keyInts, keys.begin() + (size_t)(i + 1) * keyInts);
+        rids.erase(rids.begin() + i);
+    }
+    void setKey(int i, const unsigned int* slot, const RID& rid) {
+        memcpy(&keys[(size_t)i * keyInts], slot, keyInts * sizeof(unsigned int));
+        rids[i] = rid;
+    }
+};
+int BPlusTree::varUsedInts(const BPlusPage& node) const {
+    int dirBase = node.isLeaf() ? node.keyBase : node.valueBase;
+    int entries = node.keyCount() + (node.isLeaf() ? 0 : 1);
+    return dirBase + node.valueStride * entries + (PAGE_INT_NUM - (int)node.data[BP_HEAP_OFFSET]) -
+           (int)node.data[BP_GARBAGE_OFFSET];
+}
+void BPlusTree::readImage(const BPlusPage& node, VarImage& img) {
+    int n = node.keyCount();
+    img.leaf = node.isLeaf();
+    img.keyInts = keyInts;
+    img.keys.resize((size_t)n * keyInts);
+    img.rids.resize(n);
+    img.children.clear();
+    img.counts.clear();
+    for (int i = 0; i < n; i++) {
+        entryKey(node, i, &img.keys[(size_t)i * keyInts]);
+        img.rids[i] = img.leaf ? node.rid(i) : (unique ? RID() : node.sepRid(i));
+    }
+    if (!img.leaf) {
+        for (int i = 0; i <= n; i++) {
+            img.children.push_back(node.child(i));
+            img.counts.push_back(counted ? node.subtreeCount(i) : 0);
+        }
+    }
+}
+// 把 [from, to) 这些键（内部节点连同子页号 [from, to]）写成一个节点需要的 int 数
+int BPlusTree::imageInts(const VarImage& img, int from, int to) {
+    int n = to - from;
+    int ints = BP_HEADER_SIZE + varStride(img.leaf) * (n + (img.leaf ? 0 : 1));
+    if (n == 0) return ints;
+    int plen = slotPrefix(img.key(from), img.key(to - 1));
+    ints += (plen + 3) / 4;
+    for (int i = from; i < to; i++) {
+        ints += 1 + ((int)img.key(i)[0] - plen + 3) / 4;
+    }
+    return ints;
+}
+// 整页重写：公共前缀重新计算，键区顺序排好，回收已删除键的空间；页头的类型、父节点和叶子链不变
+void BPlusTree::writeImage(BPlusPage& node, const VarImage& img, int from, int to) {
+    int n = to - from;
+    int plen = n > 0 ? slotPrefix(img.key(from), img.key(to - 1)) : 0;
+    node.data[BP_PREFIX_LEN_OFFSET] = plen;
+    memset(node.data + BP_HEADER_SIZE, 0, (plen + 3) / 4 * sizeof(unsigned int));
+    if (n > 0) {
+        memcpy(node.data + BP_HEADER_SIZE, img.key(from) + 1, plen);
+    }
+    setLayout(node);
+    int heap = PAGE_INT_NUM;
+    for (int i = 0; i < n; i++) {
+        const unsigned int* slot = img.key(from + i);
+        int len = (int)slot[0] - plen;
+        int width = 1 + (len + 3) / 4;
+        heap -= width;
+        node.data[heap + width - 1] = 0;
+        node.data[heap] = len;
+        memcpy(node.data + heap + 1, (const unsigned char*)(slot + 1) + plen, len);
+        node.data[node.keyBase + node.valueStride * i] = heap;
+        if (img.leaf) {
+            node.setRid(i, img.rids[from + i]);
+        } else if (!unique) {
+            node.setSepRid(i, img.rids[from + i]);
+        }
+    }
+    if (!img.leaf) {
+        for (int i = 0; i <= n; i++) {
+            node.setChild(i, img.children[from + i]);
+            if (counted) node.setSubtreeCount(i, img.counts[from + i]);
+        }
+    }
+    node.setKeyCount(n);
+    node.data[BP_HEAP_OFFSET] = heap;
+    node.data[BP_GARBAGE_OFFSET] = 0;
+    bufPageManager->markDirty(node.bufIndex);
+}
+void BPlusTree::writeOrSplit(BPlusPage& node, const VarImage& img) {
+    if (imageFits(img, 0, img.count())) {
+        writeImage(node, img, 0, img.count());
+    } else {
+        varSplit(node, img);
+    }
+}
+void BPlusTree::shortSeparator(const unsigned int* left, const unsigned int* right, unsigned int* sep) {
+    int len = std::min((int)right[0], slotPrefix(left, right) + 1);
+    memset(sep, 0, keyInts * sizeof(unsigned int));
+    sep[0] = len;
+    memcpy(sep + 1, right + 1, len);
+}
+// 写不下的节点分成两页：分界点按键的字节数取中，两边各自的公共前缀可能变短，
+// 写不下时向两侧挪动分界点（插到节点一端的键让前缀变短时，分在新键旁边一定写得下）
+void BPlusTree::varSplit(BPlusPage& node, const VarImage& img) {
+    int n = img.count();
+    bool leaf = img.leaf;
+    int lo = 1;
+    int hi = leaf ? n - 1 : n - 2;
+    long long total = 0;
+    for (int i = 0; i < n; i++) total += img.key(i)[0];
+    int mid = lo;
+    long long acc = 0;
+    int fill = rightAppend ? BP_BULK_FILL : 50;
+    for (int i = 0; i < n; i++) {
+        acc += img.key(i)[0];
+        if (acc * 100 >= total * fill) {
+            mid = i + 1;
+            break;
+        }
+    }
+    mid = std::max(lo, std::min(mid, hi));
+    int m = mid;
+    for (int d = 0; mid - d >= lo || mid + d <= hi; d++) {
+        int cand[2] = {mid - d, mid + d};
+        bool found = false;
+        for (int c : cand) {
+            if (c < lo || c > hi) continue;
+            if (imageFits(img, 0, c) && imageFits(img, leaf ? c : c + 1, n)) {
+                m = c;
+                found = true;
                 break;
             }
-            if (aboveLow && belowHigh) {
-                result.push_back(leaf.rids[i]);
+        }
+        if (found) break;
+    }
+    if (leaf) {
+        BPlusPage right = newNode(true);
+        right.setNextLeaf(node.nextLeaf());
+        right.setPrevLeaf(node.pageNum);
+        writeImage(node, img, 0, m);
+        writeImage(right, img, m, n);
+        node.setNextLeaf(right.pageNum);
+        if (right.nextLeaf() != -1) {
+            BPlusPage next = getNode(right.nextLeaf());
+            next.setPrevLeaf(right.pageNum);
+            bufPageManager->markDirty(next.bufIndex);
+        }
+        bufPageManager->markDirty(node.bufIndex);
+        unsigned int sepKey[BP_MAX_KEY_INTS];
+        shortSeparator(img.key(m - 1), img.key(m), sepKey);
+        varInsertIntoParent(node, sepKey, img.rids[m], right);
+    } else {
+        BPlusPage right = newNode(false);
+        writeImage(node, img, 0, m);
+        writeImage(right, img, m + 1, n);
+        unsigned int midKey[BP_MAX_KEY_INTS];
+        memcpy(midKey, img.key(m), keyInts * sizeof(unsigned int));
+        varInsertIntoParent(node, midKey, img.rids[m], right);
+    }
+}
+// 与节点的公共前缀相同、空闲区放得下时直接插入
+bool BPlusTree::varInsertInPlace(BPlusPage& leaf, int i, const unsigned int* slot, const RID& rid) {
+    int n = leaf.keyCount();
+    int len = slot[0];
+    int plen = leaf.prefixLen();
+    const unsigned char* bytes = (const unsigned char*)(slot + 1);
+    if (n == 0 || len < plen || memcmp(bytes, leaf.prefix(), plen) != 0) return false;
+    int width = 1 + (len - plen + 3) / 4;
+    int dirEnd = leaf.keyBase + 3 * n;
+    int heap = leaf.data[BP_HEAP_OFFSET];
+    if (heap - width < dirEnd + 3) return false;
+    memmove(leaf.data + leaf.keyBase + 3 * (i + 1), leaf.data + leaf.keyBase + 3 * i,
+            3 * (n - i) * sizeof(unsigned int));
+    heap -= width;
+    leaf.data[heap + width - 1] = 0;
+    leaf.data[heap] = len - plen;
+    memcpy(leaf.data + heap + 1, bytes + plen, len - plen);
+    // 键写完再让目录指向它，并发的读者不会读到没写好的长度
+    std::atomic_thread_fence(std::memory_order_release);
+    leaf.data[leaf.keyBase + 3 * i] = heap;
+    leaf.setRid(i, rid);
+    leaf.data[BP_HEAP_OFFSET] = heap;
+    leaf.setKeyCount(n + 1);
+    return true;
+}
+void BPlusTree::varInsertLeaf(BPlusPage& leaf, int i, const unsigned int* slot, const RID& rid) {
+    // 放不下或前缀不同时整页重写或分裂
+    if (varInsertInPlace(leaf, i, slot, rid)) {
+        bufPageManager->markDirty(leaf.bufIndex);
+        return;
+    }
+    VarImage img;
+    readImage(leaf, img);
+    img.insert(i, slot, rid);
+    writeOrSplit(leaf, img);
+}
+void BPlusTree::varInsertIntoParent(BPlusPage& left, const unsigned int* sepKey, const RID& sepRid,
+                                    BPlusPage& right) {
+    VarImage img;
+    img.leaf = false;
+    img.keyInts = keyInts;
+    if (path.empty()) {
+        BPlusPage newRoot = newNode(false);
+        img.insert(0, sepKey, sepRid);
+        img.children.push_back(left.pageNum);
+        img.children.push_back(right.pageNum);
+        img.counts.push_back(counted ? nodeTotal(left) : 0);
+        img.counts.push_back(counted ? nodeTotal(right) : 0);
+        writeImage(newRoot, img, 0, 1);
+        rootPage = newRoot.pageNum;
+        updateHeader();
+        return;
+    }
+    BPlusPage parent = getNode(path.back());
+    int i = childIndex(parent, left.pageNum);
+    readImage(parent, img);
+    img.insert(i, sepKey, sepRid);
+    img.children.insert(img.children.begin() + i + 1, right.pageNum);
+    img.counts.insert(img.counts.begin() + i + 1, counted ? nodeTotal(right) : 0);
+    if (counted) img.counts[i] = nodeTotal(left);
+    path.pop_back();
+    writeOrSplit(parent, img);
+}
+void BPlusTree::varEraseFromLeaf(BPlusPage& leaf, int i) {
+    int n = leaf.keyCount();
+    dropFromLeaf(leaf, i);
+    bufPageManager->markDirty(leaf.bufIndex);
+    addRecordCount(-1);
+    if (leaf.pageNum == rootPage) {
+        if (n - 1 == 0) {
+            freeNode(leaf.pageNum);
+            rootPage = -1;
+            firstLeaf = -1;
+            updateHeader();
+        }
+        return;
+    }
+    if (varUsedInts(leaf) < PAGE_INT_NUM * BP_VAR_MIN_FILL / 100) {
+        varRebalance(leaf);
+    }
+}
+// 与定长布局相同的顺序：先向左右兄弟借一项，再尝试合并；变长键借完或合并后可能写不下，
+// 这时放弃这一步，节点暂时低于下限也不影响查找
+void BPlusTree::varRebalance(BPlusPage& node) {
+    BPlusPage parent = getNode(path.back());
+    int idx = childIndex(parent, node.pageNum);
+    int minInts = PAGE_INT_NUM * BP_VAR_MIN_FILL / 100;
+    bool leaf = node.isLeaf();
+    VarImage pimg;
+    VarImage nimg;
+    readImage(parent, pimg);
+    readImage(node, nimg);
+    unsigned int sepKey[BP_MAX_KEY_INTS];
+    if (idx > 0) {
+        BPlusPage left = getNode(parent.child(idx - 1));
+        VarImage limg;
+        readImage(left, limg);
+        int ln = limg.count();
+        if (ln > 1) {
+            VarImage l2 = limg;
+            VarImage n2 = nimg;
+            VarImage p2 = pimg;
+            if (leaf) {
+                n2.insert(0, limg.key(ln - 1), limg.rids[ln - 1]);
+                l2.erase(ln - 1);
+                shortSeparator(l2.key(ln - 2), n2.key(0), sepKey);
+                p2.setKey(idx - 1, sepKey, n2.rids[0]);
+            } else {
+                n2.insert(0, pimg.key(idx - 1), pimg.rids[idx - 1]);
+                n2.children.insert(n2.children.begin(), limg.children[ln]);
+                n2.counts.insert(n2.counts.begin(), limg.counts[ln]);
+                p2.setKey(idx - 1, limg.key(ln - 1), limg.rids[ln - 1]);
+                l2.erase(ln - 1);
+                l2.children.pop_back();
+                l2.counts.pop_back();
+            }
+            p2.counts[idx - 1] = l2.total();
+            p2.counts[idx] = n2.total();
+            if (imageInts(l2, 0, l2.count()) >= minInts && imageFits(n2, 0, n2.count()) &&
+                imageFits(p2, 0, p2.count())) {
+                writeImage(left, l2, 0, l2.count());
+                writeImage(node, n2, 0, n2.count());
+                writeImage(parent, p2, 0, p2.count());
+                return;
             }
         }
-        if (!done && leaf.nextLeaf != -1) {
-            leaf = readNode(leaf.nextLeaf);
-        } else {
+    }
+    if (idx < parent.keyCount()) {
+        BPlusPage right = getNode(parent.child(idx + 1));
+        VarImage rimg;
+        readImage(right, rimg);
+        int rn = rimg.count();
+        if (rn > 1) {
+            VarImage r2 = rimg;
+            VarImage n2 = nimg;
+            VarImage p2 = pimg;
+            int n = nimg.count();
+            if (leaf) {
+                n2.insert(n, rimg.key(0), rimg.rids[0]);
+                r2.erase(0);
+                shortSeparator(n2.key(n), r2.key(0), sepKey);
+                p2.setKey(idx, sepKey, r2.rids[0]);
+            } else {
+                n2.insert(n, pimg.key(idx), pimg.rids[idx]);
+                n2.children.push_back(rimg.children[0]);
+                n2.counts.push_back(rimg.counts[0]);
+                p2.setKey(idx, rimg.key(0), rimg.rids[0]);
+                r2.erase(0);
+                r2.children.erase(r2.children.begin());
+                r2.counts.erase(r2.counts.begin());
+            }
+            p2.counts[idx] = n2.total();
+            p2.counts[idx + 1] = r2.total();
+            if (imageInts(r2, 0, r2.count()) >= minInts && imageFits(n2, 0, n2.count()) &&
+                imageFits(p2, 0, p2.count())) {
+                writeImage(right, r2, 0, r2.count());
+                writeImage(node, n2, 0, n2.count());
+                writeImage(parent, p2, 0, p2.count());
+                return;
+            }
+        }
+    }
+    // 合并：右边的节点接到左边节点之后（内部节点中间夹上父节点的分隔键），右边的页回收
+    int sepIdx = idx > 0 ? idx - 1 : idx;
+    if (sepIdx >= parent.keyCount()) return;
+    BPlusPage left = idx > 0 ? getNode(parent.child(idx - 1)) : node;
+    BPlusPage right = idx > 0 ? node : getNode(parent.child(idx + 1));
+    VarImage merged;
+    VarImage rimg;
+    readImage(left, merged);
+    readImage(right, rimg);
+    int ln = merged.count();
+    if (!leaf) {
+        merged.insert(ln, pimg.key(sepIdx), pimg.rids[sepIdx]);
+    }
+    merged.keys.insert(merged.keys.end(), rimg.keys.begin(), rimg.keys.end());
+    merged.rids.insert(merged.rids.end(), rimg.rids.begin(), rimg.rids.end());
+    merged.children.insert(merged.children.end(), rimg.children.begin(), rimg.children.end());
+    merged.counts.insert(merged.counts.end(), rimg.counts.begin(), rimg.counts.end());
+    if (!imageFits(merged, 0, merged.count())) return;
+    writeImage(left, merged, 0, merged.count());
+    if (leaf) {
+        left.setNextLeaf(right.nextLeaf());
+        bufPageManager->markDirty(left.bufIndex);
+        if (right.nextLeaf() != -1) {
+            BPlusPage next = getNode(right.nextLeaf());
+            next.setPrevLeaf(left.pageNum);
+            bufPageManager->markDirty(next.bufIndex);
+        }
+    }
+    refreshCount(parent, sepIdx);
+    freeNode(right.pageNum);
+    varRemoveSeparator(parent, sepIdx);
+}
+void BPlusTree::varRemoveSeparator(BPlusPage& parent, int sepIdx) {
+    VarImage img;
+    readImage(parent, img);
+    img.erase(sepIdx);
+    img.children.erase(img.children.begin() + sepIdx + 1);
+    img.counts.erase(img.counts.begin() + sepIdx + 1);
+    writeImage(parent, img, 0, img.count());
+    if (parent.pageNum == rootPage) {
+        if (img.count() == 0) {
+            rootPage = parent.child(0);
+            freeNode(parent.pageNum);
+            updateHeader();
+        }
+        return;
+    }
+    if (varUsedInts(parent) < PAGE_INT_NUM * BP_VAR_MIN_FILL / 100) {
+        path.pop_back();
+        varRebalance(parent);
+    }
+}
+bool BPlusTree::setConcurrent(bool on) {
+    if (on == concurrent) return true;
+    if (!on) {
+        bufPageManager->unpinPage(pinnedHeaderIndex);
+        pinnedHeader = nullptr;
+        concurrent = false;
+        return true;
+    }
+    if (bufPageManager->capacity < BP_CONCURRENT_MIN_FRAMES) return false;
+    pinnedHeader = bufPageManager->pinPage(fileID, 0, pinnedHeaderIndex);
+    if (!pinnedHeader) return false;
+    filter.reset();
+    concurrent = true;
+    return true;
+}
+// 缓存页面都被钉住时 data 为空，调用方放掉已钉住的页面后从头重试
+BPlusPage BPlusTree::pinNode(int pageNum) {
+    BPlusPage node;
+    node.data = bufPageManager->pinPage(fileID, pageNum, node.bufIndex);
+    node.pageNum = pageNum;
+    node.keyInts = keyInts;
+    if (node.data) setLayout(node);
+    return node;
+}
+void BPlusTree::unpinAll(std::vector<BPlusPage>& nodes) {
+    for (const BPlusPage& node : nodes) {
+        unpinNode(node);
+    }
+    nodes.clear();
+}
+unsigned long long BPlusTree::readLatch(const BPlusPage& node) {
+    std::atomic<unsigned long long>& latch = bufPageManager->versions[node.bufIndex];
+    unsigned long long version = latch.load(std::memory_order_acquire);
+    while (version & 1) {
+        std::this_thread::yield();
+        version = latch.load(std::memory_order_acquire);
+    }
+    return version;
+}
+bool BPlusTree::validLatch(const BPlusPage& node, unsigned long long version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return bufPageManager->versions[node.bufIndex].load(std::memory_order_relaxed) == version;
+}
+void BPlusTree::lockLatch(const BPlusPage& node) {
+    std::atomic<unsigned long long>& latch = bufPageManager->versions[node.bufIndex];
+    for (;;) {
+        unsigned long long version = readLatch(node);
+        if (latch.compare_exchange_weak(version, version + 1, std::memory_order_acquire)) break;
+    }
+    // 之后对页面的改写不能早于加锁被读者看到
+    std::atomic_thread_fence(std::memory_order_release);
+}
+void BPlusTree::unlockLatch(const BPlusPage& node) {
+    bufPageManager->versions[node.bufIndex].fetch_add(1, std::memory_order_release);
+}
+bool BPlusTree::structureStable(unsigned long long version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return structureVersion.load(std::memory_order_relaxed) == version;
+}
+template <typename Op>
+bool BPlusTree::exclusively(Op op) {
+    std::unique_lock<std::shared_mutex> writer(structureLatch);
+    std::lock_guard<std::mutex> buffer(bufPageManager->latch);
+    structureVersion.fetch_add(1, std::memory_order_relaxed);  // 奇数：结构修改中
+    std::atomic_thread_fence(std::memory_order_release);
+    bool ok = op();
+    structureVersion.fetch_add(1, std::memory_order_release);
+    return ok;
+}
+template <typename K>
+bool BPlusTree::pinPath(const K& key, const RID* rid, std::vector<BPlusPage>& nodes,
+                        unsigned long long version) {
+    int page = rootPage.load(std::memory_order_acquire);
+    if (page == -1) return structureStable(version);
+    for (;;) {
+        // 子页号要在确认结构没变之后才能用
+        if (!structureStable(version) || page <= 0) {
+            unpinAll(nodes);
+            return false;
+        }
+        BPlusPage node = pinNode(page);
+        if (!node.data) {
+            unpinAll(nodes);
+            return false;
+        }
+        nodes.push_back(node);
+        if (node.isLeaf()) return true;
+        page = childFor(node, key, rid);
+    }
+}
+template <typename K>
+int BPlusTree::trySearch(const K& key, RID& rid, unsigned long long version) {
+    std::vector<BPlusPage> nodes;
+    if (!pinPath(key, nullptr, nodes, version)) return -1;
+    if (nodes.empty()) return 0;
+    BPlusPage leaf = nodes.back();
+    int status;
+    for (;;) {
+        unsigned long long latch = readLatch(leaf);
+        int n = leaf.keyCount();
+        int i = lowerBound(leaf, key);
+        int next = leaf.nextLeaf();
+        // 从最左候选叶子开始时，第一个匹配项可能在后继叶子里
+        bool walk = leftmostDescent(key) && i >= n && next != -1;
+        bool found = !walk && i < n && compareEntry(leaf, i, key) == 0;
+        RID entry = found ? leaf.rid(i) : RID();
+        if (!validLatch(leaf, latch) || !structureStable(version)) {
+            status = -1;
+            break;
+        }
+        if (!walk) {
+            if (found) rid = entry;
+            status = found ? 1 : 0;
             break;
         }
+        leaf = pinNode(next);
+        if (!leaf.data) {
+            status = -1;
+            break;
+        }
+        nodes.push_back(leaf);
     }
-    return result;
+    unpinAll(nodes);
+    return status;
 }
-void BPlusTree::deleteFromLeaf(BPlusTreeNode& leaf, const std::string& key) {
-    int i = 0;
-    while (i < leaf.keyCount && leaf.strKeys[i] != key) {
-        i++;
+template <typename K>
+bool BPlusTree::searchConcurrent(const K& key, RID& rid) {
+    if (!matchesType(keyType, key)) return false;
+    std::shared_lock<std::shared_mutex> shared(structureLatch, std::defer_lock);
+    if (varKeys) shared.lock();
+    for (;;) {
+        unsigned long long version = structureVersion.load(std::memory_order_acquire);
+        if (version & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        int status = trySearch(key, rid, version);
+        if (status >= 0) return status == 1;
     }
-    if (i < leaf.keyCount) {
-        leaf.strKeys.erase(leaf.strKeys.begin() + i);
-        leaf.rids.erase(leaf.rids.begin() + i);
-        leaf.keyCount--;
+}
+// 不改结构时路径上的内部节点不会变，只有计数被并发地加减
+void BPlusTree::addPinnedCounts(std::vector<BPlusPage>& nodes, int delta) {
+    if (counted) {
+        for (int j = (int)nodes.size() - 2; j >= 0; j--) {
+            BPlusPage& parent = nodes[j];
+            int i = childIndex(parent, nodes[j + 1].pageNum);
+            __atomic_fetch_add(parent.data + parent.countBase + parent.countStride * i, (unsigned int)delta,
+                               __ATOMIC_RELAXED);
+            bufPageManager->markDirtyPinned(parent.bufIndex);
+        }
     }
+    __atomic_fetch_add(pinnedHeader + 6, (unsigned int)delta, __ATOMIC_RELAXED);
+    bufPageManager->markDirtyPinned(pinnedHeaderIndex);
+}
+template <typename K>
+int BPlusTree::tryLeafInsert(const K& key, const RID& rid) {
+    std::vector<BPlusPage> nodes;
+    if (!pinPath(key, &rid, nodes, structureVersion.load(std::memory_order_acquire)) || nodes.empty()) {
+        return -1;  // 空树由结构修改建根
+    }
+    BPlusPage& leaf = nodes.back();
+    lockLatch(leaf);
+    int n = leaf.keyCount();
+    int i;
+    bool exists;
+    if (unique) {
+        i = lowerBound(leaf, key);
+        exists = i < n && compareEntry(leaf, i, key) == 0;
+    } else {
+        i = searchEntry(leaf, key, rid, false);
+        exists = i < n && compareEntry(leaf, i, key) == 0 && leaf.rid(i) == rid;
+    }
+    int status = exists ? 0 : -1;
+    if (!exists) {
+        if (varKeys) {
+            unsigned int slot[BP_MAX_KEY_INTS];
+            storeKey(slot, key);
+            if (varInsertInPlace(leaf, i, slot, rid)) status = 1;
+        } else if (n + 1 < order) {
+            placeInLeaf(leaf, i, key, rid);
+            status = 1;
+        }
+        if (status == 1) bufPageManager->markDirtyPinned(leaf.bufIndex);
+    }
+    unlockLatch(leaf);
+    if (status == 1) addPinnedCounts(nodes, 1);
+    unpinAll(nodes);
+    return status;
+}
+template <typename K>
+int BPlusTree::tryLeafRemove(const K& key, const RID* rid) {
+    std::vector<BPlusPage> nodes;
+    if (!pinPath(key, rid, nodes, structureVersion.load(std::memory_order_acquire))) return -1;
+    if (nodes.empty()) return 0;
+    BPlusPage& leaf = nodes.back();
+    lockLatch(leaf);
+    int n = leaf.keyCount();
+    int i = unique ? lowerBound(leaf, key) : searchEntry(leaf, key, *rid, false);
+    int status = 0;
+    if (i < n && compareEntry(leaf, i, key) == 0 && (unique || leaf.rid(i) == *rid)) {
+        status = -1;
+        if (!underflowsAfterErase(leaf, i)) {
+            dropFromLeaf(leaf, i);
+            bufPageManager->markDirtyPinned(leaf.bufIndex);
+            status = 1;
+        }
+    }
+    unlockLatch(leaf);
+    if (status == 1) addPinnedCounts(nodes, -1);
+    unpinAll(nodes);
+    return status;
+}
+template <typename K>
+bool BPlusTree::insertConcurrent(const K& key, const RID& rid) {
+    if (!matchesType(keyType, key)) return false;
+    {
+        std::shared_lock<std::shared_mutex> shared(structureLatch);
+        int status = tryLeafInsert(key, rid);
+        if (status >= 0) return status == 1;
+    }
+    // 叶子要分裂（或树还是空的）：独占整棵树，按单线程的方式插入
+    return exclusively([&] { return insertImpl(key, rid); });
+}
+template <typename K>
+bool BPlusTree::removeConcurrent(const K& key, const RID* rid) {
+    if (!matchesType(keyType, key)) return false;
+    if (unique || rid != nullptr) {
+        std::shared_lock<std::shared_mutex> shared(structureLatch);
+        int status = tryLeafRemove(key, rid);
+        if (status >= 0) return status == 1;
+    }
+    // 叶子会下溢，或非唯一树要先找出第一个匹配的条目
+    return exclusively([&] { return rid != nullptr ? removeImpl(key, *rid) : removeImpl(key); });
+}
+bool BPlusTree::insert(int key, const RID& rid) {
+    if (!(concurrent ? insertConcurrent(key, rid) : insertImpl(key, rid))) return false;
+    filterAdd(key);
+    return true;
+}
+bool BPlusTree::remove(int key) {
+    return concurrent ? removeConcurrent(key, nullptr) : removeImpl(key);
+}
+bool BPlusTree::remove(int key, const RID& rid) {
+    return concurrent ? removeConcurrent(key, &rid) : removeImpl(key, rid);
+}
+bool BPlusTree::search(int key, RID& rid) {
+    if (!mayContain(key)) return false;
+    return concurrent ? searchConcurrent(key, rid) : searchImpl(key, rid);
+}
+std::vector<RID> BPlusTree::rangeSearch(int lowKey, int highKey, bool includeLow, bool includeHigh) {
+    return rangeSearchImpl(lowKey, highKey, includeLow, includeHigh);
+}
+bool BPlusTree::insert(float key, const RID& rid) {
+    if (!(concurrent ? insertConcurrent(key, rid) : insertImpl(key, rid))) return false;
+    filterAdd(key);
+    return true;
+}
+bool BPlusTree::remove(float key) {
+    return concurrent ? removeConcurrent(key, nullptr) : removeImpl(key);
+}
+bool BPlusTree::remove(float key, const RID& rid) {
+    return concurrent ? removeConcurrent(key, &rid) : removeImpl(key, rid);
+}
+bool BPlusTree::search(float key, RID& rid) {
+    if (!mayContain(key)) return false;
+    return concurrent ? searchConcurrent(key, rid) : searchImpl(key, rid);
+}
+std::vector<RID> BPlusTree::rangeSearch(float lowKey, float highKey, bool includeLow, bool includeHigh) {
+    return rangeSearchImpl(lowKey, highKey, includeLow, includeHigh);
+}
+bool BPlusTree::insert(const std::string& key, const RID& rid) {
+    if (!(concurrent ? insertConcurrent(key, rid) : insertImpl(key, rid))) return false;
+    filterAdd(key);
+    return true;
 }
 bool BPlusTree::remove(const std::string& key) {
-    if (keyType != KeyType::VARCHAR || rootPage == -1) return false;
-    int leafPage = findLeaf(key);
-    if (leafPage == -1) return false;
-    BPlusTreeNode leaf = readNode(leafPage);
-    bool found = false;
-    for (int i = 0; i < leaf.keyCount; i++) {
-        if (leaf.strKeys[i] == key) {
-            found = true;
-            break;
+    return concurrent ? removeConcurrent(key, nullptr) : removeImpl(key);
+}
+bool BPlusTree::remove(const std::string& key, const RID& rid) {
+    return concurrent ? removeConcurrent(key, &rid) : removeImpl(key, rid);
+}
+bool BPlusTree::search(const std::string& key, RID& rid) {
+    if (!mayContain(key)) return false;
+    return concurrent ? searchConcurrent(key, rid) : searchImpl(key, rid);
+}
+std::vector<RID> BPlusTree::rangeSearch(const std::string& lowKey, const std::string& highKey,
+                                         bool includeLow, bool includeHigh) {
+    return rangeSearchImpl(lowKey, highKey, includeLow, includeHigh);
+}
+bool BPlusTree::insert(const CompositeKey& key, const RID& rid) {
+    // 插入必须给出全部列
+    if (isPrefixKey(key)) return false;
+    if (!(concurrent ? insertConcurrent(key, rid) : insertImpl(key, rid))) return false;
+    filterAdd(key);
+    return true;
+}
+bool BPlusTree::remove(const CompositeKey& key) {
+    if (isPrefixKey(key)) return false;
+    return concurrent ? removeConcurrent(key, nullptr) : removeImpl(key);
+}
+bool BPlusTree::remove(const CompositeKey& key, const RID& rid) {
+    if (isPrefixKey(key)) return false;
+    return concurrent ? removeConcurrent(key, &rid) : removeImpl(key, rid);
+}
+bool BPlusTree::search(const CompositeKey& key, RID& rid) {
+    if (!mayContain(key)) return false;
+    return concurrent ? searchConcurrent(key, rid) : searchImpl(key, rid);
+}
+std::vector<RID> BPlusTree::rangeSearch(const CompositeKey& lowKey, const CompositeKey& highKey,
+                                         bool includeLow, bool includeHigh) {
+    return rangeSearchImpl(lowKey, highKey, includeLow, includeHigh);
+}
+template <typename K>
+void BPlusTree::bulkAddImpl(const K& key, const RID& rid) {
+    if (!matchesType(keyType, key) || isPrefixKey(key)) return;
+    size_t pos = bulkKeys.size();
+    bulkKeys.resize(pos + keyInts);
+    storeKey(&bulkKeys[pos], key);
+    bulkRids.push_back(rid);
+    bulkCount++;
+    if (bulkKeys.size() >= BP_BULK_RUN_INTS) {
+        spillBulkRun();
+    }
+}
+void BPlusTree::bulkAddSlot(const unsigned int* slot, const RID& rid) {
+    bulkKeys.insert(bulkKeys.end(), slot, slot + keyInts);
+    bulkRids.push_back(rid);
+    bulkCount++;
+    if (bulkKeys.size() >= BP_BULK_RUN_INTS) {
+        spillBulkRun();
+    }
+}
+void BPlusTree::bulkAdd(int key, const RID& rid) {
+    bulkAddImpl(key, rid);
+}
+void BPlusTree::bulkAdd(float key, const RID& rid) {
+    bulkAddImpl(key, rid);
+}
+void BPlusTree::bulkAdd(const std::string& key, const RID& rid) {
+    bulkAddImpl(key, rid);
+}
+void BPlusTree::bulkAdd(const CompositeKey& key, const RID& rid) {
+    bulkAddImpl(key, rid);
+}
+// 暂存区按 (key, RID) 排序，返回条目下标的顺序
+template <typename T>
+static std::vector<int> sortScalarKeys(const std::vector<unsigned int>& keys, const std::vector<RID>& rids) {
+    struct Item {
+        T key;
+        int pageNum;
+        int slotNum;
+        int idx;
+    };
+    std::vector<Item> items(rids.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        memcpy(&items[i].key, &keys[i], sizeof(T));
+        items[i].pageNum = rids[i].pageNum;
+        items[i].slotNum = rids[i].slotNum;
+        items[i].idx = (int)i;
+    }
+    std::sort(items.begin(), items.end(), [](const Item& x, const Item& y) {
+        if (x.key != y.key) return x.key < y.key;
+        if (x.pageNum != y.pageNum) return x.pageNum < y.pageNum;
+        return x.slotNum < y.slotNum;
+    });
+    std::vector<int> perm(items.size());
+    for (size_t i = 0; i < items.size(); i++) perm[i] = items[i].idx;
+    return perm;
+}
+std::vector<int> BPlusTree::sortBulkBuffer() {
+    // 单个 int 的键直接按值排序，省去逐次比较槽位的开销
+    if (keyType == KeyType::INT) {
+        return sortScalarKeys<int>(bulkKeys, bulkRids);
+    }
+    if (keyType == KeyType::FLOAT) {
+        return sortScalarKeys<float>(bulkKeys, bulkRids);
+    }
+    std::vector<int> perm(bulkRids.size());
+    for (size_t i = 0; i < perm.size(); i++) perm[i] = (int)i;
+    if (varKeys) {
+        std::sort(perm.begin(), perm.end(), [&](int x, int y) {
+            int c = VarcharKeyTraits::compareSlots(&bulkKeys[(size_t)x * keyInts], &bulkKeys[(size_t)y * keyInts]);
+            if (c != 0) return c < 0;
+            return compareRid(bulkRids[x], bulkRids[y]) < 0;
+        });
+        return perm;
+    }
+    std::sort(perm.begin(), perm.end(), [&](int x, int y) {
+        int c = compareSlots(&bulkKeys[(size_t)x * keyInts], &bulkKeys[(size_t)y * keyInts]);
+        if (c != 0) return c < 0;
+        return compareRid(bulkRids[x], bulkRids[y]) < 0;
+    });
+    return perm;
+}
+// 把暂存区排好序写到临时文件，每条为 [键槽位][RID]
+bool BPlusTree::spillBulkRun() {
+    if (bulkRids.empty()) return true;
+    FILE* run = tmpfile();
+    if (!run) return false;
+    std::vector<int> perm = sortBulkBuffer();
+    for (int i : perm) {
+        int ridWords[2] = {bulkRids[i].pageNum, bulkRids[i].slotNum};
+        fwrite(&bulkKeys[(size_t)i * keyInts], sizeof(unsigned int), keyInts, run);
+        fwrite(ridWords, sizeof(int), 2, run);
+    }
+    rewind(run);
+    bulkRuns.push_back(run);
+    bulkKeys.clear();
+    bulkRids.clear();
+    return true;
+}
+void BPlusTree::clearBulk() {
+    for (FILE* run : bulkRuns) {
+        fclose(run);
+    }
+    bulkRuns.clear();
+    std::vector<unsigned int>().swap(bulkKeys);
+    std::vector<RID>().swap(bulkRids);
+    bulkCount = 0;
+}
+// 装填状态：当前叶子、每个叶子应放的条目数，以及上一层要用的 (页号, 最小键, 最小 RID)
+struct BPlusTree::BulkPacker {
+    long long total;
+    long long leafCount;
+    long long leafIndex;
+    int leafFill;           // 当前叶子应装的条目数
+    BPlusPage leaf;
+    bool hasLeaf;
+    std::vector<unsigned int> prevKey;
+    bool hasPrev;
+    int fillPercent;
+    std::vector<int> pages;
+    std::vector<unsigned int> counts;   // 各页的条目数，建内部节点时作为子树计数
+    std::vector<unsigned int> lowKeys;
+    std::vector<RID> lowRids;
+    // 变长布局：当前叶子的条目先攒在内存里，装满后一次写出
+    VarImage varLeaf;
+    long long varBytes;     // 攒下的键的总字节数
+    int varPrefix;          // 攒下的键的公共前缀长度
+};
+bool BPlusTree::packEntry(BulkPacker& packer, const unsigned int* slot, const RID& rid) {
+    if (unique && packer.hasPrev && compareSlots(packer.prevKey.data(), slot) == 0) {
+        return false;  // 唯一树中有重复键
+    }
+    if (filter) filter->add(slotHash(slot));
+    if (varKeys) {
+        // 按公共前缀估算写出后的大小（每个键按 int 补齐时多算 3 字节），超过填充率就换新叶子
+        VarImage& img = packer.varLeaf;
+        if (img.count() > 0) {
+            long long n = img.count() + 1;
+            long long plen = std::min(packer.varPrefix, slotPrefix(img.key(0), slot));
+            long long bytes = packer.varBytes + slot[0];
+            long long ints = BP_HEADER_SIZE + (plen + 3) / 4 + 4 * n + (bytes - n * plen + 3 * n) / 4;
+            if (ints > (long long)PAGE_INT_NUM * packer.fillPercent / 100) {
+                flushVarLeaf(packer);
+            }
+        }
+        if (img.count() == 0) {
+            // 新叶子左侧的分隔键取上一个键与本键之间最短的前缀
+            unsigned int sepKey[BP_MAX_KEY_INTS];
+            if (packer.hasPrev) {
+                shortSeparator(packer.prevKey.data(), slot, sepKey);
+            } else {
+                memcpy(sepKey, slot, keyInts * sizeof(unsigned int));
+            }
+            packer.lowKeys.insert(packer.lowKeys.end(), sepKey, sepKey + keyInts);
+            packer.lowRids.push_back(rid);
+            packer.varBytes = 0;
+            packer.varPrefix = slot[0];
+        } else {
+            packer.varPrefix = std::min(packer.varPrefix, slotPrefix(img.key(0), slot));
+        }
+        img.insert(img.count(), slot, rid);
+        packer.varBytes += slot[0];
+        memcpy(packer.prevKey.data(), slot, keyInts * sizeof(unsigned int));
+        packer.hasPrev = true;
+        return true;
+    }
+    memcpy(packer.prevKey.data(), slot, keyInts * sizeof(unsigned int));
+    packer.hasPrev = true;
+    if (!packer.hasLeaf || packer.leaf.keyCount() >= packer.leafFill) {
+        // 叶子数按填充率定好后，条目平均分到各叶子，避免最后一个叶子过空
+        long long base = packer.total / packer.leafCount;
+        long long rem = packer.total % packer.leafCount;
+        packer.leafFill = (int)(base + (packer.leafIndex < rem ? 1 : 0));
+        packer.leafIndex++;
+        BPlusPage leaf = newNode(true);
+        if (packer.hasLeaf) {
+            // 上一个叶子可能已被换出缓存，重新取一次
+            BPlusPage prev = getNode(packer.leaf.pageNum);
+            prev.setNextLeaf(leaf.pageNum);
+            bufPageManager->markDirty(prev.bufIndex);
+            leaf.setPrevLeaf(prev.pageNum);
+        } else {
+            firstLeaf = leaf.pageNum;
+        }
+        packer.leaf = leaf;
+        packer.hasLeaf = true;
+        packer.pages.push_back(leaf.pageNum);
+        packer.counts.push_back(0);
+        packer.lowKeys.insert(packer.lowKeys.end(), slot, slot + keyInts);
+        packer.lowRids.push_back(rid);
+    }
+    BPlusPage& leaf = packer.leaf;
+    int n = leaf.keyCount();
+    memcpy(leaf.key(n), slot, keyInts * sizeof(unsigned int));
+    leaf.setRid(n, rid);
+    leaf.setKeyCount(n + 1);
+    packer.counts.back()++;
+    bufPageManager->markDirty(leaf.bufIndex);
+    return true;
+}
+void BPlusTree::flushVarLeaf(BulkPacker& packer) {
+    VarImage& img = packer.varLeaf;
+    BPlusPage leaf = newNode(true);
+    if (packer.hasLeaf) {
+        BPlusPage prev = getNode(packer.leaf.pageNum);
+        prev.setNextLeaf(leaf.pageNum);
+        bufPageManager->markDirty(prev.bufIndex);
+        leaf.setPrevLeaf(prev.pageNum);
+    } else {
+        firstLeaf = leaf.pageNum;
+    }
+    writeImage(leaf, img, 0, img.count());
+    packer.leaf = leaf;
+    packer.hasLeaf = true;
+    packer.pages.push_back(leaf.pageNum);
+    packer.counts.push_back(img.count());
+    img.keys.clear();
+    img.rids.clear();
+}
+// 变长布局的内部节点按字节数分组：每组攒到平均大小就收尾，且不超过一页；
+// 分隔键按完整长度估算，另外给公共前缀留出一个键的位置
+void BPlusTree::buildVarInternalLevels(BulkPacker& packer) {
+    std::vector<int> pages = packer.pages;
+    std::vector<unsigned int> counts = packer.counts;
+    std::vector<unsigned int> lowKeys = packer.lowKeys;
+    std::vector<RID> lowRids = packer.lowRids;
+    int stride = varStride(false);
+    long long limit = std::max((long long)PAGE_INT_NUM * packer.fillPercent / 100,
+                               (long long)BP_HEADER_SIZE + keyInts + 3 * stride + 2 * (keyInts + 1));
+    while (pages.size() > 1) {
+        size_t m = pages.size();
+        long long total = 0;
+        for (size_t c = 0; c < m; c++) {
+            total += stride + 1 + (lowKeys[c * keyInts] + 3) / 4;
+        }
+        long long groups = (total + limit - 1) / limit;
+        long long target = total / std::max(1LL, groups);
+        std::vector<int> upPages;
+        std::vector<unsigned int> upCounts;
+        std::vector<unsigned int> upKeys;
+        std::vector<RID> upRids;
+        size_t start = 0;
+        while (start < m) {
+            size_t end = start + 1;
+            long long acc = BP_HEADER_SIZE + keyInts + 2 * stride;
+            while (end < m) {
+                long long cost = stride + 1 + (lowKeys[end * keyInts] + 3) / 4;
+                if (acc + cost > PAGE_INT_NUM) break;
+                // 到平均大小就收尾，但不给下一组只留一个子节点
+                if (acc >= target && m - end > 1) break;
+                acc += cost;
+                end++;
+            }
+            VarImage img;
+            img.leaf = false;
+            img.keyInts = keyInts;
+            img.keys.assign(lowKeys.begin() + (start + 1) * keyInts, lowKeys.begin() + end * keyInts);
+            img.rids.assign(lowRids.begin() + start + 1, lowRids.begin() + end);
+            img.children.assign(pages.begin() + start, pages.begin() + end);
+            img.counts.assign(counts.begin() + start, counts.begin() + end);
+            BPlusPage node = newNode(false);
+            writeImage(node, img, 0, img.count());
+            upPages.push_back(node.pageNum);
+            upCounts.push_back((unsigned int)img.total());
+            upKeys.insert(upKeys.end(), lowKeys.begin() + start * keyInts,
+                          lowKeys.begin() + (start + 1) * keyInts);
+            upRids.push_back(lowRids[start]);
+            start = end;
+        }
+        pages.swap(upPages);
+        counts.swap(upCounts);
+        lowKeys.swap(upKeys);
+        lowRids.swap(upRids);
+    }
+    rootPage = pages[0];
+}
+// 逐层向上：把下一层的节点按填充率分组，每组建一个内部节点，直到只剩一个根
+void BPlusTree::buildInternalLevels(BulkPacker& packer) {
+    if (varKeys) {
+        buildVarInternalLevels(packer);
+        return;
+    }
+    std::vector<int> pages = packer.pages;
+    std::vector<unsigned int> counts = packer.counts;
+    std::vector<unsigned int> lowKeys = packer.lowKeys;
+    std::vector<RID> lowRids = packer.lowRids;
+    int childCap = std::max(3, std::min(internalOrder, internalOrder * packer.fillPercent / 100));
+    while (pages.size() > 1) {
+        size_t m = pages.size();
+        size_t groups = (m + childCap - 1) / childCap;
+        std::vector<int> upPages;
+        std::vector<unsigned int> upCounts;
+        std::vector<unsigned int> upKeys;
+        std::vector<RID> upRids;
+        size_t start = 0;
+        for (size_t g = 0; g < groups; g++) {
+            size_t size = m / groups + (g < m % groups ? 1 : 0);
+            BPlusPage node = newNode(false);
+            unsigned int sum = 0;
+            for (size_t j = 0; j < size; j++) {
+                size_t c = start + j;
+                node.setChild(j, pages[c]);
+                if (counted) node.setSubtreeCount(j, counts[c]);
+                sum += counts[c];
+                if (j > 0) {
+                    memcpy(node.key(j - 1), &lowKeys[c * keyInts], keyInts * sizeof(unsigned int));
+                    if (!unique) {
+                        node.setSepRid(j - 1, lowRids[c]);
+                    }
+                }
+            }
+            node.setKeyCount(size - 1);
+            bufPageManager->markDirty(node.bufIndex);
+            upPages.push_back(node.pageNum);
+            upCounts.push_back(sum);
+            upKeys.insert(upKeys.end(), lowKeys.begin() + start * keyInts,
+                          lowKeys.begin() + (start + 1) * keyInts);
+            upRids.push_back(lowRids[start]);
+            start += size;
+        }
+        pages.swap(upPages);
+        counts.swap(upCounts);
+        lowKeys.swap(upKeys);
+        lowRids.swap(upRids);
+    }
+    rootPage = pages[0];
+}
+bool BPlusTree::bulkBuild(int fillPercent) {
+    if (rootPage != -1) {
+        clearBulk();
+        return false;
+    }
+    if (bulkCount == 0) {
+        clearBulk();
+        return true;
+    }
+    fillPercent = std::max(10, std::min(fillPercent, 100));
+    if (filter) filter->reset(bulkCount * 2);
+    BulkPacker packer;
+    packer.total = bulkCount;
+    // 节点达到阶数就会分裂，满填充时也只装 order - 1 个
+    int leafCap = std::max(1, std::min(order - 1, order * fillPercent / 100));
+    packer.leafCount = (bulkCount + leafCap - 1) / leafCap;
+    packer.leafIndex = 0;
+    packer.leafFill = 0;
+    packer.hasLeaf = false;
+    packer.prevKey.resize(keyInts);
+    packer.hasPrev = false;
+    packer.fillPercent = fillPercent;
+    packer.varLeaf.leaf = true;
+    packer.varLeaf.keyInts = keyInts;
+    packer.varBytes = 0;
+    packer.varPrefix = 0;
+
+    bool ok = true;
+    if (bulkRuns.empty()) {
+        std::vector<int> perm = sortBulkBuffer();
+        for (size_t i = 0; i < perm.size() && ok; i++) {
+            ok = packEntry(packer, &bulkKeys[(size_t)perm[i] * keyInts], bulkRids[perm[i]]);
+        }
+    } else {
+        // 多路归并各个有序的临时文件
+        ok = spillBulkRun();
+        int recInts = keyInts + 2;
+        size_t k = bulkRuns.size();
+        std::vector<unsigned int> heads(k * recInts);
+        std::vector<bool> alive(k);
+        for (size_t r = 0; r < k; r++) {
+            alive[r] = fread(&heads[r * recInts], sizeof(unsigned int), recInts, bulkRuns[r]) == (size_t)recInts;
+        }
+        auto ridOf = [&](size_t r) {
+            return RID((int)heads[r * recInts + keyInts], (int)heads[r * recInts + keyInts + 1]);
+        };
+        auto greater = [&](size_t x, size_t y) {
+            int c = compareSlots(&heads[x * recInts], &heads[y * recInts]);
+            if (c != 0) return c > 0;
+            return compareRid(ridOf(x), ridOf(y)) > 0;
+        };
+        std::vector<size_t> heap;
+        for (size_t r = 0; r < k; r++) {
+            if (alive[r]) heap.push_back(r);
         }
+        std::make_heap(heap.begin(), heap.end(), greater);
+        while (!heap.empty() && ok) {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            size_t r = heap.back();
+            heap.pop_back();
+            ok = packEntry(packer, &heads[r * recInts], ridOf(r));
+            if (fread(&heads[r * recInts], sizeof(unsigned int), recInts, bulkRuns[r]) == (size_t)recInts) {
+                heap.push_back(r);
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+        }
+    }
+    long long count = bulkCount;
+    clearBulk();
+    if (!ok) {
+        // 已写出的页面作废，树恢复为空
+        initialize(unique);
+        return false;
     }
-    if (!found) return false;
-    deleteFromLeaf(leaf, key);
+    if (packer.varLeaf.count() > 0) {
+        flushVarLeaf(packer);
+    }
+    buildInternalLevels(packer);
+    updateHeader();
+    addRecordCount((int)count);
+    return true;
+}
+bool BPlusTree::compact(int fillPercent, int& pagesBefore, int& pagesAfter) {
     int index;
     BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    headerPage[6]--;
-    bufPageManager->markDirty(index);
-    writeNode(leaf);
+    int oldPages = headerPage[5];
+    pagesBefore = oldPages + 1;
+    clearBulk();
+    // 定长槽位的组合键要换成 memcmp 编码，槽位大小也会变，先解回组合键
+    bool reencode = (keyType == KeyType::COMPOSITE && !varKeys);
+    std::vector<CompositeKey> oldKeys;
+    std::vector<RID> oldRids;
+    int currentPage = firstLeaf;
+    while (currentPage != -1) {
+        BPlusPage leaf = getNode(currentPage);
+        int n = leaf.keyCount();
+        unsigned int buf[BP_MAX_KEY_INTS];
+        for (int i = 0; i < n; i++) {
+            if (reencode) {
+                oldKeys.push_back(slotToComposite(leaf.key(i)));
+                oldRids.push_back(leaf.rid(i));
+            } else {
+                bulkAddSlot(entryKey(leaf, i, buf), leaf.rid(i));
+            }
+        }
+        currentPage = leaf.nextLeaf();
+    }
+    // 条目都已取出，从空树重新装填，页号从 1 开始连续分配
+    initialize(unique);
+    for (size_t i = 0; i < oldKeys.size(); i++) {
+        bulkAdd(oldKeys[i], oldRids[i]);
+    }
+    bool ok = bulkBuild(fillPercent);
+    headerPage = bufPageManager->getPage(fileID, 0, index);
+    int newPages = headerPage[5];
+    pagesAfter = newPages + 1;
+    // 新树之后的旧页已经无用，直接丢弃缓存，不再写回
+    for (int p = newPages + 1; p <= oldPages; p++) {
+        int bufIndex = bufPageManager->hash->findIndex(fileID, p);
+        if (bufIndex != -1) {
+            bufPageManager->release(bufIndex);
+        }
+    }
+    return ok;
+}
+// 旧格式的叶子是 [键][RID] 逐项交错存放的变长记录，这里沿叶子链读出全部条目，
+// 然后按当前格式重建整棵树
+bool BPlusTree::migrateLegacy() {
+    std::vector<int> intKeys;
+    std::vector<float> floatKeys;
+    std::vector<std::string> strKeys;
+    std::vector<RID> rids;
+    int currentPage = firstLeaf;
+    while (currentPage != -1) {
+        int index;
+        BufType page = bufPageManager->getPage(fileID, currentPage, index);
+        int count = page[1];
+        int pos = BP_HEADER_SIZE;
+        for (int i = 0; i < count && pos < PAGE_INT_NUM; i++) {
+            if (keyType == KeyType::INT) {
+                intKeys.push_back(static_cast<int>(page[pos++]));
+            } else if (keyType == KeyType::FLOAT) {
+                float f;
+                memcpy(&f, &page[pos++], sizeof(float));
+                floatKeys.push_back(f);
+            } else {
+                int len = page[pos++];
+                strKeys.push_back(std::string((const char*)&page[pos], len));
+                pos += (len + 3) / 4;
+            }
+            rids.push_back(RID(page[pos], page[pos + 1]));
+            pos += 2;
+        }
+        currentPage = page[3];
+        bufPageManager->access(index);
+    }
+    initialize(unique);
+    for (size_t i = 0; i < rids.size(); i++) {
+        if (keyType == KeyType::INT) {
+            bulkAdd(intKeys[i], rids[i]);
+        } else if (keyType == KeyType::FLOAT) {
+            bulkAdd(floatKeys[i], rids[i]);
+        } else {
+            bulkAdd(strKeys[i], rids[i]);
+        }
+    }
+    return bulkBuild();
+}
+// 单列 VARCHAR 和编码后的组合键只取 [长度][内容] 部分，与槽位后面补的内容无关
+unsigned long long BPlusTree::slotHash(const unsigned int* slot) const {
+    if (keyType == KeyType::VARCHAR || keyType == KeyType::COMPOSITE) {
+        return BloomFilter::hashBytes(slot + 1, slot[0]);
+    }
+    // -0 与 0 是同一个键
+    return wordHash((keyType == KeyType::FLOAT && slot[0] == 0x80000000u) ? 0 : slot[0]);
+}
+unsigned long long BPlusTree::wordHash(unsigned int word) {
+    return BloomFilter::hashBytes(&word, sizeof(word));
+}
+unsigned long long BPlusTree::keyHash(int key) {
+    return wordHash(static_cast<unsigned int>(key));
+}
+unsigned long long BPlusTree::keyHash(float key) {
+    if (key == 0.0f) key = 0.0f;
+    unsigned int word;
+    memcpy(&word, &key, sizeof(word));
+    return wordHash(word);
+}
+unsigned long long BPlusTree::keyHash(const std::string& key) {
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return BloomFilter::hashBytes(slot + 1, slot[0]);
+}
+unsigned long long BPlusTree::keyHash(const CompositeKey& key) {
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return BloomFilter::hashBytes(slot + 1, slot[0]);
+}
+template <typename K>
+void BPlusTree::filterAdd(const K& key) {
+    if (!filter) return;
+    filter->add(keyHash(key));
+    if (filter->full()) rebuildFilter();
+}
+template <typename K>
+bool BPlusTree::mayContain(const K& key) {
+    return !filter || isPrefixKey(key) || filter->mayContain(keyHash(key));
+}
+template bool BPlusTree::mayContain<int>(const int&);
+template bool BPlusTree::mayContain<float>(const float&);
+template bool BPlusTree::mayContain<std::string>(const std::string&);
+template bool BPlusTree::mayContain<CompositeKey>(const CompositeKey&);
+bool BPlusTree::bufferable() const {
+    if (keyType != KeyType::COMPOSITE) return true;
+    return normalizedKeys() && keyPartOffset((int)keyParts.size() - 1) >= 0;
+}
+template <typename K>
+bool BPlusTree::encodeKey(const K& key, unsigned int* slot) {
+    if (!matchesType(keyType, key) || isPrefixKey(key)) return false;
+    memset(slot, 0, keyInts * sizeof(unsigned int));
+    storeKey(slot, key);
     return true;
 }
-std::vector<RID> BPlusTree::getAllRIDs() {
-    std::vector<RID> result;
-    if (firstLeaf == -1) return result;
+template bool BPlusTree::encodeKey<int>(const int&, unsigned int*);
+template bool BPlusTree::encodeKey<float>(const float&, unsigned int*);
+template bool BPlusTree::encodeKey<std::string>(const std::string&, unsigned int*);
+template bool BPlusTree::encodeKey<CompositeKey>(const CompositeKey&, unsigned int*);
+// 按键类型把槽位解回键再插入，组合键逐列解码
+bool BPlusTree::insertSlot(const unsigned int* slot, const RID& rid) {
+    if (keyType == KeyType::INT) {
+        return insert(static_cast<int>(slot[0]), rid);
+    }
+    if (keyType == KeyType::FLOAT) {
+        float f;
+        memcpy(&f, slot, sizeof(float));
+        return insert(f, rid);
+    }
+    if (keyType == KeyType::VARCHAR) {
+        return insert(std::string((const char*)(slot + 1), slot[0]), rid);
+    }
+    CompositeKey key;
+    unsigned int buf[BP_MAX_KEY_INTS];
+    for (int i = 0; i < (int)keyParts.size(); i++) {
+        const unsigned int* part = keyPart(slot, i, buf);
+        if (!part) return false;
+        if (keyParts[i].type == KeyType::INT) {
+            key.addInt(static_cast<int>(part[0]));
+        } else if (keyParts[i].type == KeyType::FLOAT) {
+            float f;
+            memcpy(&f, part, sizeof(float));
+            key.addFloat(f);
+        } else {
+            key.addString(std::string((const char*)(part + 1), part[0]));
+        }
+    }
+    return insert(key, rid);
+}
+// 沿叶子链取出现有的键，按两倍的键数重新分配
+void BPlusTree::rebuildFilter() {
+    std::vector<unsigned long long> hashes;
+    unsigned int buf[BP_MAX_KEY_INTS];
     int currentPage = firstLeaf;
     while (currentPage != -1) {
-        BPlusTreeNode leaf = readNode(currentPage);
-        for (int i = 0; i < leaf.keyCount; i++) {
-            result.push_back(leaf.rids[i]);
+        BPlusPage leaf = getNode(currentPage);
+        int n = leaf.keyCount();
+        for (int i = 0; i < n; i++) {
+            hashes.push_back(slotHash(entryKey(leaf, i, buf)));
         }
-        currentPage = leaf.nextLeaf;
+        currentPage = leaf.nextLeaf();
+    }
+    filter->reset((long long)hashes.size() * 2);
+    for (unsigned long long h : hashes) {
+        filter->add(h);
+    }
+}
+void BPlusTree::enableFilter() {
+    if (concurrent || (keyType == KeyType::COMPOSITE && !varKeys)) return;
+    if (!filter) filter = std::make_unique<BloomFilter>();
+    rebuildFilter();
+}
+void BPlusTree::attachFilter(std::unique_ptr<BloomFilter> f) {
+    if (concurrent || (keyType == KeyType::COMPOSITE && !varKeys)) return;
+    filter = std::move(f);
+}
+std::vector<RID> BPlusTree::getAllRIDs() {
+    std::vector<RID> result;
+    for (BPlusCursor c = openCursor(); c.valid(); c.next()) {
+        result.push_back(c.rid());
     }
     return result;
 }
 void BPlusTree::getStatistics(int& nodeCount, int& recordCount, int& height) {
     int index;
     BufType headerPage = bufPageManager->getPage(fileID, 0, index);
-    nodeCount = headerPage[5];
+    nodeCount = headerPage[5] - headerPage[BP_FREE_COUNT_OFFSET];
     recordCount = headerPage[6];
+    bufPageManager->access(index);
     height = 0;
     if (rootPage != -1) {
-        int currentPage = rootPage;
-        BPlusTreeNode node = readNode(currentPage);
+        BPlusPage node = getNode(rootPage);
         height = 1;
-        while (!node.isLeaf && !node.children.empty()) {
-            currentPage = node.children[0];
-            node = readNode(currentPage);
+        while (!node.isLeaf() && node.keyCount() > 0) {
+            node = getNode(node.child(0));
             height++;
         }
     }
-    bufPageManager->access(index);
 }
 void BPlusTree::close() {
     bufPageManager->close();
@@ -818,45 +2681,64 @@ void BPlusTree::printTree() {
     std::cout << "B+ Tree Structure:" << std::endl;
     printNode(rootPage, 0);
 }
+void BPlusTree::printKey(const unsigned int* slot) {
+    if (keyType == KeyType::INT) {
+        std::cout << static_cast<int>(slot[0]);
+    } else if (keyType == KeyType::FLOAT) {
+        float f;
+        memcpy(&f, slot, sizeof(float));
+        std::cout << f;
+    } else if (keyType == KeyType::VARCHAR) {
+        std::cout << std::string((const char*)(slot + 1), slot[0]);
+    } else {
+        unsigned int buf[BP_MAX_KEY_INTS];
+        std::cout << "(";
+        for (size_t i = 0; i < keyParts.size(); i++) {
+            // 内部节点的分隔键可能只是编码的前缀，解不出的列不再打印
+            const unsigned int* part = keyPart(slot, (int)i, buf);
+            if (!part) break;
+            if (i > 0) std::cout << ",";
+            if (keyParts[i].type == KeyType::INT) {
+                std::cout << static_cast<int>(part[0]);
+            } else if (keyParts[i].type == KeyType::FLOAT) {
+                float f;
+                memcpy(&f, part, sizeof(float));
+                std::cout << f;
+            } else {
+                std::cout << std::string((const char*)(part + 1), part[0]);
+            }
+        }
+        std::cout << ")";
+    }
+}
 void BPlusTree::printNode(int pageNum, int level) {
-    BPlusTreeNode node = readNode(pageNum);
+    BPlusPage node = getNode(pageNum);
     std::string indent(level * 2, ' ');
-    if (node.isLeaf) {
+    int n = node.keyCount();
+    unsigned int buf[BP_MAX_KEY_INTS];
+    if (node.isLeaf()) {
         std::cout << indent << "Leaf[" << pageNum << "]: ";
-        for (int i = 0; i < node.keyCount; i++) {
-            if (keyType == KeyType::INT) {
-                std::cout << node.keys[i];
-            } else if (keyType == KeyType::FLOAT) {
-                std::cout << node.floatKeys[i];
-            } else {
-                std::cout << node.strKeys[i];
-            }
-            std::cout << "->(" << node.rids[i].pageNum << "," << node.rids[i].slotNum << ")";
-            if (i < node.keyCount - 1) std::cout << ", ";
+        for (int i = 0; i < n; i++) {
+            printKey(entryKey(node, i, buf));
+            RID rid = node.rid(i);
+            std::cout << "->(" << rid.pageNum << "," << rid.slotNum << ")";
+            if (i < n - 1) std::cout << ", ";
         }
         std::cout << std::endl;
     } else {
         std::cout << indent << "Internal[" << pageNum << "]: ";
-        for (int i = 0; i < node.keyCount; i++) {
-            if (keyType == KeyType::INT) {
-                std::cout << node.keys[i];
-            } else if (keyType == KeyType::FLOAT) {
-                std::cout << node.floatKeys[i];
-            } else {
-                std::cout << node.strKeys[i];
-            }
-            if (i < node.keyCount - 1) std::cout << ", ";
+        for (int i = 0; i < n; i++) {
+            printKey(entryKey(node, i, buf));
+            if (i < n - 1) std::cout << ", ";
         }
         std::cout << std::endl;
-        
-        for (int childPage : node.children) {
+
+        std::vector<int> children;
+        for (int i = 0; i <= n; i++) {
+            children.push_back(node.child(i));
+        }
+        for (int childPage : children) {
             printNode(childPage, level + 1);
         }
     }
 }
-void BPlusTree::updateParentKey(int parentPage, int oldKey, int newKey) {
-}
-void BPlusTree::updateParentKey(int parentPage, float oldKey, float newKey) {
-}
-void BPlusTree::updateParentKey(int parentPage, const std::string& oldKey, const std::string& newKey) {
-}
@@ -4,20 +4,93 @@
 #include "../filesystem/bufmanager/BufPageManager.h"
 #include "../filesystem/fileio/FileManager.h"
 #include "../filesystem/utils/pagedef.h"
+#include "KeySearch.h"
+#include "KeyTraits.h"
+#include "BloomFilter.h"
 #include <cstring>
 #include <vector>
 #include <string>
 #include <iostream>
 #include <algorithm>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
 #define BP_PAGE_HEADER 0
 #define BP_PAGE_INTERNAL 1
 #define BP_PAGE_LEAF 2
+#define BP_PAGE_FREE 3             // 已回收、挂在空闲链表上的页
 #define BP_HEADER_SIZE 16
-#define BP_MAGIC 0x42505452
+#define BP_MAGIC_V1 0x42505452     // 旧格式：键与值逐项交错存储
+#define BP_MAGIC 0x42505432        // 当前格式：定长槽位、键数组与值数组分开存放
+#define BP_FORMAT_VERSION 2
+#define BP_MAX_KEY_INTS 256        // 单个键槽位的上限（int 数）
+#define BP_MAX_KEY_PARTS 16        // 组合键最多的列数
+#define BP_SCHEMA_OFFSET 16        // 头页中组合键各列 (类型, 长度) 的起始位置
+#define BP_FREE_LIST_OFFSET 10     // 头页中空闲页链表的表头（0 表示空）
+#define BP_FREE_COUNT_OFFSET 11    // 头页中空闲页的个数
+#define BP_LAYOUT_OFFSET 12        // 头页中的节点布局：0 为定长槽位，1 为变长键（VARCHAR 和组合键）
+#define BP_LAYOUT_VAR 1
+#define BP_COUNTS_OFFSET 13        // 头页中的标记：为 1 时内部节点为每个子节点记录子树的条目数
+#define BP_BULK_FILL 90            // 批量建树的默认填充率（%）
+#define BP_VAR_MIN_FILL 35         // 变长键节点的占用低于页面的这个比例（%）时向兄弟借或合并
+// 多线程模式要求缓存至少有这么多页面：每个线程最多钉住一条根到叶子的路径和一个后继叶子，
+// 分裂、合并等结构修改独占进行时还要给它读写的页面留出位置
+#define BP_CONCURRENT_MIN_FRAMES 64
+#ifndef BP_BULK_RUN_INTS
+#define BP_BULK_RUN_INTS (16 * 1024 * 1024)  // 批量建树在内存中暂存的上限（int 数），超过后排序写出到临时文件
+#endif
+
+// 节点页头（以 int 为单位）
+#define BP_TYPE_OFFSET 0
+#define BP_COUNT_OFFSET 1
+#define BP_RESERVED_OFFSET 2        // 旧文件在这里存父节点页号，现已不用
+#define BP_NEXT_OFFSET 3
+#define BP_PREV_OFFSET 4
+// 变长键节点的页头
+#define BP_PREFIX_LEN_OFFSET 5     // 节点内公共前缀的字节数，前缀紧跟在页头之后
+#define BP_HEAP_OFFSET 6           // 键区的起始位置，键区从页尾向前增长
+#define BP_GARBAGE_OFFSET 7        // 键区中已删除的键占用的 int 数
 enum class KeyType {
     INT = 0,
     FLOAT = 1,
-    VARCHAR = 2
+    VARCHAR = 2,
+    COMPOSITE = 3
+};
+// 组合键中的一列
+struct KeyPart {
+    KeyType type;
+    int length;             // VARCHAR的长度
+    KeyPart() : type(KeyType::INT), length(0) {}
+    KeyPart(KeyType t, int len = 0) : type(t), length(len) {}
+};
+// 组合键的值：各列依次编码，VARCHAR 为 [长度][内容按 int 补齐]
+// 列数少于索引定义时视为前缀，只比较前面的列
+// 新建的组合键索引在节点里存 NormalizedKey 编码后的字节串；早先的定长槽位按列逐段比较，整理后换成前者
+class CompositeKey {
+public:
+    std::vector<unsigned int> words;
+    std::vector<KeyType> types;
+
+    void addInt(int v) {
+        words.push_back(static_cast<unsigned int>(v));
+        types.push_back(KeyType::INT);
+    }
+    void addFloat(float v) {
+        unsigned int w;
+        memcpy(&w, &v, sizeof(float));
+        words.push_back(w);
+        types.push_back(KeyType::FLOAT);
+    }
+    void addString(const std::string& v) {
+        size_t pos = words.size();
+        words.push_back(v.length());
+        words.resize(pos + 1 + (v.length() + 3) / 4, 0);
+        memcpy(&words[pos + 1], v.data(), v.length());
+        types.push_back(KeyType::VARCHAR);
+    }
+    int partCount() const { return (int)types.size(); }
 };
 struct RID {
     int pageNum;
@@ -34,113 +107,452 @@ struct RID {
         return pageNum >= 0 && slotNum >= 0;
     }
 };
-class BPlusTreeNode {
+// 缓冲页上的节点视图：直接读写页内数据，不解码、不分配内存
+// 定长布局：[页头 BP_HEADER_SIZE][键槽位 maxKeys * keyInts][值区]
+// 叶子的值区为 RID 数组（每项 2 个 int），内部节点为子页号数组（maxKeys + 1 项）
+// 允许重复键的树中，内部节点在子页号之后还存放分隔键对应的 RID，按 (key, RID) 排序
+// 带计数的树中，内部节点最后是各子树的条目数数组（maxKeys + 1 项）
+// 变长布局（VARCHAR 键和 memcmp 编码的组合键）：[页头][公共前缀][目录][空闲][键区]
+// 目录每项定长，叶子为 (键偏移, RID)，内部节点为 (子页号, 键偏移[, 分隔键 RID][, 子树条目数])，
+// 内部节点多一项只放子页号和子树条目数
+// 键区从页尾向前分配，每个键只存去掉公共前缀后的部分：[长度][内容按 int 补齐]
+struct BPlusPage {
+    BufType data;
+    int pageNum;
+    int bufIndex;
+    int keyInts;
+    int valueBase;
+    int sepRidBase;
+    bool varKeys;
+    int valueStride;        // 相邻两项值（RID / 子页号）的间隔
+    int sepStride;
+    int keyBase;            // 变长布局中第 0 项键偏移的位置，间隔同 valueStride
+    int countBase;          // 内部节点第 0 个子树条目数的位置
+    int countStride;
+
+    bool isLeaf() const { return data[BP_TYPE_OFFSET] == BP_PAGE_LEAF; }
+    int keyCount() const { return (int)data[BP_COUNT_OFFSET]; }
+    void setKeyCount(int n) { data[BP_COUNT_OFFSET] = n; }
+    int nextLeaf() const { return (int)data[BP_NEXT_OFFSET]; }
+    void setNextLeaf(int p) { data[BP_NEXT_OFFSET] = p; }
+    int prevLeaf() const { return (int)data[BP_PREV_OFFSET]; }
+    void setPrevLeaf(int p) { data[BP_PREV_OFFSET] = p; }
+
+    // 定长布局的键槽位
+    unsigned int* key(int i) const { return data + BP_HEADER_SIZE + i * keyInts; }
+    int child(int i) const { return (int)data[valueBase + valueStride * i]; }
+    void setChild(int i, int p) { data[valueBase + valueStride * i] = p; }
+    RID rid(int i) const {
+        return RID((int)data[valueBase + valueStride * i], (int)data[valueBase + valueStride * i + 1]);
+    }
+    void setRid(int i, const RID& r) {
+        data[valueBase + valueStride * i] = r.pageNum;
+        data[valueBase + valueStride * i + 1] = r.slotNum;
+    }
+    RID sepRid(int i) const {
+        return RID((int)data[sepRidBase + sepStride * i], (int)data[sepRidBase + sepStride * i + 1]);
+    }
+    void setSepRid(int i, const RID& r) {
+        data[sepRidBase + sepStride * i] = r.pageNum;
+        data[sepRidBase + sepStride * i + 1] = r.slotNum;
+    }
+    // 变长布局：公共前缀与第 i 个键去掉前缀后的部分 [长度][内容]
+    int prefixLen() const { return (int)data[BP_PREFIX_LEN_OFFSET]; }
+    const unsigned char* prefix() const { return (const unsigned char*)(data + BP_HEADER_SIZE); }
+    unsigned int* suffix(int i) const { return data + data[keyBase + valueStride * i]; }
+    unsigned int subtreeCount(int i) const { return data[countBase + countStride * i]; }
+    void setSubtreeCount(int i, unsigned int c) { data[countBase + countStride * i] = c; }
+    // 叶子取条目的 RID，内部节点取分隔键的 RID
+    RID entryRid(int i) const { return isLeaf() ? rid(i) : sepRid(i); }
+};
+class BPlusTree;
+// 叶子链上的游标：打开时定位到范围的一端，之后用 next / prev 逐条移动，不物化结果
+// 只记住 (叶子页号, 位置)，每步从缓存取页；进入新叶子时预读同一方向上的下一个叶子
+class BPlusCursor {
 public:
-    int pageNum;            // 页号
-    bool isLeaf;            // 是否为叶子节点
-    int keyCount;           // 键数量
-    int parent;             // 父节点页号
-    int nextLeaf;           // 下一个叶子 (仅叶子节点)
-    int prevLeaf;           // 上一个叶子 (仅叶子节点)
-    std::vector<int> keys;          // 整数键
-    std::vector<float> floatKeys;   // 浮点键
-    std::vector<std::string> strKeys; // 字符串键
-    std::vector<int> children;      // 子节点页号 (内部节点)
-    std::vector<RID> rids;          // 记录ID (叶子节点)
-    
-    BPlusTreeNode() : pageNum(-1), isLeaf(true), keyCount(0), 
-                      parent(-1), nextLeaf(-1), prevLeaf(-1) {}
+    BPlusCursor()
+        : tree(nullptr), page(-1), pos(0), backward(false), hasLow(false), hasHigh(false),
+          includeLow(true), includeHigh(true), boundParts(0), checkedPage(-1), checkedCount(0),
+          wholeLeaf(false) {
+        leaf.data = nullptr;
+    }
+    bool valid() const { return page != -1; }
+    RID rid() const;
+    const unsigned int* key() const;   // 当前条目的键槽位
+    bool next();      // 向键增大的方向移动；越过上界或走到头后失效
+    bool prev();      // 向键减小的方向移动；越过下界或走到头后失效
+    bool advance() { return backward ? prev() : next(); }  // 沿打开时的方向移动
+private:
+    friend class BPlusTree;
+    BPlusTree* tree;
+    int page;
+    int pos;
+    bool backward;
+    bool hasLow, hasHigh;
+    bool includeLow, includeHigh;
+    int boundParts;                 // 组合键前缀界只比较前几列
+    int checkedPage, checkedCount;  // 已判过整体是否在界内的叶子及当时的条目数
+    bool wholeLeaf;                 // 该叶子的条目全部在界内
+    std::vector<unsigned int> low, high;
+    mutable BPlusPage leaf;         // 当前叶子的缓存视图，缓存页被换出后重新取
+    mutable std::vector<unsigned int> keyBuf;  // 变长布局的叶子里键要拼回完整槽位
 };
 class BPlusTree {
 private:
+    friend class BPlusCursor;
     FileManager* fileManager;
     BufPageManager* bufPageManager;
     int fileID;
     KeyType keyType;
     int keyLength;          // VARCHAR的长度
-    int order;              // B+树的阶
-    int rootPage;           // 根节点页号
+    std::vector<KeyPart> keyParts;  // 组合键各列（仅 COMPOSITE）
+    bool unique;            // 是否唯一索引；非唯一时条目按 (key, RID) 排序
+    int order;              // 叶子的阶（节点最多暂存的键数，达到即分裂）
+    int internalOrder;      // 内部节点的阶
+    int keyInts;            // 每个键槽位占用的 int 数
+    int leafValueBase;      // 叶子值区起始偏移
+    int internalValueBase;  // 内部节点值区起始偏移
+    int sepRidBase;         // 内部节点分隔键 RID 区起始偏移（仅非唯一树）
+    int internalCountBase;  // 内部节点子树条目数区起始偏移（仅带计数的树）
+    std::atomic<int> rootPage;  // 根节点页号，多线程模式下读者不加锁读取
     int firstLeaf;          // 第一个叶子页号
-    
-    int calculateOrder();
-    
-    // 读写节点
-    BPlusTreeNode readNode(int pageNum);
-    void writeNode(const BPlusTreeNode& node);
-    
-    // 分配新页面
+    bool varKeys;           // 节点是否为变长布局（新建的 VARCHAR 和组合键索引）
+    bool counted;           // 内部节点是否记录各子树的条目数（新建的索引都带，旧文件整理后带上）
+    // 最近一次 findLeaf 经过的内部节点页号，根在前；节点不记父节点，
+    // 分裂、借与合并从这里取父节点，向上一层处理前弹出一项
+    std::vector<int> path;
+    // 最右叶子及到它的路径：键递增地插入时直接追加到这里；分配或回收页后作废
+    int appendLeaf;
+    std::vector<int> appendPath;
+    bool rightAppend;       // 本次插入在最右叶子的末尾，沿路径的分裂按 BP_BULK_FILL 装满左页
+
+    // 多线程访问（setConcurrent 打开后）：
+    // 叶子靠缓存页面上的版本锁保护，写者加锁修改，读者不加锁，读完核对版本号，变了就重来；
+    // 不改结构的插入、删除共享 structureLatch，只锁要改的叶子，路径上的子树计数用原子加减；
+    // 分裂、借、合并和根的变化独占 structureLatch 并整段持有缓存的 latch，进行期间
+    // structureVersion 为奇数，读者发现它变过就从根重新下降。变长布局的节点重写时目录会整体移动，
+    // 这种树的读者也共享 structureLatch，不与结构修改同时进行
+    bool concurrent;
+    BufType pinnedHeader;   // 多线程模式下一直钉住的头页，条目数直接在上面原子加减
+    int pinnedHeaderIndex;
+    std::shared_mutex structureLatch;
+    std::atomic<unsigned long long> structureVersion;
+
+    // 批量建树的暂存区：键槽位连续存放，RID 单独存放；超出上限的部分排序后写到临时文件
+    std::vector<unsigned int> bulkKeys;
+    std::vector<RID> bulkRids;
+    std::vector<FILE*> bulkRuns;
+    long long bulkCount;
+
+    // 布隆过滤器（enableFilter 之后）：插入和批量建树时加入键，search 先问它，判定不存在就不读页；
+    // 删除不清位，加入的键数超出容量时按叶子上现有的键重建
+    std::unique_ptr<BloomFilter> filter;
+    unsigned long long slotHash(const unsigned int* slot) const;
+    // 按键的静态类型取哈希，与 slotHash 对同类型树上存下的槽位结果一致
+    static unsigned long long wordHash(unsigned int word);
+    unsigned long long keyHash(int key);
+    unsigned long long keyHash(float key);
+    unsigned long long keyHash(const std::string& key);
+    unsigned long long keyHash(const CompositeKey& key);
+    template <typename K> void filterAdd(const K& key);
+    void rebuildFilter();
+
+    void calculateLayout();
+    static int partInts(const KeyPart& part);  // 组合键中一列占用的 int 数
+    static int partMaxBytes(const KeyPart& part);  // 组合键中一列 memcmp 编码后最多的字节数
+    // 组合键在变长布局中按字节串比较：键是条目的前缀即视为相等，前缀查找与逐列比较时一致
+    bool normalizedKeys() const { return varKeys && keyType == KeyType::COMPOSITE; }
+    int normalize(const CompositeKey& key, unsigned char* out);   // 返回编码的字节数，超出槽位的截掉
+    CompositeKey slotToComposite(const unsigned int* slot);       // 定长槽位解回组合键（整理时换布局用）
+
+    // 取得节点视图
+    BPlusPage getNode(int pageNum);
+    BPlusPage newNode(bool leaf);
+    void setLayout(BPlusPage& node);
+
+    // 分配新页面，优先复用空闲链表中的页
     int allocateNewPage();
-    
+    // 回收页面，挂到空闲链表上
+    void freeNode(int pageNum);
+
     // 更新头页面
     void updateHeader();
-    
-    // 比较键
-    int compareKeys(int key1, int key2);
-    int compareKeys(float key1, float key2);
-    int compareKeys(const std::string& key1, const std::string& key2);
-    
-    // 查找操作
-    int findLeaf(int key);
-    int findLeaf(float key);
-    int findLeaf(const std::string& key);
-    
-    // 插入操作辅助函数
-    void insertIntoLeaf(BPlusTreeNode& leaf, int key, const RID& rid);
-    void insertIntoLeaf(BPlusTreeNode& leaf, float key, const RID& rid);
-    void insertIntoLeaf(BPlusTreeNode& leaf, const std::string& key, const RID& rid);
-    
-    void insertIntoParent(BPlusTreeNode& left, int key, BPlusTreeNode& right);
-    void insertIntoParent(BPlusTreeNode& left, float key, BPlusTreeNode& right);
-    void insertIntoParent(BPlusTreeNode& left, const std::string& key, BPlusTreeNode& right);
-    
-    void splitLeaf(BPlusTreeNode& leaf);
-    void splitInternal(BPlusTreeNode& node);
-    
-    // 删除操作辅助函数
-    void deleteFromLeaf(BPlusTreeNode& leaf, int key);
-    void deleteFromLeaf(BPlusTreeNode& leaf, float key);
-    void deleteFromLeaf(BPlusTreeNode& leaf, const std::string& key);
-    
-    void redistributeOrMerge(BPlusTreeNode& node);
-    void mergeNodes(BPlusTreeNode& left, BPlusTreeNode& right);
-    void redistributeNodes(BPlusTreeNode& left, BPlusTreeNode& right, bool leftToRight);
-    
-    // 更新父节点中的键
-    void updateParentKey(int parentPage, int oldKey, int newKey);
-    void updateParentKey(int parentPage, float oldKey, float newKey);
-    void updateParentKey(int parentPage, const std::string& oldKey, const std::string& newKey);
-    
+    void addRecordCount(int delta);
+
+    // 键槽位的读写与比较
+    void storeKey(unsigned int* slot, int key);
+    void storeKey(unsigned int* slot, float key);
+    void storeKey(unsigned int* slot, const std::string& key);
+    void storeKey(unsigned int* slot, const CompositeKey& key);
+    static int compareKey(const unsigned int* slot, int key) { return IntKeyTraits::compare(slot, key); }
+    static int compareKey(const unsigned int* slot, float key) { return FloatKeyTraits::compare(slot, key); }
+    static int compareKey(const unsigned int* slot, const std::string& key) {
+        return VarcharKeyTraits::compare(slot, key);
+    }
+    int compareKey(const unsigned int* slot, const CompositeKey& key);
+    static bool matchesType(KeyType t, int) { return t == KeyType::INT; }
+    static bool matchesType(KeyType t, float) { return t == KeyType::FLOAT; }
+    static bool matchesType(KeyType t, const std::string&) { return t == KeyType::VARCHAR; }
+    static bool matchesType(KeyType t, const CompositeKey&) { return t == KeyType::COMPOSITE; }
+    // 前缀键（列数不全的组合键）需要从最左的候选叶子开始找
+    template <typename K> bool isPrefixKey(const K&) const { return false; }
+    bool isPrefixKey(const CompositeKey& key) const { return key.partCount() < (int)keyParts.size(); }
+    template <typename K> bool leftmostDescent(const K& key) const { return !unique || isPrefixKey(key); }
+    static int compareRid(const RID& a, const RID& b);
+    // 两个键槽位的比较（批量建树排序、游标判界用）；组合键只比较前 parts 列
+    // 比较函数在 calculateLayout 中按键类型选定，单列键直接用 KeyTraits 的实现
+    // 查找路径不经过这里（各 Impl 模板按键的 C++ 类型内联 compareKey），经过这里的是多路归并、
+    // 游标判界和写优化缓冲；换成直接调用 IntKeyTraits 后，这几处实测都分不出差别
+    typedef int (*SlotCompare)(const BPlusTree*, const unsigned int*, const unsigned int*, int);
+    SlotCompare slotCompare;
+    int compareSlots(const unsigned int* a, const unsigned int* b, int parts = BP_MAX_KEY_PARTS) const {
+        return slotCompare(this, a, b, parts);
+    }
+    static int compareCompositeSlots(const BPlusTree* tree, const unsigned int* a, const unsigned int* b,
+                                     int parts);
+    int compareParts(const unsigned int* a, const unsigned int* b, int parts) const;
+    static int partCount(const CompositeKey& key) { return key.partCount(); }
+    template <typename K> static int partCount(const K&) { return BP_MAX_KEY_PARTS; }
+    // 节点中第 i 个键与给定键比较，两种布局通用
+    template <typename K> int compareEntry(const BPlusPage& node, int i, const K& key) {
+        return compareKey(node.key(i), key);
+    }
+    int compareEntry(const BPlusPage& node, int i, const std::string& key);
+    int compareEntry(const BPlusPage& node, int i, const CompositeKey& key);
+    int compareEntrySlot(const BPlusPage& node, int i, const unsigned int* slot,
+                         int parts = BP_MAX_KEY_PARTS);
+    // 第 i 个键的完整槽位：定长布局直接指向页内，变长布局拼到 buf 里
+    const unsigned int* entryKey(const BPlusPage& node, int i, unsigned int* buf);
+
+    // 节点内查找：第一个 >= key 的位置 (upper == false) / 第一个 > key 的位置 (upper == true)
+    // INT/FLOAT 键连续存放，交给 KeySearch 的 SIMD 内核；VARCHAR 和组合键走二分
+    int searchNode(const BPlusPage& node, int key, bool upper);
+    int searchNode(const BPlusPage& node, float key, bool upper);
+    int searchNode(const BPlusPage& node, const std::string& key, bool upper);
+    int searchNode(const BPlusPage& node, const CompositeKey& key, bool upper);
+    int searchVarNode(const BPlusPage& node, const unsigned char* key, int len, bool upper);
+    int compareVarEntry(const BPlusPage& node, int i, const unsigned char* key, int len);
+    template <typename K> int binarySearch(const BPlusPage& node, const K& key, bool upper);
+    template <typename K> int lowerBound(const BPlusPage& node, const K& key) {
+        return searchNode(node, key, false);
+    }
+    template <typename K> int upperBound(const BPlusPage& node, const K& key) {
+        return searchNode(node, key, true);
+    }
+    // 非唯一树中 (key, rid) 的位置：第一个 >= / > (key, rid) 的条目
+    template <typename K> int searchEntry(const BPlusPage& node, const K& key, const RID& rid, bool upper);
+    // 下降时进入的子节点：给出 rid 时按 (key, rid) 定位条目，否则同 findLeaf(key)
+    template <typename K> int childFor(const BPlusPage& node, const K& key, const RID* rid);
+    // 可能包含 key 的最左叶子
+    template <typename K> int findLeaf(const K& key);
+    // 应当包含条目 (key, rid) 的叶子
+    template <typename K> int findLeaf(const K& key, const RID& rid);
+    // 可能包含 key 的最右叶子
+    template <typename K> int findLastLeaf(const K& key);
+    int lastLeaf();
+
+    // 多线程访问：节点钉在缓存里使用，叶子的版本锁放在缓存页面上
+    BPlusPage pinNode(int pageNum);
+    void unpinNode(const BPlusPage& node) { bufPageManager->unpinPage(node.bufIndex); }
+    void unpinAll(std::vector<BPlusPage>& nodes);
+    unsigned long long readLatch(const BPlusPage& node);  // 等到没有写者，返回版本号
+    bool validLatch(const BPlusPage& node, unsigned long long version);
+    void lockLatch(const BPlusPage& node);
+    void unlockLatch(const BPlusPage& node);
+    bool structureStable(unsigned long long version);
+    // 结构修改：独占树和缓存，在其中调用单线程的实现
+    template <typename Op> bool exclusively(Op op);
+    // 从根钉住一条路径（nodes 末尾为叶子）；下降途中结构变了时放掉已钉的节点，返回 false
+    template <typename K> bool pinPath(const K& key, const RID* rid, std::vector<BPlusPage>& nodes,
+                                       unsigned long long version);
+    // 以下返回 1 / 0 为成功 / 失败，-1 表示要重试或改走结构修改
+    template <typename K> int trySearch(const K& key, RID& rid, unsigned long long version);
+    template <typename K> int tryLeafInsert(const K& key, const RID& rid);
+    template <typename K> int tryLeafRemove(const K& key, const RID* rid);
+    void addPinnedCounts(std::vector<BPlusPage>& nodes, int delta);
+    template <typename K> bool searchConcurrent(const K& key, RID& rid);
+    template <typename K> bool insertConcurrent(const K& key, const RID& rid);
+    template <typename K> bool removeConcurrent(const K& key, const RID* rid);
+
+    // 游标移动后跨叶子、判界；走出范围时游标失效
+    bool settleCursor(BPlusCursor& cursor);
+    bool withinBounds(const BPlusCursor& cursor, const BPlusPage& leaf, int i);
+    const BPlusPage& cursorLeaf(const BPlusCursor& cursor);
+    void prefetchLeaf(int pageNum);
+
+    // 各键类型共用的实现
+    template <typename K> bool insertImpl(const K& key, const RID& rid);
+    // (key, rid) 是否大于缓存的最右叶子的最后一项，是则取出该叶子
+    template <typename K> bool appendsAtEnd(const K& key, const RID& rid, BPlusPage& leaf);
+    template <typename K> bool searchImpl(const K& key, RID& rid);
+    template <typename K> bool removeImpl(const K& key);
+    template <typename K> bool removeImpl(const K& key, const RID& rid);
+    template <typename K> std::vector<RID> rangeSearchImpl(const K& lowKey, const K& highKey,
+                                                          bool includeLow, bool includeHigh);
+
+    // 插入操作辅助函数（分隔键以槽位形式传递，与键类型无关）
+    void insertIntoParent(BPlusPage& left, const unsigned int* sepKey, const RID& sepRid,
+                          BPlusPage& right);
+    void splitLeaf(BPlusPage& leaf);
+    void splitInternal(BPlusPage& node);
+    template <typename K> void placeInLeaf(BPlusPage& leaf, int i, const K& key, const RID& rid);
+    void eraseFromLeaf(BPlusPage& leaf, int i);
+    void dropFromLeaf(BPlusPage& leaf, int i);          // 只移走条目，不处理下溢
+    bool underflowsAfterErase(const BPlusPage& leaf, int i);
+
+    // 子树计数：插入、删除前先把叶子到根路径上的计数加减 1，分裂、借、合并后
+    // 用 refreshCount 按子节点的实际内容重算父节点里的那一项
+    long long nodeTotal(const BPlusPage& node);
+    void addPathCount(int leafPage, int delta);
+    void refreshCount(BPlusPage& parent, int i);
+    // 小于 key（upper 时为小于等于）的条目数，沿一条路径下降，累加左侧子树的计数
+    template <typename K> long long rankOf(const K& key, bool upper);
+
+    // 删除后的下溢处理：先向左右兄弟借，借不到就与兄弟合并，合并会删去父节点的一个分隔键
+    int childIndex(const BPlusPage& parent, int childPage);
+    void rebalanceLeaf(BPlusPage& leaf);
+    void rebalanceInternal(BPlusPage& node);
+    void mergeLeaves(BPlusPage& left, BPlusPage& right, BPlusPage& parent, int sepIdx);
+    void mergeInternal(BPlusPage& left, BPlusPage& right, BPlusPage& parent, int sepIdx);
+    void removeSeparator(BPlusPage& parent, int sepIdx);
+
+    // 变长布局的节点操作：小改动直接在页内进行，其余把节点解码成 VarImage 改好后整页重写，
+    // 写不下时按字节数分成两页；公共前缀取节点第一个键与最后一个键的公共部分
+    struct VarImage;
+    int varStride(bool leaf) const { return leaf ? 3 : (unique ? 2 : 4) + (counted ? 1 : 0); }
+    int varUsedInts(const BPlusPage& node) const;
+    void readImage(const BPlusPage& node, VarImage& img);
+    int imageInts(const VarImage& img, int from, int to);
+    bool imageFits(const VarImage& img, int from, int to) { return imageInts(img, from, to) <= PAGE_INT_NUM; }
+    void writeImage(BPlusPage& node, const VarImage& img, int from, int to);
+    void writeOrSplit(BPlusPage& node, const VarImage& img);
+    void varSplit(BPlusPage& node, const VarImage& img);
+    void varInsertLeaf(BPlusPage& leaf, int i, const unsigned int* slot, const RID& rid);
+    // 不重写页面就能放下时直接插入，返回是否插入了
+    bool varInsertInPlace(BPlusPage& leaf, int i, const unsigned int* slot, const RID& rid);
+    void varInsertIntoParent(BPlusPage& left, const unsigned int* sepKey, const RID& sepRid,
+                             BPlusPage& right);
+    void varEraseFromLeaf(BPlusPage& leaf, int i);
+    void varRebalance(BPlusPage& node);
+    void varRemoveSeparator(BPlusPage& parent, int sepIdx);
+    // 叶子分裂时上推的分隔键：right 的最短前缀，且大于 left
+    void shortSeparator(const unsigned int* left, const unsigned int* right, unsigned int* sep);
+
+    // 批量建树
+    template <typename K> void bulkAddImpl(const K& key, const RID& rid);
+    void bulkAddSlot(const unsigned int* slot, const RID& rid);
+    std::vector<int> sortBulkBuffer();
+    bool spillBulkRun();
+    void clearBulk();
+    struct BulkPacker;
+    bool packEntry(BulkPacker& packer, const unsigned int* slot, const RID& rid);
+    void flushVarLeaf(BulkPacker& packer);
+    void buildInternalLevels(BulkPacker& packer);
+    void buildVarInternalLevels(BulkPacker& packer);
+
+    // 旧格式索引文件迁移
+    bool migrateLegacy();
+
 public:
     BPlusTree(FileManager* fm, BufPageManager* bpm, int fid, KeyType kType, int kLen = 0);
-    
-    bool initialize();
+    BPlusTree(FileManager* fm, BufPageManager* bpm, int fid, const std::vector<KeyPart>& parts);
+    ~BPlusTree();
+
+    bool initialize(bool uniqueKeys = true);
     bool load();
-    
+
     bool insert(int key, const RID& rid);
     bool remove(int key);
+    bool remove(int key, const RID& rid);
     bool search(int key, RID& rid);
     std::vector<RID> rangeSearch(int lowKey, int highKey, bool includeLow = true, bool includeHigh = true);
-    
+
     bool insert(float key, const RID& rid);
     bool remove(float key);
+    bool remove(float key, const RID& rid);
     bool search(float key, RID& rid);
     std::vector<RID> rangeSearch(float lowKey, float highKey, bool includeLow = true, bool includeHigh = true);
-    
+
     bool insert(const std::string& key, const RID& rid);
     bool remove(const std::string& key);
+    bool remove(const std::string& key, const RID& rid);
     bool search(const std::string& key, RID& rid);
-    std::vector<RID> rangeSearch(const std::string& lowKey, const std::string& highKey, 
+    std::vector<RID> rangeSearch(const std::string& lowKey, const std::string& highKey,
                                   bool includeLow = true, bool includeHigh = true);
 
+    // 组合键；search / rangeSearch 的键可以只给前几列
+    bool insert(const CompositeKey& key, const RID& rid);
+    bool remove(const CompositeKey& key);
+    bool remove(const CompositeKey& key, const RID& rid);
+    bool search(const CompositeKey& key, RID& rid);
+    std::vector<RID> rangeSearch(const CompositeKey& lowKey, const CompositeKey& highKey,
+                                  bool includeLow = true, bool includeHigh = true);
+
+    // 自底向上批量建树，只能用于空树：bulkAdd 暂存条目（顺序任意），
+    // bulkBuild 排序后按 fillPercent 的填充率装填叶子和内部节点；唯一树遇到重复键时返回 false
+    void bulkAdd(int key, const RID& rid);
+    void bulkAdd(float key, const RID& rid);
+    void bulkAdd(const std::string& key, const RID& rid);
+    void bulkAdd(const CompositeKey& key, const RID& rid);
+    bool bulkBuild(int fillPercent = BP_BULK_FILL);
+
+    // 在线整理：沿叶子链读出全部条目，按 fillPercent 重新装填，空闲页清空；
+    // 返回前后文件的页数（含头页），新树之后的页可以从文件尾截掉
+    bool compact(int fillPercent, int& pagesBefore, int& pagesAfter);
+
+    // 范围游标：lowKey / highKey 为空指针时该侧不设界；backward 为 true 时从高端开始
+    // 支持 int、float、std::string、CompositeKey（可只给前几列）
+    template <typename K>
+    BPlusCursor openCursor(const K* lowKey, const K* highKey, bool includeLow = true,
+                           bool includeHigh = true, bool backward = false);
+    // 整棵树的游标
+    BPlusCursor openCursor(bool backward = false);
+    // 区间内的条目数（参数同 openCursor）：有子树计数时沿两端各下降一次，没有时沿叶子逐条数
+    template <typename K>
+    long long countRange(const K* lowKey, const K* highKey, bool includeLow = true, bool includeHigh = true);
+    bool hasSubtreeCounts() const { return counted; }
+
+    // 多线程访问：打开后 insert / remove / search 可以在多个线程中同时调用；
+    // 游标、区间计数、批量建树、整理等其余操作仍要在没有其他线程访问时进行
+    // 多线程模式下不维护布隆过滤器，打开时丢弃；缓存页面少于 BP_CONCURRENT_MIN_FRAMES 时不能打开，返回 false
+    // 目前只供直接使用 BPlusTree 的程序（测试、基准）调用，IndexManager 打开的索引都是单线程模式
+    bool setConcurrent(bool on);
+    bool isConcurrent() const { return concurrent; }
+
+    // 布隆过滤器：enableFilter 按现有条目建一个，attachFilter 换上从文件读回的；
+    // 早先建的定长组合键索引不支持（浮点列的 -0 与 0 槽位不同），整理成新布局后才能打开
+    void enableFilter();
+    void attachFilter(std::unique_ptr<BloomFilter> f);
+    const BloomFilter* getFilter() const { return filter.get(); }
+    // 过滤器判定键一定不在树中时返回 false；没有过滤器或前缀键时总是 true
+    template <typename K> bool mayContain(const K& key);
+
+    // 写优化缓冲（IndexBuffer）用：键与槽位互转、按槽位比较和插入
+    // 早先的定长组合键和超长的编码组合键解不回完整的键，不能缓冲
+    bool bufferable() const;
+    int getKeyInts() const { return keyInts; }
+    template <typename K> bool encodeKey(const K& key, unsigned int* slot);   // 类型不符或前缀键时返回 false
+    int compareKeySlots(const unsigned int* a, const unsigned int* b) const { return compareSlots(a, b); }
+    unsigned long long keySlotHash(const unsigned int* slot) const { return slotHash(slot); }
+    bool insertSlot(const unsigned int* slot, const RID& rid);
+    static int compareRids(const RID& a, const RID& b) { return compareRid(a, b); }
+
     std::vector<RID> getAllRIDs();
-    
+
     void getStatistics(int& nodeCount, int& recordCount, int& height);
     void close();
     KeyType getKeyType() const { return keyType; }
+    const std::vector<KeyPart>& getKeyParts() const { return keyParts; }
+    // 第 part 列在键槽位中的偏移（单列索引只有第 0 列）；该列会被截断或放不下时返回 -1
+    // memcmp 编码的组合键没有固定偏移，能解出时返回 0
+    int keyPartOffset(int part) const;
+    // 游标键槽位中的第 part 列，按 [值] / [长度][内容] 的格式给出；编码的键解到 buf 里
+    const unsigned int* keyPart(const unsigned int* slot, int part, unsigned int* buf) const;
+    bool isUnique() const { return unique; }
     void printTree();
 private:
+    void printKey(const unsigned int* slot);
     void printNode(int pageNum, int level);
 };
 
 #endif
-
@@ -0,0 +1,77 @@
+#include "BloomFilter.h"
+#include <cstdio>
+#include <cstring>
+
+void BloomFilter::reset(long long keys) {
+    capacity = keys < BLOOM_MIN_KEYS ? BLOOM_MIN_KEYS : keys;
+    added = 0;
+    long long bits = capacity * BLOOM_BITS_PER_KEY;
+    long long blocks = (bits + 64 * BLOOM_BLOCK_WORDS - 1) / (64 * BLOOM_BLOCK_WORDS);
+    words.assign((size_t)blocks * BLOOM_BLOCK_WORDS, 0);
+}
+// 块内的各位取自哈希值乘常数后的高位，每个 9 位选 512 位中的一位
+void BloomFilter::add(unsigned long long hash) {
+    unsigned long long* b = block(hash);
+    unsigned long long g = hash * 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        unsigned int bit = (unsigned int)(g >> (55 - 9 * i)) & 511;
+        b[bit >> 6] |= 1ull << (bit & 63);
+    }
+    added++;
+}
+bool BloomFilter::mayContain(unsigned long long hash) const {
+    const unsigned long long* b = block(hash);
+    unsigned long long g = hash * 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        unsigned int bit = (unsigned int)(g >> (55 - 9 * i)) & 511;
+        if (!(b[bit >> 6] & (1ull << (bit & 63)))) return false;
+    }
+    return true;
+}
+bool BloomFilter::save(const std::string& path) const {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    long long header[4] = {BLOOM_MAGIC, (long long)(words.size() / BLOOM_BLOCK_WORDS), capacity, added};
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+              fwrite(words.data(), sizeof(unsigned long long), words.size(), f) == words.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) remove(path.c_str());
+    return ok;
+}
+bool BloomFilter::load(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    long long header[4];
+    bool ok = fread(header, sizeof(header), 1, f) == 1 && header[0] == BLOOM_MAGIC && header[1] > 0 &&
+              header[2] > 0 && header[3] >= 0;
+    if (ok) {
+        std::vector<unsigned long long> bits((size_t)header[1] * BLOOM_BLOCK_WORDS);
+        ok = fread(bits.data(), sizeof(unsigned long long), bits.size(), f) == bits.size();
+        if (ok) {
+            words.swap(bits);
+            capacity = header[2];
+            added = header[3];
+        }
+    }
+    fclose(f);
+    return ok;
+}
+// 每次取 8 字节混合，末尾不足 8 字节的部分补 0，长度也参与混合
+unsigned long long BloomFilter::hashBytes(const void* data, int len) {
+    const unsigned char* p = (const unsigned char*)data;
+    unsigned long long h = 0x27D4EB2F165667C5ull ^ ((unsigned long long)len * 0x9E3779B97F4A7C15ull);
+    for (int i = 0; i < len; i += 8) {
+        unsigned long long k = 0;
+        memcpy(&k, p + i, len - i < 8 ? len - i : 8);
+        k *= 0x87C37B91114253D5ull;
+        k = (k << 31) | (k >> 33);
+        h ^= k * 0x4CF5AD432745937Full;
+        h = ((h << 27) | (h >> 37)) * 5 + 0x52DCE729;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
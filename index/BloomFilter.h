@@ -0,0 +1,45 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <string>
+#include <vector>
+#define BLOOM_MAGIC 0x424C4D31
+#define BLOOM_BITS_PER_KEY 10          // 每个键 10 位、7 个哈希，误判率约 1%
+#define BLOOM_HASHES 7
+#define BLOOM_BLOCK_WORDS 8            // 一个键的各位都落在同一个 64 字节的块里，查一次只碰一条缓存行
+#define BLOOM_MIN_KEYS 1024
+
+// 分块布隆过滤器：回答“键一定不存在”或“键可能存在”
+// 只能加不能删，删掉的键仍会被判为可能存在；加入的键数超过设计容量后误判率上升，
+// 由使用者按现有的键重建（见 full()）
+class BloomFilter {
+private:
+    std::vector<unsigned long long> words;
+    long long capacity;     // 设计容量（键数）
+    long long added;        // 重建以来加入的键数
+
+    unsigned long long* block(unsigned long long hash) {
+        return &words[(size_t)((hash & 0xFFFFFFFFu) % (words.size() / BLOOM_BLOCK_WORDS)) * BLOOM_BLOCK_WORDS];
+    }
+    const unsigned long long* block(unsigned long long hash) const {
+        return &words[(size_t)((hash & 0xFFFFFFFFu) % (words.size() / BLOOM_BLOCK_WORDS)) * BLOOM_BLOCK_WORDS];
+    }
+
+public:
+    explicit BloomFilter(long long keys = 0) { reset(keys); }
+    // 清空并按 keys 个键重新分配
+    void reset(long long keys);
+    void add(unsigned long long hash);
+    bool mayContain(unsigned long long hash) const;
+    bool full() const { return added > capacity; }
+    long long getCapacity() const { return capacity; }
+    long long getAdded() const { return added; }
+
+    // 文件格式：[magic][块数][容量][已加入数][位图]
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    static unsigned long long hashBytes(const void* data, int len);
+};
+
+#endif
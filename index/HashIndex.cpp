@@ -0,0 +1,486 @@
+#include "HashIndex.h"
+
+HashIndex::HashIndex(FileManager* fm, BufPageManager* bpm, int fid, KeyType kType, int kLen)
+    : fileManager(fm), bufPageManager(bpm), fileID(fid), keyType(kType), keyLength(kLen), globalDepth(0) {
+    calculateLayout();
+}
+void HashIndex::calculateLayout() {
+    keyInts = 1;
+    if (keyType == KeyType::VARCHAR) {
+        keyInts = std::min((keyLength + 3) / 4 + 1, BP_MAX_KEY_INTS);
+    }
+    entryInts = 3 + keyInts;
+    capacity = (PAGE_INT_NUM - HASH_BUCKET_HEADER) / entryInts;
+}
+bool HashIndex::initialize() {
+    int index;
+    BufType headerPage = bufPageManager->allocPage(fileID, 0, index, false);
+    memset(headerPage, 0, PAGE_SIZE);
+    headerPage[0] = HASH_MAGIC;
+    headerPage[HASH_KEY_TYPE_OFFSET] = static_cast<int>(keyType);
+    headerPage[HASH_KEY_LENGTH_OFFSET] = keyLength;
+    headerPage[HASH_DEPTH_OFFSET] = 0;
+    headerPage[HASH_PAGES_OFFSET] = 0;
+    headerPage[HASH_RECORDS_OFFSET] = 0;
+    headerPage[HASH_DIR_PAGES_OFFSET] = 0;
+    headerPage[HASH_FREE_LIST_OFFSET] = 0;
+    bufPageManager->markDirty(index);
+    globalDepth = 0;
+    dirPages.clear();
+
+    // 一个目录页，只有一项，指向一个空桶
+    int dirPage = allocatePage();
+    int bucket = newBucketPage(HASH_PAGE_BUCKET, 0);
+    headerPage = bufPageManager->getPage(fileID, 0, index);
+    headerPage[HASH_DIR_OFFSET] = dirPage;
+    headerPage[HASH_DIR_PAGES_OFFSET] = 1;
+    bufPageManager->markDirty(index);
+    dirPages.push_back(dirPage);
+    setDirectoryEntry(0, bucket);
+    return true;
+}
+bool HashIndex::load() {
+    int index;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    if (headerPage[0] != HASH_MAGIC) {
+        return false;
+    }
+    keyType = static_cast<KeyType>(headerPage[HASH_KEY_TYPE_OFFSET]);
+    keyLength = headerPage[HASH_KEY_LENGTH_OFFSET];
+    globalDepth = headerPage[HASH_DEPTH_OFFSET];
+    dirPages.clear();
+    for (int i = 0; i < (int)headerPage[HASH_DIR_PAGES_OFFSET]; i++) {
+        dirPages.push_back(headerPage[HASH_DIR_OFFSET + i]);
+    }
+    bufPageManager->access(index);
+    calculateLayout();
+    return !dirPages.empty();
+}
+long long HashIndex::getRecordCount() {
+    int index;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    return headerPage[HASH_RECORDS_OFFSET];
+}
+void HashIndex::addRecordCount(int delta) {
+    int index;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    headerPage[HASH_RECORDS_OFFSET] += delta;
+    bufPageManager->markDirty(index);
+}
+int HashIndex::allocatePage() {
+    int index;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    int freePage = headerPage[HASH_FREE_LIST_OFFSET];
+    if (freePage > 0) {
+        int pageIndex;
+        BufType page = bufPageManager->getPage(fileID, freePage, pageIndex);
+        int next = page[HASH_NEXT_OFFSET];
+        headerPage = bufPageManager->getPage(fileID, 0, index);
+        headerPage[HASH_FREE_LIST_OFFSET] = next;
+        bufPageManager->markDirty(index);
+        return freePage;
+    }
+    int pageNum = headerPage[HASH_PAGES_OFFSET] + 1;
+    headerPage[HASH_PAGES_OFFSET] = pageNum;
+    bufPageManager->markDirty(index);
+    return pageNum;
+}
+void HashIndex::freePage(int pageNum) {
+    if (pageNum <= 0) return;
+    int index;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    int oldHead = headerPage[HASH_FREE_LIST_OFFSET];
+    headerPage[HASH_FREE_LIST_OFFSET] = pageNum;
+    bufPageManager->markDirty(index);
+    BufType page = bufPageManager->getPage(fileID, pageNum, index);
+    memset(page, 0, HASH_BUCKET_HEADER * sizeof(unsigned int));
+    page[HASH_TYPE_OFFSET] = HASH_PAGE_FREE;
+    page[HASH_NEXT_OFFSET] = oldHead;
+    bufPageManager->markDirty(index);
+}
+int HashIndex::newBucketPage(int type, int localDepth) {
+    int pageNum = allocatePage();
+    int index;
+    BufType page = bufPageManager->getPage(fileID, pageNum, index);
+    memset(page, 0, HASH_BUCKET_HEADER * sizeof(unsigned int));
+    page[HASH_TYPE_OFFSET] = type;
+    page[HASH_COUNT_OFFSET] = 0;
+    page[HASH_LOCAL_DEPTH_OFFSET] = localDepth;
+    page[HASH_NEXT_OFFSET] = -1;
+    bufPageManager->markDirty(index);
+    return pageNum;
+}
+void HashIndex::storeKey(unsigned int* slot, int key) {
+    slot[0] = static_cast<unsigned int>(key);
+}
+void HashIndex::storeKey(unsigned int* slot, float key) {
+    // -0.0 与 0.0 相等，统一成 0.0 才能落到同一个桶
+    if (key == 0.0f) key = 0.0f;
+    memcpy(slot, &key, sizeof(float));
+}
+void HashIndex::storeKey(unsigned int* slot, const std::string& key) {
+    int len = std::min((int)key.length(), (keyInts - 1) * 4);
+    memset(slot, 0, keyInts * sizeof(unsigned int));
+    slot[0] = len;
+    memcpy(slot + 1, key.data(), len);
+}
+int HashIndex::usedKeyInts(const unsigned int* slot) const {
+    if (keyType != KeyType::VARCHAR) return 1;
+    return 1 + ((int)slot[0] + 3) / 4;
+}
+// 按 int 逐个混合（MurmurHash3 的做法），低位用作目录下标
+unsigned int HashIndex::hashSlot(const unsigned int* slot) const {
+    int n = usedKeyInts(slot);
+    unsigned int h = 0x9747b28cu;
+    for (int i = 0; i < n; i++) {
+        unsigned int k = slot[i] * 0xcc9e2d51u;
+        k = (k << 15) | (k >> 17);
+        h ^= k * 0x1b873593u;
+        h = ((h << 13) | (h >> 19)) * 5 + 0xe6546b64u;
+    }
+    h ^= (unsigned int)n;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+bool HashIndex::matches(const unsigned int* entry, unsigned int hash, const unsigned int* slot) const {
+    return entry[0] == hash && memcmp(entry + 3, slot, usedKeyInts(slot) * sizeof(unsigned int)) == 0;
+}
+int HashIndex::directoryEntry(int i) {
+    int index;
+    BufType page = bufPageManager->getPage(fileID, dirPages[i / PAGE_INT_NUM], index);
+    return (int)page[i % PAGE_INT_NUM];
+}
+void HashIndex::setDirectoryEntry(int i, int pageNum) {
+    int index;
+    BufType page = bufPageManager->getPage(fileID, dirPages[i / PAGE_INT_NUM], index);
+    page[i % PAGE_INT_NUM] = pageNum;
+    bufPageManager->markDirty(index);
+}
+// 目录翻倍：新的一半是旧的一半的拷贝，整页的部分按页复制
+bool HashIndex::doubleDirectory() {
+    if (globalDepth >= HASH_MAX_DEPTH) return false;
+    int size = 1 << globalDepth;
+    int index;
+    if (size < PAGE_INT_NUM) {
+        BufType page = bufPageManager->getPage(fileID, dirPages[0], index);
+        memcpy(page + size, page, size * sizeof(unsigned int));
+        bufPageManager->markDirty(index);
+    } else {
+        int oldPages = size / PAGE_INT_NUM;
+        for (int i = 0; i < oldPages; i++) {
+            int pageNum = allocatePage();
+            int srcIndex, dstIndex;
+            BufType src = bufPageManager->getPage(fileID, dirPages[i], srcIndex);
+            bufPageManager->access(srcIndex);
+            BufType dst = bufPageManager->getPage(fileID, pageNum, dstIndex);
+            memcpy(dst, src, PAGE_SIZE);
+            bufPageManager->markDirty(dstIndex);
+            dirPages.push_back(pageNum);
+        }
+        BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+        for (size_t i = oldPages; i < dirPages.size(); i++) {
+            headerPage[HASH_DIR_OFFSET + i] = dirPages[i];
+        }
+        headerPage[HASH_DIR_PAGES_OFFSET] = dirPages.size();
+        bufPageManager->markDirty(index);
+    }
+    globalDepth++;
+    BufType headerPage = bufPageManager->getPage(fileID, 0, index);
+    headerPage[HASH_DEPTH_OFFSET] = globalDepth;
+    bufPageManager->markDirty(index);
+    return true;
+}
+// 桶里的哈希值只有低位相同，高位近似均匀分布，先按哈希值在 [0, 2^32) 中的比例猜位置，
+// 再从猜测处倍增步长找出包含答案的区间，最后在小区间里二分；
+// 溢出页上的哈希值不均匀时猜得不准，倍增仍保证 O(log n)
+int HashIndex::lowerBound(BufType page, unsigned int hash) const {
+    int n = page[HASH_COUNT_OFFSET];
+    if (n == 0) return 0;
+    int guess = (int)(((unsigned long long)hash * n) >> 32);
+    int lo, hi;
+    int step = 1;
+    if (entryAt(page, guess)[0] < hash) {
+        lo = hi = guess + 1;
+        while (hi < n && entryAt(page, hi)[0] < hash) {
+            lo = hi + 1;
+            hi += step;
+            step <<= 1;
+        }
+        hi = std::min(hi, n);
+    } else {
+        lo = hi = guess;
+        while (lo > 0 && entryAt(page, lo - 1)[0] >= hash) {
+            hi = lo - 1;
+            lo -= step;
+            step <<= 1;
+        }
+        lo = std::max(lo, 0);
+    }
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (entryAt(page, mid)[0] < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+void HashIndex::readChain(int bucketPage, std::vector<unsigned int>& entries, std::vector<int>& pages) {
+    for (int pageNum = bucketPage; pageNum != -1;) {
+        int index;
+        BufType page = bufPageManager->getPage(fileID, pageNum, index);
+        int n = page[HASH_COUNT_OFFSET];
+        entries.insert(entries.end(), entryAt(page, 0), entryAt(page, n));
+        pages.push_back(pageNum);
+        pageNum = (int)page[HASH_NEXT_OFFSET];
+    }
+}
+void HashIndex::writeChain(std::vector<int>& pages, const std::vector<unsigned int>& unsorted) {
+    int total = (int)(unsorted.size() / entryInts);
+    // 每页内按哈希值排好
+    std::vector<int> order(total);
+    for (int i = 0; i < total; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return unsorted[(size_t)a * entryInts] < unsorted[(size_t)b * entryInts];
+    });
+    std::vector<unsigned int> entries;
+    entries.reserve(unsorted.size());
+    for (int i : order) {
+        entries.insert(entries.end(), unsorted.begin() + (size_t)i * entryInts,
+                       unsorted.begin() + (size_t)(i + 1) * entryInts);
+    }
+    int needed = std::max(1, (total + capacity - 1) / capacity);
+    while ((int)pages.size() < needed) {
+        pages.push_back(newBucketPage(HASH_PAGE_OVERFLOW, 0));
+    }
+    for (size_t i = needed; i < pages.size(); i++) {
+        freePage(pages[i]);
+    }
+    pages.resize(needed);
+    for (int i = 0; i < needed; i++) {
+        int from = i * capacity;
+        int n = std::min(capacity, total - from);
+        int index;
+        BufType page = bufPageManager->getPage(fileID, pages[i], index);
+        if (n > 0) {
+            memcpy(entryAt(page, 0), &entries[(size_t)from * entryInts], (size_t)n * entryInts * sizeof(unsigned int));
+        }
+        page[HASH_COUNT_OFFSET] = n;
+        page[HASH_NEXT_OFFSET] = (i + 1 < needed) ? pages[i + 1] : -1;
+        bufPageManager->markDirty(index);
+    }
+}
+// 按哈希值的第 localDepth 位把桶链分成两个桶，需要时先把目录翻倍
+bool HashIndex::splitBucket(int bucketPage, int dirIndex) {
+    int index;
+    BufType page = bufPageManager->getPage(fileID, bucketPage, index);
+    int depth = page[HASH_LOCAL_DEPTH_OFFSET];
+    if (depth >= HASH_MAX_DEPTH) return false;
+    if (depth == globalDepth && !doubleDirectory()) return false;
+
+    std::vector<unsigned int> entries, stay, move;
+    std::vector<int> pages;
+    readChain(bucketPage, entries, pages);
+    for (size_t i = 0; i < entries.size(); i += entryInts) {
+        std::vector<unsigned int>& side = ((entries[i] >> depth) & 1) ? move : stay;
+        side.insert(side.end(), entries.begin() + i, entries.begin() + i + entryInts);
+    }
+    int newBucket = newBucketPage(HASH_PAGE_BUCKET, depth + 1);
+    page = bufPageManager->getPage(fileID, bucketPage, index);
+    page[HASH_LOCAL_DEPTH_OFFSET] = depth + 1;
+    bufPageManager->markDirty(index);
+    writeChain(pages, stay);
+    std::vector<int> newPages(1, newBucket);
+    writeChain(newPages, move);
+
+    // 原来指向这个桶、且第 depth 位为 1 的目录项改指新桶
+    int first = (dirIndex & ((1 << depth) - 1)) | (1 << depth);
+    for (int i = first; i < (1 << globalDepth); i += (1 << (depth + 1))) {
+        setDirectoryEntry(i, newBucket);
+    }
+    return true;
+}
+int HashIndex::largestHashGroup(int bucketPage) {
+    std::vector<unsigned int> entries, hashes;
+    std::vector<int> pages;
+    readChain(bucketPage, entries, pages);
+    for (size_t i = 0; i < entries.size(); i += entryInts) {
+        hashes.push_back(entries[i]);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    int best = 0;
+    for (size_t i = 0, j; i < hashes.size(); i = j) {
+        for (j = i; j < hashes.size() && hashes[j] == hashes[i]; j++) {}
+        best = std::max(best, (int)(j - i));
+    }
+    return best;
+}
+bool HashIndex::insertSlot(const unsigned int* slot, const RID& rid) {
+    unsigned int hash = hashSlot(slot);
+    while (true) {
+        int dirIndex = hash & ((1u << globalDepth) - 1);
+        int bucket = directoryEntry(dirIndex);
+        // 走一遍桶链：查重、找空位，顺带看分裂能否把键分开
+        int total = 0;
+        int pages = 0;
+        int freePageNum = -1;
+        int lastPage = bucket;
+        bool sameHash = true;
+        for (int pageNum = bucket; pageNum != -1;) {
+            int index;
+            BufType page = bufPageManager->getPage(fileID, pageNum, index);
+            int n = page[HASH_COUNT_OFFSET];
+            if (n > 0 && (entryAt(page, 0)[0] != hash || entryAt(page, n - 1)[0] != hash)) {
+                sameHash = false;
+            }
+            for (int i = lowerBound(page, hash); i < n && entryAt(page, i)[0] == hash; i++) {
+                const unsigned int* entry = entryAt(page, i);
+                if ((int)entry[1] == rid.pageNum && (int)entry[2] == rid.slotNum && matches(entry, hash, slot)) {
+                    return false;
+                }
+            }
+            if (n < capacity && freePageNum == -1) freePageNum = pageNum;
+            total += n;
+            pages++;
+            lastPage = pageNum;
+            pageNum = (int)page[HASH_NEXT_OFFSET];
+        }
+        // 整条链都满了才分裂，并且除去最多的那个哈希值后剩下的条目要够半页，
+        // 否则被大量重复键占住的桶会因为个别其他键反复分裂，目录白白翻倍
+        if (total >= capacity * pages && !sameHash &&
+            total - largestHashGroup(bucket) >= capacity / 2 && splitBucket(bucket, dirIndex)) {
+            continue;
+        }
+        if (freePageNum == -1) {
+            freePageNum = newBucketPage(HASH_PAGE_OVERFLOW, 0);
+            int index;
+            BufType last = bufPageManager->getPage(fileID, lastPage, index);
+            last[HASH_NEXT_OFFSET] = freePageNum;
+            bufPageManager->markDirty(index);
+        }
+        int index;
+        BufType page = bufPageManager->getPage(fileID, freePageNum, index);
+        int n = page[HASH_COUNT_OFFSET];
+        int pos = lowerBound(page, hash);
+        unsigned int* entry = entryAt(page, pos);
+        memmove(entryAt(page, pos + 1), entry, (size_t)(n - pos) * entryInts * sizeof(unsigned int));
+        entry[0] = hash;
+        entry[1] = rid.pageNum;
+        entry[2] = rid.slotNum;
+        memcpy(entry + 3, slot, keyInts * sizeof(unsigned int));
+        page[HASH_COUNT_OFFSET] = n + 1;
+        bufPageManager->markDirty(index);
+        addRecordCount(1);
+        return true;
+    }
+}
+bool HashIndex::removeSlot(const unsigned int* slot, const RID& rid) {
+    unsigned int hash = hashSlot(slot);
+    int bucket = directoryEntry(hash & ((1u << globalDepth) - 1));
+    int prevPage = -1;
+    for (int pageNum = bucket; pageNum != -1;) {
+        int index;
+        BufType page = bufPageManager->getPage(fileID, pageNum, index);
+        int n = page[HASH_COUNT_OFFSET];
+        int next = page[HASH_NEXT_OFFSET];
+        for (int i = lowerBound(page, hash); i < n && entryAt(page, i)[0] == hash; i++) {
+            unsigned int* entry = entryAt(page, i);
+            if ((int)entry[1] != rid.pageNum || (int)entry[2] != rid.slotNum || !matches(entry, hash, slot)) {
+                continue;
+            }
+            memmove(entry, entryAt(page, i + 1), (size_t)(n - 1 - i) * entryInts * sizeof(unsigned int));
+            page[HASH_COUNT_OFFSET] = n - 1;
+            bufPageManager->markDirty(index);
+            // 空出来的溢出页从链上摘下回收
+            if (n == 1 && prevPage != -1) {
+                int prevIndex;
+                BufType prev = bufPageManager->getPage(fileID, prevPage, prevIndex);
+                prev[HASH_NEXT_OFFSET] = next;
+                bufPageManager->markDirty(prevIndex);
+                freePage(pageNum);
+            }
+            addRecordCount(-1);
+            return true;
+        }
+        prevPage = pageNum;
+        pageNum = next;
+    }
+    return false;
+}
+std::vector<RID> HashIndex::lookupSlot(const unsigned int* slot) {
+    std::vector<RID> rids;
+    unsigned int hash = hashSlot(slot);
+    int bucket = directoryEntry(hash & ((1u << globalDepth) - 1));
+    for (int pageNum = bucket; pageNum != -1;) {
+        int index;
+        BufType page = bufPageManager->getPage(fileID, pageNum, index);
+        int n = page[HASH_COUNT_OFFSET];
+        for (int i = lowerBound(page, hash); i < n && entryAt(page, i)[0] == hash; i++) {
+            const unsigned int* entry = entryAt(page, i);
+            if (matches(entry, hash, slot)) {
+                rids.push_back(RID((int)entry[1], (int)entry[2]));
+            }
+        }
+        pageNum = (int)page[HASH_NEXT_OFFSET];
+    }
+    return rids;
+}
+bool HashIndex::insert(int key, const RID& rid) {
+    if (keyType != KeyType::INT) return false;
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return insertSlot(slot, rid);
+}
+bool HashIndex::insert(float key, const RID& rid) {
+    if (keyType != KeyType::FLOAT) return false;
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return insertSlot(slot, rid);
+}
+bool HashIndex::insert(const std::string& key, const RID& rid) {
+    if (keyType != KeyType::VARCHAR) return false;
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return insertSlot(slot, rid);
+}
+bool HashIndex::remove(int key, const RID& rid) {
+    if (keyType != KeyType::INT) return false;
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return removeSlot(slot, rid);
+}
+bool HashIndex::remove(float key, const RID& rid) {
+    if (keyType != KeyType::FLOAT) return false;
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return removeSlot(slot, rid);
+}
+bool HashIndex::remove(const std::string& key, const RID& rid) {
+    if (keyType != KeyType::VARCHAR) return false;
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return removeSlot(slot, rid);
+}
+std::vector<RID> HashIndex::lookup(int key) {
+    if (keyType != KeyType::INT) return std::vector<RID>();
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return lookupSlot(slot);
+}
+std::vector<RID> HashIndex::lookup(float key) {
+    if (keyType != KeyType::FLOAT) return std::vector<RID>();
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return lookupSlot(slot);
+}
+std::vector<RID> HashIndex::lookup(const std::string& key) {
+    if (keyType != KeyType::VARCHAR) return std::vector<RID>();
+    unsigned int slot[BP_MAX_KEY_INTS];
+    storeKey(slot, key);
+    return lookupSlot(slot);
+}
@@ -0,0 +1,101 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include "BPlusTree.h"
+#include <vector>
+#include <string>
+#define HASH_MAGIC 0x48534831          // 可扩展哈希索引文件
+#define HASH_MAX_DEPTH 20              // 目录最多 2^20 项，再满的桶只挂溢出页
+#define HASH_DIR_OFFSET 16             // 头页中目录页号的起始位置
+
+// 头页（以 int 为单位）
+#define HASH_KEY_TYPE_OFFSET 1
+#define HASH_KEY_LENGTH_OFFSET 2
+#define HASH_DEPTH_OFFSET 3            // 全局深度
+#define HASH_PAGES_OFFSET 4            // 已分配的页数（不含头页）
+#define HASH_RECORDS_OFFSET 5          // 条目总数
+#define HASH_DIR_PAGES_OFFSET 6        // 目录页数
+#define HASH_FREE_LIST_OFFSET 7        // 空闲页链表的表头（0 表示空）
+
+// 桶页的页头
+#define HASH_PAGE_BUCKET 1
+#define HASH_PAGE_OVERFLOW 2
+#define HASH_PAGE_FREE 3
+#define HASH_TYPE_OFFSET 0
+#define HASH_COUNT_OFFSET 1
+#define HASH_LOCAL_DEPTH_OFFSET 2
+#define HASH_NEXT_OFFSET 3             // 溢出页链，-1 表示没有
+#define HASH_BUCKET_HEADER 8
+
+// 磁盘上的可扩展哈希索引，只回答等值查找（= 条件、主键和唯一约束的重复检查）
+// 头页之后是目录页（2^globalDepth 项桶页号）和桶页；目录翻倍时追加目录页
+// 桶页：[页头][条目...]，条目为 [哈希值][RID][键槽位]，键槽位的格式同 B+ 树；
+// 页内条目按哈希值排序，查找时按哈希值的比例猜位置再二分
+// 桶满时按哈希值的下一位分裂；桶里的键哈希值全都相同或深度到上限时改挂溢出页
+// 允许重复键，条目由 (key, RID) 区分；删除不收缩目录
+class HashIndex {
+private:
+    FileManager* fileManager;
+    BufPageManager* bufPageManager;
+    int fileID;
+    KeyType keyType;
+    int keyLength;          // VARCHAR的长度
+    int keyInts;            // 每个键槽位占用的 int 数
+    int entryInts;          // 每个条目占用的 int 数
+    int capacity;           // 每页最多的条目数
+    int globalDepth;
+    std::vector<int> dirPages;  // 目录页号，与头页中的列表一致
+
+    void calculateLayout();
+    void storeKey(unsigned int* slot, int key);
+    void storeKey(unsigned int* slot, float key);
+    void storeKey(unsigned int* slot, const std::string& key);
+    int usedKeyInts(const unsigned int* slot) const;
+    unsigned int hashSlot(const unsigned int* slot) const;
+    bool matches(const unsigned int* entry, unsigned int hash, const unsigned int* slot) const;
+    unsigned int* entryAt(BufType page, int i) const { return page + HASH_BUCKET_HEADER + i * entryInts; }
+    int lowerBound(BufType page, unsigned int hash) const;   // 页内第一个哈希值 >= hash 的条目
+
+    int allocatePage();
+    void freePage(int pageNum);
+    int newBucketPage(int type, int localDepth);
+    void addRecordCount(int delta);
+
+    // 目录
+    int directoryEntry(int i);
+    void setDirectoryEntry(int i, int pageNum);
+    bool doubleDirectory();
+
+    // 桶链：读出全部条目 / 按顺序写回，页不够时追加溢出页，多余的页回收
+    void readChain(int bucketPage, std::vector<unsigned int>& entries, std::vector<int>& pages);
+    void writeChain(std::vector<int>& pages, const std::vector<unsigned int>& unsorted);
+    bool splitBucket(int bucketPage, int dirIndex);
+    int largestHashGroup(int bucketPage);   // 桶链中哈希值相同的条目最多有几个
+
+    bool insertSlot(const unsigned int* slot, const RID& rid);
+    bool removeSlot(const unsigned int* slot, const RID& rid);
+    std::vector<RID> lookupSlot(const unsigned int* slot);
+
+public:
+    HashIndex(FileManager* fm, BufPageManager* bpm, int fid, KeyType kType, int kLen = 0);
+
+    bool initialize();
+    bool load();
+
+    // FLOAT 键与 B+ 树一样按 float 存放
+    bool insert(int key, const RID& rid);
+    bool insert(float key, const RID& rid);
+    bool insert(const std::string& key, const RID& rid);
+    bool remove(int key, const RID& rid);
+    bool remove(float key, const RID& rid);
+    bool remove(const std::string& key, const RID& rid);
+    std::vector<RID> lookup(int key);
+    std::vector<RID> lookup(float key);
+    std::vector<RID> lookup(const std::string& key);
+
+    KeyType getKeyType() const { return keyType; }
+    int getGlobalDepth() const { return globalDepth; }
+    long long getRecordCount();
+};
+
+#endif
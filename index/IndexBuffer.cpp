@@ -0,0 +1,292 @@
+#include "IndexBuffer.h"
+#include <cstring>
+#include <queue>
+
+IndexBuffer::IndexBuffer(BPlusTree* t, const std::string& path)
+    : tree(t), prefix(path), keyInts(t->getKeyInts()), recInts(t->getKeyInts() + 2), log(nullptr),
+      memtable(RecordLess{this}) {
+}
+IndexBuffer::~IndexBuffer() {
+    if (log) fclose(log);
+    for (auto& run : runs) {
+        fclose(run->file);
+    }
+}
+int IndexBuffer::compareRecords(const unsigned int* a, const unsigned int* b) const {
+    int c = tree->compareKeySlots(a, b);
+    if (c != 0) return c;
+    return BPlusTree::compareRids(recordRid(a, keyInts), recordRid(b, keyInts));
+}
+void IndexBuffer::fillRecord(unsigned int* rec, const unsigned int* slot, const RID& rid) const {
+    memcpy(rec, slot, keyInts * sizeof(unsigned int));
+    rec[keyInts] = static_cast<unsigned int>(rid.pageNum);
+    rec[keyInts + 1] = static_cast<unsigned int>(rid.slotNum);
+}
+bool IndexBuffer::open() {
+    // 日志里是上次写成段之后的插入，逐条放回内存缓冲（重复的忽略）
+    std::vector<unsigned int> rec(recInts);
+    FILE* f = fopen(logPath().c_str(), "rb");
+    if (f) {
+        while (fread(rec.data(), sizeof(unsigned int), recInts, f) == (size_t)recInts) {
+            addRecord(rec.data());
+        }
+        fclose(f);
+    }
+    // 段文件从 run0 起连续编号，写到一半的临时文件丢掉（其条目仍在日志里）
+    for (int n = 0;; n++) {
+        remove((runPath(n) + ".tmp").c_str());
+        if (!loadRun(runPath(n))) break;
+    }
+    log = fopen(logPath().c_str(), "ab");
+    return log != nullptr;
+}
+bool IndexBuffer::loadRun(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    long long header[3];
+    if (fread(header, sizeof(header), 1, f) != 1 || header[0] != IB_RUN_MAGIC || header[2] != keyInts) {
+        fclose(f);
+        return false;
+    }
+    auto run = std::make_unique<Run>();
+    run->path = path;
+    run->file = f;
+    run->count = header[1];
+    run->filter.reset(run->count);
+    std::vector<unsigned int> rec(recInts);
+    for (long long i = 0; i < run->count; i++) {
+        if (fread(rec.data(), sizeof(unsigned int), recInts, f) != (size_t)recInts) {
+            fclose(f);
+            return false;
+        }
+        indexRecord(*run, i, rec.data());
+    }
+    runs.push_back(std::move(run));
+    return true;
+}
+void IndexBuffer::indexRecord(Run& run, long long i, const unsigned int* rec) {
+    if (i % IB_SPARSE_STEP == 0) {
+        run.sparse.insert(run.sparse.end(), rec, rec + keyInts);
+    }
+    run.filter.add(tree->keySlotHash(rec));
+}
+bool IndexBuffer::addRecord(const unsigned int* rec) {
+    int index = (int)(records.size() / recInts);
+    records.insert(records.end(), rec, rec + recInts);
+    if (!memtable.insert(index).second) {
+        records.resize(records.size() - recInts);
+        return false;
+    }
+    return true;
+}
+template <typename K>
+bool IndexBuffer::insert(const K& key, const RID& rid) {
+    unsigned int slot[BP_MAX_KEY_INTS];
+    if (!tree->encodeKey(key, slot)) {
+        return tree->insert(key, rid);
+    }
+    RID found;
+    if (tree->isUnique() && (lookup(slot, found) || tree->search(key, found))) {
+        return false;
+    }
+    std::vector<unsigned int> rec(recInts);
+    fillRecord(rec.data(), slot, rid);
+    if (!addRecord(rec.data())) return false;
+    fwrite(rec.data(), sizeof(unsigned int), recInts, log);
+    if ((long long)memtable.size() >= IB_MEMTABLE_ENTRIES) {
+        flush();
+    }
+    return true;
+}
+template <typename K>
+bool IndexBuffer::search(const K& key, RID& rid) {
+    unsigned int slot[BP_MAX_KEY_INTS];
+    if (!tree->encodeKey(key, slot)) {
+        merge();
+        return tree->search(key, rid);
+    }
+    return lookup(slot, rid) || tree->search(key, rid);
+}
+template <typename K>
+bool IndexBuffer::mayContain(const K& key) {
+    unsigned int slot[BP_MAX_KEY_INTS];
+    if (!tree->encodeKey(key, slot)) {
+        merge();
+        return tree->mayContain(key);
+    }
+    RID rid;
+    return lookup(slot, rid) || tree->mayContain(key);
+}
+template bool IndexBuffer::insert<int>(const int&, const RID&);
+template bool IndexBuffer::insert<float>(const float&, const RID&);
+template bool IndexBuffer::insert<std::string>(const std::string&, const RID&);
+template bool IndexBuffer::insert<CompositeKey>(const CompositeKey&, const RID&);
+template bool IndexBuffer::search<int>(const int&, RID&);
+template bool IndexBuffer::search<float>(const float&, RID&);
+template bool IndexBuffer::search<std::string>(const std::string&, RID&);
+template bool IndexBuffer::search<CompositeKey>(const CompositeKey&, RID&);
+template bool IndexBuffer::mayContain<int>(const int&);
+template bool IndexBuffer::mayContain<float>(const float&);
+template bool IndexBuffer::mayContain<std::string>(const std::string&);
+template bool IndexBuffer::mayContain<CompositeKey>(const CompositeKey&);
+// 探针记录的 RID 取 (-1, -1)，排在同键的所有条目之前；新写的段在后，从后往前查
+bool IndexBuffer::lookup(const unsigned int* slot, RID& rid) {
+    std::vector<unsigned int> probe(recInts);
+    fillRecord(probe.data(), slot, RID());
+    auto it = memtable.lower_bound(probe.data());
+    if (it != memtable.end() && tree->compareKeySlots(record(*it), slot) == 0) {
+        rid = recordRid(record(*it), keyInts);
+        return true;
+    }
+    for (int i = (int)runs.size() - 1; i >= 0; i--) {
+        if (lookupRun(*runs[i], slot, rid)) return true;
+    }
+    return false;
+}
+// 稀疏索引中第一个不小于键的是第 b 项，则第一条不小于键的记录落在 [(b-1)*STEP, b*STEP] 里，
+// 只读这一段
+bool IndexBuffer::lookupRun(Run& run, const unsigned int* slot, RID& rid) {
+    if (run.count == 0 || !run.filter.mayContain(tree->keySlotHash(slot))) return false;
+    long long lo = 0;
+    long long hi = (long long)(run.sparse.size() / keyInts);
+    while (lo < hi) {
+        long long mid = (lo + hi) / 2;
+        if (tree->compareKeySlots(run.sparse.data() + mid * keyInts, slot) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    long long first = lo > 0 ? (lo - 1) * IB_SPARSE_STEP : 0;
+    long long last = std::min(lo * IB_SPARSE_STEP, run.count - 1);
+    std::vector<unsigned int> block((size_t)(last - first + 1) * recInts);
+    long offset = (long)(sizeof(long long) * 3 + first * recInts * sizeof(unsigned int));
+    if (fseek(run.file, offset, SEEK_SET) != 0 ||
+        fread(block.data(), sizeof(unsigned int), block.size(), run.file) != block.size()) {
+        return false;
+    }
+    for (long long i = 0; i <= last - first; i++) {
+        const unsigned int* rec = block.data() + i * recInts;
+        int c = tree->compareKeySlots(rec, slot);
+        if (c == 0) {
+            rid = recordRid(rec, keyInts);
+            return true;
+        }
+        if (c > 0) break;
+    }
+    return false;
+}
+// 内存缓冲按序写成下一个段：先写临时文件再改名，之后清空日志；稀疏索引和过滤器边写边建
+bool IndexBuffer::flush() {
+    if (memtable.empty()) return true;
+    auto run = std::make_unique<Run>();
+    run->path = runPath((int)runs.size());
+    run->count = (long long)memtable.size();
+    run->filter.reset(run->count);
+    std::string tmpPath = run->path + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) return false;
+    long long header[3] = {IB_RUN_MAGIC, run->count, keyInts};
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+    long long i = 0;
+    for (int index : memtable) {
+        if (!ok) break;
+        ok = fwrite(record(index), sizeof(unsigned int), recInts, f) == (size_t)recInts;
+        indexRecord(*run, i++, record(index));
+    }
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmpPath.c_str(), run->path.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    run->file = fopen(run->path.c_str(), "rb");
+    if (!run->file) return false;
+    runs.push_back(std::move(run));
+    memtable.clear();
+    records.clear();
+    if (log) fclose(log);
+    log = fopen(logPath().c_str(), "wb");
+    return log != nullptr;
+}
+long long IndexBuffer::size() const {
+    long long n = (long long)memtable.size();
+    for (const auto& run : runs) {
+        n += run->count;
+    }
+    return n;
+}
+// 各段（内存缓冲先写成一段）多路归并后按键序逐条插入；插入失败的是上次并到一半时已插过的，
+// 跳过即可。没有段时内存缓冲本身有序，直接插入
+bool IndexBuffer::merge() {
+    if (memtable.empty() && runs.empty()) return true;
+    if (runs.empty()) {
+        for (int index : memtable) {
+            tree->insertSlot(record(index), recordRid(record(index), keyInts));
+        }
+    } else {
+        if (!flush()) return false;
+        struct Cursor {
+            FILE* file;
+            long long left;
+            std::vector<unsigned int> rec;
+        };
+        std::vector<Cursor> cursors(runs.size());
+        auto greater = [this, &cursors](int a, int b) {
+            return compareRecords(cursors[a].rec.data(), cursors[b].rec.data()) > 0;
+        };
+        std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+        for (size_t i = 0; i < runs.size(); i++) {
+            Cursor& cur = cursors[i];
+            cur.file = runs[i]->file;
+            cur.left = runs[i]->count;
+            cur.rec.resize(recInts);
+            fseek(cur.file, sizeof(long long) * 3, SEEK_SET);
+            if (cur.left > 0 && fread(cur.rec.data(), sizeof(unsigned int), recInts, cur.file) == (size_t)recInts) {
+                cur.left--;
+                heap.push((int)i);
+            }
+        }
+        while (!heap.empty()) {
+            int i = heap.top();
+            heap.pop();
+            Cursor& cur = cursors[i];
+            tree->insertSlot(cur.rec.data(), recordRid(cur.rec.data(), keyInts));
+            if (cur.left > 0 && fread(cur.rec.data(), sizeof(unsigned int), recInts, cur.file) == (size_t)recInts) {
+                cur.left--;
+                heap.push(i);
+            }
+        }
+    }
+    memtable.clear();
+    records.clear();
+    for (auto& run : runs) {
+        fclose(run->file);
+        remove(run->path.c_str());
+    }
+    runs.clear();
+    if (log) fclose(log);
+    log = fopen(logPath().c_str(), "wb");
+    return log != nullptr;
+}
+void IndexBuffer::sync() {
+    if (log) fflush(log);
+}
+void IndexBuffer::discard() {
+    if (log) fclose(log);
+    log = nullptr;
+    for (auto& run : runs) {
+        fclose(run->file);
+    }
+    runs.clear();
+    memtable.clear();
+    records.clear();
+    removeFiles(prefix);
+}
+void IndexBuffer::removeFiles(const std::string& prefix) {
+    remove((prefix + ".ilog").c_str());
+    for (int n = 0;; n++) {
+        std::string path = prefix + ".run" + std::to_string(n);
+        remove((path + ".tmp").c_str());
+        if (remove(path.c_str()) != 0) break;
+    }
+}
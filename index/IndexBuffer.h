@@ -0,0 +1,87 @@
+#ifndef INDEX_BUFFER_H
+#define INDEX_BUFFER_H
+
+#include "BPlusTree.h"
+#include "BloomFilter.h"
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#define IB_RUN_MAGIC 0x49425231
+#define IB_MEMTABLE_ENTRIES 16384      // 内存缓冲的条目数上限（放得进缓存），满了整体写成一个有序段
+#define IB_MAX_RUNS 4                  // 段数达到后由 IndexManager 在语句之间并入 B+ 树
+#define IB_SPARSE_STEP 64              // 段文件每隔多少条在内存里留一个键（稀疏索引）
+
+// 写优化的索引缓冲（LSM 风格），挂在一棵 B+ 树前面：
+// 插入先追加到日志（table_col.ilog），再放进内存中按 (键, RID) 有序的缓冲；缓冲满了写成一个
+// 有序段（table_col.run0、run1 ...），日志随之清空。段积累多了就多路归并、按键序插入 B+ 树，
+// 相邻的键落在同一个叶子上，不再是每条一次随机下降
+// 只缓冲插入：等值查找依次查内存缓冲、各段（先问段的布隆过滤器）和 B+ 树；
+// 删除、范围查找、游标等其余操作之前由 IndexManager 调 merge() 全部并入，再直接用树
+class IndexBuffer {
+private:
+    struct Run {
+        std::string path;
+        FILE* file;
+        long long count;
+        std::vector<unsigned int> sparse;   // 第 0、STEP、2*STEP ... 条的键槽位
+        BloomFilter filter;
+    };
+    // 内存缓冲的记录连续存放在 records 里，有序集合只存下标；查找时用探针记录比较
+    struct RecordLess {
+        const IndexBuffer* buffer;
+        typedef void is_transparent;
+        bool operator()(int a, int b) const { return buffer->compareRecords(buffer->record(a), buffer->record(b)) < 0; }
+        bool operator()(int a, const unsigned int* b) const { return buffer->compareRecords(buffer->record(a), b) < 0; }
+        bool operator()(const unsigned int* a, int b) const { return buffer->compareRecords(a, buffer->record(b)) < 0; }
+    };
+
+    BPlusTree* tree;
+    std::string prefix;         // 目录/table_col，日志和段文件由它加后缀得到
+    int keyInts;
+    int recInts;                // 一条记录：[键槽位 keyInts][页号][槽号]
+    FILE* log;
+    std::vector<unsigned int> records;
+    std::set<int, RecordLess> memtable;
+    std::vector<std::unique_ptr<Run>> runs;
+
+    const unsigned int* record(int i) const { return records.data() + (size_t)i * recInts; }
+    int compareRecords(const unsigned int* a, const unsigned int* b) const;
+    void fillRecord(unsigned int* rec, const unsigned int* slot, const RID& rid) const;
+    static RID recordRid(const unsigned int* rec, int keyInts) {
+        return RID(static_cast<int>(rec[keyInts]), static_cast<int>(rec[keyInts + 1]));
+    }
+    std::string logPath() const { return prefix + ".ilog"; }
+    std::string runPath(int n) const { return prefix + ".run" + std::to_string(n); }
+
+    bool addRecord(const unsigned int* rec);        // 放进内存缓冲；(键, RID) 已在其中时返回 false
+    bool lookup(const unsigned int* slot, RID& rid);
+    bool lookupRun(Run& run, const unsigned int* slot, RID& rid);
+    bool loadRun(const std::string& path);
+    void indexRecord(Run& run, long long i, const unsigned int* rec);   // 第 i 条记录加入稀疏索引和过滤器
+    bool flush();
+
+public:
+    IndexBuffer(BPlusTree* tree, const std::string& prefix);
+    ~IndexBuffer();
+    // 回放日志、读入已有的段；上次没有并入的条目都还在
+    bool open();
+
+    // 唯一索引的键已在缓冲或树中时返回 false；键类型不符时交给树处理
+    template <typename K> bool insert(const K& key, const RID& rid);
+    // 前缀键没法在缓冲里按槽位找，先全部并入再查树
+    template <typename K> bool search(const K& key, RID& rid);
+    template <typename K> bool mayContain(const K& key);
+
+    long long size() const;          // 缓冲着的条目数（内存缓冲 + 各段）
+    int runCount() const { return (int)runs.size(); }
+    // 把内存缓冲和各段按键序并入 B+ 树，删掉段文件并清空日志
+    bool merge();
+    void sync();                     // 日志写到文件
+    // 关闭并删掉日志和段文件（索引删除或缓冲已并入后不再使用时）
+    void discard();
+    static void removeFiles(const std::string& prefix);
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "IndexManager.h"
 #include <fstream>
 #include <sys/stat.h>
+#include <unistd.h>
 
 IndexManager::IndexManager(FileManager* fm, BufPageManager* bpm, const std::string& path)
     : fileManager(fm), bufPageManager(bpm), basePath(path) {
@@ -11,11 +12,17 @@ IndexManager::~IndexManager() {
 std::string IndexManager::getIndexPath(const std::string& tableName, const std::string& columnName) {
     return basePath + "/" + tableName + "_" + columnName + ".idx";
 }
+std::string IndexManager::getHashIndexPath(const std::string& tableName, const std::string& columnName) {
+    return basePath + "/" + tableName + "_" + columnName + ".hash";
+}
+std::string IndexManager::getBloomPath(const std::string& indexKey) {
+    return basePath + "/" + indexKey + ".bloom";
+}
 std::string IndexManager::getIndexKey(const std::string& tableName, const std::string& columnName) {
     return tableName + "_" + columnName;
 }
 bool IndexManager::createIndex(const std::string& tableName, const std::string& columnName,
-                                KeyType keyType, int keyLength) {
+                                KeyType keyType, int keyLength, bool unique) {
     std::string indexPath = getIndexPath(tableName, columnName);
     std::string indexKey = getIndexKey(tableName, columnName);
     if (indexExists(tableName, columnName)) {
@@ -29,20 +36,61 @@ bool IndexManager::createIndex(const std::string& tableName, const std::string&
         return false;
     }
     auto tree = std::make_unique<BPlusTree>(fileManager, bufPageManager, fileID, keyType, keyLength);
-    if (!tree->initialize()) {
+    if (!tree->initialize(unique)) {
+        fileManager->closeFile(fileID);
+        return false;
+    }
+    if (unique) tree->enableFilter();
+    indexFileIDs[indexKey] = fileID;
+    openIndexes[indexKey] = std::move(tree);
+    return true;
+}
+bool IndexManager::createIndex(const std::string& tableName, const std::string& columnName,
+                                const std::vector<KeyPart>& parts, bool unique) {
+    std::string indexPath = getIndexPath(tableName, columnName);
+    std::string indexKey = getIndexKey(tableName, columnName);
+    if (parts.empty() || parts.size() > BP_MAX_KEY_PARTS || indexExists(tableName, columnName)) {
+        return false;
+    }
+    if (!fileManager->createFile(indexPath.c_str())) {
+        return false;
+    }
+    int fileID;
+    if (!fileManager->openFile(indexPath.c_str(), fileID)) {
+        return false;
+    }
+    auto tree = std::make_unique<BPlusTree>(fileManager, bufPageManager, fileID, parts);
+    if (!tree->initialize(unique)) {
         fileManager->closeFile(fileID);
         return false;
     }
+    if (unique) tree->enableFilter();
     indexFileIDs[indexKey] = fileID;
     openIndexes[indexKey] = std::move(tree);
     return true;
 }
+std::string IndexManager::compositeName(const std::vector<std::string>& columns) {
+    std::string name;
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (i > 0) name += "+";
+        name += columns[i];
+    }
+    return name;
+}
 bool IndexManager::dropIndex(const std::string& tableName, const std::string& columnName) {
     std::string indexPath = getIndexPath(tableName, columnName);
     std::string indexKey = getIndexKey(tableName, columnName);
+    auto bit = buffers.find(indexKey);
+    if (bit != buffers.end()) {
+        bit->second->discard();
+        buffers.erase(bit);
+    } else {
+        IndexBuffer::removeFiles(basePath + "/" + indexKey);
+    }
     if (openIndexes.find(indexKey) != openIndexes.end()) {
         closeIndex(tableName, columnName);
     }
+    remove(getBloomPath(indexKey).c_str());
     return (remove(indexPath.c_str()) == 0);
 }
 bool IndexManager::indexExists(const std::string& tableName, const std::string& columnName) {
@@ -50,10 +98,21 @@ bool IndexManager::indexExists(const std::string& tableName, const std::string&
     struct stat buffer;
     return (stat(indexPath.c_str(), &buffer) == 0);
 }
+bool IndexManager::isUniqueIndex(const std::string& tableName, const std::string& columnName) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    return tree && tree->isUnique();
+}
 BPlusTree* IndexManager::openIndex(const std::string& tableName, const std::string& columnName) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    IndexBuffer* buffer = getBuffer(tableName, columnName, tree);
+    if (buffer) buffer->merge();
+    return tree;
+}
+BPlusTree* IndexManager::openTree(const std::string& tableName, const std::string& columnName) {
     std::string indexKey = getIndexKey(tableName, columnName);
-    if (openIndexes.find(indexKey) != openIndexes.end()) {
-        return openIndexes[indexKey].get();
+    auto it = openIndexes.find(indexKey);
+    if (it != openIndexes.end()) {
+        return it->second.get();
     }
     if (!indexExists(tableName, columnName)) {
         return nullptr;
@@ -68,6 +127,18 @@ BPlusTree* IndexManager::openIndex(const std::string& tableName, const std::stri
         fileManager->closeFile(fileID);
         return nullptr;
     }
+    // 唯一索引带布隆过滤器：文件只在正常关闭时写出，读入后即删除，
+    // 没有文件（旧库或上次没有正常关闭）就从叶子重建
+    if (tree->isUnique()) {
+        std::string bloomPath = getBloomPath(indexKey);
+        auto filter = std::make_unique<BloomFilter>();
+        if (filter->load(bloomPath)) {
+            tree->attachFilter(std::move(filter));
+        } else {
+            tree->enableFilter();
+        }
+        remove(bloomPath.c_str());
+    }
     indexFileIDs[indexKey] = fileID;
     BPlusTree* ptr = tree.get();
     openIndexes[indexKey] = std::move(tree);
@@ -76,7 +147,9 @@ BPlusTree* IndexManager::openIndex(const std::string& tableName, const std::stri
 void IndexManager::closeIndex(const std::string& tableName, const std::string& columnName) {
     std::string indexKey = getIndexKey(tableName, columnName);
     
+    buffers.erase(indexKey);
     if (openIndexes.find(indexKey) != openIndexes.end()) {
+        saveFilter(indexKey, openIndexes[indexKey].get());
         openIndexes.erase(indexKey);
         if (indexFileIDs.find(indexKey) != indexFileIDs.end()) {
             fileManager->closeFile(indexFileIDs[indexKey]);
@@ -84,8 +157,79 @@ void IndexManager::closeIndex(const std::string& tableName, const std::string& c
         }
     }
 }
+bool IndexManager::optimizeIndex(const std::string& tableName, const std::string& columnName, int fillPercent,
+                                  int& pagesBefore, int& pagesAfter) {
+    BPlusTree* tree = openIndex(tableName, columnName);
+    if (!tree || !tree->compact(fillPercent, pagesBefore, pagesAfter)) {
+        return false;
+    }
+    // 早先的定长组合键索引整理成新布局后才能带过滤器
+    if (tree->isUnique() && !tree->getFilter()) {
+        tree->enableFilter();
+    }
+    // 尾部旧页的缓存已丢弃，新树的页之后写回时会重新扩展文件
+    std::string indexPath = getIndexPath(tableName, columnName);
+    if (pagesAfter < pagesBefore) {
+        truncate(indexPath.c_str(), (off_t)pagesAfter * PAGE_SIZE);
+    }
+    return true;
+}
+// 表打开缓冲且索引的槽位能解回键时才经过缓冲；第一次用到时打开，回放上次留下的日志和段
+IndexBuffer* IndexManager::getBuffer(const std::string& tableName, const std::string& columnName,
+                                     BPlusTree* tree) {
+    if (!tree || bufferedTables.count(tableName) == 0 || !tree->bufferable()) {
+        return nullptr;
+    }
+    std::string indexKey = getIndexKey(tableName, columnName);
+    auto it = buffers.find(indexKey);
+    if (it != buffers.end()) {
+        return it->second.get();
+    }
+    auto buffer = std::make_unique<IndexBuffer>(tree, basePath + "/" + indexKey);
+    if (!buffer->open()) {
+        return nullptr;
+    }
+    IndexBuffer* ptr = buffer.get();
+    buffers[indexKey] = std::move(buffer);
+    return ptr;
+}
+void IndexManager::setBuffered(const std::string& tableName, bool on) {
+    if (on) {
+        bufferedTables.insert(tableName);
+    } else {
+        bufferedTables.erase(tableName);
+    }
+}
+bool IndexManager::unbufferIndex(const std::string& tableName, const std::string& columnName) {
+    IndexBuffer* buffer = getBuffer(tableName, columnName, openTree(tableName, columnName));
+    if (!buffer) return true;
+    if (!buffer->merge()) return false;
+    buffer->discard();
+    buffers.erase(getIndexKey(tableName, columnName));
+    return true;
+}
+long long IndexManager::bufferedEntries(const std::string& tableName, const std::string& columnName) {
+    IndexBuffer* buffer = getBuffer(tableName, columnName, openTree(tableName, columnName));
+    return buffer ? buffer->size() : 0;
+}
+void IndexManager::maintainBuffers() {
+    for (auto& pair : buffers) {
+        pair.second->sync();
+        if (pair.second->runCount() >= IB_MAX_RUNS) {
+            pair.second->merge();
+        }
+    }
+}
+void IndexManager::saveFilter(const std::string& indexKey, BPlusTree* tree) {
+    const BloomFilter* filter = tree->getFilter();
+    if (filter) {
+        filter->save(getBloomPath(indexKey));
+    }
+}
 void IndexManager::closeAll() {
+    buffers.clear();
     for (auto& pair : openIndexes) {
+        saveFilter(pair.first, pair.second.get());
         pair.second.reset();
     }
     openIndexes.clear();
@@ -93,32 +237,46 @@ void IndexManager::closeAll() {
         fileManager->closeFile(pair.second);
     }
     indexFileIDs.clear();
+    openHashIndexes.clear();
+    for (auto& pair : hashFileIDs) {
+        fileManager->closeFile(pair.second);
+    }
+    hashFileIDs.clear();
 }
 bool IndexManager::insertEntry(const std::string& tableName, const std::string& columnName,
                                 int key, const RID& rid) {
-    BPlusTree* tree = openIndex(tableName, columnName);
+    BPlusTree* tree = openTree(tableName, columnName);
     if (!tree || tree->getKeyType() != KeyType::INT) {
         return false;
     }
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->insert(key, rid);
+    }
     return tree->insert(key, rid);
 }
 
 bool IndexManager::insertEntry(const std::string& tableName, const std::string& columnName,
                                 double key, const RID& rid) {
-    BPlusTree* tree = openIndex(tableName, columnName);
+    BPlusTree* tree = openTree(tableName, columnName);
     if (!tree || tree->getKeyType() != KeyType::FLOAT) {
         return false;
     }
     float fkey = (float)key;
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->insert(fkey, rid);
+    }
     return tree->insert(fkey, rid);
 }
 
 bool IndexManager::insertEntry(const std::string& tableName, const std::string& columnName,
                                 const std::string& key, const RID& rid) {
-    BPlusTree* tree = openIndex(tableName, columnName);
+    BPlusTree* tree = openTree(tableName, columnName);
     if (!tree || tree->getKeyType() != KeyType::VARCHAR) {
         return false;
     }
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->insert(key, rid);
+    }
     return tree->insert(key, rid);
 }
 
@@ -148,34 +306,102 @@ bool IndexManager::deleteEntry(const std::string& tableName, const std::string&
     return tree->remove(key);
 }
 
+bool IndexManager::deleteEntry(const std::string& tableName, const std::string& columnName,
+                                int key, const RID& rid) {
+    BPlusTree* tree = openIndex(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::INT) {
+        return false;
+    }
+    return tree->remove(key, rid);
+}
+
+bool IndexManager::deleteEntry(const std::string& tableName, const std::string& columnName,
+                                double key, const RID& rid) {
+    BPlusTree* tree = openIndex(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::FLOAT) {
+        return false;
+    }
+    float fkey = (float)key;
+    return tree->remove(fkey, rid);
+}
+
+bool IndexManager::deleteEntry(const std::string& tableName, const std::string& columnName,
+                                const std::string& key, const RID& rid) {
+    BPlusTree* tree = openIndex(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::VARCHAR) {
+        return false;
+    }
+    return tree->remove(key, rid);
+}
+
 bool IndexManager::searchEntry(const std::string& tableName, const std::string& columnName,
                                 int key, RID& rid) {
-    BPlusTree* tree = openIndex(tableName, columnName);
+    BPlusTree* tree = openTree(tableName, columnName);
     if (!tree || tree->getKeyType() != KeyType::INT) {
         return false;
     }
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->search(key, rid);
+    }
     return tree->search(key, rid);
 }
 
 bool IndexManager::searchEntry(const std::string& tableName, const std::string& columnName,
                                 double key, RID& rid) {
-    BPlusTree* tree = openIndex(tableName, columnName);
+    BPlusTree* tree = openTree(tableName, columnName);
     if (!tree || tree->getKeyType() != KeyType::FLOAT) {
         return false;
     }
     float fkey = (float)key;
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->search(fkey, rid);
+    }
     return tree->search(fkey, rid);
 }
 
 bool IndexManager::searchEntry(const std::string& tableName, const std::string& columnName,
                                 const std::string& key, RID& rid) {
-    BPlusTree* tree = openIndex(tableName, columnName);
+    BPlusTree* tree = openTree(tableName, columnName);
     if (!tree || tree->getKeyType() != KeyType::VARCHAR) {
         return false;
     }
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->search(key, rid);
+    }
     return tree->search(key, rid);
 }
 
+bool IndexManager::mayContain(const std::string& tableName, const std::string& columnName, int key) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::INT) return true;
+    IndexBuffer* buffer = getBuffer(tableName, columnName, tree);
+    return buffer ? buffer->mayContain(key) : tree->mayContain(key);
+}
+
+bool IndexManager::mayContain(const std::string& tableName, const std::string& columnName, double key) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    float fkey = (float)key;
+    if (!tree || tree->getKeyType() != KeyType::FLOAT) return true;
+    IndexBuffer* buffer = getBuffer(tableName, columnName, tree);
+    return buffer ? buffer->mayContain(fkey) : tree->mayContain(fkey);
+}
+
+bool IndexManager::mayContain(const std::string& tableName, const std::string& columnName,
+                               const std::string& key) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::VARCHAR) return true;
+    IndexBuffer* buffer = getBuffer(tableName, columnName, tree);
+    return buffer ? buffer->mayContain(key) : tree->mayContain(key);
+}
+
+bool IndexManager::mayContain(const std::string& tableName, const std::string& columnName,
+                               const CompositeKey& key) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::COMPOSITE) return true;
+    IndexBuffer* buffer = getBuffer(tableName, columnName, tree);
+    return buffer ? buffer->mayContain(key) : tree->mayContain(key);
+}
+
 std::vector<RID> IndexManager::rangeSearch(const std::string& tableName, const std::string& columnName,
                                             int lowKey, int highKey, bool includeLow, bool includeHigh) {
     BPlusTree* tree = openIndex(tableName, columnName);
@@ -206,3 +432,164 @@ std::vector<RID> IndexManager::rangeSearch(const std::string& tableName, const s
     return tree->rangeSearch(lowKey, highKey, includeLow, includeHigh);
 }
 
+bool IndexManager::insertEntry(const std::string& tableName, const std::string& columnName,
+                                const CompositeKey& key, const RID& rid) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::COMPOSITE) {
+        return false;
+    }
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->insert(key, rid);
+    }
+    return tree->insert(key, rid);
+}
+
+bool IndexManager::deleteEntry(const std::string& tableName, const std::string& columnName,
+                                const CompositeKey& key, const RID& rid) {
+    BPlusTree* tree = openIndex(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::COMPOSITE) {
+        return false;
+    }
+    return tree->remove(key, rid);
+}
+
+bool IndexManager::searchEntry(const std::string& tableName, const std::string& columnName,
+                                const CompositeKey& key, RID& rid) {
+    BPlusTree* tree = openTree(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::COMPOSITE) {
+        return false;
+    }
+    if (IndexBuffer* buffer = getBuffer(tableName, columnName, tree)) {
+        return buffer->search(key, rid);
+    }
+    return tree->search(key, rid);
+}
+
+std::vector<RID> IndexManager::rangeSearch(const std::string& tableName, const std::string& columnName,
+                                            const CompositeKey& lowKey, const CompositeKey& highKey,
+                                            bool includeLow, bool includeHigh) {
+    BPlusTree* tree = openIndex(tableName, columnName);
+    if (!tree || tree->getKeyType() != KeyType::COMPOSITE) {
+        return std::vector<RID>();
+    }
+    return tree->rangeSearch(lowKey, highKey, includeLow, includeHigh);
+}
+
+bool IndexManager::createHashIndex(const std::string& tableName, const std::string& columnName,
+                                    KeyType keyType, int keyLength) {
+    std::string indexPath = getHashIndexPath(tableName, columnName);
+    std::string indexKey = getIndexKey(tableName, columnName);
+    if (keyType == KeyType::COMPOSITE || hashIndexExists(tableName, columnName)) {
+        return false;
+    }
+    if (!fileManager->createFile(indexPath.c_str())) {
+        return false;
+    }
+    int fileID;
+    if (!fileManager->openFile(indexPath.c_str(), fileID)) {
+        return false;
+    }
+    auto index = std::make_unique<HashIndex>(fileManager, bufPageManager, fileID, keyType, keyLength);
+    if (!index->initialize()) {
+        fileManager->closeFile(fileID);
+        return false;
+    }
+    hashFileIDs[indexKey] = fileID;
+    openHashIndexes[indexKey] = std::move(index);
+    return true;
+}
+
+bool IndexManager::dropHashIndex(const std::string& tableName, const std::string& columnName) {
+    std::string indexKey = getIndexKey(tableName, columnName);
+    if (openHashIndexes.find(indexKey) != openHashIndexes.end()) {
+        openHashIndexes.erase(indexKey);
+        fileManager->closeFile(hashFileIDs[indexKey]);
+        hashFileIDs.erase(indexKey);
+    }
+    return (remove(getHashIndexPath(tableName, columnName).c_str()) == 0);
+}
+
+bool IndexManager::hashIndexExists(const std::string& tableName, const std::string& columnName) {
+    std::string indexPath = getHashIndexPath(tableName, columnName);
+    struct stat buffer;
+    return (stat(indexPath.c_str(), &buffer) == 0);
+}
+
+HashIndex* IndexManager::openHashIndex(const std::string& tableName, const std::string& columnName) {
+    std::string indexKey = getIndexKey(tableName, columnName);
+    auto it = openHashIndexes.find(indexKey);
+    if (it != openHashIndexes.end()) {
+        return it->second.get();
+    }
+    if (!hashIndexExists(tableName, columnName)) {
+        return nullptr;
+    }
+    std::string indexPath = getHashIndexPath(tableName, columnName);
+    int fileID;
+    if (!fileManager->openFile(indexPath.c_str(), fileID)) {
+        return nullptr;
+    }
+    auto index = std::make_unique<HashIndex>(fileManager, bufPageManager, fileID, KeyType::INT, 0);
+    if (!index->load()) {
+        fileManager->closeFile(fileID);
+        return nullptr;
+    }
+    hashFileIDs[indexKey] = fileID;
+    HashIndex* ptr = index.get();
+    openHashIndexes[indexKey] = std::move(index);
+    return ptr;
+}
+
+bool IndexManager::insertHashEntry(const std::string& tableName, const std::string& columnName,
+                                    int key, const RID& rid) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index && index->insert(key, rid);
+}
+
+bool IndexManager::insertHashEntry(const std::string& tableName, const std::string& columnName,
+                                    double key, const RID& rid) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index && index->insert((float)key, rid);
+}
+
+bool IndexManager::insertHashEntry(const std::string& tableName, const std::string& columnName,
+                                    const std::string& key, const RID& rid) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index && index->insert(key, rid);
+}
+
+bool IndexManager::deleteHashEntry(const std::string& tableName, const std::string& columnName,
+                                    int key, const RID& rid) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index && index->remove(key, rid);
+}
+
+bool IndexManager::deleteHashEntry(const std::string& tableName, const std::string& columnName,
+                                    double key, const RID& rid) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index && index->remove((float)key, rid);
+}
+
+bool IndexManager::deleteHashEntry(const std::string& tableName, const std::string& columnName,
+                                    const std::string& key, const RID& rid) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index && index->remove(key, rid);
+}
+
+std::vector<RID> IndexManager::hashLookup(const std::string& tableName, const std::string& columnName,
+                                           int key) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index ? index->lookup(key) : std::vector<RID>();
+}
+
+std::vector<RID> IndexManager::hashLookup(const std::string& tableName, const std::string& columnName,
+                                           double key) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index ? index->lookup((float)key) : std::vector<RID>();
+}
+
+std::vector<RID> IndexManager::hashLookup(const std::string& tableName, const std::string& columnName,
+                                           const std::string& key) {
+    HashIndex* index = openHashIndex(tableName, columnName);
+    return index ? index->lookup(key) : std::vector<RID>();
+}
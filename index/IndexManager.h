@@ -2,8 +2,11 @@
 #define INDEX_MANAGER_H
 
 #include "BPlusTree.h"
+#include "HashIndex.h"
+#include "IndexBuffer.h"
 #include <string>
 #include <map>
+#include <set>
 #include <memory>
 class IndexManager {
 private:
@@ -13,19 +16,38 @@ private:
     
     std::map<std::string, std::unique_ptr<BPlusTree>> openIndexes;
     std::map<std::string, int> indexFileIDs;
+    std::map<std::string, std::unique_ptr<HashIndex>> openHashIndexes;
+    std::map<std::string, int> hashFileIDs;
     std::string getIndexPath(const std::string& tableName, const std::string& columnName);
+    std::string getHashIndexPath(const std::string& tableName, const std::string& columnName);
+    std::string getBloomPath(const std::string& indexKey);   // 唯一索引的布隆过滤器（table_col.bloom）
+    void saveFilter(const std::string& indexKey, BPlusTree* tree);
     std::string getIndexKey(const std::string& tableName, const std::string& columnName);
+    // 写优化缓冲（见 IndexBuffer）：bufferedTables 中各表的 B+ 树索引，插入和等值查找经过缓冲，
+    // 其余操作通过 openIndex 取树时先把缓冲并入
+    std::set<std::string> bufferedTables;
+    std::map<std::string, std::unique_ptr<IndexBuffer>> buffers;
+    BPlusTree* openTree(const std::string& tableName, const std::string& columnName);   // 不并入缓冲
+    IndexBuffer* getBuffer(const std::string& tableName, const std::string& columnName, BPlusTree* tree);
     
 public:
     IndexManager(FileManager* fm, BufPageManager* bpm, const std::string& path);
     
     ~IndexManager();
     bool createIndex(const std::string& tableName, const std::string& columnName,
-                     KeyType keyType, int keyLength = 0);
+                     KeyType keyType, int keyLength = 0, bool unique = true);
+    // 组合索引：columnName 为 compositeName() 拼出的名字
+    bool createIndex(const std::string& tableName, const std::string& columnName,
+                     const std::vector<KeyPart>& parts, bool unique = true);
+    static std::string compositeName(const std::vector<std::string>& columns);
     bool dropIndex(const std::string& tableName, const std::string& columnName);
     bool indexExists(const std::string& tableName, const std::string& columnName);
+    bool isUniqueIndex(const std::string& tableName, const std::string& columnName);
     BPlusTree* openIndex(const std::string& tableName, const std::string& columnName);
     void closeIndex(const std::string& tableName, const std::string& columnName);
+    // 在线整理索引：按 fillPercent 重新装填后截掉文件尾部不再使用的页
+    bool optimizeIndex(const std::string& tableName, const std::string& columnName, int fillPercent,
+                       int& pagesBefore, int& pagesAfter);
     void closeAll();
     bool insertEntry(const std::string& tableName, const std::string& columnName,
                      int key, const RID& rid);
@@ -37,6 +59,13 @@ public:
     bool deleteEntry(const std::string& tableName, const std::string& columnName, double key);
     bool deleteEntry(const std::string& tableName, const std::string& columnName,
                      const std::string& key);
+    // 按 (key, RID) 删除，非唯一索引必须用这组接口
+    bool deleteEntry(const std::string& tableName, const std::string& columnName,
+                     int key, const RID& rid);
+    bool deleteEntry(const std::string& tableName, const std::string& columnName,
+                     double key, const RID& rid);
+    bool deleteEntry(const std::string& tableName, const std::string& columnName,
+                     const std::string& key, const RID& rid);
     bool searchEntry(const std::string& tableName, const std::string& columnName,
                      int key, RID& rid);
     bool searchEntry(const std::string& tableName, const std::string& columnName,
@@ -44,6 +73,11 @@ public:
 
     bool searchEntry(const std::string& tableName, const std::string& columnName,
                      const std::string& key, RID& rid);
+    // 索引的布隆过滤器判定键一定不存在时返回 false（不读索引页）；没有过滤器时总是 true
+    bool mayContain(const std::string& tableName, const std::string& columnName, int key);
+    bool mayContain(const std::string& tableName, const std::string& columnName, double key);
+    bool mayContain(const std::string& tableName, const std::string& columnName, const std::string& key);
+    bool mayContain(const std::string& tableName, const std::string& columnName, const CompositeKey& key);
     std::vector<RID> rangeSearch(const std::string& tableName, const std::string& columnName,
                                   int lowKey, int highKey, bool includeLow = true, bool includeHigh = true);
     std::vector<RID> rangeSearch(const std::string& tableName, const std::string& columnName,
@@ -51,6 +85,46 @@ public:
     std::vector<RID> rangeSearch(const std::string& tableName, const std::string& columnName,
                                   const std::string& lowKey, const std::string& highKey,
                                   bool includeLow = true, bool includeHigh = true);
+    bool insertEntry(const std::string& tableName, const std::string& columnName,
+                     const CompositeKey& key, const RID& rid);
+    bool deleteEntry(const std::string& tableName, const std::string& columnName,
+                     const CompositeKey& key, const RID& rid);
+    bool searchEntry(const std::string& tableName, const std::string& columnName,
+                     const CompositeKey& key, RID& rid);
+    // 键可以只给前几列，按前缀范围扫描
+    std::vector<RID> rangeSearch(const std::string& tableName, const std::string& columnName,
+                                  const CompositeKey& lowKey, const CompositeKey& highKey,
+                                  bool includeLow = true, bool includeHigh = true);
+    // 哈希索引：单列、只做等值查找，与同一列上的 B+ 树索引各用各的文件（table_col.hash）
+    bool createHashIndex(const std::string& tableName, const std::string& columnName,
+                         KeyType keyType, int keyLength = 0);
+    bool dropHashIndex(const std::string& tableName, const std::string& columnName);
+    bool hashIndexExists(const std::string& tableName, const std::string& columnName);
+    HashIndex* openHashIndex(const std::string& tableName, const std::string& columnName);
+    bool insertHashEntry(const std::string& tableName, const std::string& columnName,
+                         int key, const RID& rid);
+    bool insertHashEntry(const std::string& tableName, const std::string& columnName,
+                         double key, const RID& rid);
+    bool insertHashEntry(const std::string& tableName, const std::string& columnName,
+                         const std::string& key, const RID& rid);
+    bool deleteHashEntry(const std::string& tableName, const std::string& columnName,
+                         int key, const RID& rid);
+    bool deleteHashEntry(const std::string& tableName, const std::string& columnName,
+                         double key, const RID& rid);
+    bool deleteHashEntry(const std::string& tableName, const std::string& columnName,
+                         const std::string& key, const RID& rid);
+    std::vector<RID> hashLookup(const std::string& tableName, const std::string& columnName, int key);
+    std::vector<RID> hashLookup(const std::string& tableName, const std::string& columnName, double key);
+    std::vector<RID> hashLookup(const std::string& tableName, const std::string& columnName,
+                                const std::string& key);
+    // 按表选择索引的写入方式：打开后插入先进缓冲，由 maintainBuffers 在语句之间并入 B+ 树
+    void setBuffered(const std::string& tableName, bool on);
+    bool isBuffered(const std::string& tableName) const { return bufferedTables.count(tableName) > 0; }
+    // 缓冲全部并入 B+ 树并删掉其文件（关闭缓冲前对每个索引调用）
+    bool unbufferIndex(const std::string& tableName, const std::string& columnName);
+    long long bufferedEntries(const std::string& tableName, const std::string& columnName);
+    // 日志写到文件，段积累到 IB_MAX_RUNS 个的缓冲并入 B+ 树
+    void maintainBuffers();
     void setBasePath(const std::string& path) { basePath = path; }
 };
 
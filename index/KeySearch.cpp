@@ -0,0 +1,171 @@
+#include "KeySearch.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KEY_SEARCH_X86 1
+#endif
+
+typedef int (*IntCountFn)(const int*, int, int, bool);
+typedef int (*FloatCountFn)(const float*, int, float, bool);
+
+// 键有序，窗口内"小于 key（upper 时为小于等于）"的个数就是目标位置
+static int countIntScalar(const int* keys, int n, int key, bool upper) {
+    int c = 0;
+    if (upper) {
+        for (int i = 0; i < n; i++) c += (keys[i] <= key);
+    } else {
+        for (int i = 0; i < n; i++) c += (keys[i] < key);
+    }
+    return c;
+}
+static int countFloatScalar(const float* keys, int n, float key, bool upper) {
+    int c = 0;
+    if (upper) {
+        for (int i = 0; i < n; i++) c += (keys[i] <= key);
+    } else {
+        for (int i = 0; i < n; i++) c += (keys[i] < key);
+    }
+    return c;
+}
+
+#ifdef KEY_SEARCH_X86
+__attribute__((target("avx2")))
+static int countIntAVX2(const int* keys, int n, int key, bool upper) {
+    __m256i k = _mm256_set1_epi32(key);
+    int c = 0;
+    int i = 0;
+    // upper 时比较 key + 1 > v，等价于 v <= key（key 为 INT_MAX 时走标量）
+    if (upper) {
+        if (key == 0x7fffffff) return countIntScalar(keys, n, key, upper);
+        k = _mm256_set1_epi32(key + 1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(keys + i));
+        __m256i m = _mm256_cmpgt_epi32(k, v);
+        c += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+    }
+    return c + countIntScalar(keys + i, n - i, key, upper);
+}
+__attribute__((target("avx2")))
+static int countFloatAVX2(const float* keys, int n, float key, bool upper) {
+    __m256 k = _mm256_set1_ps(key);
+    int c = 0;
+    int i = 0;
+    if (upper) {
+        for (; i + 8 <= n; i += 8) {
+            __m256 m = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), k, _CMP_LE_OQ);
+            c += __builtin_popcount(_mm256_movemask_ps(m));
+        }
+    } else {
+        for (; i + 8 <= n; i += 8) {
+            __m256 m = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), k, _CMP_LT_OQ);
+            c += __builtin_popcount(_mm256_movemask_ps(m));
+        }
+    }
+    return c + countFloatScalar(keys + i, n - i, key, upper);
+}
+__attribute__((target("sse4.1")))
+static int countIntSSE4(const int* keys, int n, int key, bool upper) {
+    __m128i k = _mm_set1_epi32(key);
+    int c = 0;
+    int i = 0;
+    if (upper) {
+        if (key == 0x7fffffff) return countIntScalar(keys, n, key, upper);
+        k = _mm_set1_epi32(key + 1);
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        __m128i m = _mm_cmpgt_epi32(k, v);
+        c += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+    }
+    return c + countIntScalar(keys + i, n - i, key, upper);
+}
+__attribute__((target("sse4.1")))
+static int countFloatSSE4(const float* keys, int n, float key, bool upper) {
+    __m128 k = _mm_set1_ps(key);
+    int c = 0;
+    int i = 0;
+    if (upper) {
+        for (; i + 4 <= n; i += 4) {
+            c += __builtin_popcount(_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(keys + i), k)));
+        }
+    } else {
+        for (; i + 4 <= n; i += 4) {
+            c += __builtin_popcount(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(keys + i), k)));
+        }
+    }
+    return c + countFloatScalar(keys + i, n - i, key, upper);
+}
+#endif
+
+static int detectKernel() {
+#ifdef KEY_SEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SEARCH_KERNEL_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SEARCH_KERNEL_SSE4;
+#endif
+    return SEARCH_KERNEL_SCALAR;
+}
+
+static int activeKernel = SEARCH_KERNEL_AUTO;
+static IntCountFn countInt = countIntScalar;
+static FloatCountFn countFloat = countFloatScalar;
+
+int KeySearch::setKernel(int kernel) {
+    int best = detectKernel();
+    if (kernel == SEARCH_KERNEL_AUTO || kernel > best) {
+        kernel = best;
+    }
+    activeKernel = kernel;
+    countInt = countIntScalar;
+    countFloat = countFloatScalar;
+#ifdef KEY_SEARCH_X86
+    if (kernel == SEARCH_KERNEL_AVX2) {
+        countInt = countIntAVX2;
+        countFloat = countFloatAVX2;
+    } else if (kernel == SEARCH_KERNEL_SSE4) {
+        countInt = countIntSSE4;
+        countFloat = countFloatSSE4;
+    }
+#endif
+    return kernel;
+}
+
+int KeySearch::getKernel() {
+    if (activeKernel == SEARCH_KERNEL_AUTO) setKernel(SEARCH_KERNEL_AUTO);
+    return activeKernel;
+}
+
+const char* KeySearch::kernelName(int kernel) {
+    switch (kernel) {
+        case SEARCH_KERNEL_AVX2: return "avx2";
+        case SEARCH_KERNEL_SSE4: return "sse4.1";
+        case SEARCH_KERNEL_SCALAR: return "scalar";
+        default: return "auto";
+    }
+}
+
+int KeySearch::searchInt(const int* keys, int n, int key, bool upper) {
+    if (activeKernel == SEARCH_KERNEL_AUTO) setKernel(SEARCH_KERNEL_AUTO);
+    int lo = 0;
+    int hi = n;
+    while (hi - lo > KEY_SEARCH_WINDOW) {
+        int mid = lo + (hi - lo) / 2;
+        bool right = upper ? (keys[mid] <= key) : (keys[mid] < key);
+        if (right) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo + countInt(keys + lo, hi - lo, key, upper);
+}
+
+int KeySearch::searchFloat(const float* keys, int n, float key, bool upper) {
+    if (activeKernel == SEARCH_KERNEL_AUTO) setKernel(SEARCH_KERNEL_AUTO);
+    int lo = 0;
+    int hi = n;
+    while (hi - lo > KEY_SEARCH_WINDOW) {
+        int mid = lo + (hi - lo) / 2;
+        bool right = upper ? (keys[mid] <= key) : (keys[mid] < key);
+        if (right) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo + countFloat(keys + lo, hi - lo, key, upper);
+}
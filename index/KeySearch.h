@@ -0,0 +1,26 @@
+#ifndef KEY_SEARCH_H
+#define KEY_SEARCH_H
+
+// B+ 树节点内的有序键查找
+// 先二分缩小范围，剩下不超过 KEY_SEARCH_WINDOW 个键时用 SIMD 比较计数
+// 运行时检测 CPU：AVX2 > SSE4.1 > 标量
+#define KEY_SEARCH_WINDOW 32
+
+#define SEARCH_KERNEL_AUTO 0
+#define SEARCH_KERNEL_SCALAR 1
+#define SEARCH_KERNEL_SSE4 2
+#define SEARCH_KERNEL_AVX2 3
+
+class KeySearch {
+public:
+    // 第一个 >= key 的位置 (upper == false) / 第一个 > key 的位置 (upper == true)
+    static int searchInt(const int* keys, int n, int key, bool upper);
+    static int searchFloat(const float* keys, int n, float key, bool upper);
+
+    // 指定使用的内核，主要给基准测试用；返回实际生效的内核
+    static int setKernel(int kernel);
+    static int getKernel();
+    static const char* kernelName(int kernel);
+};
+
+#endif
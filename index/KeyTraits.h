@@ -0,0 +1,134 @@
+#ifndef KEY_TRAITS_H
+#define KEY_TRAITS_H
+
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+// 单列键在槽位上的比较，按键类型在编译期选定
+// BPlusTree 的各 Impl 模板通过 compareKey 重载用到这里；槽位与槽位的比较（游标判界、
+// 批量建树排序与归并）在确定节点布局时按键类型取一次，之后不再逐次判断类型
+// 组合键的列类型要到运行时才知道，仍由 BPlusTree 逐列比较
+struct IntKeyTraits {
+    typedef int Key;
+    static int compare(const unsigned int* slot, int key) {
+        int k = static_cast<int>(slot[0]);
+        if (k < key) return -1;
+        if (k > key) return 1;
+        return 0;
+    }
+    static int compareSlots(const unsigned int* a, const unsigned int* b) {
+        return compare(a, static_cast<int>(b[0]));
+    }
+};
+struct FloatKeyTraits {
+    typedef float Key;
+    static int compare(const unsigned int* slot, float key) {
+        float k;
+        memcpy(&k, slot, sizeof(float));
+        if (k < key) return -1;
+        if (k > key) return 1;
+        return 0;
+    }
+    static int compareSlots(const unsigned int* a, const unsigned int* b) {
+        float f;
+        memcpy(&f, b, sizeof(float));
+        return compare(a, f);
+    }
+};
+// 定长 VARCHAR 槽位：[长度][内容按 int 补齐]，按字节序比较
+struct VarcharKeyTraits {
+    typedef std::string Key;
+    static int compareBytes(const void* a, int la, const void* b, int lb) {
+        int c = memcmp(a, b, std::min(la, lb));
+        if (c != 0) return c < 0 ? -1 : 1;
+        if (la < lb) return -1;
+        if (la > lb) return 1;
+        return 0;
+    }
+    static int compare(const unsigned int* slot, const std::string& key) {
+        return compareBytes(slot + 1, (int)slot[0], key.data(), (int)key.length());
+    }
+    static int compareSlots(const unsigned int* a, const unsigned int* b) {
+        return compareBytes(a + 1, (int)a[0], b + 1, (int)b[0]);
+    }
+};
+// 组合键的 memcmp 编码：各列依次编码后拼成一个字节串，直接逐字节比较即为键序
+// INT：符号位取反后按大端序；FLOAT：非负数符号位取反、负数各位取反后按大端序（-0 当作 0）；
+// VARCHAR：0x00 写成 0x00 0xFF，末尾加 0x00 0x00，较短的串排在前面，且编码不会是另一编码的真前缀
+struct NormalizedKey {
+    static int putInt(unsigned char* out, int v) {
+        return putWord(out, static_cast<unsigned int>(v) ^ 0x80000000u);
+    }
+    static int putFloat(unsigned char* out, float v) {
+        if (v == 0.0f) v = 0.0f;
+        unsigned int u;
+        memcpy(&u, &v, sizeof(float));
+        return putWord(out, (u & 0x80000000u) ? ~u : u | 0x80000000u);
+    }
+    static int putString(unsigned char* out, const void* data, int len) {
+        const unsigned char* in = (const unsigned char*)data;
+        int n = 0;
+        for (int i = 0; i < len; i++) {
+            out[n++] = in[i];
+            if (in[i] == 0) out[n++] = 0xFF;
+        }
+        out[n++] = 0;
+        out[n++] = 0;
+        return n;
+    }
+    // 最坏情况下（全为 0x00）一列 VARCHAR 编码后的字节数
+    static int maxStringBytes(int len) { return 2 * len + 2; }
+
+    // 解码：返回读过的字节数，avail 内读不完整时返回 -1
+    static int getInt(const unsigned char* in, int avail, int& v) {
+        if (avail < 4) return -1;
+        v = static_cast<int>(getWord(in) ^ 0x80000000u);
+        return 4;
+    }
+    static int getFloat(const unsigned char* in, int avail, float& v) {
+        if (avail < 4) return -1;
+        unsigned int u = getWord(in);
+        u = (u & 0x80000000u) ? u & 0x7FFFFFFFu : ~u;
+        memcpy(&v, &u, sizeof(float));
+        return 4;
+    }
+    static int getString(const unsigned char* in, int avail, std::string& v) {
+        v.clear();
+        for (int i = 0; i + 1 < avail; i++) {
+            if (in[i] != 0) {
+                v.push_back((char)in[i]);
+            } else if (in[i + 1] == 0) {
+                return i + 2;
+            } else {
+                v.push_back('\0');
+                i++;
+            }
+        }
+        return -1;
+    }
+    // 跳过一列 VARCHAR 的编码，返回其字节数
+    static int skipString(const unsigned char* in, int avail) {
+        for (int i = 0; i + 1 < avail; i++) {
+            if (in[i] == 0) {
+                if (in[i + 1] == 0) return i + 2;
+                i++;
+            }
+        }
+        return -1;
+    }
+
+private:
+    static int putWord(unsigned char* out, unsigned int u) {
+        out[0] = (unsigned char)(u >> 24);
+        out[1] = (unsigned char)(u >> 16);
+        out[2] = (unsigned char)(u >> 8);
+        out[3] = (unsigned char)u;
+        return 4;
+    }
+    static unsigned int getWord(const unsigned char* in) {
+        return ((unsigned int)in[0] << 24) | ((unsigned int)in[1] << 16) | ((unsigned int)in[2] << 8) | in[3];
+    }
+};
+
+#endif
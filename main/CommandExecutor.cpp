@@ -29,8 +29,19 @@ static std::string getHelpMessage() {
     oss << "\n";
     oss << "  Index operations:\n";
     oss << "    ALTER TABLE t ADD INDEX (col)\n";
+    oss << "    ALTER TABLE t ADD INDEX [name] USING HASH (col)  - Hash index for = lookups\n";
     oss << "    ALTER TABLE t DROP INDEX name\n";
     oss << "    SHOW INDEXES\n";
+    oss << "    SET INDEX_FILLFACTOR n   - Leaf/node fill (%) when building an index\n";
+    oss << "    OPTIMIZE INDEX t[.name]  - Repack the indexes of a table and shrink their files\n";
+    oss << "    ALTER TABLE t SET INDEX_MODE BUFFERED|DIRECT\n";
+    oss << "                             - Buffer index inserts and merge them in sorted batches\n";
+    oss << "\n";
+    oss << "  Storage:\n";
+    oss << "    COMPRESS TABLE t         - Compress cold pages of a table\n";
+    oss << "    VACUUM t                 - Reclaim space of deleted records\n";
+    oss << "    SET AUTOVACUUM ON|OFF    - Vacuum automatically after large deletes\n";
+    oss << "    SET JOIN_HASH_ROWS n     - Sort-merge joins whose smaller side exceeds n rows\n";
     oss << "\n";
     oss << "  Other:\n";
     oss << "    LOAD DATA INFILE 'file' INTO TABLE t FIELDS TERMINATED BY ','\n";
@@ -39,7 +50,7 @@ static std::string getHelpMessage() {
     return oss.str();
 }
 CommandExecutor::CommandExecutor(const std::string& dataDir, bool batch) 
-    : running(true), batchMode(batch) {
+    : running(true), batchMode(batch), autoVacuum(false) {
     MyBitMap::initConst();
     fileManager = std::make_unique<FileManager>();
     bufPageManager = std::make_unique<BufPageManager>(fileManager.get());
@@ -123,12 +134,95 @@ std::string CommandExecutor::execute(const std::string& sql) {
     if (upperSql == "HELP") {
         return batchMode ? "@\n" : getHelpMessage();
     }
+    // 语法文件之外的存储维护命令，在解析之前直接处理
+    {
+        std::istringstream iss(trimmedSql);
+        std::string word1, word2, word3, extra, word5, word6, tail;
+        iss >> word1 >> word2 >> word3 >> extra >> word5 >> word6 >> tail;
+        std::string kw1 = word1, kw2 = word2, kw3 = word3, kw4 = extra, kw5 = word5, kw6 = word6;
+        for (char& c : kw1) c = std::toupper(c);
+        for (char& c : kw2) c = std::toupper(c);
+        for (char& c : kw3) c = std::toupper(c);
+        for (char& c : kw4) c = std::toupper(c);
+        for (char& c : kw5) c = std::toupper(c);
+        for (char& c : kw6) c = std::toupper(c);
+        if (kw1 == "ALTER" && kw2 == "TABLE" && kw4 == "SET" && kw5 == "INDEX_MODE" && tail.empty()) {
+            ResultSet result = executeIndexMode(word3, kw6);
+            return batchMode ? formatBatch(result) : formatInteractive(result);
+        }
+        if (kw1 == "COMPRESS" && kw2 == "TABLE" && !word3.empty() && extra.empty()) {
+            ResultSet result = executeCompress(word3);
+            return batchMode ? formatBatch(result) : formatInteractive(result);
+        }
+        if (kw1 == "VACUUM" && !word2.empty() && word3.empty()) {
+            ResultSet result = executeVacuum(word2);
+            return batchMode ? formatBatch(result) : formatInteractive(result);
+        }
+        if (kw1 == "OPTIMIZE" && kw2 == "INDEX" && !word3.empty() && extra.empty()) {
+            ResultSet result = executeOptimizeIndex(word3);
+            return batchMode ? formatBatch(result) : formatInteractive(result);
+        }
+        if (kw1 == "SET" && kw2 == "AUTOVACUUM" && extra.empty()) {
+            ResultSet result;
+            if (kw3 == "ON" || kw3 == "OFF") {
+                autoVacuum = (kw3 == "ON");
+                result.setMessage("Autovacuum " + kw3);
+            } else {
+                result.setError("Usage: SET AUTOVACUUM ON|OFF");
+            }
+            return batchMode ? formatBatch(result) : formatInteractive(result);
+        }
+        if (kw1 == "SET" && kw2 == "INDEX_FILLFACTOR" && extra.empty()) {
+            ResultSet result;
+            int percent = atoi(word3.c_str());
+            if (percent >= 10 && percent <= 100) {
+                systemManager->setIndexFillFactor(percent);
+                result.setMessage("Index fill factor " + std::to_string(percent));
+            } else {
+                result.setError("Usage: SET INDEX_FILLFACTOR 10-100");
+            }
+            return batchMode ? formatBatch(result) : formatInteractive(result);
+        }
+        if (kw1 == "SET" && kw2 == "JOIN_HASH_ROWS" && extra.empty()) {
+            ResultSet result;
+            long long rows = atoll(word3.c_str());
+            if (rows >= 1) {
+                queryExecutor->setJoinHashMaxRows((size_t)rows);
+                result.setMessage("Join hash table limit " + std::to_string(rows) + " rows");
+            } else {
+                result.setError("Usage: SET JOIN_HASH_ROWS n (n >= 1)");
+            }
+            return batchMode ? formatBatch(result) : formatInteractive(result);
+        }
+    }
+    // 语法文件里没有 USING HASH：去掉后照常解析，再改建哈希索引
+    bool usingHash = false;
+    if (upperSql.compare(0, 6, "ALTER ") == 0) {
+        for (size_t pos = upperSql.find(" USING"); pos != std::string::npos; pos = upperSql.find(" USING", pos + 6)) {
+            size_t hash = upperSql.find_first_not_of(" \t\n\r", pos + 6);
+            if (hash == std::string::npos || hash == pos + 6 || upperSql.compare(hash, 4, "HASH") != 0) continue;
+            char after = hash + 4 < upperSql.size() ? upperSql[hash + 4] : ' ';
+            if (std::isalnum((unsigned char)after) || after == '_') continue;
+            trimmedSql = trimmedSql.substr(0, pos) + " " + trimmedSql.substr(hash + 4);
+            usingHash = true;
+            break;
+        }
+    }
     SQLStatement stmt = parser.parse(trimmedSql);
     if (!stmt.isValid()) {
         ResultSet errResult;
         errResult.setError(stmt.errorMessage.empty() ? parser.getLastError() : stmt.errorMessage);
         return batchMode ? formatBatch(errResult) : formatInteractive(errResult);
     }
+    if (usingHash) {
+        ResultSet hashResult;
+        if (stmt.type == SQLType::ALTER_ADD_INDEX) {
+            hashResult = executeAddHashIndex(stmt);
+        } else {
+            hashResult.setError("USING HASH only applies to ADD INDEX");
+        }
+        return batchMode ? formatBatch(hashResult) : formatInteractive(hashResult);
+    }
     ResultSet result;
     switch (stmt.type) {
         case SQLType::CREATE_DATABASE:
@@ -162,6 +256,17 @@ std::string CommandExecutor::execute(const std::string& sql) {
             result.setError("Unknown statement type");
             break;
     }
+    // 自动 VACUUM：在语句之间进行，避免与查询并发访问缓存
+    if (autoVacuum && result.success &&
+        (stmt.type == SQLType::DELETE || stmt.type == SQLType::UPDATE) &&
+        systemManager->needsAutoVacuum(stmt.tableName)) {
+        VacuumStats stats;
+        systemManager->vacuumTable(stmt.tableName, stats);
+    }
+    // 写优化缓冲同样在语句之间维护：日志写到文件，段积累多了就并入索引
+    if (systemManager->getIndexManager()) {
+        systemManager->getIndexManager()->maintainBuffers();
+    }
     if (stmt.type == SQLType::DESC_TABLE && result.success) {
         TableMeta meta = systemManager->describeTable(stmt.tableName);
         if (batchMode) {
@@ -172,6 +277,113 @@ std::string CommandExecutor::execute(const std::string& sql) {
     }
     return batchMode ? formatBatch(result) : formatInteractive(result);
 }
+ResultSet CommandExecutor::executeCompress(const std::string& tableName) {
+    ResultSet result;
+    if (systemManager->getCurrentDatabase().empty()) {
+        result.setError("No database selected");
+        return result;
+    }
+    if (!systemManager->tableExists(tableName)) {
+        result.setError("Table '" + tableName + "' does not exist");
+        return result;
+    }
+    int pagesBefore = 0, pagesAfter = 0;
+    if (!systemManager->compressTable(tableName, pagesBefore, pagesAfter)) {
+        result.setError("Failed to compress table '" + tableName + "'");
+        return result;
+    }
+    result.setMessage("Table '" + tableName + "' compressed: " + std::to_string(pagesBefore) +
+                      " pages -> " + std::to_string(pagesAfter) + " pages");
+    return result;
+}
+ResultSet CommandExecutor::executeVacuum(const std::string& tableName) {
+    ResultSet result;
+    if (systemManager->getCurrentDatabase().empty()) {
+        result.setError("No database selected");
+        return result;
+    }
+    if (!systemManager->tableExists(tableName)) {
+        result.setError("Table '" + tableName + "' does not exist");
+        return result;
+    }
+    VacuumStats stats;
+    if (!systemManager->vacuumTable(tableName, stats)) {
+        result.setError("Failed to vacuum table '" + tableName + "'");
+        return result;
+    }
+    result.setMessage("Table '" + tableName + "' vacuumed: " + std::to_string(stats.deadRecords) +
+                      " deleted records removed, " + std::to_string(stats.pagesBefore) + " pages -> " +
+                      std::to_string(stats.pagesAfter) + " pages, " +
+                      std::to_string(stats.bytesReclaimed) + " bytes reclaimed");
+    return result;
+}
+// 目标为 "表" 或 "表.索引"，与 SHOW INDEXES 的输出一致
+ResultSet CommandExecutor::executeOptimizeIndex(const std::string& target) {
+    ResultSet result;
+    if (systemManager->getCurrentDatabase().empty()) {
+        result.setError("No database selected");
+        return result;
+    }
+    std::string tableName = target;
+    std::string indexName;
+    size_t dot = target.find('.');
+    if (dot != std::string::npos) {
+        tableName = target.substr(0, dot);
+        indexName = target.substr(dot + 1);
+    }
+    if (!systemManager->tableExists(tableName)) {
+        result.setError("Table '" + tableName + "' does not exist");
+        return result;
+    }
+    int pagesBefore = 0, pagesAfter = 0;
+    if (!systemManager->optimizeIndex(tableName, indexName, pagesBefore, pagesAfter)) {
+        result.setError("Failed to optimize index '" + target + "'");
+        return result;
+    }
+    result.setMessage("Index '" + target + "' optimized: " + std::to_string(pagesBefore) +
+                      " pages -> " + std::to_string(pagesAfter) + " pages");
+    return result;
+}
+ResultSet CommandExecutor::executeIndexMode(const std::string& tableName, const std::string& mode) {
+    ResultSet result;
+    if (systemManager->getCurrentDatabase().empty()) {
+        result.setError("No database selected");
+        return result;
+    }
+    if (mode != "BUFFERED" && mode != "DIRECT") {
+        result.setError("Usage: ALTER TABLE t SET INDEX_MODE BUFFERED|DIRECT");
+        return result;
+    }
+    if (!systemManager->tableExists(tableName)) {
+        result.setError("Table '" + tableName + "' does not exist");
+        return result;
+    }
+    if (!systemManager->setIndexMode(tableName, mode == "BUFFERED")) {
+        result.setError("Failed to change index mode of table '" + tableName + "'");
+        return result;
+    }
+    result.setMessage("Index mode of table '" + tableName + "': " + mode);
+    return result;
+}
+ResultSet CommandExecutor::executeAddHashIndex(const SQLStatement& stmt) {
+    ResultSet result;
+    if (systemManager->getCurrentDatabase().empty()) {
+        result.setError("No database selected");
+        return result;
+    }
+    if (stmt.indexColumns.size() != 1) {
+        result.setError("Hash index must be on exactly one column");
+        return result;
+    }
+    const std::string& colName = stmt.indexColumns[0];
+    std::string idxName = stmt.indexName.empty() ? stmt.tableName + "_" + colName + "_hash" : stmt.indexName;
+    if (systemManager->createHashIndex(stmt.tableName, stmt.indexColumns, idxName)) {
+        result.setMessage("Hash index created on " + stmt.tableName + "(" + colName + ")");
+    } else {
+        result.setError("Failed to create hash index");
+    }
+    return result;
+}
 ResultSet CommandExecutor::executeDDL(const SQLStatement& stmt) {
     ResultSet result;
     switch (stmt.type) {
@@ -405,12 +617,17 @@ ResultSet CommandExecutor::executeAlter(const SQLStatement& stmt) {
                 break;
             }
             
-            // xz只支持单列索引
+            // 多列时建组合索引
             std::string colName = stmt.indexColumns[0];
+            std::string colList = colName;
+            for (size_t i = 1; i < stmt.indexColumns.size(); i++) {
+                colList += ", " + stmt.indexColumns[i];
+            }
             std::string idxName = stmt.indexName.empty() ? 
-                                   stmt.tableName + "_" + colName + "_idx" : stmt.indexName;
-            if (systemManager->createIndex(stmt.tableName, colName, idxName)) {
-                result.setMessage("Index created on " + stmt.tableName + "(" + colName + ")");
+                                   stmt.tableName + "_" + IndexManager::compositeName(stmt.indexColumns) + "_idx" :
+                                   stmt.indexName;
+            if (systemManager->createIndex(stmt.tableName, stmt.indexColumns, idxName)) {
+                result.setMessage("Index created on " + stmt.tableName + "(" + colList + ")");
             } else {
                 result.setError("Failed to create index");
             }
@@ -600,9 +817,10 @@ ResultSet CommandExecutor::executeAlter(const SQLStatement& stmt) {
         }
         case SQLType::ALTER_ADD_UNIQUE: {
             if (!stmt.indexColumns.empty()) {
-                std::string colName = stmt.indexColumns[0];
-                if (systemManager->createIndex(stmt.tableName, colName, 
-                    stmt.indexName.empty() ? stmt.tableName + "_" + colName + "_uniq" : stmt.indexName)) {
+                std::string colName = IndexManager::compositeName(stmt.indexColumns);
+                if (systemManager->createIndex(stmt.tableName, stmt.indexColumns,
+                    stmt.indexName.empty() ? stmt.tableName + "_" + colName + "_uniq" : stmt.indexName,
+                    true)) {
                     result.setMessage("Unique constraint added");
                 } else {
                     result.setError("Failed to add unique constraint - duplicate values exist");
@@ -667,7 +885,7 @@ std::string CommandExecutor::formatDescBatch(const TableMeta& meta) {
             if (i > 0) oss << ", ";
             oss << idx.columns[i];
         }
-        oss << ");\n";
+        oss << (idx.isHash ? ") USING HASH;\n" : ");\n");
     }
     oss << "@\n";
     return oss.str();
@@ -748,7 +966,7 @@ std::string CommandExecutor::formatDescInteractive(const TableMeta& meta) {
             if (i > 0) oss << ", ";
             oss << idx.columns[i];
         }
-        oss << ");\n";
+        oss << (idx.isHash ? ") USING HASH;\n" : ");\n");
     }
     return oss.str();
 }
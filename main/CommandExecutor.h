@@ -15,12 +15,19 @@ private:
     SimpleParser parser;
     bool running;
     bool batchMode; 
+    bool autoVacuum;
     ResultSet executeDDL(const SQLStatement& stmt);
     
     ResultSet executeDML(const SQLStatement& stmt);
  
     ResultSet executeAlter(const SQLStatement& stmt);
 
+    ResultSet executeCompress(const std::string& tableName);
+    ResultSet executeVacuum(const std::string& tableName);
+    ResultSet executeOptimizeIndex(const std::string& target);
+    ResultSet executeAddHashIndex(const SQLStatement& stmt);
+    ResultSet executeIndexMode(const std::string& tableName, const std::string& mode);
+
     std::string formatInteractive(const ResultSet& result);
     std::string formatBatch(const ResultSet& result);
     std::string formatDescBatch(const TableMeta& meta);
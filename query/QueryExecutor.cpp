@@ -5,88 +5,19 @@
 #include <regex>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <cctype>
 
-QueryExecutor::QueryExecutor(SystemManager* sm) : systemManager(sm) {
-}
+// LIKE 前缀按大小写展开后最多扫描的区间数
+#define LIKE_MAX_PREFIX_RANGES 16
+// 外表的组合不超过 max(JOIN_MAX_PROBES, 内表行数 / JOIN_PROBE_RATIO) 个时逐个查内表的索引（索引嵌套循环），
+// 否则读一遍内表做哈希连接；30 万行的内表上两种做法约在 2.5 万次查找时持平
+#define JOIN_MAX_PROBES 16
+#define JOIN_PROBE_RATIO 16
+// 哈希连接建表一侧默认超过这么多行时改用排序归并：只排行号，不另占哈希表的内存
+#define JOIN_HASH_MAX_ROWS (1 << 21)
 
-// --------- Large-table safety helpers ---------
-// In some course-project RecordManager implementations, getAllRecordIDs() may
-// return the requested capacity even when the actual number of records is
-// smaller (e.g., the function truncates but still returns capacity), and
-// meta->recordCount might be left as 0 after bulk load.
-// If we blindly treat "count == capacity" as "not enough" and keep doubling,
-// we can end up allocating/iterating tens of millions of IDs and appear to
-// "hang" on big COUNT(*) tests.
-//
-// This helper caps growth when recordCount is unknown, and adds a small sanity
-// check on the tail of the returned buffer to avoid runaway doubling.
-static void getAllRecordIDsSafe(RecordManager* rm, TableMeta* meta, std::vector<int>& recordIDs) {
-    recordIDs.clear();
-    if (!rm) return;
-
-    // If recordCount is known, trust it as a strong hint.
-    const bool hasHint = (meta && meta->recordCount > 0);
-    // Unknown recordCount: start larger to reduce calls, but cap to a reasonable
-    // upper bound to avoid runaway memory/time in worst-case buggy returns.
-    const size_t kUnknownStart = 65536;
-    const size_t kUnknownHardCap = 5000000; // 5M IDs ~= 20MB, enough for 1.8M rows test
-
-    size_t capacity = hasHint ? (size_t)meta->recordCount + 1024 : kUnknownStart;
-    size_t hardCap  = hasHint ? std::max(capacity, (size_t)meta->recordCount + 1024) : kUnknownHardCap;
-    if (capacity > hardCap) capacity = hardCap;
-
-    int count = 0;
-    while (true) {
-        recordIDs.resize(capacity);
-        count = rm->getAllRecordIDs(recordIDs.data(), (int)capacity);
-        if (count < 0) {
-            recordIDs.clear();
-            return;
-        }
-
-        if (count < (int)capacity) {
-            // Clearly got them all.
-            recordIDs.resize((size_t)count);
-            return;
-        }
-
-        // count == capacity: could be true truncation, could be buggy return.
-        // If we already used the recordCount hint-sized buffer, stop here.
-        if (hasHint && capacity >= (size_t)meta->recordCount + 1024) {
-            recordIDs.resize((size_t)count);
-            return;
-        }
-
-        // Sanity check: if the tail looks unfilled (many identical values),
-        // it usually means the function did NOT fill the whole buffer but
-        // still returned "capacity" as count. If we keep these IDs, we'll end
-        // up calling getRecord() on the same RID millions of times (looks like
-        // a hang). In this case we trim the suspicious suffix and stop growing.
-        const size_t sample = std::min((size_t)64, capacity);
-        size_t start = capacity - sample;
-        int tailVal = recordIDs[start];
-        bool allSame = true;
-        for (size_t i = start + 1; i < capacity; i++) {
-            if (recordIDs[i] != tailVal) { allSame = false; break; }
-        }
-        if (allSame && capacity > kUnknownStart) {
-            // Trim the whole sample suffix, then also trim any further identical tail.
-            recordIDs.resize(start);
-            while (!recordIDs.empty() && recordIDs.back() == tailVal) {
-                recordIDs.pop_back();
-            }
-            return;
-        }
-
-        if (capacity >= hardCap) {
-            // Reached safe cap; return what we have.
-            recordIDs.resize((size_t)count);
-            return;
-        }
-        size_t nextCap = capacity * 2;
-        if (nextCap > hardCap) nextCap = hardCap;
-        capacity = nextCap;
-    }
+QueryExecutor::QueryExecutor(SystemManager* sm) : systemManager(sm), joinHashMaxRows(JOIN_HASH_MAX_ROWS) {
 }
 
 std::vector<char> QueryExecutor::serializeRecord(const TableMeta& meta, 
@@ -352,60 +283,69 @@ std::vector<std::pair<int, std::vector<Value>>> QueryExecutor::scanTableFiltered
     RecordManager* rm = systemManager->getRecordManager(tableName);
     if (!rm) return results;
     
-    BufPageManager* bpm = systemManager->getBufPageManager();
-    int fileID = systemManager->getTableFileID(tableName);
-    if (fileID < 0) return results;
-    
-    // 常量定义（与 RecordManager.h 一致）
-    const int RM_PAGE_INT_NUM = 2048;
-    const int RM_PAGE_HEADER_SIZE = 16;
-    const int RM_PAGE_DATA_START = RM_PAGE_HEADER_SIZE;
-    const int RM_PAGE_FREE_START_OFFSET = 2;
-    const int RM_PAGE_NEXT_PAGE_OFFSET = 3;
-    const int RM_RECORD_HEADER_SIZE = 2;
-    
-    int pageID = 0;
-    while (true) {
-        int index;
-        BufType page = bpm->getPage(fileID, pageID, index);
-        int freeStart = page[RM_PAGE_FREE_START_OFFSET];
-        int nextPage = page[RM_PAGE_NEXT_PAGE_OFFSET];
-        
-        // 遍历页面中的所有记录
-        int pos = RM_PAGE_DATA_START;
-        while (pos < freeStart) {
-            int recordLen = page[pos];
-            if (recordLen <= 0 || pos + recordLen > RM_PAGE_INT_NUM) {
-                break;
-            }
-            int rid = page[pos + 1];
-            if (rid != 0) {  // 非删除的记录
-                // 反序列化记录
-                int dataLen = recordLen - RM_RECORD_HEADER_SIZE;
-                std::vector<char> data(dataLen * 4);
-                memcpy(data.data(), &page[pos + RM_RECORD_HEADER_SIZE], dataLen * 4);
-                
-                std::vector<Value> values = deserializeRecord(*meta, data.data(), (int)data.size());
-                
-                // 立即检查 WHERE 条件，只保留匹配的记录
-                if (matchAllWhereClauses(whereClauses, *meta, values)) {
-                    results.push_back({rid, std::move(values)});
-                }
-            }
-            pos += recordLen;
-        }
-        
-        bpm->access(index);
-        
-        if (nextPage == -1 || nextPage > 1000000) {
-            break;
+    // 逐页读取（压缩页按列解码），立即检查 WHERE 条件，只保留匹配的记录
+    rm->forEachRecord([&](int rid, const unsigned int* data, int dataLen) {
+        std::vector<Value> values = deserializeRecord(*meta, (const char*)data, dataLen * 4);
+        if (matchAllWhereClauses(whereClauses, *meta, values)) {
+            results.push_back({rid, std::move(values)});
         }
-        pageID = nextPage;
-    }
+    });
     
     return results;
 }
 
+// 常量的类型与列一致时才能直接当作索引键（FLOAT 列也接受整数常量）
+static bool valueMatchesColumn(const ColumnDef& col, const Value& value) {
+    if (value.isNull) return false;
+    if (col.type == DataType::INT) return value.type == Value::Type::INT;
+    if (col.type == DataType::FLOAT) {
+        return value.type == Value::Type::FLOAT || value.type == Value::Type::INT;
+    }
+    return value.type == Value::Type::STRING;
+}
+
+// FLOAT 索引里存的是 float，常量先按列类型换算
+static float floatKeyOf(const Value& value) {
+    return value.type == Value::Type::INT ? (float)value.intVal : (float)value.floatVal;
+}
+
+// LIKE 模式里第一个通配符之前的字面前缀
+static std::string likePrefix(const std::string& pattern) {
+    size_t pos = pattern.find_first_of("%_");
+    return pattern.substr(0, pos == std::string::npos ? pattern.size() : pos);
+}
+
+// LIKE 不区分大小写，前缀里的每个字母都要按大小写两种写法去查，
+// 展开后的前缀长度相同、互不相交，排好序后依次扫描仍然是索引顺序；
+// 字母多时只展开前面一段，剩下的交给回表后的条件过滤
+static std::vector<std::string> likePrefixVariants(const std::string& prefix) {
+    std::vector<std::string> variants(1);
+    for (char c : prefix) {
+        bool letter = std::isalpha((unsigned char)c) != 0;
+        if (letter && variants.size() * 2 > LIKE_MAX_PREFIX_RANGES) break;
+        size_t n = variants.size();
+        for (size_t i = 0; i < n; i++) {
+            if (letter) {
+                variants.push_back(variants[i] + (char)std::toupper((unsigned char)c));
+                variants[i] += (char)std::tolower((unsigned char)c);
+            } else {
+                variants[i] += c;
+            }
+        }
+    }
+    std::sort(variants.begin(), variants.end());
+    return variants;
+}
+
+// 以 prefix 开头的字符串都小于返回值：去掉末尾的 0xFF 后把最后一个字节加一，全是 0xFF 时没有上界
+static bool prefixUpperBound(std::string prefix, std::string& bound) {
+    while (!prefix.empty() && (unsigned char)prefix.back() == 0xFF) prefix.pop_back();
+    if (prefix.empty()) return false;
+    prefix.back() = (char)((unsigned char)prefix.back() + 1);
+    bound = prefix;
+    return true;
+}
+
 bool QueryExecutor::shouldUseIndex(const std::string& tableName, const WhereClause& clause) {
     TableMeta* meta = systemManager->getTableMeta(tableName);
     if (!meta) return false;
@@ -417,19 +357,29 @@ bool QueryExecutor::shouldUseIndex(const std::string& tableName, const WhereClau
         colName = colName.substr(dotPos + 1);
     }
     
-    if (!meta->hasIndex(colName)) {
+    // 哈希索引只回答等值条件
+    bool hashEq = clause.op == CompareOp::EQ && meta->hasHashIndex(colName);
+    if (!meta->hasIndex(colName) && !hashEq) {
+        return false;
+    }
+    // 索引键按列类型取值，列与列比较、NULL 或类型不一致的常量只能走扫描
+    const ColumnDef* colDef = meta->getColumn(colName);
+    if (clause.isColumnCompare || !colDef || !valueMatchesColumn(*colDef, clause.value)) {
+        return false;
+    }
+    // LIKE 只有字面前缀非空时才能换成 VARCHAR 索引上的前缀区间
+    if (clause.op == CompareOp::LIKE &&
+        (colDef->type != DataType::VARCHAR || likePrefix(clause.value.strVal).empty())) {
         return false;
     }
     
-    // 只有当列是**单列主键**时才使用索引扫描
-    // 复合主键的单个列可能有重复值，B+ 树不支持重复键，使用索引扫描会漏掉记录
-    if (meta->primaryKey.size() != 1 || meta->primaryKey[0] != colName) {
+    if (!hashEq && !indexIsComplete(tableName, *meta, colName)) {
         return false;
     }
     
     if (clause.op == CompareOp::EQ || clause.op == CompareOp::LT ||
         clause.op == CompareOp::LE || clause.op == CompareOp::GT ||
-        clause.op == CompareOp::GE) {
+        clause.op == CompareOp::GE || clause.op == CompareOp::LIKE) {
         return true;
     }
     
@@ -440,67 +390,156 @@ std::vector<std::pair<int, std::vector<Value>>> QueryExecutor::indexScan(
     const std::string& tableName, const WhereClause& clause) {
     
     std::vector<std::pair<int, std::vector<Value>>> results;
-    
+    std::vector<RID> rids;
+    if (clause.op == CompareOp::EQ && hashLookup(tableName, clause.column.columnName, clause.value, rids)) {
+        return fetchRecords(tableName, rids);
+    }
+    std::vector<BPlusCursor> cursors;
+    if (!openIndexCursors(tableName, clause.column.columnName, &clause, false, cursors)) {
+        return results;
+    }
+    for (auto& cursor : cursors) {
+        for (; cursor.valid(); cursor.next()) {
+            rids.push_back(cursor.rid());
+        }
+    }
+    return fetchRecords(tableName, rids);
+}
+
+bool QueryExecutor::hashLookup(const std::string& tableName, const std::string& columnName,
+                               const Value& value, std::vector<RID>& rids) {
     TableMeta* meta = systemManager->getTableMeta(tableName);
-    if (!meta) return results;
-    
     IndexManager* indexMgr = systemManager->getIndexManager();
-    if (!indexMgr) return results;
-    
-    RecordManager* rm = systemManager->getRecordManager(tableName);
-    if (!rm) return results;
-    
-    const ColumnDef* col = meta->getColumn(clause.column.columnName);
-    if (!col) return results;
+    std::string colName = columnName;
+    size_t dotPos = colName.find('.');
+    if (dotPos != std::string::npos) {
+        colName = colName.substr(dotPos + 1);
+    }
+    if (!meta || !indexMgr || value.isNull || !meta->hasHashIndex(colName)) return false;
+    const ColumnDef* col = meta->getColumn(colName);
+    if (!col || !valueMatchesColumn(*col, value)) return false;
+    if (col->type == DataType::INT) {
+        rids = indexMgr->hashLookup(tableName, colName, value.intVal);
+    } else if (col->type == DataType::FLOAT) {
+        rids = indexMgr->hashLookup(tableName, colName, (double)floatKeyOf(value));
+    } else {
+        rids = indexMgr->hashLookup(tableName, colName, value.strVal);
+    }
+    // 桶内条目无序；按 recordID 排好，与 B+ 树上相同键的 (key, RID) 顺序一致
+    std::sort(rids.begin(), rids.end(), [](const RID& a, const RID& b) { return a.slotNum < b.slotNum; });
+    return true;
+}
+
+bool QueryExecutor::keyMayExist(const std::string& tableName, const std::string& columnName,
+                                const Value& value) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!meta || !indexMgr || value.isNull || !meta->hasIndex(columnName)) return true;
+    const ColumnDef* col = meta->getColumn(columnName);
+    if (!col) return true;
+    // 与插入索引时取值的方式一致
+    if (col->type == DataType::INT) return indexMgr->mayContain(tableName, columnName, value.intVal);
+    if (col->type == DataType::FLOAT) return indexMgr->mayContain(tableName, columnName, value.floatVal);
+    return indexMgr->mayContain(tableName, columnName, value.strVal);
+}
+
+// 把条件换成索引上的一个或几个区间（LIKE 前缀按大小写展开），按扫描方向排好；
+// clause 为空时遍历整个索引
+bool QueryExecutor::openIndexCursors(const std::string& tableName, const std::string& columnName,
+                                     const WhereClause* clause, bool backward,
+                                     std::vector<BPlusCursor>& cursors) {
+    cursors.clear();
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!meta || !indexMgr) return false;
+    std::string colName = columnName;
+    size_t dotPos = colName.find('.');
+    if (dotPos != std::string::npos) {
+        colName = colName.substr(dotPos + 1);
+    }
+    const ColumnDef* col = meta->getColumn(colName);
+    BPlusTree* tree = indexMgr->openIndex(tableName, colName);
+    if (!col || !tree) return false;
+    if (!clause) {
+        cursors.push_back(tree->openCursor(backward));
+        return true;
+    }
     
-    std::vector<RID> rids;
+    if (clause->op == CompareOp::LIKE) {
+        std::string prefix = likePrefix(clause->value.strVal);
+        if (prefix.empty() || col->type != DataType::VARCHAR) return false;
+        if ((int)prefix.size() > col->length) prefix.resize(col->length);
+        std::vector<std::string> variants = likePrefixVariants(prefix);
+        if (backward) std::reverse(variants.begin(), variants.end());
+        for (const auto& low : variants) {
+            std::string high;
+            bool hasHigh = prefixUpperBound(low, high);
+            cursors.push_back(tree->openCursor(&low, hasHigh ? &high : nullptr, true, false, backward));
+        }
+        return true;
+    }
     
+    bool hasLow = clause->op == CompareOp::EQ || clause->op == CompareOp::GT || clause->op == CompareOp::GE;
+    bool hasHigh = clause->op == CompareOp::EQ || clause->op == CompareOp::LT || clause->op == CompareOp::LE;
+    bool includeLow = clause->op != CompareOp::GT;
+    bool includeHigh = clause->op != CompareOp::LT;
     if (col->type == DataType::INT) {
-        int key = clause.value.intVal;
-        if (clause.op == CompareOp::EQ) {
-            RID rid;
-            if (indexMgr->searchEntry(tableName, clause.column.columnName, key, rid)) {
-                rids.push_back(rid);
-            }
-        } else {
-            int lowKey = std::numeric_limits<int>::min();
-            int highKey = std::numeric_limits<int>::max();
-            bool includeLow = true, includeHigh = true;
-            
-            if (clause.op == CompareOp::GT) {
-                lowKey = key;
-                includeLow = false;
-            } else if (clause.op == CompareOp::GE) {
-                lowKey = key;
-            } else if (clause.op == CompareOp::LT) {
-                highKey = key;
-                includeHigh = false;
-            } else if (clause.op == CompareOp::LE) {
-                highKey = key;
-            }
-            
-            rids = indexMgr->rangeSearch(tableName, clause.column.columnName, 
-                                          lowKey, highKey, includeLow, includeHigh);
-        }
+        int key = clause->value.intVal;
+        cursors.push_back(tree->openCursor(hasLow ? &key : nullptr, hasHigh ? &key : nullptr,
+                                           includeLow, includeHigh, backward));
     } else if (col->type == DataType::FLOAT) {
-        float key = clause.value.floatVal;
-        if (clause.op == CompareOp::EQ) {
-            RID rid;
-            if (indexMgr->searchEntry(tableName, clause.column.columnName, key, rid)) {
-                rids.push_back(rid);
-            }
+        // 记录里是 double，换成 float 后不同的值可能落到同一个键上，边界都取闭区间，多出来的由回表过滤
+        float key = floatKeyOf(clause->value);
+        cursors.push_back(tree->openCursor(hasLow ? &key : nullptr, hasHigh ? &key : nullptr,
+                                           true, true, backward));
+    } else {
+        // 超过键长的常量会被截断，同样取闭区间
+        std::string key = clause->value.strVal;
+        cursors.push_back(tree->openCursor(hasLow ? &key : nullptr, hasHigh ? &key : nullptr,
+                                           true, true, backward));
+    }
+    return true;
+}
+
+// 沿索引游标逐条取记录交给 visit，visit 返回 false 时停止，不再读后面的叶子和记录
+bool QueryExecutor::streamIndexScan(const std::string& tableName, const std::string& columnName,
+                                    const WhereClause* clause, bool backward,
+                                    const std::function<bool(int, const std::vector<Value>&)>& visit) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    RecordManager* rm = systemManager->getRecordManager(tableName);
+    if (!meta || !rm) return false;
+    std::vector<char> buffer(8192);
+    std::vector<RID> rids;
+    if (clause && clause->op == CompareOp::EQ && hashLookup(tableName, columnName, clause->value, rids)) {
+        if (backward) std::reverse(rids.begin(), rids.end());
+        for (const auto& rid : rids) {
+            int len = rm->getRecord(rid.slotNum, buffer.data(), (int)buffer.size());
+            if (len <= 0) continue;
+            if (!visit(rid.slotNum, deserializeRecord(*meta, buffer.data(), len))) return true;
         }
-  
-    } else if (col->type == DataType::VARCHAR) {
-        std::string key = clause.value.strVal;
-        if (clause.op == CompareOp::EQ) {
-            RID rid;
-            if (indexMgr->searchEntry(tableName, clause.column.columnName, key, rid)) {
-                rids.push_back(rid);
-            }
+        return true;
+    }
+    std::vector<BPlusCursor> cursors;
+    if (!openIndexCursors(tableName, columnName, clause, backward, cursors)) {
+        return false;
+    }
+    for (auto& cursor : cursors) {
+        for (; cursor.valid(); cursor.advance()) {
+            int recordID = cursor.rid().slotNum;
+            int len = rm->getRecord(recordID, buffer.data(), (int)buffer.size());
+            if (len <= 0) continue;
+            if (!visit(recordID, deserializeRecord(*meta, buffer.data(), len))) return true;
         }
     }
-    
+    return true;
+}
+
+std::vector<std::pair<int, std::vector<Value>>> QueryExecutor::fetchRecords(
+    const std::string& tableName, const std::vector<RID>& rids) {
+    std::vector<std::pair<int, std::vector<Value>>> results;
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    RecordManager* rm = systemManager->getRecordManager(tableName);
+    if (!meta || !rm) return results;
 
     char* buffer = new char[8192];
     for (const auto& rid : rids) {
@@ -515,6 +554,476 @@ std::vector<std::pair<int, std::vector<Value>>> QueryExecutor::indexScan(
     return results;
 }
 
+bool QueryExecutor::tryIndexScan(const std::string& tableName,
+                                 const std::vector<WhereClause>& whereClauses,
+                                 std::vector<std::pair<int, std::vector<Value>>>& records) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!meta || !indexMgr || whereClauses.empty()) return false;
+    if (whereClauses.size() == 1) {
+        if (!shouldUseIndex(tableName, whereClauses[0])) return false;
+        records = indexScan(tableName, whereClauses[0]);
+        return true;
+    }
+    
+    // 组合索引：从第一列起连续有等值条件的列构成查找前缀
+    std::string bestIdx;
+    CompositeKey bestKey;
+    for (const auto& idx : meta->indexes) {
+        if (!TableMeta::isCompositeIndex(idx)) continue;
+        CompositeKey key;
+        compositeEqPrefix(*meta, idx, whereClauses, key);
+        if (key.partCount() > bestKey.partCount()) {
+            bestIdx = idx;
+            bestKey = key;
+        }
+    }
+    
+    // 单列索引：等值条件优先
+    const WhereClause* chosen = nullptr;
+    if (bestKey.partCount() < 2) {
+        for (const auto& clause : whereClauses) {
+            if (shouldUseIndex(tableName, clause) &&
+                (!chosen || (clause.op == CompareOp::EQ && chosen->op != CompareOp::EQ))) {
+                chosen = &clause;
+            }
+        }
+    }
+    if (chosen) {
+        records = indexScan(tableName, *chosen);
+    } else if (bestKey.partCount() > 0) {
+        records = fetchRecords(tableName, indexMgr->rangeSearch(tableName, bestIdx, bestKey, bestKey));
+    } else {
+        return false;
+    }
+    // 剩下的条件由调用方过滤；按 recordID 排序，结果顺序与全表扫描一致
+    std::sort(records.begin(), records.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    return true;
+}
+
+int QueryExecutor::compositeEqPrefix(const TableMeta& meta, const std::string& indexName,
+                                     const std::vector<WhereClause>& whereClauses, CompositeKey& key) {
+    for (const auto& colName : TableMeta::getIndexColumns(indexName)) {
+        const ColumnDef* col = meta.getColumn(colName);
+        const WhereClause* eq = nullptr;
+        for (const auto& clause : whereClauses) {
+            std::string name = clause.column.columnName;
+            size_t dotPos = name.find('.');
+            if (dotPos != std::string::npos) name = name.substr(dotPos + 1);
+            if (name == colName && clause.op == CompareOp::EQ && !clause.isColumnCompare &&
+                col && valueMatchesColumn(*col, clause.value)) {
+                eq = &clause;
+                break;
+            }
+        }
+        if (!eq) break;
+        if (col->type == DataType::INT) {
+            key.addInt(eq->value.intVal);
+        } else if (col->type == DataType::FLOAT) {
+            key.addFloat(floatKeyOf(eq->value));
+        } else {
+            key.addString(eq->value.strVal.substr(0, col->length));
+        }
+    }
+    return key.partCount();
+}
+
+// 非唯一索引包含每一条记录，可以直接用；唯一索引只在单列主键或显式 UNIQUE 上才完整
+// （早期版本给复合主键的各列、以及 ADD INDEX 建的都是唯一树，重复值会被丢掉）
+bool QueryExecutor::indexIsComplete(const std::string& tableName, const TableMeta& meta,
+                                    const std::string& colName) {
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!indexMgr) return false;
+    if (!indexMgr->isUniqueIndex(tableName, colName)) return true;
+    if (meta.primaryKey.size() == 1 && meta.primaryKey[0] == colName) return true;
+    for (const auto& idx : meta.explicitIndexes) {
+        if (idx.isUnique && !idx.columns.empty() && idx.columns[0] == colName) return true;
+    }
+    return false;
+}
+
+bool QueryExecutor::coversQuery(const std::string& tableName, const std::string& indexName,
+                                const std::vector<int>& usedCols,
+                                const std::vector<WhereClause>& whereClauses, bool nullsIgnored) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!meta || !indexMgr) return false;
+    bool composite = TableMeta::isCompositeIndex(indexName);
+    std::vector<std::string> keyCols = composite ? TableMeta::getIndexColumns(indexName)
+                                                 : std::vector<std::string>{indexName};
+    if (!composite && !indexIsComplete(tableName, *meta, indexName)) return false;
+
+    // 不回表时只有键里的列有值
+    std::vector<int> cols = usedCols;
+    std::vector<std::string> rejectNull;   // 条件不成立于 NULL 的列
+    for (const auto& clause : whereClauses) {
+        std::string name = clause.column.columnName;
+        size_t dotPos = name.find('.');
+        if (dotPos != std::string::npos) name = name.substr(dotPos + 1);
+        cols.push_back(meta->getColumnIndex(name));
+        if (clause.op != CompareOp::IS_NULL && clause.op != CompareOp::IN) rejectNull.push_back(name);
+        if (clause.isColumnCompare) {
+            std::string right = clause.rightColumn.columnName;
+            dotPos = right.find('.');
+            if (dotPos != std::string::npos) right = right.substr(dotPos + 1);
+            cols.push_back(meta->getColumnIndex(right));
+            rejectNull.push_back(right);
+        }
+    }
+    BPlusTree* tree = indexMgr->openIndex(tableName, indexName);
+    if (!tree) return false;
+    for (int colIdx : cols) {
+        if (colIdx < 0) return false;
+        const ColumnDef& col = meta->columns[colIdx];
+        // FLOAT 键是 float，记录里是 double，解不回原值
+        if (col.type == DataType::FLOAT) return false;
+        auto it = std::find(keyCols.begin(), keyCols.end(), col.name);
+        if (it == keyCols.end() || tree->keyPartOffset((int)(it - keyCols.begin())) < 0) return false;
+    }
+    // 有键列为 NULL 的行不在索引里，这些行必须本来就会被 WHERE 或聚合排除
+    if (composite || !nullsIgnored) {
+        for (const auto& name : keyCols) {
+            const ColumnDef* col = meta->getColumn(name);
+            if (!col) return false;
+            if (!col->notNull && std::find(rejectNull.begin(), rejectNull.end(), name) == rejectNull.end()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 能用的覆盖索引里优先选 WHERE 能缩小扫描范围的
+std::string QueryExecutor::findCoveringIndex(const std::string& tableName, const std::vector<int>& usedCols,
+                                             const std::vector<WhereClause>& whereClauses, bool nullsIgnored) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    if (!meta) return "";
+    std::string best;
+    bool bestNarrow = false;
+    for (const auto& idx : meta->indexes) {
+        if (!coversQuery(tableName, idx, usedCols, whereClauses, nullsIgnored)) continue;
+        bool narrow = false;
+        if (TableMeta::isCompositeIndex(idx)) {
+            CompositeKey key;
+            narrow = compositeEqPrefix(*meta, idx, whereClauses, key) > 0;
+        } else {
+            for (const auto& clause : whereClauses) {
+                if (shouldUseIndex(tableName, clause)) narrow = true;
+            }
+        }
+        if (best.empty() || (narrow && !bestNarrow)) {
+            best = idx;
+            bestNarrow = narrow;
+        }
+    }
+    return best;
+}
+
+// 键槽位里的一列解回记录中的值（只用于 INT / VARCHAR）
+static Value keyPartValue(const ColumnDef& col, const unsigned int* part) {
+    if (col.type == DataType::INT) return Value((int)part[0]);
+    // 与 deserializeRecord 一致，去掉尾部的 '\0'
+    std::string str((const char*)(part + 1), part[0]);
+    while (!str.empty() && str.back() == '\0') str.pop_back();
+    return Value(str);
+}
+
+bool QueryExecutor::streamCoveringScan(const std::string& tableName, const std::string& indexName,
+                                       const std::vector<WhereClause>& whereClauses, bool backward,
+                                       const std::function<bool(int, const std::vector<Value>&)>& visit) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!meta || !indexMgr) return false;
+    BPlusTree* tree = indexMgr->openIndex(tableName, indexName);
+    if (!tree) return false;
+    bool composite = TableMeta::isCompositeIndex(indexName);
+    std::vector<std::string> keyNames = composite ? TableMeta::getIndexColumns(indexName)
+                                                  : std::vector<std::string>{indexName};
+    // 能原样解出的键列及其在键中的序号
+    std::vector<int> keyCols, parts;
+    for (int i = 0; i < (int)keyNames.size(); i++) {
+        int colIdx = meta->getColumnIndex(keyNames[i]);
+        if (colIdx < 0 || tree->keyPartOffset(i) < 0 || meta->columns[colIdx].type == DataType::FLOAT) continue;
+        keyCols.push_back(colIdx);
+        parts.push_back(i);
+    }
+
+    std::vector<BPlusCursor> cursors;
+    if (composite) {
+        CompositeKey key;
+        if (compositeEqPrefix(*meta, indexName, whereClauses, key) > 0) {
+            cursors.push_back(tree->openCursor(&key, &key, true, true, backward));
+        } else {
+            cursors.push_back(tree->openCursor(backward));
+        }
+    } else {
+        const WhereClause* driver = nullptr;
+        for (const auto& clause : whereClauses) {
+            if (shouldUseIndex(tableName, clause) &&
+                (!driver || (clause.op == CompareOp::EQ && driver->op != CompareOp::EQ))) {
+                driver = &clause;
+            }
+        }
+        if (!openIndexCursors(tableName, indexName, driver, backward, cursors)) return false;
+    }
+
+    std::vector<Value> values(meta->columns.size(), Value::makeNull());
+    for (auto& cursor : cursors) {
+        for (; cursor.valid(); cursor.advance()) {
+            const unsigned int* slot = cursor.key();
+            unsigned int buf[BP_MAX_KEY_INTS];
+            for (size_t i = 0; i < keyCols.size(); i++) {
+                values[keyCols[i]] = keyPartValue(meta->columns[keyCols[i]], tree->keyPart(slot, parts[i], buf));
+            }
+            if (!visit(cursor.rid().slotNum, values)) return true;
+        }
+    }
+    return true;
+}
+
+bool QueryExecutor::tryIndexAggregate(const std::string& tableName, const std::vector<AggregateType>& aggTypes,
+                                      const std::vector<int>& aggCols,
+                                      const std::vector<WhereClause>& whereClauses,
+                                      std::vector<long long>& counts, std::vector<Value>& bests) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!meta || !indexMgr) return false;
+    int colIdx = -1;
+    bool countStar = false;
+    for (size_t i = 0; i < aggTypes.size(); i++) {
+        if (aggTypes[i] != AggregateType::COUNT && aggTypes[i] != AggregateType::MIN &&
+            aggTypes[i] != AggregateType::MAX) {
+            return false;
+        }
+        if (aggCols[i] == -1) {
+            countStar = true;
+        } else if (colIdx == -1 || colIdx == aggCols[i]) {
+            colIdx = aggCols[i];
+        } else {
+            return false;
+        }
+    }
+    // 各条件合并成该列上的一个区间 [low, high]，两端取最紧的那个
+    const Value* low = nullptr;
+    const Value* high = nullptr;
+    bool includeLow = true;
+    bool includeHigh = true;
+    for (const auto& clause : whereClauses) {
+        std::string name = clause.column.columnName;
+        size_t dotPos = name.find('.');
+        if (dotPos != std::string::npos) name = name.substr(dotPos + 1);
+        int idx = meta->getColumnIndex(name);
+        if (colIdx == -1) colIdx = idx;
+        if (idx < 0 || idx != colIdx || clause.isColumnCompare) return false;
+        const ColumnDef& col = meta->columns[idx];
+        if (!valueMatchesColumn(col, clause.value)) return false;
+        // 超过列长的常量在索引里会被截断，交给逐条比较
+        if (col.type == DataType::VARCHAR && (int)clause.value.strVal.size() > col.length) return false;
+        bool lowSide = clause.op == CompareOp::EQ || clause.op == CompareOp::GT || clause.op == CompareOp::GE;
+        bool highSide = clause.op == CompareOp::EQ || clause.op == CompareOp::LT || clause.op == CompareOp::LE;
+        if (!lowSide && !highSide) return false;
+        if (lowSide) {
+            int c = low ? compareValues(clause.value, *low) : 1;
+            if (c > 0 || (c == 0 && clause.op == CompareOp::GT)) {
+                low = &clause.value;
+                includeLow = clause.op != CompareOp::GT;
+            }
+        }
+        if (highSide) {
+            int c = high ? compareValues(clause.value, *high) : -1;
+            if (c < 0 || (c == 0 && clause.op == CompareOp::LT)) {
+                high = &clause.value;
+                includeHigh = clause.op != CompareOp::LT;
+            }
+        }
+    }
+    if (colIdx < 0) return false;
+    const ColumnDef& col = meta->columns[colIdx];
+    if (!meta->hasIndex(col.name) || !coversQuery(tableName, col.name, {colIdx}, whereClauses, !countStar)) {
+        return false;
+    }
+    BPlusTree* tree = indexMgr->openIndex(tableName, col.name);
+    if (!tree) return false;
+
+    counts.assign(aggTypes.size(), 0);
+    bests.assign(aggTypes.size(), Value::makeNull());
+    auto evaluate = [&](const auto* lowKey, const auto* highKey) {
+        long long count = -1;
+        for (size_t i = 0; i < aggTypes.size(); i++) {
+            if (aggTypes[i] == AggregateType::COUNT) {
+                if (count < 0) count = tree->countRange(lowKey, highKey, includeLow, includeHigh);
+                counts[i] = count;
+            } else {
+                // MIN 取区间第一项，MAX 取最后一项
+                bool backward = aggTypes[i] == AggregateType::MAX;
+                BPlusCursor cursor = tree->openCursor(lowKey, highKey, includeLow, includeHigh, backward);
+                if (cursor.valid()) bests[i] = keyPartValue(col, cursor.key());
+            }
+        }
+    };
+    if (col.type == DataType::INT) {
+        int lowKey = low ? low->intVal : 0;
+        int highKey = high ? high->intVal : 0;
+        evaluate(low ? &lowKey : nullptr, high ? &highKey : nullptr);
+    } else {
+        std::string lowKey = low ? low->strVal : "";
+        std::string highKey = high ? high->strVal : "";
+        evaluate(low ? &lowKey : nullptr, high ? &highKey : nullptr);
+    }
+    return true;
+}
+
+bool QueryExecutor::makeCompositeKey(const TableMeta& meta, const std::vector<std::string>& columns,
+                                     const std::vector<Value>& values, CompositeKey& key) {
+    for (const auto& colName : columns) {
+        int colIdx = meta.getColumnIndex(colName);
+        if (colIdx < 0 || colIdx >= (int)values.size() || values[colIdx].isNull) {
+            return false;
+        }
+        const ColumnDef& col = meta.columns[colIdx];
+        const Value& val = values[colIdx];
+        if (col.type == DataType::INT) {
+            key.addInt(val.intVal);
+        } else if (col.type == DataType::FLOAT) {
+            key.addFloat((float)val.floatVal);
+        } else {
+            key.addString(val.strVal.substr(0, col.length));
+        }
+    }
+    return true;
+}
+
+void QueryExecutor::insertIndexEntries(const std::string& tableName, const TableMeta& meta,
+                                       int recordID, const std::vector<Value>& values) {
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!indexMgr) return;
+    RID rid(0, recordID);
+    for (const auto& idx : meta.indexes) {
+        if (TableMeta::isCompositeIndex(idx)) {
+            CompositeKey key;
+            if (makeCompositeKey(meta, TableMeta::getIndexColumns(idx), values, key)) {
+                indexMgr->insertEntry(tableName, idx, key, rid);
+            }
+            continue;
+        }
+        int colIdx = meta.getColumnIndex(idx);
+        if (colIdx < 0 || colIdx >= (int)values.size() || values[colIdx].isNull) continue;
+        const Value& val = values[colIdx];
+        if (meta.columns[colIdx].type == DataType::INT) {
+            indexMgr->insertEntry(tableName, idx, val.intVal, rid);
+        } else if (meta.columns[colIdx].type == DataType::FLOAT) {
+            indexMgr->insertEntry(tableName, idx, val.floatVal, rid);
+        } else {
+            indexMgr->insertEntry(tableName, idx, val.strVal, rid);
+        }
+    }
+    for (const auto& idx : meta.hashIndexes) {
+        int colIdx = meta.getColumnIndex(idx);
+        if (colIdx < 0 || colIdx >= (int)values.size() || values[colIdx].isNull) continue;
+        const Value& val = values[colIdx];
+        if (meta.columns[colIdx].type == DataType::INT) {
+            indexMgr->insertHashEntry(tableName, idx, val.intVal, rid);
+        } else if (meta.columns[colIdx].type == DataType::FLOAT) {
+            indexMgr->insertHashEntry(tableName, idx, val.floatVal, rid);
+        } else {
+            indexMgr->insertHashEntry(tableName, idx, val.strVal, rid);
+        }
+    }
+}
+
+void QueryExecutor::deleteIndexEntries(const std::string& tableName, const TableMeta& meta,
+                                       int recordID, const std::vector<Value>& values) {
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!indexMgr) return;
+    RID rid(0, recordID);
+    for (const auto& idx : meta.indexes) {
+        if (TableMeta::isCompositeIndex(idx)) {
+            CompositeKey key;
+            if (makeCompositeKey(meta, TableMeta::getIndexColumns(idx), values, key)) {
+                indexMgr->deleteEntry(tableName, idx, key, rid);
+            }
+            continue;
+        }
+        int colIdx = meta.getColumnIndex(idx);
+        if (colIdx < 0 || colIdx >= (int)values.size() || values[colIdx].isNull) continue;
+        const Value& val = values[colIdx];
+        if (meta.columns[colIdx].type == DataType::INT) {
+            indexMgr->deleteEntry(tableName, idx, val.intVal, rid);
+        } else if (meta.columns[colIdx].type == DataType::FLOAT) {
+            indexMgr->deleteEntry(tableName, idx, val.floatVal, rid);
+        } else {
+            indexMgr->deleteEntry(tableName, idx, val.strVal, rid);
+        }
+    }
+    for (const auto& idx : meta.hashIndexes) {
+        int colIdx = meta.getColumnIndex(idx);
+        if (colIdx < 0 || colIdx >= (int)values.size() || values[colIdx].isNull) continue;
+        const Value& val = values[colIdx];
+        if (meta.columns[colIdx].type == DataType::INT) {
+            indexMgr->deleteHashEntry(tableName, idx, val.intVal, rid);
+        } else if (meta.columns[colIdx].type == DataType::FLOAT) {
+            indexMgr->deleteHashEntry(tableName, idx, val.floatVal, rid);
+        } else {
+            indexMgr->deleteHashEntry(tableName, idx, val.strVal, rid);
+        }
+    }
+}
+
+void QueryExecutor::updateCompositeIndexEntries(const std::string& tableName, const TableMeta& meta,
+                                                int recordID, const std::vector<Value>& oldValues,
+                                                const std::vector<Value>& newValues) {
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!indexMgr) return;
+    RID rid(0, recordID);
+    for (const auto& idx : meta.indexes) {
+        if (!TableMeta::isCompositeIndex(idx)) continue;
+        std::vector<std::string> cols = TableMeta::getIndexColumns(idx);
+        CompositeKey oldKey, newKey;
+        bool hasOld = makeCompositeKey(meta, cols, oldValues, oldKey);
+        bool hasNew = makeCompositeKey(meta, cols, newValues, newKey);
+        if (hasOld == hasNew && oldKey.words == newKey.words) continue;
+        if (hasOld) indexMgr->deleteEntry(tableName, idx, oldKey, rid);
+        if (hasNew) indexMgr->insertEntry(tableName, idx, newKey, rid);
+    }
+}
+
+// 哈希索引的列被改动时删掉旧条目、插入新条目
+void QueryExecutor::updateHashIndexEntries(const std::string& tableName, const TableMeta& meta, int recordID,
+                                           const std::vector<Value>& oldValues,
+                                           const std::vector<Value>& newValues) {
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!indexMgr) return;
+    RID rid(0, recordID);
+    for (const auto& idx : meta.hashIndexes) {
+        int colIdx = meta.getColumnIndex(idx);
+        if (colIdx < 0 || colIdx >= (int)oldValues.size() || colIdx >= (int)newValues.size()) continue;
+        const Value& oldVal = oldValues[colIdx];
+        const Value& newVal = newValues[colIdx];
+        if (oldVal.isNull && newVal.isNull) continue;
+        if (!oldVal.isNull && !newVal.isNull && compareValues(oldVal, newVal) == 0) continue;
+        DataType type = meta.columns[colIdx].type;
+        if (!oldVal.isNull) {
+            if (type == DataType::INT) {
+                indexMgr->deleteHashEntry(tableName, idx, oldVal.intVal, rid);
+            } else if (type == DataType::FLOAT) {
+                indexMgr->deleteHashEntry(tableName, idx, oldVal.floatVal, rid);
+            } else {
+                indexMgr->deleteHashEntry(tableName, idx, oldVal.strVal, rid);
+            }
+        }
+        if (!newVal.isNull) {
+            if (type == DataType::INT) {
+                indexMgr->insertHashEntry(tableName, idx, newVal.intVal, rid);
+            } else if (type == DataType::FLOAT) {
+                indexMgr->insertHashEntry(tableName, idx, newVal.floatVal, rid);
+            } else {
+                indexMgr->insertHashEntry(tableName, idx, newVal.strVal, rid);
+            }
+        }
+    }
+}
+
 ResultSet QueryExecutor::executeInsert(const std::string& tableName,
                                         const std::vector<std::vector<Value>>& valueLists) {
     ResultSet result;
@@ -531,8 +1040,6 @@ ResultSet QueryExecutor::executeInsert(const std::string& tableName,
         return result;
     }
     
-    IndexManager* indexMgr = systemManager->getIndexManager();
-    
     int insertedCount = 0;
     
     for (const auto& values : valueLists) {
@@ -548,8 +1055,8 @@ ResultSet QueryExecutor::executeInsert(const std::string& tableName,
             return result;
         }
         
-        // 检查主键约束 
-        if (!checkPrimaryKey(tableName, values)) {
+        // 检查主键约束和 UNIQUE 索引
+        if (!checkPrimaryKey(tableName, values) || !checkUniqueIndexes(tableName, values)) {
             result.setError("Duplicate entry - duplicate value violates constraint");
             return result;
         }
@@ -571,24 +1078,7 @@ ResultSet QueryExecutor::executeInsert(const std::string& tableName,
         }
         
         // 更新索引
-        if (indexMgr) {
-            for (size_t i = 0; i < meta->columns.size(); i++) {
-                if (meta->hasIndex(meta->columns[i].name)) {
-                    RID rid(0, recordID);
-                    const Value& val = values[i];
-                    
-                    if (!val.isNull) {
-                        if (meta->columns[i].type == DataType::INT) {
-                            indexMgr->insertEntry(tableName, meta->columns[i].name, val.intVal, rid);
-                        } else if (meta->columns[i].type == DataType::FLOAT) {
-                            indexMgr->insertEntry(tableName, meta->columns[i].name, val.floatVal, rid);
-                        } else {
-                            indexMgr->insertEntry(tableName, meta->columns[i].name, val.strVal, rid);
-                        }
-                    }
-                }
-            }
-        }
+        insertIndexEntries(tableName, *meta, recordID, values);
         
         insertedCount++;
         systemManager->updateRecordCount(tableName, 1);
@@ -615,13 +1105,11 @@ ResultSet QueryExecutor::executeDelete(const std::string& tableName,
         return result;
     }
     
-    IndexManager* indexMgr = systemManager->getIndexManager();
-    
-    // 优化：如果 WHERE 子句只有一个条件且可以使用索引，则使用索引扫描
+    // 优化：如果 WHERE 条件可以使用索引，则使用索引扫描
     // 否则如果有 WHERE 子句，使用流式过滤扫描以节省内存
     std::vector<std::pair<int, std::vector<Value>>> records;
-    if (whereClauses.size() == 1 && shouldUseIndex(tableName, whereClauses[0])) {
-        records = indexScan(tableName, whereClauses[0]);
+    if (tryIndexScan(tableName, whereClauses, records)) {
+        // 剩余条件在下面逐行检查
     } else if (!whereClauses.empty()) {
         records = scanTableFiltered(tableName, whereClauses);
     } else {
@@ -687,22 +1175,7 @@ ResultSet QueryExecutor::executeDelete(const std::string& tableName,
                 return result;
             }
             
-            if (indexMgr) {
-                for (size_t i = 0; i < meta->columns.size(); i++) {
-                    if (meta->hasIndex(meta->columns[i].name)) {
-                        const Value& val = values[i];
-                        if (!val.isNull) {
-                            if (meta->columns[i].type == DataType::INT) {
-                                indexMgr->deleteEntry(tableName, meta->columns[i].name, val.intVal);
-                            } else if (meta->columns[i].type == DataType::FLOAT) {
-                                indexMgr->deleteEntry(tableName, meta->columns[i].name, val.floatVal);
-                            } else {
-                                indexMgr->deleteEntry(tableName, meta->columns[i].name, val.strVal);
-                            }
-                        }
-                    }
-                }
-            }
+            deleteIndexEntries(tableName, *meta, recordID, values);
             
             if (rm->deleteRecord(recordID)) {
                 deletedCount++;
@@ -774,12 +1247,13 @@ ResultSet QueryExecutor::executeUpdate(const std::string& tableName,
                     if (indexMgr && meta->hasIndex(sc.column)) {
                         const Value& oldVal = oldValues[colIdx];
                         if (!oldVal.isNull) {
+                            RID rid(0, recordID);
                             if (meta->columns[colIdx].type == DataType::INT) {
-                                indexMgr->deleteEntry(tableName, sc.column, oldVal.intVal);
+                                indexMgr->deleteEntry(tableName, sc.column, oldVal.intVal, rid);
                             } else if (meta->columns[colIdx].type == DataType::FLOAT) {
-                                indexMgr->deleteEntry(tableName, sc.column, oldVal.floatVal);
+                                indexMgr->deleteEntry(tableName, sc.column, oldVal.floatVal, rid);
                             } else {
-                                indexMgr->deleteEntry(tableName, sc.column, oldVal.strVal);
+                                indexMgr->deleteEntry(tableName, sc.column, oldVal.strVal, rid);
                             }
                         }
                     }
@@ -891,6 +1365,10 @@ ResultSet QueryExecutor::executeUpdate(const std::string& tableName,
                 }
             }
             
+            // 组合索引在约束检查之后再改，避免主键检查看到自己的新键
+            updateCompositeIndexEntries(tableName, *meta, recordID, oldValues, newValues);
+            updateHashIndexEntries(tableName, *meta, recordID, oldValues, newValues);
+            
             // 序列化并更新记录
             std::vector<char> data = serializeRecord(*meta, newValues);
             if (rm->updateRecord(recordID, data.data(), data.size())) {
@@ -1157,69 +1635,131 @@ ResultSet QueryExecutor::executeSelect(const std::vector<Selector>& selectors,
             states.push_back(st);
         }
 
-        // 获取 recordID：使用安全版本，避免 recordCount 未维护时无限扩容导致"卡死"。
-        std::vector<int> recordIDs;
-        getAllRecordIDsSafe(rm, meta, recordIDs);
-
-        char* buffer = new char[8192];
-        for (int rid : recordIDs) {
-            int len = rm->getRecord(rid, buffer, 8192);
-            if (len <= 0) continue;
-            std::vector<Value> values = deserializeRecord(*meta, buffer, len);
-            if (!matchAllWhereClauses(whereClauses, *meta, values)) continue;
-
-            // 命中 WHERE 的记录，更新各聚合状态
+        // COUNT / MIN / MAX 落在一个索引上时直接从树上求，不逐条扫描
+        std::vector<long long> indexCounts;
+        std::vector<Value> indexBests;
+        bool fromIndex = tryIndexAggregate(tableName, selectAggTypes, selectColIndices, whereClauses,
+                                           indexCounts, indexBests);
+        // 无 WHERE 且只涉及 INT 列时，按列统计：压缩页直接使用块头的 SUM/MIN/MAX
+        bool columnar = whereClauses.empty();
+        for (const auto& st : states) {
+            if (st.colIdx == -1) continue;
+            int offset = meta->getColumnOffset(st.colIdx);
+            if (meta->columns[st.colIdx].type != DataType::INT || offset % 4 != 0) {
+                columnar = false;
+            }
+        }
+        if (fromIndex) {
+            for (size_t i = 0; i < states.size(); i++) {
+                states[i].cnt = indexCounts[i];
+                states[i].best = indexBests[i];
+            }
+        } else if (columnar) {
+            std::map<int, IntColumnStats> statsByCol;
+            for (const auto& st : states) {
+                if (statsByCol.count(st.colIdx)) continue;
+                IntColumnStats stats;
+                int wordOffset = (st.colIdx == -1) ? -1 : meta->getColumnOffset(st.colIdx) / 4;
+                rm->aggregateIntColumn(wordOffset, st.colIdx, stats);
+                statsByCol[st.colIdx] = stats;
+            }
             for (auto& st : states) {
+                const IntColumnStats& stats = statsByCol[st.colIdx];
                 switch (st.type) {
                     case AggregateType::COUNT:
-                        if (st.colIdx == -1) {
-                            // COUNT(*)
-                            st.cnt++;
-                        } else if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
-                            // COUNT(col)
-                            if (!values[st.colIdx].isNull) st.cnt++;
-                        }
+                        st.cnt = (st.colIdx == -1) ? stats.rows : stats.count;
                         break;
                     case AggregateType::SUM:
-                        if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
-                            const Value& v = values[st.colIdx];
-                            if (!v.isNull) {
-                                if (v.type == Value::Type::INT) st.sum += (double)v.intVal;
-                                else if (v.type == Value::Type::FLOAT) {
-                                    st.sum += (double)v.floatVal;
-                                    st.hasFloat = true;
-                                }
-                            }
-                        }
+                        st.sum = (double)stats.sum;
                         break;
                     case AggregateType::AVG:
-                        if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
-                            const Value& v = values[st.colIdx];
-                            if (!v.isNull) {
-                                if (v.type == Value::Type::INT) st.sum += (double)v.intVal;
-                                else if (v.type == Value::Type::FLOAT) st.sum += (double)v.floatVal;
-                                st.cnt++;
-                            }
-                        }
+                        st.sum = (double)stats.sum;
+                        st.cnt = stats.count;
                         break;
                     case AggregateType::MAX:
-                        if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
-                            const Value& v = values[st.colIdx];
-                            if (!v.isNull && (st.best.isNull || compareValues(v, st.best) > 0)) st.best = v;
-                        }
+                        if (stats.count > 0) st.best = Value(stats.maxVal);
                         break;
                     case AggregateType::MIN:
-                        if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
-                            const Value& v = values[st.colIdx];
-                            if (!v.isNull && (st.best.isNull || compareValues(v, st.best) < 0)) st.best = v;
-                        }
+                        if (stats.count > 0) st.best = Value(stats.minVal);
                         break;
                     default:
                         break;
                 }
             }
+        } else {
+            // 命中 WHERE 的记录，更新各聚合状态
+            auto accumulate = [&](const std::vector<Value>& values) {
+                for (auto& st : states) {
+                    switch (st.type) {
+                        case AggregateType::COUNT:
+                            if (st.colIdx == -1) {
+                                // COUNT(*)
+                                st.cnt++;
+                            } else if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
+                                // COUNT(col)
+                                if (!values[st.colIdx].isNull) st.cnt++;
+                            }
+                            break;
+                        case AggregateType::SUM:
+                            if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
+                                const Value& v = values[st.colIdx];
+                                if (!v.isNull) {
+                                    if (v.type == Value::Type::INT) st.sum += (double)v.intVal;
+                                    else if (v.type == Value::Type::FLOAT) {
+                                        st.sum += (double)v.floatVal;
+                                        st.hasFloat = true;
+                                    }
+                                }
+                            }
+                            break;
+                        case AggregateType::AVG:
+                            if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
+                                const Value& v = values[st.colIdx];
+                                if (!v.isNull) {
+                                    if (v.type == Value::Type::INT) st.sum += (double)v.intVal;
+                                    else if (v.type == Value::Type::FLOAT) st.sum += (double)v.floatVal;
+                                    st.cnt++;
+                                }
+                            }
+                            break;
+                        case AggregateType::MAX:
+                            if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
+                                const Value& v = values[st.colIdx];
+                                if (!v.isNull && (st.best.isNull || compareValues(v, st.best) > 0)) st.best = v;
+                            }
+                            break;
+                        case AggregateType::MIN:
+                            if (st.colIdx >= 0 && st.colIdx < (int)values.size()) {
+                                const Value& v = values[st.colIdx];
+                                if (!v.isNull && (st.best.isNull || compareValues(v, st.best) < 0)) st.best = v;
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            };
+            // 只用到一个索引里的列时沿索引叶子计算，不回表
+            std::vector<int> usedCols;
+            bool nullsIgnored = true;
+            for (const auto& st : states) {
+                if (st.colIdx >= 0) usedCols.push_back(st.colIdx);
+                else nullsIgnored = false;
+            }
+            std::string covering = findCoveringIndex(tableName, usedCols, whereClauses, nullsIgnored);
+            if (!covering.empty()) {
+                streamCoveringScan(tableName, covering, whereClauses, false,
+                    [&](int, const std::vector<Value>& values) {
+                        if (matchAllWhereClauses(whereClauses, *meta, values)) accumulate(values);
+                        return true;
+                    });
+            } else {
+                rm->forEachRecord([&](int, const unsigned int* data, int dataLen) {
+                    std::vector<Value> values = deserializeRecord(*meta, (const char*)data, dataLen * 4);
+                    if (matchAllWhereClauses(whereClauses, *meta, values)) accumulate(values);
+                });
+            }
         }
-        delete[] buffer;
 
         ResultRow aggRow;
         for (const auto& st : states) {
@@ -1255,13 +1795,99 @@ ResultSet QueryExecutor::executeSelect(const std::vector<Selector>& selectors,
         return result;
     }
 
+    // 有 LIMIT 时尽量沿索引游标边取边过滤，凑够 OFFSET + LIMIT 行就停止；
+    // 有 ORDER BY 时只有排序列上的索引能按序给出结果
+    if (limit >= 0 && !hasGroupBy) {
+        std::string orderCol = orderByColumn.columnName;
+        size_t dotPos = orderCol.find('.');
+        if (dotPos != std::string::npos) {
+            orderCol = orderCol.substr(dotPos + 1);
+        }
+        const WhereClause* driver = nullptr;
+        for (const auto& clause : whereClauses) {
+            std::string name = clause.column.columnName;
+            size_t pos = name.find('.');
+            if (pos != std::string::npos) name = name.substr(pos + 1);
+            if (hasOrderBy && name != orderCol) continue;
+            if (shouldUseIndex(tableName, clause) &&
+                (!driver || (clause.op == CompareOp::EQ && driver->op != CompareOp::EQ))) {
+                driver = &clause;
+            }
+        }
+        // FLOAT 索引键是 float，记录里的 double 在同一个键内不一定有序，不能靠索引排序
+        const ColumnDef* orderDef = hasOrderBy ? meta->getColumn(orderCol) : nullptr;
+        if (orderDef && orderDef->type == DataType::FLOAT) {
+            driver = nullptr;
+        }
+        // 只按单列主键排序时整个主键索引就是有序的全表
+        bool fullIndex = !driver && orderDef && orderDef->type != DataType::FLOAT &&
+                         meta->primaryKey.size() == 1 &&
+                         meta->primaryKey[0] == orderCol && meta->hasIndex(orderCol);
+        if (driver || fullIndex) {
+            std::string indexCol = driver ? driver->column.columnName : orderCol;
+            bool backward = hasOrderBy && orderType == OrderType::DESC;
+            int skipped = 0;
+            auto emit = [&](int, const std::vector<Value>& values) {
+                if (!matchAllWhereClauses(whereClauses, *meta, values)) return true;
+                if (skipped < offset) {
+                    skipped++;
+                    return true;
+                }
+                ResultRow row;
+                for (int colIdx : selectColIndices) {
+                    if (colIdx >= 0 && colIdx < (int)values.size()) {
+                        row.values.push_back(values[colIdx]);
+                    }
+                }
+                result.addRow(row);
+                return (int)result.rows.size() < limit;
+            };
+            if (limit > 0) {
+                std::string indexName = indexCol;
+                size_t pos = indexName.find('.');
+                if (pos != std::string::npos) indexName = indexName.substr(pos + 1);
+                if (coversQuery(tableName, indexName, selectColIndices, whereClauses, false)) {
+                    streamCoveringScan(tableName, indexName, whereClauses, backward, emit);
+                } else {
+                    streamIndexScan(tableName, indexCol, driver, backward, emit);
+                }
+            }
+            return result;
+        }
+    }
+
     // 优化：使用流式过滤扫描，避免将所有记录加载到内存
     std::vector<std::vector<Value>> filteredRecords;
     
-    if (whereClauses.size() == 1 && shouldUseIndex(tableName, whereClauses[0])) {
+    std::vector<std::pair<int, std::vector<Value>>> indexRecords;
+    std::vector<int> usedCols;
+    for (int colIdx : selectColIndices) {
+        if (colIdx >= 0) usedCols.push_back(colIdx);
+    }
+    if (hasOrderBy && meta->getColumnIndex(orderByColumn.columnName) >= 0) {
+        usedCols.push_back(meta->getColumnIndex(orderByColumn.columnName));
+    }
+    if (hasGroupBy) {
+        usedCols.push_back(meta->getColumnIndex(groupByColumn.columnName));
+    }
+    std::string covering = findCoveringIndex(tableName, usedCols, whereClauses, false);
+    if (!covering.empty()) {
+        // 覆盖索引：只读叶子，按 recordID 排序后与全表扫描顺序一致
+        streamCoveringScan(tableName, covering, whereClauses, false,
+            [&](int recordID, const std::vector<Value>& values) {
+                if (matchAllWhereClauses(whereClauses, *meta, values)) {
+                    indexRecords.push_back({recordID, values});
+                }
+                return true;
+            });
+        std::sort(indexRecords.begin(), indexRecords.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (auto& entry : indexRecords) {
+            filteredRecords.push_back(std::move(entry.second));
+        }
+    } else if (tryIndexScan(tableName, whereClauses, indexRecords)) {
         // 使用索引扫描
-        auto records = indexScan(tableName, whereClauses[0]);
-        for (const auto& [recordID, values] : records) {
+        for (const auto& [recordID, values] : indexRecords) {
             if (matchAllWhereClauses(whereClauses, *meta, values)) {
                 filteredRecords.push_back(values);
             }
@@ -1398,6 +2024,52 @@ ResultSet QueryExecutor::executeSelect(const std::vector<Selector>& selectors,
     return result;
 }
 
+// 连接用的哈希表：条目是调用方的下标 0..n-1，按哈希值分桶，桶内按下标从小到大串起来
+struct JoinHashTable {
+    std::vector<int> heads;
+    std::vector<int> links;
+    std::vector<size_t> hashes;
+    int shift;
+    
+    template <typename F> void build(size_t n, F hashOf) {
+        int bits = 1;
+        while (((size_t)1 << bits) < n * 2) bits++;
+        shift = 64 - bits;
+        heads.assign((size_t)1 << bits, -1);
+        links.assign(n, -1);
+        hashes.resize(n);
+        // 倒着插到桶头，桶内就是正序
+        for (size_t k = n; k-- > 0;) {
+            hashes[k] = hashOf(k);
+            size_t b = bucket(hashes[k]);
+            links[k] = heads[b];
+            heads[b] = (int)k;
+        }
+    }
+    size_t bucket(size_t h) const { return (size_t)((h * 0x9E3779B97F4A7C15ULL) >> shift); }
+    int first(size_t h) const { return skip(heads[bucket(h)], h); }
+    int nextOf(int k, size_t h) const { return skip(links[k], h); }
+    int skip(int k, size_t h) const {
+        while (k >= 0 && hashes[k] != h) k = links[k];
+        return k;
+    }
+};
+
+// compareValues 判为相等的值哈希也相同：NULL 与 NULL 相等，INT 与 FLOAT 比较时都按 double 算
+static size_t joinHash(const Value& v, bool asDouble) {
+    if (v.isNull) return 0;
+    if (v.type == Value::Type::STRING) return std::hash<std::string>()(v.strVal);
+    if (v.type == Value::Type::INT && !asDouble) return std::hash<int>()(v.intVal);
+    double d = v.type == Value::Type::INT ? (double)v.intVal : v.floatVal;
+    if (d == 0) d = 0;   // -0.0 与 0.0 相等
+    return std::hash<double>()(d);
+}
+
+static bool joinTypesHashable(DataType a, DataType b) {
+    bool numeric = (a == DataType::INT || a == DataType::FLOAT) && (b == DataType::INT || b == DataType::FLOAT);
+    return numeric || (a == DataType::VARCHAR && b == DataType::VARCHAR);
+}
+
 ResultSet QueryExecutor::executeJoin(const std::vector<std::string>& tables,
                                       const std::vector<WhereClause>& whereClauses,
                                       const std::vector<Selector>& selectors) {
@@ -1418,11 +2090,6 @@ ResultSet QueryExecutor::executeJoin(const std::vector<std::string>& tables,
         metas.push_back(meta);
     }
     
-    std::vector<std::vector<std::pair<int, std::vector<Value>>>> allRecords;
-    for (const auto& tableName : tables) {
-        allRecords.push_back(scanTable(tableName));
-    }
-    
     std::vector<std::string> allColNames;
     std::vector<DataType> allColTypes;
     std::vector<std::pair<int, int>> colMapping;  
@@ -1435,145 +2102,318 @@ ResultSet QueryExecutor::executeJoin(const std::vector<std::string>& tables,
         }
     }
     
-    // 构建组合后的元数据（提前构建，用于过滤）
-    TableMeta combinedMeta;
-    for (size_t t = 0; t < tables.size(); t++) {
-        for (const auto& col : metas[t]->columns) {
-            ColumnDef newCol = col;
-            newCol.name = tables[t] + "." + col.name;
-            combinedMeta.columns.push_back(newCol);
+    // 条件里的列只解析一次：带表名的先精确匹配 table.column，否则按列名取第一个
+    auto resolveColumn = [&](const Column& column) -> int {
+        if (!column.tableName.empty()) {
+            std::string fullName = column.tableName + "." + column.columnName;
+            for (size_t i = 0; i < allColNames.size(); i++) {
+                if (allColNames[i] == fullName) return (int)i;
+            }
+        }
+        for (size_t i = 0; i < colMapping.size(); i++) {
+            if (metas[colMapping[i].first]->columns[colMapping[i].second].name == column.columnName) {
+                return (int)i;
+            }
         }
+        return -1;
+    };
+    
+    // 解析不了的条件对所有组合都不成立
+    std::vector<JoinClause> joinClauses;
+    bool unresolved = false;
+    for (const auto& clause : whereClauses) {
+        JoinClause jc;
+        jc.clause = &clause;
+        jc.left = resolveColumn(clause.column);
+        jc.right = clause.isColumnCompare ? resolveColumn(clause.rightColumn) : -1;
+        if (jc.left < 0 || (clause.isColumnCompare && jc.right < 0)) {
+            unresolved = true;
+            break;
+        }
+        int leftTable = colMapping[jc.left].first;
+        int rightTable = jc.right >= 0 ? colMapping[jc.right].first : leftTable;
+        jc.step = std::max(leftTable, rightTable);
+        jc.local = leftTable == rightTable;
+        joinClauses.push_back(jc);
     }
     
-    // 预处理 WHERE 条件，区分可以提前应用的单表条件和 JOIN 条件
-    auto matchRecord = [&](const std::vector<Value>& record) -> bool {
-        for (const auto& clause : whereClauses) {
-            std::string leftColName = clause.column.tableName.empty() ?
-                                       clause.column.columnName :
-                                       clause.column.tableName + "." + clause.column.columnName;
-            
-            int leftIdx = -1;
-            if (!clause.column.tableName.empty()) {
-                for (size_t i = 0; i < allColNames.size(); i++) {
-                    if (allColNames[i] == leftColName) {
-                        leftIdx = i;
-                        break;
-                    }
-                }
+    size_t tableCount = tables.size();
+    std::vector<std::vector<const JoinClause*>> stepClauses(tableCount);
+    for (const auto& jc : joinClauses) {
+        if (!jc.local) stepClauses[jc.step].push_back(&jc);
+    }
+    
+    // 每张表读进来的行（只留满足单表条件的），组合里存的是行号
+    std::vector<std::vector<std::pair<int, std::vector<Value>>>> inputs(tableCount);
+    std::vector<std::vector<int>> scanRows(tableCount);
+    std::vector<bool> loaded(tableCount, false);
+    std::vector<std::unordered_map<int, int>> rowOf(tableCount);   // 索引连接的内表：recordID -> 行号，-1 为被过滤
+    
+    auto matchLocal = [&](int t, const std::vector<Value>& values) {
+        for (const auto& jc : joinClauses) {
+            if (!jc.local || jc.step != t) continue;
+            const Value& right = jc.right >= 0 ? values[colMapping[jc.right].second] : jc.clause->value;
+            if (!matchJoinValues(*jc.clause, values[colMapping[jc.left].second], right)) return false;
+        }
+        return true;
+    };
+    auto addRow = [&](int t, int recordID, std::vector<Value>&& values) -> int {
+        if (!matchLocal(t, values)) return -1;
+        inputs[t].push_back({recordID, std::move(values)});
+        return (int)inputs[t].size() - 1;
+    };
+    
+    // 单表条件下推到扫描：能用索引的走索引，其余边读边过滤
+    auto loadInput = [&](int t) {
+        if (loaded[t]) return;
+        loaded[t] = true;
+        std::vector<WhereClause> pushed;
+        for (const auto& jc : joinClauses) {
+            if (jc.local && jc.step == t && !jc.clause->isColumnCompare) {
+                WhereClause clause = *jc.clause;
+                clause.column = Column(metas[t]->columns[colMapping[jc.left].second].name);
+                pushed.push_back(clause);
             }
-            if (leftIdx < 0) {
-                for (size_t i = 0; i < allColNames.size(); i++) {
-                    size_t dotPos = allColNames[i].find('.');
-                    std::string colNameWithoutTable = (dotPos != std::string::npos) ? 
-                                                       allColNames[i].substr(dotPos + 1) : 
-                                                       allColNames[i];
-                    if (colNameWithoutTable == clause.column.columnName) {
-                        leftIdx = i;
-                        break;
-                    }
+        }
+        std::vector<std::pair<int, std::vector<Value>>> rows;
+        if (pushed.empty() || !tryIndexScan(tables[t], pushed, rows)) {
+            rows = scanTable(tables[t]);
+        }
+        for (auto& row : rows) {
+            auto it = rowOf[t].find(row.first);
+            int pos = it != rowOf[t].end() ? it->second : addRow(t, row.first, std::move(row.second));
+            if (pos >= 0) scanRows[t].push_back(pos);
+        }
+    };
+    
+    // 第一张以外的每张表找一个与前面的表做等值比较的条件：本表一侧的列上有完整索引时可以逐个查索引
+    // （索引嵌套循环），两边类型可比时可以做哈希连接；都没有时对本表过滤后的行做嵌套循环
+    std::vector<int> eqInner(tableCount, -1);
+    std::vector<int> eqOuter(tableCount, -1);
+    std::vector<bool> indexed(tableCount, false);
+    for (size_t t = 1; t < tableCount; t++) {
+        for (const JoinClause* jc : stepClauses[t]) {
+            if (jc->clause->op != CompareOp::EQ || !jc->clause->isColumnCompare) continue;
+            int inner = colMapping[jc->left].first == (int)t ? jc->left : jc->right;
+            int outer = inner == jc->left ? jc->right : jc->left;
+            if (!joinTypesHashable(allColTypes[inner], allColTypes[outer])) continue;
+            const std::string& colName = metas[t]->columns[colMapping[inner].second].name;
+            bool usable = allColTypes[inner] == allColTypes[outer] &&
+                          (metas[t]->hasHashIndex(colName) ||
+                           (metas[t]->hasIndex(colName) && indexIsComplete(tables[t], *metas[t], colName)));
+            if (eqInner[t] < 0 || (usable && !indexed[t])) {
+                eqInner[t] = inner;
+                eqOuter[t] = outer;
+                indexed[t] = usable;
+            }
+        }
+    }
+    
+    // 归并时一侧的顺序可以直接沿连接列上的 B+ 树叶子读出（只读键和 recordID，不回表）：
+    // 要求 INT 列上有完整的 B+ 树索引、本表没有单表条件；order 是本表的行号，按键排好
+    auto indexOrder = [&](int t, int col, std::vector<int>& order) {
+        const ColumnDef& colDef = metas[t]->columns[colMapping[col].second];
+        if (colDef.type != DataType::INT || !metas[t]->hasIndex(colDef.name) ||
+            !indexIsComplete(tables[t], *metas[t], colDef.name)) {
+            return false;
+        }
+        for (const auto& jc : joinClauses) {
+            if (jc.local && jc.step == t) return false;
+        }
+        std::vector<BPlusCursor> cursors;
+        if (!openIndexCursors(tables[t], colDef.name, nullptr, false, cursors)) return false;
+        int maxID = 0;
+        for (const auto& row : inputs[t]) maxID = std::max(maxID, row.first);
+        std::vector<int> posOf(maxID + 1, -1);
+        for (int pos : scanRows[t]) posOf[inputs[t][pos].first] = pos;
+        order.clear();
+        for (auto& cursor : cursors) {
+            for (; cursor.valid(); cursor.next()) {
+                int recordID = cursor.rid().slotNum;
+                if (recordID >= 0 && recordID <= maxID && posOf[recordID] >= 0) order.push_back(posOf[recordID]);
+            }
+        }
+        return true;
+    };
+    
+    // 左深流水线：组合扁平存放，每个占 tableCount 个行号，按 FROM 顺序逐表扩展
+    auto valueAt = [&](const int* tuple, int idx) -> const Value& {
+        const auto& m = colMapping[idx];
+        return inputs[m.first][tuple[m.first]].second[m.second];
+    };
+    std::vector<int> tuples;
+    if (!unresolved) {
+        loadInput(0);
+        for (int pos : scanRows[0]) {
+            tuples.push_back(pos);
+            tuples.insert(tuples.end(), tableCount - 1, -1);
+        }
+    }
+    std::vector<char> buffer(8192);
+    std::vector<RID> rids;
+    std::vector<int> matches;
+    for (size_t t = 1; t < tableCount && !tuples.empty(); t++) {
+        RecordManager* rm = systemManager->getRecordManager(tables[t]);
+        std::vector<int> next;
+        size_t outerCount = tuples.size() / tableCount;
+        // 组合 i 配上本表第 pos 行后检查做到这张表时能判定的条件
+        auto matchStep = [&](size_t i, int pos) {
+            tuples[i + t] = pos;
+            for (const JoinClause* jc : stepClauses[t]) {
+                const Value& right = jc->right >= 0 ? valueAt(&tuples[i], jc->right) : jc->clause->value;
+                if (!matchJoinValues(*jc->clause, valueAt(&tuples[i], jc->left), right)) return false;
+            }
+            return true;
+        };
+        auto emit = [&](size_t i) {
+            next.insert(next.end(), tuples.begin() + i, tuples.begin() + i + tableCount);
+        };
+        // (外表组合, 本表行号) 的配对按外表顺序稳定排好后输出，同一组合内保持配对的先后
+        auto emitPairs = [&](const std::vector<std::pair<int, int>>& pairs) {
+            std::vector<int> start(outerCount + 1, 0);
+            for (const auto& p : pairs) start[p.first + 1]++;
+            for (size_t k = 0; k < outerCount; k++) start[k + 1] += start[k];
+            std::vector<int> order(pairs.size());
+            for (const auto& p : pairs) order[start[p.first]++] = p.second;
+            size_t j = 0;
+            for (size_t k = 0; k < outerCount; k++) {
+                for (; j < (size_t)start[k]; j++) {
+                    tuples[k * tableCount + t] = order[j];
+                    emit(k * tableCount);
                 }
             }
+        };
+        
+        // 每查一次索引要回表取一行，外表的组合相对内表行数不多时才逐个查索引
+        bool useIndex = false;
+        if (indexed[t] && rm) {
+            int innerRows, innerPages;
+            rm->getStatistics(innerRows, innerPages);
+            useIndex = outerCount <= (size_t)std::max(JOIN_MAX_PROBES, innerRows / JOIN_PROBE_RATIO);
+        }
+        if (eqInner[t] >= 0 && !useIndex) {
+            loadInput((int)t);
+            const std::vector<int>& rows = scanRows[t];
+            int innerCol = colMapping[eqInner[t]].second;
+            bool asDouble = allColTypes[eqInner[t]] != allColTypes[eqOuter[t]];
             
-            if (leftIdx < 0 || leftIdx >= (int)record.size()) return false;
-            
-            Value leftVal = record[leftIdx];
-            Value rightVal;
-            
-            if (clause.isColumnCompare) {
-                std::string rightColName = clause.rightColumn.tableName.empty() ?
-                                            clause.rightColumn.columnName :
-                                            clause.rightColumn.tableName + "." + clause.rightColumn.columnName;
-                
-                int rightIdx = -1;
-                if (!clause.rightColumn.tableName.empty()) {
-                    for (size_t i = 0; i < allColNames.size(); i++) {
-                        if (allColNames[i] == rightColName) {
-                            rightIdx = i;
-                            break;
+            // 两边的顺序都能从索引得到时用排序归并（索引里没有 NULL，两列都可能为 NULL 时
+            // 会漏掉 NULL 与 NULL 的配对）；建表一侧太大时也用排序归并，只排行号，不占哈希表的内存
+            std::vector<int> outerOrder;
+            std::vector<int> innerOrder;
+            const auto& outerCol = colMapping[eqOuter[t]];
+            bool nullSafe = metas[outerCol.first]->columns[outerCol.second].notNull ||
+                            metas[t]->columns[innerCol].notNull;
+            bool ordered = t == 1 && nullSafe && indexOrder(0, eqOuter[t], outerOrder) &&
+                           indexOrder((int)t, eqInner[t], innerOrder);
+            if (ordered || std::min(rows.size(), outerCount) > joinHashMaxRows) {
+                // 排序归并：两边按连接键排好，一边相等的一段与另一边相等的一段两两配对；
+                // 稳定排序让同键的行保持扫描顺序，配对最后再按外表顺序排回去
+                auto outerKey = [&](int k) -> const Value& { return valueAt(&tuples[(size_t)k * tableCount], eqOuter[t]); };
+                auto innerKey = [&](int pos) -> const Value& { return inputs[t][pos].second[innerCol]; };
+                if (ordered) {
+                    // 第一张表的行号换成组合的下标
+                    std::vector<int> tupleOf(inputs[0].size(), -1);
+                    for (size_t k = 0; k < outerCount; k++) tupleOf[tuples[k * tableCount]] = (int)k;
+                    for (int& k : outerOrder) k = tupleOf[k];
+                } else {
+                    outerOrder.assign(outerCount, 0);
+                    for (size_t k = 0; k < outerCount; k++) outerOrder[k] = (int)k;
+                    innerOrder = rows;
+                    std::stable_sort(outerOrder.begin(), outerOrder.end(),
+                                     [&](int a, int b) { return compareValues(outerKey(a), outerKey(b)) < 0; });
+                    std::stable_sort(innerOrder.begin(), innerOrder.end(),
+                                     [&](int a, int b) { return compareValues(innerKey(a), innerKey(b)) < 0; });
+                }
+                std::vector<std::pair<int, int>> pairs;
+                size_t a = 0, b = 0;
+                while (a < outerOrder.size() && b < innerOrder.size()) {
+                    int c = compareValues(outerKey(outerOrder[a]), innerKey(innerOrder[b]));
+                    if (c != 0) {
+                        if (c < 0) a++; else b++;
+                        continue;
+                    }
+                    size_t aEnd = a + 1;
+                    while (aEnd < outerOrder.size() &&
+                           compareValues(outerKey(outerOrder[aEnd]), innerKey(innerOrder[b])) == 0) aEnd++;
+                    size_t bEnd = b + 1;
+                    while (bEnd < innerOrder.size() &&
+                           compareValues(outerKey(outerOrder[a]), innerKey(innerOrder[bEnd])) == 0) bEnd++;
+                    for (size_t x = a; x < aEnd; x++) {
+                        for (size_t y = b; y < bEnd; y++) {
+                            if (matchStep((size_t)outerOrder[x] * tableCount, innerOrder[y])) {
+                                pairs.push_back({outerOrder[x], innerOrder[y]});
+                            }
                         }
                     }
+                    a = aEnd;
+                    b = bEnd;
                 }
-                if (rightIdx < 0) {
-                    for (size_t i = 0; i < allColNames.size(); i++) {
-                        size_t dotPos = allColNames[i].find('.');
-                        std::string colNameWithoutTable = (dotPos != std::string::npos) ? 
-                                                           allColNames[i].substr(dotPos + 1) : 
-                                                           allColNames[i];
-                        if (colNameWithoutTable == clause.rightColumn.columnName) {
-                            rightIdx = i;
-                            break;
-                        }
+                emitPairs(pairs);
+            } else if (rows.size() <= outerCount) {
+                // 内表小：按内表建表，外表的组合依次探测，桶内按扫描顺序，结果顺序与嵌套循环相同
+                JoinHashTable table;
+                table.build(rows.size(), [&](size_t k) {
+                    return joinHash(inputs[t][rows[k]].second[innerCol], asDouble);
+                });
+                for (size_t i = 0; i < tuples.size(); i += tableCount) {
+                    size_t h = joinHash(valueAt(&tuples[i], eqOuter[t]), asDouble);
+                    for (int k = table.first(h); k >= 0; k = table.nextOf(k, h)) {
+                        if (matchStep(i, rows[k])) emit(i);
                     }
                 }
-                if (rightIdx < 0 || rightIdx >= (int)record.size()) return false;
-                rightVal = record[rightIdx];
             } else {
-                rightVal = clause.value;
-            }
-            
-            if (clause.op == CompareOp::IS_NULL) {
-                if (!leftVal.isNull) return false;
-                continue;
-            }
-            if (clause.op == CompareOp::IS_NOT_NULL) {
-                if (leftVal.isNull) return false;
-                continue;
-            }
-            if (clause.op == CompareOp::LIKE) {
-                if (leftVal.isNull) return false;
-                std::string str = (leftVal.type == Value::Type::STRING) ? leftVal.strVal : 
-                                  ResultSet::valueToString(leftVal);
-                if (!likeMatch(str, clause.value.strVal)) return false;
-                continue;
-            }
-            
-            int cmp = compareValues(leftVal, rightVal);
-            if (!evaluateCompare(clause.op, cmp)) return false;
-        }
-        return true;
-    };
-    
-    // 流式 JOIN：边生成边过滤，避免内存爆炸
-    std::vector<std::vector<Value>> filteredRecords;
-    
-    // 两表 JOIN 的优化路径
-    if (tables.size() == 2) {
-        for (const auto& [rid1, vals1] : allRecords[0]) {
-            for (const auto& [rid2, vals2] : allRecords[1]) {
-                std::vector<Value> combined = vals1;
-                combined.insert(combined.end(), vals2.begin(), vals2.end());
-                
-                // 立即过滤
-                if (matchRecord(combined)) {
-                    filteredRecords.push_back(std::move(combined));
+                // 外表小：按外表的组合建表，内表逐行探测，配对后按外表顺序稳定排好
+                JoinHashTable table;
+                table.build(outerCount, [&](size_t k) {
+                    return joinHash(valueAt(&tuples[k * tableCount], eqOuter[t]), asDouble);
+                });
+                std::vector<std::pair<int, int>> pairs;
+                for (int pos : rows) {
+                    size_t h = joinHash(inputs[t][pos].second[innerCol], asDouble);
+                    for (int k = table.first(h); k >= 0; k = table.nextOf(k, h)) {
+                        if (matchStep((size_t)k * tableCount, pos)) pairs.push_back({k, pos});
+                    }
                 }
+                emitPairs(pairs);
             }
+            tuples.swap(next);
+            continue;
         }
-    } else {
-        // 多表 JOIN（仍然需要笛卡尔积，但边生成边过滤）
-        for (const auto& [rid1, vals1] : allRecords[0]) {
-            std::vector<std::vector<Value>> currentProducts;
-            currentProducts.push_back(vals1);
-            
-            for (size_t t = 1; t < tables.size(); t++) {
-                std::vector<std::vector<Value>> newProducts;
-                for (const auto& product : currentProducts) {
-                    for (const auto& [rid2, vals2] : allRecords[t]) {
-                        std::vector<Value> combined = product;
-                        combined.insert(combined.end(), vals2.begin(), vals2.end());
-                        newProducts.push_back(combined);
+        
+        for (size_t i = 0; i < tuples.size(); i += tableCount) {
+            const std::vector<int>* candidates = nullptr;
+            if (useIndex) {
+                const std::string& colName = metas[t]->columns[colMapping[eqInner[t]].second].name;
+                if (probeJoinIndex(tables[t], colName, valueAt(&tuples[i], eqOuter[t]), rids)) {
+                    matches.clear();
+                    for (const auto& rid : rids) {
+                        auto it = rowOf[t].find(rid.slotNum);
+                        int pos = -1;
+                        if (it != rowOf[t].end()) {
+                            pos = it->second;
+                        } else {
+                            int len = rm->getRecord(rid.slotNum, buffer.data(), (int)buffer.size());
+                            if (len > 0) {
+                                pos = addRow(t, rid.slotNum, deserializeRecord(*metas[t], buffer.data(), len));
+                            }
+                            rowOf[t][rid.slotNum] = pos;
+                        }
+                        if (pos >= 0) matches.push_back(pos);
                     }
+                    candidates = &matches;
                 }
-                currentProducts = std::move(newProducts);
             }
-            
-            // 过滤完整的组合
-            for (auto& record : currentProducts) {
-                if (matchRecord(record)) {
-                    filteredRecords.push_back(std::move(record));
-                }
+            // 外表的值为 NULL 等查不了索引的情况也退回扫描，比较语义与原来一致
+            if (!candidates) {
+                loadInput((int)t);
+                candidates = &scanRows[t];
+            }
+            for (int pos : *candidates) {
+                if (matchStep(i, pos)) emit(i);
             }
         }
+        tuples.swap(next);
     }
     
     bool selectAll = false;
@@ -1584,18 +2424,13 @@ ResultSet QueryExecutor::executeJoin(const std::vector<std::string>& tables,
         }
     }
     
+    std::vector<int> selectIndices;
     if (selectAll) {
         for (size_t i = 0; i < allColNames.size(); i++) {
+            selectIndices.push_back(i);
             result.addColumn(allColNames[i], allColTypes[i]);
         }
-        
-        for (const auto& record : filteredRecords) {
-            ResultRow row;
-            row.values = record;
-            result.addRow(row);
-        }
     } else {
-        std::vector<int> selectIndices;
         for (const auto& sel : selectors) {
             int foundIdx = -1;
             
@@ -1628,21 +2463,60 @@ ResultSet QueryExecutor::executeJoin(const std::vector<std::string>& tables,
                 result.addColumn(allColNames[foundIdx], allColTypes[foundIdx]);
             }
         }
-        
-        for (const auto& record : filteredRecords) {
-            ResultRow row;
-            for (int idx : selectIndices) {
-                if (idx >= 0 && idx < (int)record.size()) {
-                    row.values.push_back(record[idx]);
-                }
-            }
-            result.addRow(row);
+    }
+    
+    // 结果行直接在 rows 里构造，不再整行复制一次
+    result.rows.resize(tuples.size() / tableCount);
+    for (size_t i = 0; i < tuples.size(); i += tableCount) {
+        std::vector<Value>& values = result.rows[i / tableCount].values;
+        values.reserve(selectIndices.size());
+        for (int idx : selectIndices) {
+            values.push_back(valueAt(&tuples[i], idx));
         }
     }
     
     return result;
 }
 
+bool QueryExecutor::matchJoinValues(const WhereClause& clause, const Value& left, const Value& right) {
+    if (clause.op == CompareOp::IS_NULL) return left.isNull;
+    if (clause.op == CompareOp::IS_NOT_NULL) return !left.isNull;
+    if (clause.op == CompareOp::LIKE) {
+        if (left.isNull) return false;
+        std::string str = (left.type == Value::Type::STRING) ? left.strVal : ResultSet::valueToString(left);
+        return likeMatch(str, clause.value.strVal);
+    }
+    return evaluateCompare(clause.op, compareValues(left, right));
+}
+
+// 调用方保证列上的 B+ 树索引是完整的
+bool QueryExecutor::probeJoinIndex(const std::string& tableName, const std::string& colName,
+                                   const Value& value, std::vector<RID>& rids) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    const ColumnDef* col = meta ? meta->getColumn(colName) : nullptr;
+    if (!col || !valueMatchesColumn(*col, value)) return false;
+    if (hashLookup(tableName, colName, value, rids)) return true;
+    rids.clear();
+    // 外键悬空或内表很稀疏时，布隆过滤器挡掉的键不用下降
+    if ((col->type != DataType::FLOAT || value.type == Value::Type::FLOAT) &&
+        !keyMayExist(tableName, colName, value)) {
+        return true;
+    }
+    WhereClause eq;
+    eq.column = Column(colName);
+    eq.op = CompareOp::EQ;
+    eq.value = value;
+    std::vector<BPlusCursor> cursors;
+    if (!openIndexCursors(tableName, colName, &eq, false, cursors)) return false;
+    for (auto& cursor : cursors) {
+        for (; cursor.valid(); cursor.next()) {
+            rids.push_back(cursor.rid());
+        }
+    }
+    std::sort(rids.begin(), rids.end(), [](const RID& a, const RID& b) { return a.slotNum < b.slotNum; });
+    return true;
+}
+
 Value QueryExecutor::calculateAggregate(AggregateType aggType, const std::vector<Value>& values) {
     if (values.empty()) {
         return Value::makeNull();
@@ -1764,15 +2638,6 @@ ResultSet QueryExecutor::executeLoadData(const std::string& fileName,
     int loadedCount = 0;
     std::string line;
 
-    // 预先确定哪些列建了索引，导入时直接写入索引，避免导入完再全表扫描。
-    IndexManager* indexMgr = systemManager->getIndexManager();
-    std::vector<bool> colHasIndex(meta->columns.size(), false);
-    if (indexMgr) {
-        for (size_t i = 0; i < meta->columns.size(); i++) {
-            colHasIndex[i] = meta->hasIndex(meta->columns[i].name);
-        }
-    }
-    
     while (std::getline(file, line)) {
         if (line.empty()) continue;
         std::vector<Value> values;
@@ -1824,20 +2689,7 @@ ResultSet QueryExecutor::executeLoadData(const std::string& fileName,
             loadedCount++;
 
             // 直接更新索引：避免导入完后 scanTable(tableName) 再建索引造成的二次全表扫描。
-            if (indexMgr) {
-                RID rid(0, recordID);
-                for (size_t i = 0; i < values.size(); i++) {
-                    if (!colHasIndex[i]) continue;
-                    if (values[i].isNull) continue;
-                    if (meta->columns[i].type == DataType::INT) {
-                        indexMgr->insertEntry(tableName, meta->columns[i].name, values[i].intVal, rid);
-                    } else if (meta->columns[i].type == DataType::FLOAT) {
-                        indexMgr->insertEntry(tableName, meta->columns[i].name, values[i].floatVal, rid);
-                    } else {
-                        indexMgr->insertEntry(tableName, meta->columns[i].name, values[i].strVal, rid);
-                    }
-                }
-            }
+            insertIndexEntries(tableName, *meta, recordID, values);
         }
     }
     
@@ -1890,6 +2742,15 @@ bool QueryExecutor::checkPrimaryKey(const std::string& tableName, const std::vec
     IndexManager* indexMgr = systemManager->getIndexManager();
     if (indexMgr && meta->primaryKey.size() == 1) {
         const std::string& pkCol = meta->primaryKey[0];
+        // 布隆过滤器先排除肯定不存在的键；有哈希索引时一次探测即可
+        int pkIdx = meta->getColumnIndex(pkCol);
+        if (pkIdx >= 0 && pkIdx < (int)values.size() && !keyMayExist(tableName, pkCol, values[pkIdx])) {
+            return true;
+        }
+        std::vector<RID> rids;
+        if (pkIdx >= 0 && pkIdx < (int)values.size() && hashLookup(tableName, pkCol, values[pkIdx], rids)) {
+            return rids.empty();
+        }
         if (meta->hasIndex(pkCol)) {
             int colIdx = meta->getColumnIndex(pkCol);
             if (colIdx >= 0 && colIdx < (int)values.size() && !values[colIdx].isNull) {
@@ -1908,7 +2769,17 @@ bool QueryExecutor::checkPrimaryKey(const std::string& tableName, const std::vec
         }
     }
     
-    // 回退到全表扫描（仅用于复合主键或无索引的情况）
+    // 复合主键查组合索引（旧版本建的表没有组合索引，仍走扫描）
+    if (indexMgr && meta->primaryKey.size() > 1) {
+        std::string idxName = IndexManager::compositeName(meta->primaryKey);
+        CompositeKey key;
+        if (meta->hasIndex(idxName) && makeCompositeKey(*meta, meta->primaryKey, values, key)) {
+            RID rid;
+            return !indexMgr->searchEntry(tableName, idxName, key, rid);
+        }
+    }
+    
+    // 回退到全表扫描（仅用于无索引的情况）
     auto records = scanTable(tableName);
     for (const auto& [recordID, record] : records) {
         bool allMatch = true;
@@ -1929,6 +2800,43 @@ bool QueryExecutor::checkPrimaryKey(const std::string& tableName, const std::vec
     return true;
 }
 
+bool QueryExecutor::checkUniqueIndexes(const std::string& tableName, const std::vector<Value>& values) {
+    TableMeta* meta = systemManager->getTableMeta(tableName);
+    IndexManager* indexMgr = systemManager->getIndexManager();
+    if (!meta || !indexMgr) return true;
+    
+    for (const auto& idx : meta->explicitIndexes) {
+        if (!idx.isUnique || idx.columns.empty()) continue;
+        RID rid;
+        bool found = false;
+        if (idx.columns.size() > 1) {
+            CompositeKey key;
+            if (makeCompositeKey(*meta, idx.columns, values, key)) {
+                found = indexMgr->searchEntry(tableName, IndexManager::compositeName(idx.columns), key, rid);
+            }
+        } else {
+            int colIdx = meta->getColumnIndex(idx.columns[0]);
+            if (colIdx < 0 || colIdx >= (int)values.size() || values[colIdx].isNull) continue;
+            const ColumnDef& col = meta->columns[colIdx];
+            if (!keyMayExist(tableName, idx.columns[0], values[colIdx])) continue;
+            std::vector<RID> rids;
+            if (hashLookup(tableName, idx.columns[0], values[colIdx], rids)) {
+                found = !rids.empty();
+            } else if (col.type == DataType::INT) {
+                found = indexMgr->searchEntry(tableName, idx.columns[0], values[colIdx].intVal, rid);
+            } else if (col.type == DataType::FLOAT) {
+                found = indexMgr->searchEntry(tableName, idx.columns[0], values[colIdx].floatVal, rid);
+            } else {
+                found = indexMgr->searchEntry(tableName, idx.columns[0], values[colIdx].strVal, rid);
+            }
+        }
+        if (found) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool QueryExecutor::checkForeignKey(const std::string& tableName, const std::vector<Value>& values) {
     TableMeta* meta = systemManager->getTableMeta(tableName);
     if (!meta || meta->foreignKeys.empty()) return true;
@@ -1964,6 +2872,12 @@ bool QueryExecutor::checkForeignKey(const std::string& tableName, const std::vec
         bool useIndex = false;
         if (indexMgr && fk.columns.size() == 1 && fk.refColumns.size() == 1) {
             const std::string& refCol = fk.refColumns[0];
+            if (!keyMayExist(fk.refTable, refCol, fkValues[0])) return false;
+            std::vector<RID> rids;
+            if (hashLookup(fk.refTable, refCol, fkValues[0], rids)) {
+                if (rids.empty()) return false;
+                continue;
+            }
             if (refMeta->hasIndex(refCol)) {
                 int refColIdx = refMeta->getColumnIndex(refCol);
                 if (refColIdx >= 0 && !fkValues[0].isNull) {
@@ -128,6 +128,7 @@ struct ResultSet {
 class QueryExecutor {
 private:
     SystemManager* systemManager;
+    size_t joinHashMaxRows;     // 哈希连接建表一侧的行数上限，超过时改用排序归并
 
     std::vector<char> serializeRecord(const TableMeta& meta, const std::vector<Value>& values);
     std::vector<Value> deserializeRecord(const TableMeta& meta, const char* data, int dataLen);
@@ -147,6 +148,21 @@ private:
                           const std::vector<WhereClause>& whereClauses,
                           const std::vector<Selector>& selectors);
 
+    // JOIN 中的一个 WHERE 条件：列解析成拼接行里的下标，right 为 -1 表示与常量比较；
+    // step 是条件用到的最后一张表，左深连接做到这张表时判定，local 表示只用到这一张表
+    struct JoinClause {
+        const WhereClause* clause;
+        int left;
+        int right;
+        int step;
+        bool local;
+    };
+    bool matchJoinValues(const WhereClause& clause, const Value& left, const Value& right);
+    // 按内表连接列上的索引（B+ 树或哈希）找等于 value 的记录，RID 按 recordID 排好；
+    // 值为 NULL、类型与列不一致或列上没有可用的索引时返回 false
+    bool probeJoinIndex(const std::string& tableName, const std::string& colName, const Value& value,
+                        std::vector<RID>& rids);
+
     std::vector<std::pair<int, std::vector<Value>>> scanTable(const std::string& tableName);
 
     std::vector<std::pair<int, std::vector<Value>>> scanTableFiltered(
@@ -157,10 +173,67 @@ private:
                                                                const WhereClause& clause);
 
     bool shouldUseIndex(const std::string& tableName, const WhereClause& clause);
+    // 列上有哈希索引时做一次等值查找，RID 按 recordID 排好；没有哈希索引或值为 NULL 时返回 false
+    bool hashLookup(const std::string& tableName, const std::string& columnName, const Value& value,
+                    std::vector<RID>& rids);
+    // 列上唯一索引的布隆过滤器判定值一定不存在时返回 false，不读索引页；其余情况返回 true
+    bool keyMayExist(const std::string& tableName, const std::string& columnName, const Value& value);
+    // 按单列索引上的条件打开游标，LIKE 前缀可能对应几个区间（clause 为空时遍历整个索引）
+    bool openIndexCursors(const std::string& tableName, const std::string& columnName,
+                          const WhereClause* clause, bool backward, std::vector<BPlusCursor>& cursors);
+    // 按索引顺序逐条读记录，visit 返回 false 时提前结束
+    bool streamIndexScan(const std::string& tableName, const std::string& columnName,
+                         const WhereClause* clause, bool backward,
+                         const std::function<bool(int, const std::vector<Value>&)>& visit);
+
+    // 多个条件时挑一个索引扫描：组合索引的等值前缀优先，其次单列索引；不能用索引时返回 false
+    bool tryIndexScan(const std::string& tableName, const std::vector<WhereClause>& whereClauses,
+                      std::vector<std::pair<int, std::vector<Value>>>& records);
+    std::vector<std::pair<int, std::vector<Value>>> fetchRecords(const std::string& tableName,
+                                                                  const std::vector<RID>& rids);
+    // 组合索引从第一列起连续有等值条件的列拼成查找前缀，返回用上的列数
+    int compositeEqPrefix(const TableMeta& meta, const std::string& indexName,
+                          const std::vector<WhereClause>& whereClauses, CompositeKey& key);
+    // 单列索引是否包含每一条该列非 NULL 的记录
+    bool indexIsComplete(const std::string& tableName, const TableMeta& meta, const std::string& colName);
+
+    // 覆盖索引：usedCols 和 WHERE 里的列都能从键里原样解出，并且不在索引里的行（键列为 NULL）不影响结果；
+    // nullsIgnored 表示调用方本来就跳过该列为 NULL 的行（COUNT(*) 以外的聚合）
+    bool coversQuery(const std::string& tableName, const std::string& indexName,
+                     const std::vector<int>& usedCols, const std::vector<WhereClause>& whereClauses,
+                     bool nullsIgnored);
+    std::string findCoveringIndex(const std::string& tableName, const std::vector<int>& usedCols,
+                                  const std::vector<WhereClause>& whereClauses, bool nullsIgnored);
+    // 沿覆盖索引的叶子逐条解出行（键以外的列为 NULL），不回表；visit 返回 false 时提前结束
+    bool streamCoveringScan(const std::string& tableName, const std::string& indexName,
+                            const std::vector<WhereClause>& whereClauses, bool backward,
+                            const std::function<bool(int, const std::vector<Value>&)>& visit);
+    // 聚合只有 COUNT / MIN / MAX，且都落在同一个单列索引上、WHERE 只是该列上的区间时，
+    // COUNT 用子树计数沿区间两端各下降一次，MIN / MAX 取区间两端的条目；counts / bests 与聚合一一对应
+    bool tryIndexAggregate(const std::string& tableName, const std::vector<AggregateType>& aggTypes,
+                           const std::vector<int>& aggCols, const std::vector<WhereClause>& whereClauses,
+                           std::vector<long long>& counts, std::vector<Value>& bests);
+
+    // 按列顺序拼组合索引的键，有列为 NULL 时返回 false
+    bool makeCompositeKey(const TableMeta& meta, const std::vector<std::string>& columns,
+                          const std::vector<Value>& values, CompositeKey& key);
+    // 维护一行在本表所有索引（单列和组合）中的条目
+    void insertIndexEntries(const std::string& tableName, const TableMeta& meta,
+                            int recordID, const std::vector<Value>& values);
+    void deleteIndexEntries(const std::string& tableName, const TableMeta& meta,
+                            int recordID, const std::vector<Value>& values);
+    void updateCompositeIndexEntries(const std::string& tableName, const TableMeta& meta, int recordID,
+                                     const std::vector<Value>& oldValues,
+                                     const std::vector<Value>& newValues);
+    void updateHashIndexEntries(const std::string& tableName, const TableMeta& meta, int recordID,
+                                const std::vector<Value>& oldValues, const std::vector<Value>& newValues);
 
 public:
     QueryExecutor(SystemManager* sm);
 
+    void setJoinHashMaxRows(size_t rows) { joinHashMaxRows = rows; }
+    size_t getJoinHashMaxRows() const { return joinHashMaxRows; }
+
     ResultSet executeInsert(const std::string& tableName,const std::vector<std::vector<Value>>& valueLists);
 
 
@@ -189,6 +262,10 @@ public:
     bool checkPrimaryKey(const std::string& tableName,
                          const std::vector<Value>& values);
 
+    // 显式 UNIQUE 索引（单列或组合）上已有相同键时返回 false
+    bool checkUniqueIndexes(const std::string& tableName,
+                            const std::vector<Value>& values);
+
     bool checkForeignKey(const std::string& tableName,
                          const std::vector<Value>& values);
 
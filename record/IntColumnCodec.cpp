@@ -0,0 +1,169 @@
+#include "IntColumnCodec.h"
+#include <cstring>
+
+static int forPayloadSize(int count, int width) {
+    if (width == 0) return 0;
+    // 末尾多留两个 int，解码时可以无条件读取 8 字节
+    return (int)(((long long)count * width + 31) / 32) + 2;
+}
+
+void IntColumnSizer::add(int v) {
+    if (count == 0) {
+        minVal = maxVal = v;
+        runs = 1;
+    } else {
+        if (v < minVal) minVal = v;
+        if (v > maxVal) maxVal = v;
+        if (v != lastVal) runs++;
+    }
+    lastVal = v;
+    count++;
+}
+
+int IntColumnSizer::encodedSize(int& codec) const {
+    unsigned int range = (unsigned int)maxVal - (unsigned int)minVal;
+    int forSize = forPayloadSize(count, IntColumnCodec::bitWidth(range));
+    int rleSize = runs * 2;
+    int rawSize = count;
+    codec = CODEC_FOR;
+    int best = forSize;
+    if (rleSize < best) {
+        codec = CODEC_RLE;
+        best = rleSize;
+    }
+    if (rawSize < best) {
+        codec = CODEC_RAW;
+        best = rawSize;
+    }
+    return BLOCK_HEADER_SIZE + best;
+}
+
+int IntColumnCodec::bitWidth(unsigned int range) {
+    int width = 0;
+    while (width < 32 && (range >> width) != 0) width++;
+    return width;
+}
+
+void IntColumnCodec::packBits(const unsigned int* values, int count, int width, int base,
+                              unsigned char* out) {
+    if (width == 0) return;
+    memset(out, 0, forPayloadSize(count, width) * 4);
+    for (int i = 0; i < count; i++) {
+        unsigned long long bit = (unsigned long long)i * width;
+        unsigned long long delta = values[i] - (unsigned int)base;
+        unsigned long long word;
+        memcpy(&word, out + (bit >> 3), 8);
+        word |= delta << (bit & 7);
+        memcpy(out + (bit >> 3), &word, 8);
+    }
+}
+
+void IntColumnCodec::unpackBits(const unsigned char* in, int count, int width, int base,
+                                unsigned int* out) {
+    if (width == 0) {
+        for (int i = 0; i < count; i++) out[i] = (unsigned int)base;
+        return;
+    }
+    const unsigned long long mask = (width == 32) ? 0xffffffffULL : ((1ULL << width) - 1);
+    for (int i = 0; i < count; i++) {
+        unsigned long long bit = (unsigned long long)i * width;
+        unsigned long long word;
+        memcpy(&word, in + (bit >> 3), 8);
+        out[i] = (unsigned int)base + (unsigned int)((word >> (bit & 7)) & mask);
+    }
+}
+
+int IntColumnCodec::encode(const unsigned int* values, int count, unsigned int* out) {
+    IntColumnSizer sizer;
+    long long total = 0;
+    for (int i = 0; i < count; i++) {
+        sizer.add((int)values[i]);
+        total += (int)values[i];
+    }
+    int codec;
+    int size = sizer.encodedSize(codec);
+    out[BLOCK_CODEC_OFFSET] = codec;
+    out[BLOCK_COUNT_OFFSET] = count;
+    out[BLOCK_MIN_OFFSET] = (unsigned int)sizer.minVal;
+    out[BLOCK_MAX_OFFSET] = (unsigned int)sizer.maxVal;
+    out[BLOCK_SUM_LO_OFFSET] = (unsigned int)((unsigned long long)total & 0xffffffffULL);
+    out[BLOCK_SUM_HI_OFFSET] = (unsigned int)((unsigned long long)total >> 32);
+    out[BLOCK_PAYLOAD_OFFSET] = size - BLOCK_HEADER_SIZE;
+    unsigned int* payload = out + BLOCK_HEADER_SIZE;
+    if (codec == CODEC_FOR) {
+        int width = bitWidth((unsigned int)sizer.maxVal - (unsigned int)sizer.minVal);
+        out[BLOCK_WIDTH_OFFSET] = width;
+        packBits(values, count, width, sizer.minVal, (unsigned char*)payload);
+    } else if (codec == CODEC_RLE) {
+        out[BLOCK_WIDTH_OFFSET] = sizer.runs;
+        int r = -1;
+        for (int i = 0; i < count; i++) {
+            if (r < 0 || payload[r * 2] != values[i]) {
+                r++;
+                payload[r * 2] = values[i];
+                payload[r * 2 + 1] = 0;
+            }
+            payload[r * 2 + 1]++;
+        }
+    } else {
+        out[BLOCK_WIDTH_OFFSET] = 32;
+        memcpy(payload, values, count * 4);
+    }
+    return size;
+}
+
+void IntColumnCodec::decode(const unsigned int* block, unsigned int* out) {
+    int codec = block[BLOCK_CODEC_OFFSET];
+    int n = block[BLOCK_COUNT_OFFSET];
+    const unsigned int* payload = block + BLOCK_HEADER_SIZE;
+    if (codec == CODEC_FOR) {
+        unpackBits((const unsigned char*)payload, n, block[BLOCK_WIDTH_OFFSET],
+                   (int)block[BLOCK_MIN_OFFSET], out);
+    } else if (codec == CODEC_RLE) {
+        int runs = block[BLOCK_WIDTH_OFFSET];
+        int pos = 0;
+        for (int r = 0; r < runs; r++) {
+            unsigned int v = payload[r * 2];
+            int len = payload[r * 2 + 1];
+            for (int j = 0; j < len; j++) out[pos + j] = v;
+            pos += len;
+        }
+    } else {
+        memcpy(out, payload, n * 4);
+    }
+}
+
+unsigned int IntColumnCodec::valueAt(const unsigned int* block, int i) {
+    int codec = block[BLOCK_CODEC_OFFSET];
+    const unsigned int* payload = block + BLOCK_HEADER_SIZE;
+    if (codec == CODEC_FOR) {
+        int width = block[BLOCK_WIDTH_OFFSET];
+        unsigned int base = block[BLOCK_MIN_OFFSET];
+        if (width == 0) return base;
+        const unsigned long long mask = (width == 32) ? 0xffffffffULL : ((1ULL << width) - 1);
+        unsigned long long bit = (unsigned long long)i * width;
+        unsigned long long word;
+        memcpy(&word, (const unsigned char*)payload + (bit >> 3), 8);
+        return base + (unsigned int)((word >> (bit & 7)) & mask);
+    }
+    if (codec == CODEC_RLE) {
+        int runs = block[BLOCK_WIDTH_OFFSET];
+        for (int r = 0; r < runs; r++) {
+            int len = payload[r * 2 + 1];
+            if (i < len) return payload[r * 2];
+            i -= len;
+        }
+        return 0;
+    }
+    return payload[i];
+}
+
+int IntColumnCodec::blockSize(const unsigned int* block) {
+    return BLOCK_HEADER_SIZE + (int)block[BLOCK_PAYLOAD_OFFSET];
+}
+
+long long IntColumnCodec::sum(const unsigned int* block) {
+    unsigned long long v = ((unsigned long long)block[BLOCK_SUM_HI_OFFSET] << 32) |
+                           block[BLOCK_SUM_LO_OFFSET];
+    return (long long)v;
+}
@@ -0,0 +1,55 @@
+#ifndef INT_COLUMN_CODEC_H
+#define INT_COLUMN_CODEC_H
+
+// 整数列块的轻量压缩：frame-of-reference + bit-packing / 游程编码 / 原样存储
+// 块格式（以 int 为单位）：[块头 BLOCK_HEADER_SIZE][payload]
+#define CODEC_RAW 0
+#define CODEC_RLE 1
+#define CODEC_FOR 2
+
+#define BLOCK_CODEC_OFFSET 0
+#define BLOCK_COUNT_OFFSET 1
+#define BLOCK_WIDTH_OFFSET 2     // FOR: 位宽；RLE: 游程个数
+#define BLOCK_MIN_OFFSET 3
+#define BLOCK_MAX_OFFSET 4
+#define BLOCK_SUM_LO_OFFSET 5
+#define BLOCK_SUM_HI_OFFSET 6
+#define BLOCK_PAYLOAD_OFFSET 7   // payload 长度
+#define BLOCK_HEADER_SIZE 8
+
+// 增量估算一列值编码后的大小，用于决定一页能装下多少行
+struct IntColumnSizer {
+    int count;
+    int minVal;
+    int maxVal;
+    int runs;
+    int lastVal;
+    IntColumnSizer() : count(0), minVal(0), maxVal(0), runs(0), lastVal(0) {}
+    void add(int v);
+    // 返回编码后的总长度（含块头），codec 为选中的编码方式
+    int encodedSize(int& codec) const;
+};
+
+class IntColumnCodec {
+public:
+    // 编码 count 个值到 out，返回写入的 int 数
+    static int encode(const unsigned int* values, int count, unsigned int* out);
+    // 整块解码到 out（至少 count 个元素）
+    static void decode(const unsigned int* block, unsigned int* out);
+    // 随机访问第 i 个值
+    static unsigned int valueAt(const unsigned int* block, int i);
+    static int blockSize(const unsigned int* block);
+    static int count(const unsigned int* block) { return (int)block[BLOCK_COUNT_OFFSET]; }
+    static int minValue(const unsigned int* block) { return (int)block[BLOCK_MIN_OFFSET]; }
+    static int maxValue(const unsigned int* block) { return (int)block[BLOCK_MAX_OFFSET]; }
+    static long long sum(const unsigned int* block);
+
+    // bit-packing 核心：循环体无依赖，便于编译器向量化
+    static void packBits(const unsigned int* values, int count, int width, int base,
+                         unsigned char* out);
+    static void unpackBits(const unsigned char* in, int count, int width, int base,
+                           unsigned int* out);
+    static int bitWidth(unsigned int range);
+};
+
+#endif
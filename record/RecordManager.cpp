@@ -8,6 +8,7 @@
 
 
 #include <unordered_map>
+#include <algorithm>
 
 RecordManager::RecordManager(FileManager* fm, BufPageManager* bpm, int fid, bool fixed, int rSize, bool forceInit) {
     fileManager = fm;
@@ -16,6 +17,10 @@ RecordManager::RecordManager(FileManager* fm, BufPageManager* bpm, int fid, bool
     fixedSize = fixed;
     recordSize = rSize;
     tailPageID = 0;
+    nextNewPageID = 1;
+    deadSinceVacuum = 0;
+    chainLength = 1;
+    dirLoaded = false;
 
     int index;
     BufType patchouli = bufPageManager->getPage(fileID, 0, index);
@@ -29,23 +34,52 @@ RecordManager::RecordManager(FileManager* fm, BufPageManager* bpm, int fid, bool
                      (nextPage != (int)-1 && (nextPage < 0 || nextPage > 1000000)));
     }
     if (needInit) {
-        patchouli[PAGE_TYPE_OFFSET] = 0;
+        memset(patchouli, 0, PAGE_SIZE);
+        patchouli[PAGE_TYPE_OFFSET] = PAGE_TYPE_DATA;
         patchouli[PAGE_RECORD_COUNT_OFFSET] = 0;
         patchouli[PAGE_FREE_START_OFFSET] = PAGE_DATA_START;
         patchouli[PAGE_NEXT_PAGE_OFFSET] = (unsigned int)-1;
+        patchouli[PAGE_DIR_MAGIC_OFFSET] = PAGE_DIR_MAGIC;
         bufPageManager->markDirty(index);
-        tailPageID = 0;
+        dirLoaded = true;
+        setDirEntry(0, describePage(patchouli, 0));
+        saveFileHeader();
+    } else if (patchouli[PAGE_DIR_MAGIC_OFFSET] == PAGE_DIR_MAGIC ||
+               patchouli[PAGE_DIR_MAGIC_OFFSET] == PAGE_DIR_MAGIC_V1) {
+        // 文件头记录了尾页和页数，打开时只需读页 0
+        tailPageID = patchouli[PAGE_TAIL_OFFSET];
+        chainLength = patchouli[PAGE_CHAIN_LENGTH_OFFSET];
+        nextNewPageID = patchouli[PAGE_FILE_PAGES_OFFSET];
+        if (patchouli[PAGE_DIR_MAGIC_OFFSET] == PAGE_DIR_MAGIC_V1) {
+            // 目录项变长了，沿链表重写一遍（原有的目录页接着用）
+            rebuildDirectory();
+        }
     } else {
-
+        // 旧格式文件：沿链表走一遍，建立页目录
+        int freePageID = patchouli[PAGE_FREE_LIST_OFFSET];
         int recordCount, freeStart, nextPage;
         getPageHeader(patchouli, recordCount, freeStart, nextPage);
         while (nextPage != -1 && nextPage < 1000000) {
             tailPageID = nextPage;
+            nextNewPageID = std::max(nextNewPageID, tailPageID + 1);
             patchouli = bufPageManager->getPage(fileID, tailPageID, index);
             getPageHeader(patchouli, recordCount, freeStart, nextPage);
         }
+        // 空闲页不在数据链表中，也要计入文件长度
+        while (freePageID > 0 && freePageID < 1000000) {
+            nextNewPageID = std::max(nextNewPageID, freePageID + 1);
+            BufType page = bufPageManager->getPage(fileID, freePageID, index);
+            freePageID = page[PAGE_NEXT_PAGE_OFFSET];
+        }
+        patchouli = bufPageManager->getPage(fileID, 0, index);
+        for (int i = PAGE_FILE_HEADER_START; i < PAGE_FREE_LIST_OFFSET; i++) {
+            patchouli[i] = 0;
+        }
+        patchouli[PAGE_DIR_MAGIC_OFFSET] = PAGE_DIR_MAGIC;
+        bufPageManager->markDirty(index);
+        dirLoaded = true;
+        rebuildDirectory();
     }
-    bufPageManager->access(index);
 }
 void RecordManager::getPageHeader(BufType patchouli, int& recordCount, int& freeStart, int& nextPage) {
     recordCount = patchouli[PAGE_RECORD_COUNT_OFFSET];
@@ -58,6 +92,9 @@ void RecordManager::setPageHeader(BufType patchouli, int recordCount, int freeSt
     patchouli[PAGE_NEXT_PAGE_OFFSET] = nextPage;
 }
 int RecordManager::findRecordInPage(BufType patchouli, int recordID, int& offset) {
+    if (isFrozenPage(patchouli)) {
+        return -1;
+    }
     int recordCount, freeStart, nextPage;
     getPageHeader(patchouli, recordCount, freeStart, nextPage);
     int pos = PAGE_DATA_START;
@@ -82,6 +119,9 @@ int RecordManager::findFreeSpace(BufType patchouli, int requiredSize) {
     return freeStart;
 }
 bool RecordManager::insertRecordInPage(BufType patchouli, int recordID, BufType alice, int dataLen, int pageIndex) {
+    if (isFrozenPage(patchouli)) {
+        return false;
+    }
     int offset;
     if (findRecordInPage(patchouli, recordID, offset) > 0) {
         return false;
@@ -104,6 +144,18 @@ bool RecordManager::insertRecordInPage(BufType patchouli, int recordID, BufType
     return true;
 }
 bool RecordManager::deleteRecordInPage(BufType patchouli, int recordID, int pageIndex) {
+    if (isFrozenPage(patchouli)) {
+        int row = findRowInFrozenPage(patchouli, recordID);
+        if (row < 0) {
+            return false;
+        }
+        BufType bitmap = patchouli + patchouli[FROZEN_BITMAP_OFFSET];
+        bitmap[row >> 5] |= (1u << (row & 31));
+        patchouli[PAGE_RECORD_COUNT_OFFSET]--;
+        bufPageManager->markDirty(pageIndex);
+        deadSinceVacuum++;
+        return true;
+    }
     int offset;
     int recordLen = findRecordInPage(patchouli, recordID, offset);
     if (recordLen <= 0) {
@@ -115,34 +167,9 @@ bool RecordManager::deleteRecordInPage(BufType patchouli, int recordID, int page
     patchouli[offset + 1] = 0;
     setPageHeader(patchouli, recordCount - 1, freeStart, nextPage);
     bufPageManager->markDirty(pageIndex);
+    deadSinceVacuum++;
     return true;
 }
-int RecordManager::getNewPage() {
-    int pageID = 0;
-    int index;
-    BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
-    int recordCount, freeStart, nextPage;
-    getPageHeader(patchouli, recordCount, freeStart, nextPage);
-    while (nextPage != -1) {
-        pageID = nextPage;
-        patchouli = bufPageManager->getPage(fileID, pageID, index);
-        getPageHeader(patchouli, recordCount, freeStart, nextPage);
-    }
-    if (findFreeSpace(patchouli, RECORD_HEADER_SIZE + 10) != -1) {
-        return pageID;
-    }
-    int newPageID = pageID + 1;
-    int newIndex;
-    BufType newPage = bufPageManager->allocPage(fileID, newPageID, newIndex, false);
-    newPage[PAGE_TYPE_OFFSET] = 0;
-    newPage[PAGE_RECORD_COUNT_OFFSET] = 0;
-    newPage[PAGE_FREE_START_OFFSET] = PAGE_DATA_START;
-    newPage[PAGE_NEXT_PAGE_OFFSET] = -1;
-    setPageHeader(patchouli, recordCount, freeStart, newPageID);
-    bufPageManager->markDirty(index);
-    bufPageManager->markDirty(newIndex);
-    return newPageID;
-}
 bool RecordManager::insertRecord(int recordID, BufType alice, int dataLen) {
 
     int index;
@@ -150,28 +177,27 @@ bool RecordManager::insertRecord(int recordID, BufType alice, int dataLen) {
 
 
     if (insertRecordInPage(patchouli, recordID, alice, dataLen, index)) {
+        updateDirEntry(chainLength - 1, patchouli, recordID);
         return true;
     }
 
 
-    int recordCount, freeStart, nextPage;
-    getPageHeader(patchouli, recordCount, freeStart, nextPage);
-    int newPageID = tailPageID + 1;
-    int newIndex;
-    BufType newPage = bufPageManager->allocPage(fileID, newPageID, newIndex, false);
-    newPage[PAGE_TYPE_OFFSET] = 0;
-    newPage[PAGE_RECORD_COUNT_OFFSET] = 0;
-    newPage[PAGE_FREE_START_OFFSET] = PAGE_DATA_START;
-    newPage[PAGE_NEXT_PAGE_OFFSET] = -1;
-    setPageHeader(patchouli, recordCount, freeStart, newPageID);
+    int newPageID = allocDataPage();
+    patchouli = bufPageManager->getPage(fileID, tailPageID, index);
+    patchouli[PAGE_NEXT_PAGE_OFFSET] = newPageID;
     bufPageManager->markDirty(index);
-    bufPageManager->markDirty(newIndex);
+    int newIndex;
+    BufType newPage = bufPageManager->getPage(fileID, newPageID, newIndex);
 
 
     tailPageID = newPageID;
+    chainLength++;
 
 
-    return insertRecordInPage(newPage, recordID, alice, dataLen, newIndex);
+    bool youmu = insertRecordInPage(newPage, recordID, alice, dataLen, newIndex);
+    setDirEntry(chainLength - 1, describePage(newPage, newPageID));
+    saveFileHeader();
+    return youmu;
 }
 bool RecordManager::insertRecord(int recordID, const char* alice, int dataLen) {
     int intLen = (dataLen + 3) / 4;
@@ -183,19 +209,14 @@ bool RecordManager::insertRecord(int recordID, const char* alice, int dataLen) {
     return youmu;
 }
 bool RecordManager::deleteRecord(int recordID) {
-    int pageID = 0;
-    while (true) {
+    int pageID;
+    for (int n = findCandidatePage(recordID, 0, pageID); n >= 0; n = findCandidatePage(recordID, n + 1, pageID)) {
         int index;
         BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
         if (deleteRecordInPage(patchouli, recordID, index)) {
+            updateDirEntry(n, patchouli, 0);
             return true;
         }
-        int recordCount, freeStart, nextPage;
-        getPageHeader(patchouli, recordCount, freeStart, nextPage);
-        if (nextPage == -1) {
-            break;
-        }
-        pageID = nextPage;
     }
     return false;
 }
@@ -216,10 +237,22 @@ bool RecordManager::updateRecord(int recordID, const char* newData, int dataLen)
     return youmu;
 }
 int RecordManager::getRecord(int recordID, BufType alice, int maxLen) {
-    int pageID = 0;
-    while (true) {
+    int pageID;
+    for (int n = findCandidatePage(recordID, 0, pageID); n >= 0; n = findCandidatePage(recordID, n + 1, pageID)) {
         int index;
         BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
+        if (isFrozenPage(patchouli)) {
+            int row = findRowInFrozenPage(patchouli, recordID);
+            if (row >= 0) {
+                int dataLen = patchouli[FROZEN_DATA_LEN_OFFSET];
+                if (dataLen > maxLen) {
+                    return -1;
+                }
+                readFrozenRow(patchouli, row, alice);
+                bufPageManager->access(index);
+                return dataLen;
+            }
+        }
         int offset;
         int recordLen = findRecordInPage(patchouli, recordID, offset);
         if (recordLen > 0) {
@@ -231,12 +264,6 @@ int RecordManager::getRecord(int recordID, BufType alice, int maxLen) {
             bufPageManager->access(index);
             return copyLen;
         }
-        int recordCount, freeStart, nextPage;
-        getPageHeader(patchouli, recordCount, freeStart, nextPage);
-        if (nextPage == -1) {
-            break;
-        }
-        pageID = nextPage;
     }
     return -1;
 }
@@ -255,114 +282,713 @@ int RecordManager::getRecord(int recordID, char* alice, int maxLen) {
     return -1;
 }
 bool RecordManager::recordExists(int recordID) {
-    int pageID = 0;
-    while (true) {
+    int pageID;
+    for (int n = findCandidatePage(recordID, 0, pageID); n >= 0; n = findCandidatePage(recordID, n + 1, pageID)) {
         int index;
         BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
         int offset;
-        if (findRecordInPage(patchouli, recordID, offset) > 0) {
+        if (findRecordInPage(patchouli, recordID, offset) > 0 ||
+            (isFrozenPage(patchouli) && findRowInFrozenPage(patchouli, recordID) >= 0)) {
             bufPageManager->access(index);
             return true;
         }
-        int recordCount, freeStart, nextPage;
-        getPageHeader(patchouli, recordCount, freeStart, nextPage);
-        if (nextPage == -1) {
-            break;
-        }
-        pageID = nextPage;
     }
     return false;
 }
 int RecordManager::getAllRecordIDs(int* recordIDs, int maxCount) {
     int count = 0;
-    int pageID = 0;
-    while (count < maxCount) {
+    forEachRecord([&](int rid, const unsigned int*, int) {
+        if (count < maxCount) {
+            recordIDs[count++] = rid;
+        }
+    });
+    return count;
+}
+void RecordManager::getStatistics(int& totalRecords, int& totalPages) {
+    std::vector<PageDirEntry> entries;
+    readDirectory(0, chainLength, entries);
+    totalRecords = 0;
+    totalPages = (int)entries.size();
+    for (const auto& entry : entries) {
+        totalRecords += entry.liveRows;
+    }
+}
+
+int RecordManager::getAllRecordsDirect(std::vector<int>& recordIDs,
+                                        std::vector<std::vector<char>>& records) {
+    recordIDs.clear();
+    records.clear();
+    forEachRecord([&](int rid, const unsigned int* data, int dataLen) {
+        recordIDs.push_back(rid);
+        std::vector<char> alice(dataLen * 4);
+        memcpy(alice.data(), data, dataLen * 4);
+        records.push_back(std::move(alice));
+    });
+    return (int)recordIDs.size();
+}
+
+void RecordManager::forEachRecord(const RecordVisitor& visit) {
+    forEachRecordInRange(0, chainLength, visit);
+}
+
+void RecordManager::forEachRecordInRange(int firstPage, int endPage, const RecordVisitor& visit) {
+    std::vector<PageDirEntry> entries;
+    readDirectory(firstPage, endPage, entries);
+    std::vector<unsigned int> columns;
+    std::vector<unsigned int> row;
+    for (const auto& entry : entries) {
+        if (entry.liveRows == 0) continue;
         int index;
-        BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
+        BufType patchouli = bufPageManager->getPage(fileID, entry.pageID, index);
         int recordCount, freeStart, nextPage;
         getPageHeader(patchouli, recordCount, freeStart, nextPage);
-        int pos = PAGE_DATA_START;
-        while (pos < freeStart && count < maxCount) {
-            int recordLen = patchouli[pos];
-            if (recordLen <= 0 || pos + recordLen > PAGE_INT_NUM) {
-                break;
+        if (isFrozenPage(patchouli)) {
+            // 按列整块解码，再逐行拼回记录
+            int rows = patchouli[FROZEN_ROW_COUNT_OFFSET];
+            int rowWords = patchouli[FROZEN_DATA_LEN_OFFSET] + 1;
+            columns.resize((size_t)rows * rowWords);
+            row.resize(rowWords);
+            for (int c = 0; c < rowWords; c++) {
+                IntColumnCodec::decode(frozenColumn(patchouli, c), &columns[(size_t)c * rows]);
             }
-            int rid = patchouli[pos + 1];
-            if (rid != 0) {
-                recordIDs[count++] = rid;
+            for (int r = 0; r < rows; r++) {
+                if (isFrozenRowDeleted(patchouli, r)) continue;
+                for (int c = 0; c < rowWords; c++) {
+                    row[c] = columns[(size_t)c * rows + r];
+                }
+                visit((int)row[0], row.data() + 1, rowWords - 1);
+            }
+        } else {
+            int pos = PAGE_DATA_START;
+            while (pos < freeStart) {
+                int recordLen = patchouli[pos];
+                if (recordLen <= 0 || pos + recordLen > PAGE_INT_NUM) {
+                    break;
+                }
+                int rid = patchouli[pos + 1];
+                if (rid != 0) {
+                    visit(rid, &patchouli[pos + RECORD_HEADER_SIZE], recordLen - RECORD_HEADER_SIZE);
+                }
+                pos += recordLen;
             }
-            pos += recordLen;
         }
-        if (nextPage == -1) {
-            break;
+        bufPageManager->access(index);
+    }
+}
+
+void RecordManager::aggregateIntColumn(int wordOffset, int nullBit, IntColumnStats& stats) {
+    unsigned int nullMask = (nullBit >= 0 && nullBit < 32) ? (1u << nullBit) : 0;
+    std::vector<unsigned int> values;
+    std::vector<unsigned int> nulls;
+    std::vector<PageDirEntry> entries;
+    readDirectory(0, chainLength, entries);
+    for (const auto& entry : entries) {
+        if (entry.liveRows == 0) continue;
+        int index;
+        BufType patchouli = bufPageManager->getPage(fileID, entry.pageID, index);
+        int recordCount, freeStart, nextPage;
+        getPageHeader(patchouli, recordCount, freeStart, nextPage);
+        if (isFrozenPage(patchouli)) {
+            int rows = patchouli[FROZEN_ROW_COUNT_OFFSET];
+            int dataLen = patchouli[FROZEN_DATA_LEN_OFFSET];
+            stats.rows += recordCount;
+            if (wordOffset >= 0 && wordOffset < dataLen && recordCount > 0) {
+                const unsigned int* block = frozenColumn(patchouli, wordOffset + 1);
+                const unsigned int* nullBlock = frozenColumn(patchouli, 1);
+                bool noNulls = nullMask == 0 ||
+                               (IntColumnCodec::minValue(nullBlock) == 0 &&
+                                IntColumnCodec::maxValue(nullBlock) == 0);
+                if (noNulls && recordCount == rows) {
+                    // 整页无删除、无 NULL：直接使用块头中的统计值
+                    stats.count += rows;
+                    stats.sum += IntColumnCodec::sum(block);
+                    stats.minVal = std::min(stats.minVal, IntColumnCodec::minValue(block));
+                    stats.maxVal = std::max(stats.maxVal, IntColumnCodec::maxValue(block));
+                } else {
+                    values.resize(rows);
+                    nulls.resize(rows);
+                    IntColumnCodec::decode(block, values.data());
+                    IntColumnCodec::decode(nullBlock, nulls.data());
+                    for (int r = 0; r < rows; r++) {
+                        if (isFrozenRowDeleted(patchouli, r) || (nulls[r] & nullMask)) continue;
+                        int v = (int)values[r];
+                        stats.count++;
+                        stats.sum += v;
+                        if (v < stats.minVal) stats.minVal = v;
+                        if (v > stats.maxVal) stats.maxVal = v;
+                    }
+                }
+            }
+        } else {
+            int pos = PAGE_DATA_START;
+            while (pos < freeStart) {
+                int recordLen = patchouli[pos];
+                if (recordLen <= 0 || pos + recordLen > PAGE_INT_NUM) {
+                    break;
+                }
+                if (patchouli[pos + 1] != 0) {
+                    stats.rows++;
+                    BufType data = &patchouli[pos + RECORD_HEADER_SIZE];
+                    if (wordOffset >= 0 && wordOffset < recordLen - RECORD_HEADER_SIZE &&
+                        !(data[0] & nullMask)) {
+                        int v = (int)data[wordOffset];
+                        stats.count++;
+                        stats.sum += v;
+                        if (v < stats.minVal) stats.minVal = v;
+                        if (v > stats.maxVal) stats.maxVal = v;
+                    }
+                }
+                pos += recordLen;
+            }
         }
-        pageID = nextPage;
+        bufPageManager->access(index);
     }
-    return count;
 }
-void RecordManager::getStatistics(int& totalRecords, int& totalPages) {
-    totalRecords = 0;
-    totalPages = 0;
+
+const unsigned int* RecordManager::frozenColumn(BufType patchouli, int col) {
+    return patchouli + patchouli[patchouli[FROZEN_DIR_OFFSET] + col];
+}
+
+bool RecordManager::isFrozenRowDeleted(BufType patchouli, int row) {
+    BufType bitmap = patchouli + patchouli[FROZEN_BITMAP_OFFSET];
+    return (bitmap[row >> 5] >> (row & 31)) & 1;
+}
+
+int RecordManager::findRowInFrozenPage(BufType patchouli, int recordID) {
+    if (recordID == 0) return -1;
+    const unsigned int* ids = frozenColumn(patchouli, 0);
+    // 块头中的最小/最大 recordID 可以直接排除大部分页
+    if (recordID < IntColumnCodec::minValue(ids) || recordID > IntColumnCodec::maxValue(ids)) {
+        return -1;
+    }
+    int rows = patchouli[FROZEN_ROW_COUNT_OFFSET];
+    unsigned int decoded[FROZEN_MAX_ROWS];
+    IntColumnCodec::decode(ids, decoded);
+    for (int r = 0; r < rows; r++) {
+        if ((int)decoded[r] == recordID && !isFrozenRowDeleted(patchouli, r)) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+void RecordManager::readFrozenRow(BufType patchouli, int row, BufType alice) {
+    int dataLen = patchouli[FROZEN_DATA_LEN_OFFSET];
+    for (int j = 0; j < dataLen; j++) {
+        alice[j] = IntColumnCodec::valueAt(frozenColumn(patchouli, j + 1), row);
+    }
+}
+
+// 从 start 开始，计算一个压缩页最多能放下多少行
+int RecordManager::planFrozenPage(const std::vector<unsigned int>& rows, int rowWords, int start) {
+    int total = (int)rows.size() / rowWords;
+    std::vector<IntColumnSizer> sizers(rowWords);
+    int n = 0;
+    while (start + n < total && n < FROZEN_MAX_ROWS) {
+        const unsigned int* r = &rows[(size_t)(start + n) * rowWords];
+        int size = PAGE_HEADER_SIZE + rowWords + (n + 1 + 31) / 32;
+        for (int c = 0; c < rowWords; c++) {
+            IntColumnSizer next = sizers[c];
+            next.add((int)r[c]);
+            int codec;
+            size += next.encodedSize(codec);
+        }
+        if (size > PAGE_INT_NUM) break;
+        for (int c = 0; c < rowWords; c++) {
+            sizers[c].add((int)r[c]);
+        }
+        n++;
+    }
+    return n;
+}
+
+void RecordManager::writeFrozenPage(BufType patchouli, const unsigned int* rows, int rowWords, int n) {
+    unsigned int fileHeader[PAGE_HEADER_SIZE - PAGE_FILE_HEADER_START];
+    memcpy(fileHeader, patchouli + PAGE_FILE_HEADER_START, sizeof(fileHeader));
+    memset(patchouli, 0, PAGE_SIZE);
+    memcpy(patchouli + PAGE_FILE_HEADER_START, fileHeader, sizeof(fileHeader));
+    patchouli[PAGE_TYPE_OFFSET] = PAGE_TYPE_FROZEN;
+    patchouli[PAGE_RECORD_COUNT_OFFSET] = n;
+    patchouli[PAGE_FREE_START_OFFSET] = PAGE_INT_NUM;
+    patchouli[PAGE_NEXT_PAGE_OFFSET] = (unsigned int)-1;
+    patchouli[FROZEN_ROW_COUNT_OFFSET] = n;
+    patchouli[FROZEN_DATA_LEN_OFFSET] = rowWords - 1;
+    patchouli[FROZEN_DIR_OFFSET] = PAGE_HEADER_SIZE;
+    patchouli[FROZEN_BITMAP_OFFSET] = PAGE_HEADER_SIZE + rowWords;
+    int pos = PAGE_HEADER_SIZE + rowWords + (n + 31) / 32;
+    std::vector<unsigned int> column(n);
+    for (int c = 0; c < rowWords; c++) {
+        for (int r = 0; r < n; r++) {
+            column[r] = rows[(size_t)r * rowWords + c];
+        }
+        patchouli[PAGE_HEADER_SIZE + c] = pos;
+        pos += IntColumnCodec::encode(column.data(), n, patchouli + pos);
+    }
+}
+
+bool RecordManager::compressColdPages(int& pagesBefore, int& pagesAfter) {
+    pagesBefore = 0;
+    pagesAfter = 0;
     int pageID = 0;
-    while (true) {
+    while (pageID != tailPageID) {
         int index;
         BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
         int recordCount, freeStart, nextPage;
         getPageHeader(patchouli, recordCount, freeStart, nextPage);
-        totalRecords += recordCount;
-        totalPages++;
         if (nextPage == -1) {
             break;
         }
-        pageID = nextPage;
+        if (isFrozenPage(patchouli)) {
+            pagesBefore++;
+            pagesAfter++;
+            pageID = nextPage;
+            continue;
+        }
+
+        // 收集一段连续的、非尾页的数据页中的有效记录（要求记录等长）
+        std::vector<int> window;
+        std::vector<unsigned int> rows;
+        int rowWords = -1;
+        int p = pageID;
+        while (p != tailPageID && (int)window.size() < FREEZE_WINDOW_PAGES) {
+            BufType page = bufPageManager->getPage(fileID, p, index);
+            if (isFrozenPage(page)) break;
+            getPageHeader(page, recordCount, freeStart, nextPage);
+            std::vector<unsigned int> pageRows;
+            bool uniform = true;
+            int pos = PAGE_DATA_START;
+            while (pos < freeStart) {
+                int recordLen = page[pos];
+                if (recordLen <= 0 || pos + recordLen > PAGE_INT_NUM) break;
+                if (page[pos + 1] != 0) {
+                    if (rowWords == -1) rowWords = recordLen - 1;
+                    if (recordLen - 1 != rowWords) {
+                        uniform = false;
+                        break;
+                    }
+                    pageRows.insert(pageRows.end(), &page[pos + 1], &page[pos + recordLen]);
+                }
+                pos += recordLen;
+            }
+            if (!uniform) break;
+            rows.insert(rows.end(), pageRows.begin(), pageRows.end());
+            window.push_back(p);
+            p = nextPage;
+        }
+        if (window.empty()) {
+            pagesBefore++;
+            pagesAfter++;
+            pageID = nextPage;
+            continue;
+        }
+        int nextAfter = p;
+        pagesBefore += (int)window.size();
+
+        // 先规划每个压缩页放多少行，压缩后页数不减少就保持原样
+        std::vector<int> plan;
+        int totalRows = rowWords > 0 ? (int)rows.size() / rowWords : 0;
+        int start = 0;
+        while (start < totalRows) {
+            int n = planFrozenPage(rows, rowWords, start);
+            if (n <= 0 || plan.size() >= window.size()) break;
+            plan.push_back(n);
+            start += n;
+        }
+        if (start < totalRows || plan.size() >= window.size()) {
+            pagesAfter += (int)window.size();
+            pageID = nextAfter;
+            continue;
+        }
+
+        // 压缩页依次写回窗口内的页号，多出来的页放入空闲页链表
+        int used = std::max((int)plan.size(), 1);
+        start = 0;
+        for (int i = 0; i < (int)window.size(); i++) {
+            if (i >= used) {
+                freePage(window[i]);
+                continue;
+            }
+            BufType page = bufPageManager->getPage(fileID, window[i], index);
+            if (i < (int)plan.size()) {
+                writeFrozenPage(page, &rows[(size_t)start * rowWords], rowWords, plan[i]);
+                start += plan[i];
+            } else {
+                page[PAGE_TYPE_OFFSET] = PAGE_TYPE_DATA;
+                setPageHeader(page, 0, PAGE_DATA_START, -1);
+            }
+            page[PAGE_NEXT_PAGE_OFFSET] = (i == used - 1) ? nextAfter : window[i + 1];
+            bufPageManager->markDirty(index);
+        }
+        pagesAfter += used;
+        pageID = nextAfter;
     }
+    // 尾页保持可写
+    pagesBefore++;
+    pagesAfter++;
+    rebuildDirectory();
+    return true;
 }
 
-int RecordManager::getAllRecordsDirect(std::vector<int>& recordIDs,
-                                        std::vector<std::vector<char>>& records) {
-    recordIDs.clear();
-    records.clear();
+int RecordManager::allocDataPage() {
+    int index;
+    BufType head = bufPageManager->getPage(fileID, 0, index);
+    int pageID = head[PAGE_FREE_LIST_OFFSET];
+    BufType patchouli;
+    if (pageID > 0) {
+        // 优先复用空闲页
+        patchouli = bufPageManager->getPage(fileID, pageID, index);
+        int nextFree = patchouli[PAGE_NEXT_PAGE_OFFSET];
+        memset(patchouli, 0, PAGE_SIZE);
+        bufPageManager->markDirty(index);
+        head = bufPageManager->getPage(fileID, 0, index);
+        head[PAGE_FREE_LIST_OFFSET] = (nextFree > 0) ? nextFree : 0;
+        bufPageManager->markDirty(index);
+        patchouli = bufPageManager->getPage(fileID, pageID, index);
+    } else {
+        pageID = nextNewPageID++;
+        head[PAGE_FILE_PAGES_OFFSET] = nextNewPageID;
+        bufPageManager->markDirty(index);
+        patchouli = bufPageManager->allocPage(fileID, pageID, index, false);
+    }
+    patchouli[PAGE_TYPE_OFFSET] = PAGE_TYPE_DATA;
+    setPageHeader(patchouli, 0, PAGE_DATA_START, -1);
+    bufPageManager->markDirty(index);
+    return pageID;
+}
 
-    int pageID = 0;
-    int count = 0;
+void RecordManager::freePage(int pageID) {
+    if (pageID <= 0) return;
+    int index;
+    BufType head = bufPageManager->getPage(fileID, 0, index);
+    int oldHead = head[PAGE_FREE_LIST_OFFSET];
+    head[PAGE_FREE_LIST_OFFSET] = pageID;
+    bufPageManager->markDirty(index);
+    BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
+    memset(patchouli, 0, PAGE_SIZE);
+    patchouli[PAGE_TYPE_OFFSET] = PAGE_TYPE_FREE;
+    patchouli[PAGE_NEXT_PAGE_OFFSET] = oldHead;
+    bufPageManager->markDirty(index);
+}
 
+bool RecordManager::vacuum(VacuumStats& stats) {
+    stats = VacuumStats();
+    std::vector<int> chain;
+    int pageID = 0;
     while (true) {
         int index;
         BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
-        int recordCount, freeStart, nextPage;
-        getPageHeader(patchouli, recordCount, freeStart, nextPage);
+        chain.push_back(pageID);
+        int nextPage = patchouli[PAGE_NEXT_PAGE_OFFSET];
+        if (nextPage == -1 || nextPage > 1000000) break;
+        pageID = nextPage;
+    }
+    stats.pagesBefore = (int)chain.size();
 
+    std::vector<int> dataPages;
+    std::vector<size_t> dataSlots;   // 数据页在 chain 中的位置
+    std::vector<bool> keep(chain.size(), true);
+    std::vector<unsigned int> columns, rows;
+    for (size_t i = 0; i < chain.size(); i++) {
+        int index;
+        BufType patchouli = bufPageManager->getPage(fileID, chain[i], index);
+        if (!isFrozenPage(patchouli)) {
+            dataPages.push_back(chain[i]);
+            dataSlots.push_back(i);
+            continue;
+        }
+        // 压缩页：去掉已删除的行后重新编码，全部删除的页直接释放
+        int total = patchouli[FROZEN_ROW_COUNT_OFFSET];
+        int live = patchouli[PAGE_RECORD_COUNT_OFFSET];
+        stats.deadRecords += total - live;
+        stats.liveRecords += live;
+        if (live == total) continue;
+        if (live == 0 && chain[i] != 0) {
+            keep[i] = false;
+            continue;
+        }
+        int rowWords = patchouli[FROZEN_DATA_LEN_OFFSET] + 1;
+        columns.resize((size_t)total * rowWords);
+        for (int c = 0; c < rowWords; c++) {
+            IntColumnCodec::decode(frozenColumn(patchouli, c), &columns[(size_t)c * total]);
+        }
+        rows.clear();
+        for (int r = 0; r < total; r++) {
+            if (isFrozenRowDeleted(patchouli, r)) continue;
+            for (int c = 0; c < rowWords; c++) {
+                rows.push_back(columns[(size_t)c * total + r]);
+            }
+        }
+        writeFrozenPage(patchouli, rows.data(), rowWords, live);
+        bufPageManager->markDirty(index);
+    }
 
+    // 数据页：按链表顺序把有效记录依次压实到前面的页中
+    // 输出页只写入已经读过的页，因此可以原地进行
+    std::vector<std::vector<unsigned int>> ready;
+    std::vector<unsigned int> out(PAGE_INT_NUM, 0);
+    int outPos = PAGE_DATA_START;
+    int outCount = 0;
+    size_t written = 0;
+    auto finishPage = [&]() {
+        out[PAGE_TYPE_OFFSET] = PAGE_TYPE_DATA;
+        out[PAGE_RECORD_COUNT_OFFSET] = outCount;
+        out[PAGE_FREE_START_OFFSET] = outPos;
+        out[PAGE_NEXT_PAGE_OFFSET] = (unsigned int)-1;
+        ready.push_back(out);
+        std::fill(out.begin(), out.end(), 0);
+        outPos = PAGE_DATA_START;
+        outCount = 0;
+    };
+    auto flushReady = [&](size_t limit) {
+        while (!ready.empty() && written <= limit && written < dataPages.size()) {
+            int index;
+            BufType patchouli = bufPageManager->getPage(fileID, dataPages[written], index);
+            unsigned int fileHeader[PAGE_HEADER_SIZE - PAGE_FILE_HEADER_START];
+            memcpy(fileHeader, patchouli + PAGE_FILE_HEADER_START, sizeof(fileHeader));
+            memcpy(patchouli, ready.front().data(), PAGE_SIZE);
+            memcpy(patchouli + PAGE_FILE_HEADER_START, fileHeader, sizeof(fileHeader));
+            bufPageManager->markDirty(index);
+            ready.erase(ready.begin());
+            written++;
+        }
+    };
+    std::vector<unsigned int> src(PAGE_INT_NUM);
+    for (size_t i = 0; i < dataPages.size(); i++) {
+        int index;
+        BufType patchouli = bufPageManager->getPage(fileID, dataPages[i], index);
+        memcpy(src.data(), patchouli, PAGE_SIZE);
+        int freeStart = src[PAGE_FREE_START_OFFSET];
         int pos = PAGE_DATA_START;
         while (pos < freeStart) {
-            int recordLen = patchouli[pos];
-            if (recordLen <= 0 || pos + recordLen > PAGE_INT_NUM) {
-                break;
+            int recordLen = src[pos];
+            if (recordLen <= 0 || pos + recordLen > PAGE_INT_NUM) break;
+            if (src[pos + 1] == 0) {
+                stats.deadRecords++;
+            } else {
+                if (outPos + recordLen > PAGE_INT_NUM) finishPage();
+                memcpy(&out[outPos], &src[pos], recordLen * 4);
+                outPos += recordLen;
+                outCount++;
+                stats.liveRecords++;
             }
-            int rid = patchouli[pos + 1];
-            if (rid != 0) {
-                recordIDs.push_back(rid);
+            pos += recordLen;
+        }
+        flushReady(i);
+    }
+    if (!dataPages.empty() && (outCount > 0 || written + ready.size() == 0)) finishPage();
+    flushReady(dataPages.size());
+    if (!ready.empty()) {
+        // 不会发生：压实后的页数不会超过原来的页数
+        return false;
+    }
 
+    // 多出来的数据页释放，然后按原顺序重建链表
+    for (size_t i = written; i < dataPages.size(); i++) {
+        keep[dataSlots[i]] = false;
+    }
+    std::vector<int> newChain;
+    for (size_t k = 0; k < chain.size(); k++) {
+        if (keep[k]) {
+            newChain.push_back(chain[k]);
+        } else {
+            freePage(chain[k]);
+        }
+    }
+    for (size_t k = 0; k < newChain.size(); k++) {
+        int index;
+        BufType patchouli = bufPageManager->getPage(fileID, newChain[k], index);
+        patchouli[PAGE_NEXT_PAGE_OFFSET] = (k + 1 < newChain.size()) ? newChain[k + 1] : -1;
+        bufPageManager->markDirty(index);
+    }
+    deadSinceVacuum = 0;
+    rebuildDirectory();
 
-                int dataLen = recordLen - RECORD_HEADER_SIZE;
-                std::vector<char> alice(dataLen * 4);
-                memcpy(alice.data(), &patchouli[pos + RECORD_HEADER_SIZE], dataLen * 4);
-                records.push_back(std::move(alice));
-                count++;
-            }
-            pos += recordLen;
+    stats.pagesAfter = (int)newChain.size();
+    stats.bytesReclaimed = (long long)(stats.pagesBefore - stats.pagesAfter) * PAGE_SIZE;
+    return true;
+}
+
+void RecordManager::saveFileHeader() {
+    int index;
+    BufType head = bufPageManager->getPage(fileID, 0, index);
+    head[PAGE_DIR_MAGIC_OFFSET] = PAGE_DIR_MAGIC;
+    head[PAGE_TAIL_OFFSET] = tailPageID;
+    head[PAGE_CHAIN_LENGTH_OFFSET] = chainLength;
+    head[PAGE_FILE_PAGES_OFFSET] = nextNewPageID;
+    bufPageManager->markDirty(index);
+}
+
+void RecordManager::loadDirectory() {
+    if (dirLoaded) return;
+    dirLoaded = true;
+    dirPageIDs.clear();
+    int index;
+    BufType head = bufPageManager->getPage(fileID, 0, index);
+    int pageID = head[PAGE_DIR_HEAD_OFFSET];
+    while (pageID > 0) {
+        dirPageIDs.push_back(pageID);
+        BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
+        pageID = patchouli[PAGE_NEXT_PAGE_OFFSET];
+    }
+}
+
+// 返回第 n 个目录项所在的位置，目录页不够时自动追加
+BufType RecordManager::dirEntry(int n, int& index) {
+    loadDirectory();
+    int d = n / DIR_ENTRIES_PER_PAGE;
+    while ((int)dirPageIDs.size() <= d) {
+        int pageID = allocDataPage();
+        BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
+        patchouli[PAGE_TYPE_OFFSET] = PAGE_TYPE_DIRECTORY;
+        patchouli[PAGE_NEXT_PAGE_OFFSET] = (unsigned int)-1;
+        bufPageManager->markDirty(index);
+        BufType prev = bufPageManager->getPage(fileID, dirPageIDs.empty() ? 0 : dirPageIDs.back(), index);
+        prev[dirPageIDs.empty() ? PAGE_DIR_HEAD_OFFSET : PAGE_NEXT_PAGE_OFFSET] = pageID;
+        bufPageManager->markDirty(index);
+        dirPageIDs.push_back(pageID);
+    }
+    BufType patchouli = bufPageManager->getPage(fileID, dirPageIDs[d], index);
+    return patchouli + PAGE_HEADER_SIZE + (n % DIR_ENTRIES_PER_PAGE) * DIR_ENTRY_SIZE;
+}
+
+PageDirEntry RecordManager::describePage(BufType patchouli, int pageID) {
+    PageDirEntry entry;
+    entry.pageID = pageID;
+    entry.liveRows = patchouli[PAGE_RECORD_COUNT_OFFSET];
+    entry.freeWords = isFrozenPage(patchouli) ? 0 : PAGE_INT_NUM - (int)patchouli[PAGE_FREE_START_OFFSET];
+    if (entry.liveRows == 0) {
+        return entry;
+    }
+    if (isFrozenPage(patchouli)) {
+        const unsigned int* ids = frozenColumn(patchouli, 0);
+        entry.minRecordID = IntColumnCodec::minValue(ids);
+        entry.maxRecordID = IntColumnCodec::maxValue(ids);
+        return entry;
+    }
+    int freeStart = patchouli[PAGE_FREE_START_OFFSET];
+    int pos = PAGE_DATA_START;
+    while (pos < freeStart) {
+        int recordLen = patchouli[pos];
+        if (recordLen <= 0 || pos + recordLen > PAGE_INT_NUM) break;
+        int rid = patchouli[pos + 1];
+        if (rid != 0) {
+            entry.minRecordID = std::min(entry.minRecordID, rid);
+            entry.maxRecordID = std::max(entry.maxRecordID, rid);
         }
+        pos += recordLen;
+    }
+    return entry;
+}
 
-        bufPageManager->access(index);
+void RecordManager::setDirEntry(int n, const PageDirEntry& entry) {
+    int index;
+    BufType slot = dirEntry(n, index);
+    slot[0] = entry.pageID;
+    slot[1] = entry.freeWords;
+    slot[2] = entry.liveRows;
+    slot[3] = entry.minRecordID;
+    slot[4] = entry.maxRecordID;
+    bufPageManager->markDirty(index);
+}
 
-        if (nextPage == -1) {
-            break;
+void RecordManager::updateDirEntry(int n, BufType patchouli, int recordID) {
+    int freeWords = isFrozenPage(patchouli) ? 0 : PAGE_INT_NUM - (int)patchouli[PAGE_FREE_START_OFFSET];
+    int liveRows = patchouli[PAGE_RECORD_COUNT_OFFSET];
+    int index;
+    BufType slot = dirEntry(n, index);
+    slot[1] = freeWords;
+    slot[2] = liveRows;
+    if (recordID != 0) {
+        if (recordID < (int)slot[3]) slot[3] = recordID;
+        if (recordID > (int)slot[4]) slot[4] = recordID;
+    }
+    bufPageManager->markDirty(index);
+}
+
+int RecordManager::findCandidatePage(int recordID, int from, int& pageID) {
+    if (recordID == 0) return -1;
+    int n = from;
+    while (n < chainLength) {
+        // 只读目录页，每个目录页取一次
+        int index;
+        BufType slot = dirEntry(n, index);
+        int stop = std::min(chainLength, (n / DIR_ENTRIES_PER_PAGE + 1) * DIR_ENTRIES_PER_PAGE);
+        for (; n < stop; n++, slot += DIR_ENTRY_SIZE) {
+            if (slot[2] != 0 && recordID >= (int)slot[3] && recordID <= (int)slot[4]) {
+                pageID = slot[0];
+                return n;
+            }
         }
-        pageID = nextPage;
     }
+    return -1;
+}
 
-    return count;
+void RecordManager::readDirectory(int first, int end, std::vector<PageDirEntry>& entries) {
+    entries.clear();
+    if (first < 0) first = 0;
+    if (end > chainLength) end = chainLength;
+    int n = first;
+    while (n < end) {
+        // 每个目录页只取一次
+        int index;
+        BufType slot = dirEntry(n, index);
+        int stop = std::min(end, (n / DIR_ENTRIES_PER_PAGE + 1) * DIR_ENTRIES_PER_PAGE);
+        for (; n < stop; n++, slot += DIR_ENTRY_SIZE) {
+            PageDirEntry entry;
+            entry.pageID = slot[0];
+            entry.freeWords = slot[1];
+            entry.liveRows = slot[2];
+            entry.minRecordID = slot[3];
+            entry.maxRecordID = slot[4];
+            entries.push_back(entry);
+        }
+    }
+}
+
+bool RecordManager::getPageInfo(int n, PageDirEntry& entry) {
+    if (n < 0 || n >= chainLength) return false;
+    int index;
+    BufType slot = dirEntry(n, index);
+    entry.pageID = slot[0];
+    entry.freeWords = slot[1];
+    entry.liveRows = slot[2];
+    entry.minRecordID = slot[3];
+    entry.maxRecordID = slot[4];
+    return true;
 }
+
+// 链表结构变化后（压缩、VACUUM、旧文件升级）沿链表重写整个页目录
+void RecordManager::rebuildDirectory() {
+    std::vector<PageDirEntry> entries;
+    int pageID = 0;
+    while (true) {
+        int index;
+        BufType patchouli = bufPageManager->getPage(fileID, pageID, index);
+        entries.push_back(describePage(patchouli, pageID));
+        int nextPage = patchouli[PAGE_NEXT_PAGE_OFFSET];
+        if (nextPage == -1 || nextPage > 1000000) break;
+        pageID = nextPage;
+    }
+    tailPageID = entries.back().pageID;
+    chainLength = (int)entries.size();
+    for (int n = 0; n < chainLength; n++) {
+        setDirEntry(n, entries[n]);
+    }
+    // 多余的目录页放回空闲页链表
+    size_t needed = (chainLength + DIR_ENTRIES_PER_PAGE - 1) / DIR_ENTRIES_PER_PAGE;
+    if (dirPageIDs.size() > needed) {
+        for (size_t i = needed; i < dirPageIDs.size(); i++) {
+            freePage(dirPageIDs[i]);
+        }
+        dirPageIDs.resize(needed);
+        int index;
+        BufType last = bufPageManager->getPage(fileID, dirPageIDs.back(), index);
+        last[PAGE_NEXT_PAGE_OFFSET] = (unsigned int)-1;
+        bufPageManager->markDirty(index);
+    }
+    saveFileHeader();
+}
+
 void RecordManager::close() {
     bufPageManager->close();
 }
@@ -6,6 +6,9 @@
 #include <cstring>
 #include <iostream>
 #include <vector>
+#include <functional>
+#include <climits>
+#include "IntColumnCodec.h"
 using namespace std;
 
 #define PAGE_HEADER_SIZE 16
@@ -16,6 +19,65 @@ using namespace std;
 #define PAGE_FREE_START_OFFSET 2
 #define PAGE_NEXT_PAGE_OFFSET 3
 #define RECORD_HEADER_SIZE 2
+#define PAGE_TYPE_DATA 0
+#define PAGE_TYPE_FROZEN 1
+#define PAGE_TYPE_FREE 2
+#define PAGE_TYPE_DIRECTORY 3
+// 页 0 的文件头字段，重写整页时要保留
+#define PAGE_FILE_HEADER_START 8
+#define PAGE_DIR_MAGIC_OFFSET 8
+#define PAGE_DIR_HEAD_OFFSET 9        // 第一个目录页（0 表示没有）
+#define PAGE_TAIL_OFFSET 10
+#define PAGE_CHAIN_LENGTH_OFFSET 11   // 数据链表中的页数
+#define PAGE_FILE_PAGES_OFFSET 12     // 文件中已分配的页数
+#define PAGE_FREE_LIST_OFFSET 15      // 空闲页链表头（0 表示空，页 0 不会被释放）
+#define PAGE_DIR_MAGIC 0x50444932
+#define PAGE_DIR_MAGIC_V1 0x50444952  // 早先的目录项没有 recordID 范围，打开时重建目录
+// 页目录：按链表顺序记录每个数据页的 (pageID, 剩余空间, 有效记录数, 最小 recordID, 最大 recordID)
+// recordID 范围在插入时扩大，删除时不缩小，压缩、VACUUM 后按页内记录重算；没有记录时为 [INT_MAX, INT_MIN]
+#define DIR_ENTRY_SIZE 5
+#define DIR_ENTRIES_PER_PAGE ((PAGE_INT_NUM - PAGE_HEADER_SIZE) / DIR_ENTRY_SIZE)
+// 压缩页（frozen page）：记录按列存放，每列一个 IntColumnCodec 块
+// 列 0 为 recordID，列 j+1 为记录数据的第 j 个 int
+// 按整行的 int 压缩，不看表结构：空值位图、VARCHAR 的长度和内容、FLOAT 的两半也各自选 FOR/RLE/原样中最短的，
+// 补齐的 0 和重复的值都能压掉；这些列块头中的最小/最大值和总和没有意义，列上的聚合只读 INT 列的块
+#define FROZEN_ROW_COUNT_OFFSET 4
+#define FROZEN_DATA_LEN_OFFSET 5
+#define FROZEN_DIR_OFFSET 6
+#define FROZEN_BITMAP_OFFSET 7
+#define FROZEN_MAX_ROWS 4096
+#define FREEZE_WINDOW_PAGES 64
+// 自动 VACUUM 的触发条件：删除数达到下限且不少于有效记录的 1/4
+#define AUTOVACUUM_MIN_DEAD 1000
+
+// 单个 INT 列的聚合结果
+struct IntColumnStats {
+    long long rows;    // 有效记录数
+    long long count;   // 非 NULL 值个数
+    long long sum;
+    int minVal;
+    int maxVal;
+    IntColumnStats() : rows(0), count(0), sum(0), minVal(INT_MAX), maxVal(INT_MIN) {}
+};
+
+struct PageDirEntry {
+    int pageID;
+    int freeWords;
+    int liveRows;
+    int minRecordID;
+    int maxRecordID;
+    PageDirEntry() : pageID(0), freeWords(0), liveRows(0), minRecordID(INT_MAX), maxRecordID(INT_MIN) {}
+};
+
+// VACUUM 结果
+struct VacuumStats {
+    int pagesBefore;
+    int pagesAfter;
+    long long deadRecords;
+    long long liveRecords;
+    long long bytesReclaimed;
+    VacuumStats() : pagesBefore(0), pagesAfter(0), deadRecords(0), liveRecords(0), bytesReclaimed(0) {}
+};
 class RecordManager {
 private:
     FileManager* fileManager;
@@ -24,14 +86,38 @@ private:
     int recordSize;
     bool fixedSize;
     int tailPageID;
+    int nextNewPageID;      // 文件末尾的下一个页号
+    int deadSinceVacuum;    // 上次 VACUUM 以来删除的记录数
+    int chainLength;
+    std::vector<int> dirPageIDs;
+    bool dirLoaded;
     void getPageHeader(BufType page, int& recordCount, int& freeStart, int& nextPage);
     void setPageHeader(BufType page, int recordCount, int freeStart, int nextPage);
     int findRecordInPage(BufType page, int recordID, int& offset);
     bool insertRecordInPage(BufType page, int recordID, BufType data, int dataLen, int pageIndex);
     bool deleteRecordInPage(BufType page, int recordID, int pageIndex);
-    int getNewPage();
     int findFreeSpace(BufType page, int requiredSize);
     void compactPage(BufType page, int pageIndex);
+    bool isFrozenPage(BufType page) { return page[PAGE_TYPE_OFFSET] == PAGE_TYPE_FROZEN; }
+    const unsigned int* frozenColumn(BufType page, int col);
+    bool isFrozenRowDeleted(BufType page, int row);
+    int findRowInFrozenPage(BufType page, int recordID);
+    void readFrozenRow(BufType page, int row, BufType data);
+    int planFrozenPage(const std::vector<unsigned int>& rows, int rowWords, int start);
+    void writeFrozenPage(BufType page, const unsigned int* rows, int rowWords, int n);
+    int allocDataPage();
+    void freePage(int pageID);
+    void loadDirectory();
+    BufType dirEntry(int n, int& index);
+    PageDirEntry describePage(BufType page, int pageID);
+    void setDirEntry(int n, const PageDirEntry& entry);
+    // 页内记录增删后更新第 n 个目录项的计数，recordID 非 0 时把它并入范围
+    void updateDirEntry(int n, BufType page, int recordID);
+    // 从第 from 个目录项起找 recordID 范围包含 recordID 的数据页，返回目录项下标，没有时返回 -1
+    int findCandidatePage(int recordID, int from, int& pageID);
+    void readDirectory(int first, int end, std::vector<PageDirEntry>& entries);
+    void rebuildDirectory();
+    void saveFileHeader();
 
 public:
     RecordManager(FileManager* fm, BufPageManager* bpm, int fid, bool fixed = false, int rSize = 0, bool forceInit = false);
@@ -51,6 +137,20 @@ public:
 
     int getAllRecordsDirect(std::vector<int>& recordIDs,
                             std::vector<std::vector<char>>& records);
+    // 逐条访问所有有效记录（data 以 int 为单位，dataLen 为 int 数）
+    typedef std::function<void(int recordID, const unsigned int* data, int dataLen)> RecordVisitor;
+    void forEachRecord(const RecordVisitor& visit);
+    // 按页目录访问第 [firstPage, endPage) 个数据页，可用于把堆划分成多段分别扫描
+    void forEachRecordInRange(int firstPage, int endPage, const RecordVisitor& visit);
+    int getPageCount() const { return chainLength; }
+    bool getPageInfo(int n, PageDirEntry& entry);
+    // 统计记录数据中第 wordOffset 个 int 的 SUM/MIN/MAX，压缩页直接读块头；wordOffset < 0 时只计行数
+    void aggregateIntColumn(int wordOffset, int nullBit, IntColumnStats& stats);
+    // 把尾页之前的数据页压缩为列式压缩页
+    bool compressColdPages(int& pagesBefore, int& pagesAfter);
+    // 把有效记录压实到尽量少的页中，空出的页放入空闲页链表
+    bool vacuum(VacuumStats& stats);
+    int getDeadSinceVacuum() const { return deadSinceVacuum; }
     void close();
     void getStatistics(int& totalRecords, int& totalPages);
 };
@@ -9,7 +9,7 @@
 #include <set>
 
 SystemManager::SystemManager(FileManager* fm, BufPageManager* bpm, const std::string& dir)
-    : fileManager(fm), bufPageManager(bpm), baseDir(dir) {
+    : fileManager(fm), bufPageManager(bpm), baseDir(dir), indexFillFactor(BP_BULK_FILL) {
     createDirectory(baseDir);
 }
 SystemManager::~SystemManager() {
@@ -110,6 +110,11 @@ bool SystemManager::saveTableMeta(const std::string& tableName) {
         file << " " << idx;
     }
     file << std::endl;
+    file << "HASH_INDEXES " << meta.hashIndexes.size();
+    for (const auto& idx : meta.hashIndexes) {
+        file << " " << idx;
+    }
+    file << std::endl;
     file << "EXPLICIT_INDEXES " << meta.explicitIndexes.size() << std::endl;
     for (const auto& idx : meta.explicitIndexes) {
         file << idx.name << " " << idx.columns.size();
@@ -117,6 +122,7 @@ bool SystemManager::saveTableMeta(const std::string& tableName) {
             file << " " << col;
         }
         file << " " << (idx.isExplicit ? 1 : 0) << " " << (idx.isUnique ? 1 : 0);
+        file << " " << (idx.isHash ? 1 : 0);
         file << std::endl;
     }
     file << "PRIMARY_KEY_COLS " << meta.primaryKeyColumns.size();
@@ -127,6 +133,7 @@ bool SystemManager::saveTableMeta(const std::string& tableName) {
 
     file << "RECORD_COUNT " << meta.recordCount << std::endl;
     file << "NEXT_RECORD_ID " << meta.nextRecordID << std::endl;
+    file << "INDEX_MODE " << (meta.bufferedIndexes ? "BUFFERED" : "DIRECT") << std::endl;
     file.close();
     return true;
 }
@@ -223,6 +230,14 @@ bool SystemManager::loadTableMeta(const std::string& tableName) {
                 iss >> idx;
                 meta.indexes.push_back(idx);
             }
+        } else if (token == "HASH_INDEXES") {
+            int count;
+            iss >> count;
+            for (int i = 0; i < count; i++) {
+                std::string idx;
+                iss >> idx;
+                meta.hashIndexes.push_back(idx);
+            }
         } else if (token == "EXPLICIT_INDEXES") {
             int count;
             iss >> count;
@@ -230,6 +245,7 @@ bool SystemManager::loadTableMeta(const std::string& tableName) {
                 std::istringstream idxIss(line);
                 IndexInfo idx;
                 int colCount, isExplicitInt, isUniqueInt;
+                int isHashInt = 0;   // 早先的元数据没有这一项
                 
                 idxIss >> idx.name >> colCount;
                 for (int j = 0; j < colCount; j++) {
@@ -237,9 +253,10 @@ bool SystemManager::loadTableMeta(const std::string& tableName) {
                     idxIss >> col;
                     idx.columns.push_back(col);
                 }
-                idxIss >> isExplicitInt >> isUniqueInt;
+                idxIss >> isExplicitInt >> isUniqueInt >> isHashInt;
                 idx.isExplicit = (isExplicitInt != 0);
                 idx.isUnique = (isUniqueInt != 0);
+                idx.isHash = (isHashInt != 0);
                 
                 meta.explicitIndexes.push_back(idx);
             }
@@ -255,6 +272,10 @@ bool SystemManager::loadTableMeta(const std::string& tableName) {
             iss >> meta.recordCount;
         } else if (token == "NEXT_RECORD_ID") {
             iss >> meta.nextRecordID;
+        } else if (token == "INDEX_MODE") {
+            std::string mode;
+            iss >> mode;
+            meta.bufferedIndexes = (mode == "BUFFERED");
         }
     }
     
@@ -264,6 +285,9 @@ bool SystemManager::loadTableMeta(const std::string& tableName) {
     
     file.close();
     tableMetas[tableName] = meta;
+    if (indexManager) {
+        indexManager->setBuffered(tableName, meta.bufferedIndexes);
+    }
     return true;
 }
 
@@ -395,10 +419,15 @@ bool SystemManager::createTable(const std::string& tableName,
                 keyType = KeyType::VARCHAR;
                 keyLength = col->length;
             }
-            indexManager->createIndex(tableName, pkCol, keyType, keyLength);
+            // 复合主键的单列索引会有重复值，只有单列主键才建唯一索引
+            indexManager->createIndex(tableName, pkCol, keyType, keyLength, primaryKey.size() == 1);
             tableMetas[tableName].indexes.push_back(pkCol);
         }
     }
+    // 复合主键另建一棵 (列1, 列2, ...) 的唯一组合索引，用于主键检查和前缀查找
+    if (primaryKey.size() > 1) {
+        createCompositeIndex(tableName, primaryKey, true);
+    }
     saveTableMeta(tableName);
     return true;
 }
@@ -417,6 +446,10 @@ bool SystemManager::dropTable(const std::string& tableName) {
     for (const auto& idx : meta.indexes) {
         indexManager->dropIndex(tableName, idx);
     }
+    for (const auto& idx : meta.hashIndexes) {
+        indexManager->dropHashIndex(tableName, idx);
+    }
+    indexManager->setBuffered(tableName, false);
     std::string dataPath = getTableDataPath(tableName);
     unlink(dataPath.c_str());
     std::string metaPath = getTableMetaPath(tableName);
@@ -452,7 +485,7 @@ TableMeta* SystemManager::getTableMeta(const std::string& tableName) {
     return nullptr;
 }
 bool SystemManager::createIndex(const std::string& tableName, const std::string& columnName,
-                                 const std::string& indexName) {
+                                 const std::string& indexName, bool unique) {
     if (!tableExists(tableName)) {
         return false;
     }
@@ -476,7 +509,11 @@ bool SystemManager::createIndex(const std::string& tableName, const std::string&
         keyLength = col->length;
     }
 
-    if (!indexManager->createIndex(tableName, columnName, keyType, keyLength)) {
+    if (!indexManager->createIndex(tableName, columnName, keyType, keyLength, unique)) {
+        return false;
+    }
+    if (!buildIndexes(tableName, {columnName})) {
+        indexManager->dropIndex(tableName, columnName);
         return false;
     }
     meta.indexes.push_back(columnName);
@@ -503,21 +540,257 @@ bool SystemManager::createIndex(const std::string& tableName, const std::string&
         idxInfo.name = indexName.empty() ? tableName + "_" + columnName + "_idx" : indexName;
         idxInfo.columns.push_back(columnName);
         idxInfo.isExplicit = true;
-        idxInfo.isUnique = false;
+        idxInfo.isUnique = unique;
         meta.explicitIndexes.push_back(idxInfo);
     }
     saveTableMeta(tableName);
     return true;
 }
+bool SystemManager::createIndex(const std::string& tableName, const std::vector<std::string>& columns,
+                                 const std::string& indexName, bool unique) {
+    if (columns.size() == 1) {
+        return createIndex(tableName, columns[0], indexName, unique);
+    }
+    if (!tableExists(tableName) || columns.empty()) {
+        return false;
+    }
+    TableMeta& meta = tableMetas[tableName];
+    for (const auto& idx : meta.explicitIndexes) {
+        if (idx.name == indexName) {
+            return false;
+        }
+    }
+    if (!createCompositeIndex(tableName, columns, unique)) {
+        return false;
+    }
+    IndexInfo idxInfo;
+    idxInfo.name = indexName;
+    idxInfo.columns = columns;
+    idxInfo.isExplicit = true;
+    idxInfo.isUnique = unique;
+    meta.explicitIndexes.push_back(idxInfo);
+    saveTableMeta(tableName);
+    return true;
+}
+bool SystemManager::buildKeyParts(const TableMeta& meta, const std::vector<std::string>& columns,
+                                  std::vector<KeyPart>& parts) {
+    std::set<std::string> seen;
+    for (const auto& colName : columns) {
+        const ColumnDef* col = meta.getColumn(colName);
+        if (!col || !seen.insert(colName).second) {
+            return false;
+        }
+        if (col->type == DataType::INT) {
+            parts.push_back(KeyPart(KeyType::INT));
+        } else if (col->type == DataType::FLOAT) {
+            parts.push_back(KeyPart(KeyType::FLOAT));
+        } else {
+            parts.push_back(KeyPart(KeyType::VARCHAR, col->length));
+        }
+    }
+    return !parts.empty() && parts.size() <= BP_MAX_KEY_PARTS;
+}
+bool SystemManager::createCompositeIndex(const std::string& tableName,
+                                         const std::vector<std::string>& columns, bool unique) {
+    TableMeta& meta = tableMetas[tableName];
+    std::string idxName = IndexManager::compositeName(columns);
+    std::vector<KeyPart> parts;
+    if (meta.hasIndex(idxName) || !buildKeyParts(meta, columns, parts)) {
+        return false;
+    }
+    if (!indexManager->createIndex(tableName, idxName, parts, unique)) {
+        return false;
+    }
+    if (!buildIndexes(tableName, {idxName})) {
+        indexManager->dropIndex(tableName, idxName);
+        return false;
+    }
+    meta.indexes.push_back(idxName);
+    return true;
+}
+// 从序列化记录中读出一列，列为 NULL 或越界时返回 false
+static bool readColumn(const ColumnDef& col, int colIdx, int offset, const char* bytes, int len,
+                       Value& value) {
+    unsigned int nullBitmap;
+    memcpy(&nullBitmap, bytes, 4);
+    if (colIdx < 32 && (nullBitmap & (1u << colIdx))) return false;
+    if (col.type == DataType::INT) {
+        if (offset + 4 > len) return false;
+        int v;
+        memcpy(&v, bytes + offset, 4);
+        value = Value(v);
+    } else if (col.type == DataType::FLOAT) {
+        if (offset + 8 > len) return false;
+        double v;
+        memcpy(&v, bytes + offset, 8);
+        value = Value(v);
+    } else {
+        if (offset + 4 > len) return false;
+        int strLen;
+        memcpy(&strLen, bytes + offset, 4);
+        strLen = std::max(0, std::min(strLen, len - offset - 4));
+        std::string str(bytes + offset + 4, strLen);
+        while (!str.empty() && str.back() == '\0') {
+            str.pop_back();
+        }
+        value = Value(str);
+    }
+    return true;
+}
+bool SystemManager::buildIndexes(const std::string& tableName, const std::vector<std::string>& indexNames) {
+    RecordManager* rm = getRecordManager(tableName);
+    TableMeta& meta = tableMetas[tableName];
+    if (!rm) {
+        return false;
+    }
+    struct Target {
+        BPlusTree* tree;
+        bool composite;
+        std::vector<int> colIdx;
+        std::vector<int> offsets;
+    };
+    std::vector<Target> targets;
+    for (const auto& idxName : indexNames) {
+        Target t;
+        t.tree = indexManager->openIndex(tableName, idxName);
+        t.composite = TableMeta::isCompositeIndex(idxName);
+        if (!t.tree) {
+            return false;
+        }
+        for (const auto& col : TableMeta::getIndexColumns(idxName)) {
+            int colIdx = meta.getColumnIndex(col);
+            if (colIdx < 0) {
+                return false;
+            }
+            t.colIdx.push_back(colIdx);
+            t.offsets.push_back(meta.getColumnOffset(colIdx));
+        }
+        targets.push_back(t);
+    }
+    // 一次扫描堆表，把每个索引的 (key, RID) 交给各自的批量建树器
+    rm->forEachRecord([&](int recordID, const unsigned int* data, int dataLen) {
+        const char* bytes = (const char*)data;
+        int len = dataLen * 4;
+        if (len < 4) return;
+        RID rid(0, recordID);
+        Value v;
+        for (auto& t : targets) {
+            if (!t.composite) {
+                const ColumnDef& col = meta.columns[t.colIdx[0]];
+                if (!readColumn(col, t.colIdx[0], t.offsets[0], bytes, len, v)) continue;
+                if (col.type == DataType::INT) {
+                    t.tree->bulkAdd(v.intVal, rid);
+                } else if (col.type == DataType::FLOAT) {
+                    t.tree->bulkAdd((float)v.floatVal, rid);
+                } else {
+                    t.tree->bulkAdd(v.strVal, rid);
+                }
+                continue;
+            }
+            // 任一列为 NULL 的记录不进组合索引
+            CompositeKey key;
+            bool complete = true;
+            for (size_t i = 0; i < t.colIdx.size() && complete; i++) {
+                const ColumnDef& col = meta.columns[t.colIdx[i]];
+                complete = readColumn(col, t.colIdx[i], t.offsets[i], bytes, len, v);
+                if (!complete) break;
+                if (col.type == DataType::INT) {
+                    key.addInt(v.intVal);
+                } else if (col.type == DataType::FLOAT) {
+                    key.addFloat((float)v.floatVal);
+                } else {
+                    key.addString(v.strVal);
+                }
+            }
+            if (complete) {
+                t.tree->bulkAdd(key, rid);
+            }
+        }
+    });
+    bool ok = true;
+    for (auto& t : targets) {
+        ok = t.tree->bulkBuild(indexFillFactor) && ok;
+    }
+    return ok;
+}
+bool SystemManager::createHashIndex(const std::string& tableName, const std::vector<std::string>& columns,
+                                    const std::string& indexName) {
+    if (!tableExists(tableName) || columns.size() != 1) {
+        return false;
+    }
+    TableMeta& meta = tableMetas[tableName];
+    const std::string& columnName = columns[0];
+    int colIdx = meta.getColumnIndex(columnName);
+    if (colIdx < 0 || meta.hasHashIndex(columnName)) {
+        return false;
+    }
+    for (const auto& idx : meta.explicitIndexes) {
+        if (idx.name == indexName) {
+            return false;
+        }
+    }
+    const ColumnDef& col = meta.columns[colIdx];
+    KeyType keyType = KeyType::VARCHAR;
+    if (col.type == DataType::INT) {
+        keyType = KeyType::INT;
+    } else if (col.type == DataType::FLOAT) {
+        keyType = KeyType::FLOAT;
+    }
+    RecordManager* rm = getRecordManager(tableName);
+    if (!rm || !indexManager->createHashIndex(tableName, columnName, keyType, col.length)) {
+        return false;
+    }
+    HashIndex* index = indexManager->openHashIndex(tableName, columnName);
+    if (!index) {
+        indexManager->dropHashIndex(tableName, columnName);
+        return false;
+    }
+    // 扫描一次堆表写入已有记录，NULL 不进索引
+    int offset = meta.getColumnOffset(colIdx);
+    rm->forEachRecord([&](int recordID, const unsigned int* data, int dataLen) {
+        Value v;
+        if (dataLen * 4 < 4 || !readColumn(col, colIdx, offset, (const char*)data, dataLen * 4, v)) return;
+        RID rid(0, recordID);
+        if (col.type == DataType::INT) {
+            index->insert(v.intVal, rid);
+        } else if (col.type == DataType::FLOAT) {
+            index->insert((float)v.floatVal, rid);
+        } else {
+            index->insert(v.strVal, rid);
+        }
+    });
+    meta.hashIndexes.push_back(columnName);
+    IndexInfo idxInfo;
+    idxInfo.name = indexName;
+    idxInfo.columns = columns;
+    idxInfo.isExplicit = true;
+    idxInfo.isHash = true;
+    meta.explicitIndexes.push_back(idxInfo);
+    saveTableMeta(tableName);
+    return true;
+}
 bool SystemManager::dropIndex(const std::string& tableName, const std::string& indexName) {
     if (!tableExists(tableName)) {
         return false;
     }
     TableMeta& meta = tableMetas[tableName];
+    for (auto it = meta.explicitIndexes.begin(); it != meta.explicitIndexes.end(); ++it) {
+        if (it->name == indexName && it->isHash && !it->columns.empty()) {
+            std::string column = it->columns[0];
+            meta.explicitIndexes.erase(it);
+            indexManager->dropHashIndex(tableName, column);
+            meta.hashIndexes.erase(std::remove(meta.hashIndexes.begin(), meta.hashIndexes.end(), column),
+                                   meta.hashIndexes.end());
+            saveTableMeta(tableName);
+            return true;
+        }
+    }
     std::string columnToRemove;
     for (auto it = meta.explicitIndexes.begin(); it != meta.explicitIndexes.end(); ++it) {
-        if (it->name == indexName) {
-            if (!it->columns.empty()) {
+        if (it->name == indexName && !it->isHash) {
+            if (it->columns.size() > 1) {
+                columnToRemove = IndexManager::compositeName(it->columns);
+            } else if (!it->columns.empty()) {
                 columnToRemove = it->columns[0];
             }
             meta.explicitIndexes.erase(it);
@@ -542,7 +815,7 @@ bool SystemManager::dropIndex(const std::string& tableName, const std::string& i
     }
     meta.indexes.erase(it);
     for (auto eit = meta.explicitIndexes.begin(); eit != meta.explicitIndexes.end(); ++eit) {
-        if (!eit->columns.empty() && eit->columns[0] == indexName) {
+        if (!eit->isHash && !eit->columns.empty() && eit->columns[0] == indexName) {
             meta.explicitIndexes.erase(eit);
             break;
         }
@@ -550,12 +823,50 @@ bool SystemManager::dropIndex(const std::string& tableName, const std::string& i
     saveTableMeta(tableName);
     return true;
 }
+bool SystemManager::optimizeIndex(const std::string& tableName, const std::string& indexName,
+                                  int& pagesBefore, int& pagesAfter) {
+    pagesBefore = 0;
+    pagesAfter = 0;
+    if (!tableExists(tableName)) {
+        return false;
+    }
+    const TableMeta& meta = tableMetas[tableName];
+    std::vector<std::string> targets;
+    if (indexName.empty()) {
+        targets = meta.indexes;
+    } else {
+        // 显式索引名换成索引文件对应的列名
+        std::string column = indexName;
+        for (const auto& idx : meta.explicitIndexes) {
+            if (idx.name == indexName && !idx.columns.empty()) {
+                column = IndexManager::compositeName(idx.columns);
+                break;
+            }
+        }
+        if (std::find(meta.indexes.begin(), meta.indexes.end(), column) == meta.indexes.end()) {
+            return false;
+        }
+        targets.push_back(column);
+    }
+    for (const auto& column : targets) {
+        int before = 0, after = 0;
+        if (!indexManager->optimizeIndex(tableName, column, indexFillFactor, before, after)) {
+            return false;
+        }
+        pagesBefore += before;
+        pagesAfter += after;
+    }
+    return true;
+}
 std::vector<std::string> SystemManager::showIndexes() {
     std::vector<std::string> indexes;
     for (const auto& pair : tableMetas) {
         for (const auto& idx : pair.second.indexes) {
             indexes.push_back(pair.first + "." + idx);
         }
+        for (const auto& idx : pair.second.hashIndexes) {
+            indexes.push_back(pair.first + "." + idx + " USING HASH");
+        }
     }
     
     return indexes;
@@ -577,7 +888,8 @@ bool SystemManager::addPrimaryKey(const std::string& tableName,
     meta.primaryKey = columns;
     meta.primaryKeyColumns = columns; 
     
-    // 创建索引
+    // 先建好各个空索引，再扫描一次堆表批量写入
+    std::vector<std::string> newIndexes;
     for (const auto& col : columns) {
         if (!meta.hasIndex(col)) {
             const ColumnDef* colDef = meta.getColumn(col);
@@ -592,96 +904,30 @@ bool SystemManager::addPrimaryKey(const std::string& tableName,
                     keyType = KeyType::VARCHAR;
                     keyLength = colDef->length;
                 }
-                indexManager->createIndex(tableName, col, keyType, keyLength);
-                meta.indexes.push_back(col);
+                if (indexManager->createIndex(tableName, col, keyType, keyLength, columns.size() == 1)) {
+                    newIndexes.push_back(col);
+                }
             }
         }
     }
-    
-    // 填充索引：将现有记录插入到新创建的索引中
-    // 使用 getAllRecordsDirect 来避免内存限制
-    RecordManager* rm = getRecordManager(tableName);
-    if (rm && indexManager) {
-        // 使用 getAllRecordsDirect 批量读取所有记录
-        std::vector<int> recordIDs;
-        std::vector<std::vector<char>> records;
-        int count = rm->getAllRecordsDirect(recordIDs, records);
-        
-        for (int i = 0; i < count; i++) {
-            // 反序列化记录
-            std::vector<Value> values;
-            const char* buffer = records[i].data();
-            int len = records[i].size();
-            unsigned int nullBitmap;
-            if (len >= 4) {
-                memcpy(&nullBitmap, buffer, 4);
-                int pos = 4;
-                
-                for (size_t j = 0; j < meta.columns.size(); j++) {
-                    const ColumnDef& col = meta.columns[j];
-                    bool isNull = (nullBitmap & (1 << j)) != 0;
-                    
-                    if (col.type == DataType::INT) {
-                        if (pos + 4 <= len) {
-                            if (isNull) {
-                                values.push_back(Value::makeNull());
-                            } else {
-                                int v;
-                                memcpy(&v, buffer + pos, 4);
-                                values.push_back(Value(v));
-                            }
-                            pos += 4;
-                        }
-                    } else if (col.type == DataType::FLOAT) {
-                        if (pos + 4 <= len) {
-                            if (isNull) {
-                                values.push_back(Value::makeNull());
-                            } else {
-                                float v;
-                                memcpy(&v, buffer + pos, 4);
-                                values.push_back(Value(v));
-                            }
-                            pos += 4;
-                        }
-                    } else if (col.type == DataType::VARCHAR) {
-                        if (pos + 4 <= len) {
-                            int strLen;
-                            memcpy(&strLen, buffer + pos, 4);
-                            pos += 4;
-                            
-                            if (isNull) {
-                                values.push_back(Value::makeNull());
-                            } else {
-                                if (pos + strLen <= len) {
-                                    std::string str(buffer + pos, strLen);
-                                    while (!str.empty() && str.back() == '\0') {
-                                        str.pop_back();
-                                    }
-                                    values.push_back(Value(str));
-                                }
-                            }
-                            pos += col.length;
-                        }
-                    }
-                }
-                
-                // 将记录插入到索引中
-                for (const auto& pkCol : columns) {
-                    int colIdx = meta.getColumnIndex(pkCol);
-                    if (colIdx >= 0 && colIdx < (int)values.size() && !values[colIdx].isNull) {
-                        RID rid(0, recordIDs[i]);
-                        if (meta.columns[colIdx].type == DataType::INT) {
-                            indexManager->insertEntry(tableName, pkCol, values[colIdx].intVal, rid);
-                        } else if (meta.columns[colIdx].type == DataType::FLOAT) {
-                            indexManager->insertEntry(tableName, pkCol, values[colIdx].floatVal, rid);
-                        } else {
-                            indexManager->insertEntry(tableName, pkCol, values[colIdx].strVal, rid);
-                        }
-                    }
-                }
-            }
+    if (columns.size() > 1) {
+        std::string idxName = IndexManager::compositeName(columns);
+        std::vector<KeyPart> parts;
+        if (!meta.hasIndex(idxName) && buildKeyParts(meta, columns, parts) &&
+            indexManager->createIndex(tableName, idxName, parts, true)) {
+            newIndexes.push_back(idxName);
         }
     }
+    if (!buildIndexes(tableName, newIndexes)) {
+        for (const auto& idx : newIndexes) {
+            indexManager->dropIndex(tableName, idx);
+        }
+        meta.primaryKey.clear();
+        meta.primaryKeyColumns.clear();
+        saveTableMeta(tableName);
+        return false;
+    }
+    meta.indexes.insert(meta.indexes.end(), newIndexes.begin(), newIndexes.end());
     
     saveTableMeta(tableName);
     return true;
@@ -695,6 +941,14 @@ bool SystemManager::dropPrimaryKey(const std::string& tableName) {
     if (meta.primaryKey.empty() && meta.primaryKeyColumns.empty()) {
         return false;
     }
+    if (meta.primaryKey.size() > 1) {
+        std::string idxName = IndexManager::compositeName(meta.primaryKey);
+        auto it = std::find(meta.indexes.begin(), meta.indexes.end(), idxName);
+        if (it != meta.indexes.end()) {
+            indexManager->dropIndex(tableName, idxName);
+            meta.indexes.erase(it);
+        }
+    }
     meta.primaryKey.clear();
     meta.primaryKeyColumns.clear();
     saveTableMeta(tableName);
@@ -736,6 +990,48 @@ bool SystemManager::dropForeignKey(const std::string& tableName, const std::stri
     
     return false;
 }
+bool SystemManager::compressTable(const std::string& tableName, int& pagesBefore, int& pagesAfter) {
+    RecordManager* rm = getRecordManager(tableName);
+    if (!rm) {
+        return false;
+    }
+    return rm->compressColdPages(pagesBefore, pagesAfter);
+}
+bool SystemManager::vacuumTable(const std::string& tableName, VacuumStats& stats) {
+    RecordManager* rm = getRecordManager(tableName);
+    if (!rm || !rm->vacuum(stats)) {
+        return false;
+    }
+    // 索引中保存的是逻辑 recordID，记录搬移后无需更新；顺便校正记录数
+    TableMeta& meta = tableMetas[tableName];
+    meta.recordCount = (int)stats.liveRecords;
+    saveTableMeta(tableName);
+    return true;
+}
+bool SystemManager::setIndexMode(const std::string& tableName, bool buffered) {
+    if (currentDB.empty() || !tableExists(tableName)) {
+        return false;
+    }
+    TableMeta& meta = tableMetas[tableName];
+    if (!buffered) {
+        for (const auto& idx : meta.indexes) {
+            if (!indexManager->unbufferIndex(tableName, idx)) {
+                return false;
+            }
+        }
+    }
+    indexManager->setBuffered(tableName, buffered);
+    meta.bufferedIndexes = buffered;
+    return saveTableMeta(tableName);
+}
+bool SystemManager::needsAutoVacuum(const std::string& tableName) {
+    auto it = tableRecordManagers.find(tableName);
+    if (it == tableRecordManagers.end()) {
+        return false;
+    }
+    int dead = it->second->getDeadSinceVacuum();
+    return dead >= AUTOVACUUM_MIN_DEAD && dead * 4LL >= tableMetas[tableName].recordCount;
+}
 RecordManager* SystemManager::getRecordManager(const std::string& tableName) {
     if (!tableExists(tableName)) {
         return nullptr;
@@ -16,7 +16,8 @@ struct IndexInfo {
     std::vector<std::string> columns;
     bool isExplicit;
     bool isUnique;
-    IndexInfo() : isExplicit(true), isUnique(false) {}
+    bool isHash;            // USING HASH 建的哈希索引
+    IndexInfo() : isExplicit(true), isUnique(false), isHash(false) {}
 };
 struct TableMeta {
     std::string tableName;
@@ -25,11 +26,13 @@ struct TableMeta {
     std::vector<std::string> primaryKeyColumns;
     std::vector<KeyDef> foreignKeys;
     std::vector<std::string> indexes;
+    std::vector<std::string> hashIndexes;   // 建有哈希索引的列
     std::vector<IndexInfo> explicitIndexes;
     std::vector<IndexInfo> uniqueConstraints;
     int recordCount;
     int nextRecordID;
-    TableMeta() : recordCount(0), nextRecordID(1) {}
+    bool bufferedIndexes;   // 索引插入先进写优化缓冲（ALTER TABLE ... SET INDEX_MODE BUFFERED）
+    TableMeta() : recordCount(0), nextRecordID(1), bufferedIndexes(false) {}
     int getColumnIndex(const std::string& colName) const {
         for (size_t i = 0; i < columns.size(); i++) {
             if (columns[i].name == colName) {
@@ -46,6 +49,21 @@ struct TableMeta {
         }
         return nullptr;
     }
+    // 列在序列化记录中的字节偏移，不存在时返回 -1
+    int getColumnOffset(int colIdx) const {
+        if (colIdx < 0 || colIdx >= (int)columns.size()) return -1;
+        int offset = 4;
+        for (int i = 0; i < colIdx; i++) {
+            if (columns[i].type == DataType::INT) {
+                offset += 4;
+            } else if (columns[i].type == DataType::FLOAT) {
+                offset += 8;
+            } else if (columns[i].type == DataType::VARCHAR) {
+                offset += columns[i].length + 4;
+            }
+        }
+        return offset;
+    }
     int calculateRecordSize() const {
         int size = 4;
         for (const auto& col : columns) {
@@ -65,6 +83,27 @@ struct TableMeta {
         }
         return false;
     }
+    bool hasHashIndex(const std::string& colName) const {
+        for (const auto& idx : hashIndexes) {
+            if (idx == colName) return true;
+        }
+        return false;
+    }
+    // 组合索引在 indexes 中记为 "a+b"，拆出各列；单列索引返回只含该列的列表
+    static std::vector<std::string> getIndexColumns(const std::string& idx) {
+        std::vector<std::string> cols;
+        size_t start = 0;
+        size_t pos;
+        while ((pos = idx.find('+', start)) != std::string::npos) {
+            cols.push_back(idx.substr(start, pos - start));
+            start = pos + 1;
+        }
+        cols.push_back(idx.substr(start));
+        return cols;
+    }
+    static bool isCompositeIndex(const std::string& idx) {
+        return idx.find('+') != std::string::npos;
+    }
     bool isPrimaryKey(const std::string& colName) const {
         for (const auto& pk : primaryKey) {
             if (pk == colName) return true;
@@ -88,12 +127,21 @@ private:
     std::map<std::string, std::unique_ptr<RecordManager>> tableRecordManagers;
     std::map<std::string, int> tableFileIDs;
     std::unique_ptr<IndexManager> indexManager;
+    int indexFillFactor;    // 批量建索引时节点的填充率（%）
     bool createDirectory(const std::string& path);
     bool removeDirectory(const std::string& path);
     bool saveTableMeta(const std::string& tableName);
     bool loadTableMeta(const std::string& tableName);
     std::string getTableDataPath(const std::string& tableName);
     std::string getTableMetaPath(const std::string& tableName);
+    // 扫描一次堆表，把已有记录批量写入这些新建的空索引（名字同 TableMeta::indexes）；
+    // 唯一索引遇到重复键时返回 false
+    bool buildIndexes(const std::string& tableName, const std::vector<std::string>& indexNames);
+    // 组合索引：按列顺序生成 KeyPart
+    bool buildKeyParts(const TableMeta& meta, const std::vector<std::string>& columns,
+                       std::vector<KeyPart>& parts);
+    bool createCompositeIndex(const std::string& tableName, const std::vector<std::string>& columns,
+                              bool unique);
 
 public:
     SystemManager(FileManager* fm, BufPageManager* bpm, const std::string& dir = "./data");
@@ -112,16 +160,33 @@ public:
     TableMeta describeTable(const std::string& tableName);
     bool tableExists(const std::string& tableName);
     TableMeta* getTableMeta(const std::string& tableName);
+    // unique 为 false 时建可重复键的二级索引；会把表中已有记录写入索引
     bool createIndex(const std::string& tableName, const std::string& columnName,
-                     const std::string& indexName = "");
+                     const std::string& indexName = "", bool unique = false);
+    // 多列时建组合索引
+    bool createIndex(const std::string& tableName, const std::vector<std::string>& columns,
+                     const std::string& indexName, bool unique = false);
+    // 单列哈希索引，只用于等值查找；同一列上可以同时有 B+ 树索引
+    bool createHashIndex(const std::string& tableName, const std::vector<std::string>& columns,
+                         const std::string& indexName);
     bool dropIndex(const std::string& tableName, const std::string& indexName);
     std::vector<std::string> showIndexes();
+    // 整理索引（indexName 为空时整理表上全部索引），页数为各索引文件之和
+    bool optimizeIndex(const std::string& tableName, const std::string& indexName,
+                       int& pagesBefore, int& pagesAfter);
     bool addPrimaryKey(const std::string& tableName, const std::vector<std::string>& columns);
     bool dropPrimaryKey(const std::string& tableName);
     bool addForeignKey(const std::string& tableName, const KeyDef& fk);
     bool dropForeignKey(const std::string& tableName, const std::string& fkName);
+    bool compressTable(const std::string& tableName, int& pagesBefore, int& pagesAfter);
+    bool vacuumTable(const std::string& tableName, VacuumStats& stats);
+    bool needsAutoVacuum(const std::string& tableName);
+    // 切换表上 B+ 树索引的写入方式；切回直接写入时先把缓冲并入各索引
+    bool setIndexMode(const std::string& tableName, bool buffered);
     RecordManager* getRecordManager(const std::string& tableName);
     IndexManager* getIndexManager() { return indexManager.get(); }
+    void setIndexFillFactor(int percent) { indexFillFactor = percent; }
+    int getIndexFillFactor() const { return indexFillFactor; }
     BufPageManager* getBufPageManager() { return bufPageManager; }
     int getTableFileID(const std::string& tableName) {
         auto it = tableFileIDs.find(tableName);
@@ -0,0 +1,434 @@
+// B+ 树节点内查找的微基准
+// 1. 单个满节点（INT 阶数个键）上各查找内核的耗时
+// 2. 不同高度的树上 search() 的单次耗时，分别用各内核跑一遍
+// 3. 逐条 insert 建树与 bulkAdd/bulkBuild 批量建树的耗时和节点数，键分随机和递增两种顺序
+// 4. 等值查找：哈希索引与 B+ 树的单次耗时
+// 5. 多线程访问：1 个到硬件线程数个线程同时查找、查找夹插入的吞吐量
+// 6. 随机键逐条插入：直接插入 B+ 树与经写优化缓冲插入（含最后并入）的耗时
+// 用法：bench_btree [临时目录]
+#include "../index/BPlusTree.h"
+#include "../index/KeySearch.h"
+#include "../index/HashIndex.h"
+#include "../index/IndexBuffer.h"
+#include "../filesystem/utils/MyBitMap.h"
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <thread>
+
+static const int PROBES = 200000;
+static const int KERNELS[] = {SEARCH_KERNEL_SCALAR, SEARCH_KERNEL_SSE4, SEARCH_KERNEL_AVX2};
+
+static double nowNs() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void benchNode() {
+    const int n = 677;
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; i++) keys[i] = i * 3;
+    std::mt19937 rng(42);
+    std::vector<int> probes(PROBES);
+    for (int i = 0; i < PROBES; i++) probes[i] = (int)(rng() % (n * 3));
+
+    printf("== single node, %d INT keys ==\n", n);
+    double start = nowNs();
+    long long sink = 0;
+    for (int p : probes) {
+        int i = 0;
+        while (i < n && keys[i] < p) i++;
+        sink += i;
+    }
+    printf("  %-8s %8.1f ns/search\n", "linear", (nowNs() - start) / PROBES);
+    for (int k : KERNELS) {
+        if (KeySearch::setKernel(k) != k) continue;
+        start = nowNs();
+        for (int p : probes) sink += KeySearch::searchInt(keys.data(), n, p, false);
+        printf("  %-8s %8.1f ns/search\n", KeySearch::kernelName(k), (nowNs() - start) / PROBES);
+    }
+    if (sink == 42) printf("\n");
+}
+
+static void benchTree(const std::string& dir, KeyType type, int keyLen, int rows) {
+    FileManager* fm = new FileManager();
+    BufPageManager* bpm = new BufPageManager(fm);
+    std::string path = dir + "/bench_btree.idx";
+    remove(path.c_str());
+    fm->createFile(path.c_str());
+    int fileID;
+    fm->openFile(path.c_str(), fileID);
+    BPlusTree tree(fm, bpm, fileID, type, keyLen);
+    tree.initialize();
+
+    std::vector<int> order(rows);
+    for (int i = 0; i < rows; i++) order[i] = i;
+    std::mt19937 rng(7);
+    std::shuffle(order.begin(), order.end(), rng);
+    char buf[32];
+    for (int i = 0; i < rows; i++) {
+        if (type == KeyType::INT) {
+            tree.insert(order[i], RID(0, i));
+        } else {
+            snprintf(buf, sizeof(buf), "key-%010d", order[i]);
+            tree.insert(std::string(buf), RID(0, i));
+        }
+    }
+    int nodes, records, height;
+    tree.getStatistics(nodes, records, height);
+    printf("== %s tree, %d rows, height %d, %d nodes ==\n",
+           type == KeyType::INT ? "INT" : "VARCHAR", rows, height, nodes);
+
+    std::vector<int> probes(PROBES);
+    for (int i = 0; i < PROBES; i++) probes[i] = (int)(rng() % rows);
+    std::vector<std::string> strProbes;
+    if (type != KeyType::INT) {
+        for (int p : probes) {
+            snprintf(buf, sizeof(buf), "key-%010d", p);
+            strProbes.push_back(buf);
+        }
+    }
+    for (int k : KERNELS) {
+        if (KeySearch::setKernel(k) != k) continue;
+        if (type != KeyType::INT && k != SEARCH_KERNEL_SCALAR) continue;
+        RID rid;
+        int found = 0;
+        double start = nowNs();
+        for (int i = 0; i < PROBES; i++) {
+            if (type == KeyType::INT) found += tree.search(probes[i], rid);
+            else found += tree.search(strProbes[i], rid);
+        }
+        printf("  %-8s %8.1f ns/lookup (%d found)\n", type == KeyType::INT ? KeySearch::kernelName(k) : "binary",
+               (nowNs() - start) / PROBES, found);
+    }
+    KeySearch::setKernel(SEARCH_KERNEL_AUTO);
+    bpm->close();
+    fm->closeFile(fileID);
+    remove(path.c_str());
+    delete bpm;
+    delete fm;
+}
+
+static void benchBuild(const std::string& dir, int rows, bool ascending) {
+    FileManager* fm = new FileManager();
+    BufPageManager* bpm = new BufPageManager(fm);
+    std::vector<int> keys(rows);
+    for (int i = 0; i < rows; i++) keys[i] = i;
+    std::mt19937 rng(11);
+    if (!ascending) std::shuffle(keys.begin(), keys.end(), rng);
+    printf("== build INT index, %d rows (%s order) ==\n", rows, ascending ? "ascending" : "random");
+    for (int mode = 0; mode < 2; mode++) {
+        std::string path = dir + "/bench_build.idx";
+        remove(path.c_str());
+        fm->createFile(path.c_str());
+        int fileID;
+        fm->openFile(path.c_str(), fileID);
+        BPlusTree tree(fm, bpm, fileID, KeyType::INT, 0);
+        tree.initialize(false);
+        double start = nowNs();
+        if (mode == 0) {
+            for (int i = 0; i < rows; i++) tree.insert(keys[i], RID(0, i));
+        } else {
+            for (int i = 0; i < rows; i++) tree.bulkAdd(keys[i], RID(0, i));
+            tree.bulkBuild();
+        }
+        double ms = (nowNs() - start) / 1e6;
+        int nodes, records, height;
+        tree.getStatistics(nodes, records, height);
+        int found = 0;
+        for (int i = 0; i < rows; i += 97) {
+            found += (int)tree.rangeSearch(keys[i], keys[i]).size();
+        }
+        printf("  %-8s %8.1f ms, %d nodes, height %d, %d/%d probes found\n", mode == 0 ? "insert" : "bulk",
+               ms, nodes, height, found, (rows + 96) / 97);
+        bpm->close();
+        fm->closeFile(fileID);
+        remove(path.c_str());
+    }
+    delete bpm;
+    delete fm;
+}
+
+// 区间计数：子树计数沿两端下降，对比沿叶子逐条数
+static void benchCount(const std::string& dir, int rows) {
+    FileManager* fm = new FileManager();
+    BufPageManager* bpm = new BufPageManager(fm);
+    std::string path = dir + "/bench_count.idx";
+    remove(path.c_str());
+    fm->createFile(path.c_str());
+    int fileID;
+    fm->openFile(path.c_str(), fileID);
+    BPlusTree tree(fm, bpm, fileID, KeyType::INT, 0);
+    tree.initialize(false);
+    for (int i = 0; i < rows; i++) tree.bulkAdd(i, RID(0, i));
+    tree.bulkBuild();
+    printf("== range COUNT on INT index, %d rows ==\n", rows);
+    std::mt19937 rng(13);
+    const int queries = 200;
+    std::vector<std::pair<int, int>> ranges(queries);
+    for (auto& r : ranges) {
+        r.first = rng() % rows;
+        r.second = r.first + (int)(rng() % (rows / 4));
+    }
+    for (int mode = 0; mode < 2; mode++) {
+        long long total = 0;
+        double start = nowNs();
+        for (const auto& r : ranges) {
+            if (mode == 0) {
+                total += tree.countRange(&r.first, &r.second);
+            } else {
+                for (BPlusCursor c = tree.openCursor(&r.first, &r.second); c.valid(); c.next()) total++;
+            }
+        }
+        double us = (nowNs() - start) / 1e3 / queries;
+        printf("  %-8s %10.1f us/query, %lld entries counted\n", mode == 0 ? "counts" : "scan", us, total);
+    }
+    bpm->close();
+    fm->closeFile(fileID);
+    remove(path.c_str());
+    delete bpm;
+    delete fm;
+}
+
+static void benchHashProbe(const std::string& dir, KeyType type, int rows) {
+    FileManager* fm = new FileManager();
+    BufPageManager* bpm = new BufPageManager(fm);
+    std::string treePath = dir + "/bench_probe.idx";
+    std::string hashPath = dir + "/bench_probe.hash";
+    remove(treePath.c_str());
+    remove(hashPath.c_str());
+    fm->createFile(treePath.c_str());
+    fm->createFile(hashPath.c_str());
+    int treeID, hashID;
+    fm->openFile(treePath.c_str(), treeID);
+    fm->openFile(hashPath.c_str(), hashID);
+    int keyLen = type == KeyType::VARCHAR ? 32 : 0;
+    BPlusTree tree(fm, bpm, treeID, type, keyLen);
+    tree.initialize(true);
+    HashIndex hash(fm, bpm, hashID, type, keyLen);
+    hash.initialize();
+    auto keyOf = [](int i) { return "user-" + std::to_string(i * 2654435761u); };
+    for (int i = 0; i < rows; i++) {
+        if (type == KeyType::INT) {
+            tree.bulkAdd(i * 7, RID(0, i));
+            hash.insert(i * 7, RID(0, i));
+        } else {
+            tree.bulkAdd(keyOf(i), RID(0, i));
+            hash.insert(keyOf(i), RID(0, i));
+        }
+    }
+    tree.bulkBuild();
+    printf("== equality probe on %s keys, %d rows (hash depth %d) ==\n",
+           type == KeyType::INT ? "INT" : "VARCHAR", rows, hash.getGlobalDepth());
+    std::mt19937 rng(17);
+    std::vector<int> probes(PROBES);
+    for (auto& p : probes) p = rng() % rows;
+    std::vector<std::string> strProbes;
+    if (type == KeyType::VARCHAR) {
+        for (int p : probes) strProbes.push_back(keyOf(p));
+    }
+    for (int mode = 0; mode < 2; mode++) {
+        long long found = 0;
+        double start = nowNs();
+        for (int i = 0; i < PROBES; i++) {
+            RID rid;
+            if (type == KeyType::INT) {
+                found += mode == 0 ? (long long)hash.lookup(probes[i] * 7).size() : tree.search(probes[i] * 7, rid);
+            } else {
+                found += mode == 0 ? (long long)hash.lookup(strProbes[i]).size() : tree.search(strProbes[i], rid);
+            }
+        }
+        double ns = (nowNs() - start) / PROBES;
+        printf("  %-8s %10.1f ns/probe, %lld found\n", mode == 0 ? "hash" : "btree", ns, found);
+    }
+    bpm->close();
+    fm->closeFile(treeID);
+    fm->closeFile(hashID);
+    remove(treePath.c_str());
+    remove(hashPath.c_str());
+    delete bpm;
+    delete fm;
+}
+
+// 布隆过滤器：同一棵树上查不存在的奇数键和存在的偶数键，比较有无过滤器
+static void benchFilter(const std::string& dir, KeyType type, int rows) {
+    FileManager* fm = new FileManager();
+    BufPageManager* bpm = new BufPageManager(fm);
+    std::string path = dir + "/bench_filter.idx";
+    remove(path.c_str());
+    fm->createFile(path.c_str());
+    int fileID;
+    fm->openFile(path.c_str(), fileID);
+    int keyLen = type == KeyType::VARCHAR ? 32 : 0;
+    BPlusTree tree(fm, bpm, fileID, type, keyLen);
+    tree.initialize(true);
+    auto keyOf = [](int i) { return "user-" + std::to_string(i * 2654435761u); };
+    for (int i = 0; i < rows; i++) {
+        if (type == KeyType::INT) tree.bulkAdd(i * 2, RID(0, i));
+        else tree.bulkAdd(keyOf(i * 2), RID(0, i));
+    }
+    tree.bulkBuild();
+    printf("== bloom filter on %s keys, %d rows ==\n", type == KeyType::INT ? "INT" : "VARCHAR", rows);
+    std::mt19937 rng(23);
+    std::vector<int> probes(PROBES);
+    for (auto& p : probes) p = rng() % rows;
+    std::vector<std::string> strProbes[2];
+    if (type == KeyType::VARCHAR) {
+        for (int p : probes) {
+            strProbes[0].push_back(keyOf(p * 2 + 1));
+            strProbes[1].push_back(keyOf(p * 2));
+        }
+    }
+    for (int on = 0; on < 2; on++) {
+        if (on) tree.enableFilter();
+        for (int present = 0; present < 2; present++) {
+            long long found = 0;
+            double start = nowNs();
+            for (int i = 0; i < PROBES; i++) {
+                RID rid;
+                if (type == KeyType::INT) {
+                    found += tree.search(probes[i] * 2 + 1 - present, rid);
+                } else {
+                    found += tree.search(strProbes[present][i], rid);
+                }
+            }
+            double ns = (nowNs() - start) / PROBES;
+            printf("  filter %-3s %-7s %8.1f ns/probe, %lld found\n", on ? "on" : "off",
+                   present ? "present" : "absent", ns, found);
+        }
+    }
+    bpm->close();
+    fm->closeFile(fileID);
+    remove(path.c_str());
+    delete bpm;
+    delete fm;
+}
+
+// 索引大于页缓存时，随机键直接插入每条都要下降到一个随机叶子，缓存里放不下的页反复换出换入；
+// 经缓冲时按段归并后有序插入，相邻的键落在同一个叶子上
+static void benchBuffered(const std::string& dir, int keyLen, int rows) {
+    std::mt19937 rng(31);
+    std::vector<std::string> keys(rows);
+    for (int i = 0; i < rows; i++) {
+        keys[i] = std::to_string(rng()) + "-" + std::to_string(i);
+        keys[i].resize(keyLen, '.');
+    }
+    printf("== random inserts, VARCHAR(%d) keys, %d rows ==\n", keyLen, rows);
+    for (int buffered = 0; buffered < 2; buffered++) {
+        FileManager* fm = new FileManager();
+        BufPageManager* bpm = new BufPageManager(fm);
+        std::string path = dir + "/bench_buffer.idx";
+        remove(path.c_str());
+        fm->createFile(path.c_str());
+        int fileID;
+        fm->openFile(path.c_str(), fileID);
+        BPlusTree tree(fm, bpm, fileID, KeyType::VARCHAR, keyLen);
+        tree.initialize(false);
+        std::unique_ptr<IndexBuffer> buffer;
+        if (buffered) {
+            IndexBuffer::removeFiles(dir + "/bench_buffer");
+            buffer = std::make_unique<IndexBuffer>(&tree, dir + "/bench_buffer");
+            buffer->open();
+        }
+        double start = nowNs();
+        for (int i = 0; i < rows; i++) {
+            if (buffer) buffer->insert(keys[i], RID(0, i));
+            else tree.insert(keys[i], RID(0, i));
+        }
+        double inserted = nowNs();
+        if (buffer) buffer->merge();
+        bpm->close();
+        double end = nowNs();
+        int nodeCount, recordCount, height;
+        tree.getStatistics(nodeCount, recordCount, height);
+        bpm->close();
+        printf("  %-8s %8.0f ns/insert (insert %.0f ms, merge+flush %.0f ms), %d entries\n",
+               buffered ? "buffered" : "direct", (end - start) / rows, (inserted - start) / 1e6,
+               (end - inserted) / 1e6, recordCount);
+        if (buffer) buffer->discard();
+        fm->closeFile(fileID);
+        remove(path.c_str());
+        delete bpm;
+        delete fm;
+    }
+}
+
+// 每轮重建同一棵树，各线程查找已有的偶数键；mixed 中每 5 次操作有 1 次插入各自的奇数键
+// threads 为 off 时不打开多线程访问，作为加锁开销的参照
+static void benchConcurrent(const std::string& dir, int rows) {
+    const int ops = 200000;
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+    printf("== concurrent INT index, %d rows, %d ops per thread ==\n", rows, ops);
+    printf("  %-8s %12s %12s\n", "threads", "lookup", "mixed");
+    for (int round = -1; round < (int)counts.size(); round++) {
+        int threads = round < 0 ? 1 : counts[round];
+        double mops[2];
+        for (int mode = 0; mode < 2; mode++) {
+            FileManager* fm = new FileManager();
+            BufPageManager* bpm = new BufPageManager(fm);
+            std::string path = dir + "/bench_concurrent.idx";
+            remove(path.c_str());
+            fm->createFile(path.c_str());
+            int fileID;
+            fm->openFile(path.c_str(), fileID);
+            BPlusTree tree(fm, bpm, fileID, KeyType::INT, 0);
+            tree.initialize(true);
+            for (int i = 0; i < rows; i++) tree.bulkAdd(i * 2, RID(0, i));
+            tree.bulkBuild();
+            tree.setConcurrent(round >= 0);
+            std::vector<std::thread> workers;
+            double start = nowNs();
+            for (int t = 0; t < threads; t++) {
+                workers.emplace_back([&tree, t, threads, rows, mode]() {
+                    std::mt19937 rng(100 + t);
+                    int inserted = 0;
+                    for (int i = 0; i < ops; i++) {
+                        if (mode == 1 && i % 5 == 0) {
+                            // 各线程的奇数键互不相同，散布在整个键空间
+                            int slot = (int)(((long long)(inserted++) * threads + t) * 7919 % rows);
+                            tree.insert(slot * 2 + 1, RID(1, i));
+                        } else {
+                            RID rid;
+                            tree.search((int)(rng() % rows) * 2, rid);
+                        }
+                    }
+                });
+            }
+            for (auto& w : workers) w.join();
+            mops[mode] = (double)ops * threads / ((nowNs() - start) / 1e3);
+            bpm->close();
+            fm->closeFile(fileID);
+            remove(path.c_str());
+            delete bpm;
+            delete fm;
+        }
+        char label[16];
+        if (round < 0) snprintf(label, sizeof(label), "off");
+        else snprintf(label, sizeof(label), "%d", threads);
+        printf("  %-8s %8.2f M/s %8.2f M/s\n", label, mops[0], mops[1]);
+    }
+}
+
+int main(int argc, char** argv) {
+    MyBitMap::initConst();
+    std::string dir = argc > 1 ? argv[1] : "/tmp";
+    printf("best kernel: %s\n", KeySearch::kernelName(KeySearch::setKernel(SEARCH_KERNEL_AUTO)));
+    benchNode();
+    benchTree(dir, KeyType::INT, 0, 50000);
+    benchTree(dir, KeyType::INT, 0, 1000000);
+    benchTree(dir, KeyType::VARCHAR, 120, 20000);
+    benchTree(dir, KeyType::VARCHAR, 120, 200000);
+    benchBuild(dir, 1000000, false);
+    benchBuild(dir, 1000000, true);
+    benchCount(dir, 1000000);
+    benchHashProbe(dir, KeyType::INT, 1000000);
+    benchHashProbe(dir, KeyType::VARCHAR, 200000);
+    benchFilter(dir, KeyType::INT, 1000000);
+    benchFilter(dir, KeyType::VARCHAR, 200000);
+    benchConcurrent(dir, 1000000);
+    benchBuffered(dir, 120, 1000000);
+    return 0;
+}
@@ -0,0 +1,217 @@
+// B+ 树多线程访问的压力测试
+// 几个线程在只有 64 个缓存页面的缓冲池上同时做 insert / remove / search，键分 INT 和 VARCHAR，
+// 树分唯一和允许重复两种；每个线程只改自己的键（键 % 线程数 == 线程号），
+// 每做一步就拿自己的参照集合核对，线程都结束后再核对整棵树的条目数和区间计数
+// 用法：test_concurrent [临时目录]
+#include "../index/BPlusTree.h"
+#include "../filesystem/utils/MyBitMap.h"
+#include <iostream>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+#include <atomic>
+
+#define TEST_CASE(name) std::cout << "\n=== Test: " << name << " ===" << std::endl
+#define ASSERT_TRUE(cond, msg) do { \
+    if (!(cond)) { \
+        std::cerr << "FAILED: " << msg << std::endl; \
+        return false; \
+    } \
+    std::cout << "  PASS: " << msg << std::endl; \
+} while(0)
+
+static const int POOL_FRAMES = 64;
+static const int THREADS = 4;
+static const int KEYS_PER_THREAD = 20000;
+static const int OPS_PER_THREAD = 80000;
+static const int MAX_DUPS = 3;
+
+static std::string varcharKey(int k) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "key-%09d-padding", k);
+    return buf;
+}
+
+// 一个线程的参照集合：键 -> 该键下的 RID（唯一树至多一个），RID 的页号就是键
+typedef std::map<int, std::set<std::pair<int, int>>> RefSet;
+
+template <typename K>
+class StressRun {
+public:
+    StressRun(BPlusTree* t, bool u, K (*m)(int)) : tree(t), unique(u), makeKey(m), bad(0) {}
+
+    void worker(int id, RefSet& ref) {
+        std::mt19937 rng(17 + id);
+        int seq = 1;
+        for (int op = 0; op < OPS_PER_THREAD; op++) {
+            int k = (int)(rng() % KEYS_PER_THREAD) * THREADS + id;
+            K key = makeKey(k);
+            std::set<std::pair<int, int>>& rids = ref[k];
+            int kind = rng() % 10;
+            if (kind < 4) {
+                if (unique) {
+                    // 已有的键再插入要失败
+                    bool ok = tree->insert(key, RID(k, seq));
+                    if (ok != rids.empty()) bad++;
+                    if (ok) rids.insert(std::make_pair(k, seq));
+                } else if ((int)rids.size() < MAX_DUPS) {
+                    if (!tree->insert(key, RID(k, seq))) bad++;
+                    rids.insert(std::make_pair(k, seq));
+                }
+                seq++;
+            } else if (kind < 7) {
+                if (unique) {
+                    if (tree->remove(key) != !rids.empty()) bad++;
+                    rids.clear();
+                } else if (!rids.empty()) {
+                    std::pair<int, int> victim = *rids.begin();
+                    if (!tree->remove(key, RID(victim.first, victim.second))) bad++;
+                    rids.erase(rids.begin());
+                } else if (tree->remove(key, RID(k, 0))) {
+                    bad++;
+                }
+            }
+            // 自己的键：找到与否和找到的 RID 都要与参照集合一致
+            RID rid;
+            bool found = tree->search(key, rid);
+            if (found != !rids.empty()) bad++;
+            if (found && !rids.count(std::make_pair(rid.pageNum, rid.slotNum))) bad++;
+            // 别的线程的键：不知道在不在，找到时 RID 要对得上键
+            int other = (int)(rng() % (KEYS_PER_THREAD * THREADS));
+            if (tree->search(makeKey(other), rid) && rid.pageNum != other) bad++;
+        }
+    }
+
+    BPlusTree* tree;
+    bool unique;
+    K (*makeKey)(int);
+    std::atomic<long long> bad;
+};
+
+static int intKey(int k) { return k; }
+
+template <typename K>
+static bool runStress(const std::string& dir, KeyType type, int keyLen, bool unique, K (*makeKey)(int)) {
+    FileManager* fm = new FileManager();
+    BufPageManager* bpm = new BufPageManager(fm, POOL_FRAMES);
+    std::string path = dir + "/test_concurrent.idx";
+    remove(path.c_str());
+    fm->createFile(path.c_str());
+    int fileID;
+    fm->openFile(path.c_str(), fileID);
+    BPlusTree tree(fm, bpm, fileID, type, keyLen);
+    tree.initialize(unique);
+    bool enabled = tree.setConcurrent(true);
+
+    StressRun<K> run(&tree, unique, makeKey);
+    std::vector<RefSet> refs(THREADS);
+    std::vector<std::thread> workers;
+    for (int t = 0; enabled && t < THREADS; t++) {
+        workers.emplace_back([&run, &refs, t]() { run.worker(t, refs[t]); });
+    }
+    for (auto& w : workers) w.join();
+    tree.setConcurrent(false);
+
+    // 合并各线程的参照集合
+    std::set<std::pair<int, int>> expected;
+    for (const RefSet& ref : refs) {
+        for (const auto& entry : ref) expected.insert(entry.second.begin(), entry.second.end());
+    }
+    int lo = KEYS_PER_THREAD * THREADS / 4;
+    int hi = KEYS_PER_THREAD * THREADS * 3 / 4;
+    long long inRange = 0;
+    for (const auto& e : expected) {
+        if (e.first >= lo && e.first <= hi) inRange++;
+    }
+    std::set<std::pair<int, int>> scanned;
+    bool sorted = true;
+    int prev = -1;
+    for (BPlusCursor c = tree.openCursor(); c.valid(); c.next()) {
+        scanned.insert(std::make_pair(c.rid().pageNum, c.rid().slotNum));
+        if (c.rid().pageNum < prev) sorted = false;
+        prev = c.rid().pageNum;
+    }
+    K low = makeKey(lo);
+    K high = makeKey(hi);
+    long long counted = tree.countRange<K>(nullptr, nullptr);
+    long long rangeCounted = tree.countRange(&low, &high);
+    long long bad = run.bad;
+
+    bpm->close();
+    fm->closeFile(fileID);
+    remove(path.c_str());
+    delete bpm;
+    delete fm;
+
+    ASSERT_TRUE(enabled, "Concurrent mode enabled on a 64-frame pool");
+    ASSERT_TRUE(bad == 0, "Every operation agrees with the per-thread reference set");
+    ASSERT_TRUE(scanned == expected && sorted, "Leaf scan returns exactly the surviving entries in key order");
+    ASSERT_TRUE(counted == (long long)expected.size(), "countRange over the whole tree");
+    ASSERT_TRUE(rangeCounted == inRange, "countRange over a middle key range");
+    return true;
+}
+
+// 测试 INT 唯一索引
+static bool testIntUnique(const std::string& dir) {
+    TEST_CASE("Concurrent INT unique index");
+    return runStress<int>(dir, KeyType::INT, 0, true, intKey);
+}
+
+// 测试 INT 允许重复的索引
+static bool testIntDuplicate(const std::string& dir) {
+    TEST_CASE("Concurrent INT duplicate index");
+    return runStress<int>(dir, KeyType::INT, 0, false, intKey);
+}
+
+// 测试 VARCHAR 唯一索引
+static bool testVarcharUnique(const std::string& dir) {
+    TEST_CASE("Concurrent VARCHAR unique index");
+    return runStress<std::string>(dir, KeyType::VARCHAR, 40, true, varcharKey);
+}
+
+// 测试 VARCHAR 允许重复的索引
+static bool testVarcharDuplicate(const std::string& dir) {
+    TEST_CASE("Concurrent VARCHAR duplicate index");
+    return runStress<std::string>(dir, KeyType::VARCHAR, 40, false, varcharKey);
+}
+
+// 测试缓存太小时不能打开多线程模式
+static bool testSmallPoolRejected(const std::string& dir) {
+    TEST_CASE("Concurrent mode on a small buffer pool");
+    FileManager* fm = new FileManager();
+    BufPageManager* bpm = new BufPageManager(fm, BP_CONCURRENT_MIN_FRAMES - 1);
+    std::string path = dir + "/test_concurrent.idx";
+    remove(path.c_str());
+    fm->createFile(path.c_str());
+    int fileID;
+    fm->openFile(path.c_str(), fileID);
+    BPlusTree tree(fm, bpm, fileID, KeyType::INT, 0);
+    tree.initialize(true);
+    bool enabled = tree.setConcurrent(true);
+    bool stillSerial = !tree.isConcurrent() && tree.insert(1, RID(1, 1));
+    bpm->close();
+    fm->closeFile(fileID);
+    remove(path.c_str());
+    delete bpm;
+    delete fm;
+    ASSERT_TRUE(!enabled && stillSerial, "setConcurrent refuses a pool below BP_CONCURRENT_MIN_FRAMES");
+    return true;
+}
+
+int main(int argc, char** argv) {
+    MyBitMap::initConst();
+    std::string dir = argc > 1 ? argv[1] : "/tmp";
+    int passed = 0;
+    int failed = 0;
+    if (testIntUnique(dir)) passed++; else failed++;
+    if (testIntDuplicate(dir)) passed++; else failed++;
+    if (testVarcharUnique(dir)) passed++; else failed++;
+    if (testVarcharDuplicate(dir)) passed++; else failed++;
+    if (testSmallPoolRejected(dir)) passed++; else failed++;
+    std::cout << "\n======================================" << std::endl;
+    std::cout << "Test Results: " << passed << " passed, " << failed << " failed" << std::endl;
+    std::cout << "======================================" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -2,6 +2,10 @@
 #include <iostream>
 #include <cassert>
 #include <cstdlib>
+#include <map>
+#include <sstream>
+#include <set>
+#include <climits>
 
 // 测试辅助宏
 #define TEST_CASE(name) std::cout << "\n=== Test: " << name << " ===" << std::endl
@@ -53,6 +57,32 @@ public:
         return result;
     }
     
+    // 把查询结果表格里的数据行取出来，每行为各列去掉空白后的文本
+    static std::vector<std::string> resultRows(const std::string& result) {
+        std::vector<std::string> rows;
+        std::istringstream in(result);
+        std::string line;
+        bool header = true;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 2, "| ") != 0) continue;
+            if (header) {
+                header = false;
+                continue;
+            }
+            std::string row;
+            std::istringstream cells(line.substr(1));
+            std::string cell;
+            while (std::getline(cells, cell, '|')) {
+                size_t b = cell.find_first_not_of(' ');
+                size_t e = cell.find_last_not_of(' ');
+                if (!row.empty()) row += ",";
+                row += b == std::string::npos ? "" : cell.substr(b, e - b + 1);
+            }
+            rows.push_back(row);
+        }
+        return rows;
+    }
+    
     // 测试数据库操作
     bool testDatabaseOperations() {
         TEST_CASE("Database Operations");
@@ -336,6 +366,1066 @@ public:
         return true;
     }
     
+    // 测试可重复键的二级索引
+    bool testSecondaryIndex() {
+        TEST_CASE("Secondary Index");
+        
+        exec("CREATE DATABASE secdb");
+        exec("USE secdb");
+        exec("CREATE TABLE orders (id INT NOT NULL, customer INT, PRIMARY KEY (id))");
+        std::string sql = "INSERT INTO orders VALUES ";
+        for (int i = 1; i <= 3000; i++) {
+            if (i > 1) sql += ",";
+            sql += "(" + std::to_string(i) + "," + std::to_string(i % 4) + ")";
+        }
+        exec(sql);
+        
+        std::string result = exec("ALTER TABLE orders ADD INDEX (customer)");
+        ASSERT_CONTAINS(result, "Index created", "Add index on non-unique column");
+        result = exec("SELECT COUNT(*) FROM orders WHERE customer = 2");
+        ASSERT_CONTAINS(result, "750", "Existing rows are indexed");
+        
+        exec("DELETE FROM orders WHERE id <= 1000");
+        exec("INSERT INTO orders VALUES (5000, 2)");
+        result = exec("SELECT id FROM orders WHERE customer = 2");
+        ASSERT_CONTAINS(result, "2998", "Index scan returns duplicate keys");
+        ASSERT_CONTAINS(result, "5000", "Index scan sees new row");
+        ASSERT_NOT_CONTAINS(result, "| 998 ", "Index scan skips deleted rows");
+        
+        result = exec("ALTER TABLE orders ADD UNIQUE (customer)");
+        ASSERT_CONTAINS(result, "duplicate", "Unique index rejects duplicates");
+        
+        exec("DROP DATABASE secdb");
+        return true;
+    }
+    
+    // 测试复合主键和多列索引
+    bool testCompositeIndex() {
+        TEST_CASE("Composite Index");
+        
+        exec("CREATE DATABASE compdb");
+        exec("USE compdb");
+        exec("CREATE TABLE sc (sid INT NOT NULL, course VARCHAR(16) NOT NULL, grade INT, PRIMARY KEY (sid, course))");
+        std::string sql = "INSERT INTO sc VALUES ";
+        for (int i = 0; i < 2000; i++) {
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i % 100) + ",'c" + std::to_string(i) + "'," + std::to_string(i % 7) + ")";
+        }
+        exec(sql);
+        
+        std::string result = exec("INSERT INTO sc VALUES (42, 'c1942', 1)");
+        ASSERT_CONTAINS(result, "Duplicate", "Composite primary key rejects duplicates");
+        result = exec("INSERT INTO sc VALUES (43, 'c1942', 1)");
+        ASSERT_NOT_CONTAINS(result, "Error", "Composite primary key allows partial match");
+        result = exec("SELECT COUNT(*) FROM sc WHERE sid = 42");
+        ASSERT_CONTAINS(result, "20", "Prefix lookup on first column");
+        result = exec("SELECT grade FROM sc WHERE course = 'c1942' AND sid = 42");
+        ASSERT_CONTAINS(result, "1 row", "Full key lookup");
+        
+        exec("UPDATE sc SET course = 'moved' WHERE sid = 42 AND course = 'c1942'");
+        result = exec("INSERT INTO sc VALUES (42, 'c1942', 1)");
+        ASSERT_NOT_CONTAINS(result, "Error", "Old key removed after update");
+        result = exec("INSERT INTO sc VALUES (42, 'moved', 1)");
+        ASSERT_CONTAINS(result, "Duplicate", "New key indexed after update");
+        
+        result = exec("ALTER TABLE sc ADD INDEX (grade, sid)");
+        ASSERT_CONTAINS(result, "Index created", "Add composite index");
+        result = exec("SELECT COUNT(*) FROM sc WHERE grade = 3 AND sid = 10");
+        ASSERT_CONTAINS(result, "3", "Composite index lookup");
+        result = exec("ALTER TABLE sc ADD UNIQUE (grade, sid)");
+        ASSERT_CONTAINS(result, "duplicate", "Composite unique rejects duplicates");
+        
+        exec("DROP DATABASE compdb");
+        return true;
+    }
+    
+    // 测试对已有数据建索引（批量构建）
+    bool testBulkIndexBuild() {
+        TEST_CASE("Bulk Index Build");
+        
+        exec("CREATE DATABASE bulkdb");
+        exec("USE bulkdb");
+        exec("CREATE TABLE t (id INT NOT NULL, v INT, name VARCHAR(16))");
+        std::string sql = "INSERT INTO t VALUES ";
+        for (int i = 0; i < 5000; i++) {
+            int k = i * 37 % 5000;
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(k) + "," + std::to_string(k % 50) + ",'n" + std::to_string(k) + "')";
+        }
+        exec(sql);
+        
+        std::string result = exec("SET INDEX_FILLFACTOR 70");
+        ASSERT_CONTAINS(result, "Index fill factor 70", "Set index fill factor");
+        result = exec("SET INDEX_FILLFACTOR 5");
+        ASSERT_CONTAINS(result, "Usage", "Reject out of range fill factor");
+        result = exec("ALTER TABLE t ADD PRIMARY KEY (id)");
+        ASSERT_NOT_CONTAINS(result, "Error", "Build primary key on existing rows");
+        result = exec("ALTER TABLE t ADD INDEX (v)");
+        ASSERT_CONTAINS(result, "Index created", "Build secondary index on existing rows");
+        result = exec("SELECT name FROM t WHERE id = 4321");
+        ASSERT_CONTAINS(result, "n4321", "Lookup in bulk built primary key");
+        result = exec("SELECT COUNT(*) FROM t WHERE v = 17");
+        ASSERT_CONTAINS(result, "100", "Lookup in bulk built secondary index");
+        result = exec("INSERT INTO t VALUES (4321, 1, 'dup')");
+        ASSERT_CONTAINS(result, "Duplicate", "Bulk built primary key rejects duplicates");
+        exec("INSERT INTO t VALUES (5000, 17, 'n5000')");
+        result = exec("SELECT COUNT(*) FROM t WHERE v = 17");
+        ASSERT_CONTAINS(result, "101", "Insert after bulk build");
+        
+        exec("INSERT INTO t VALUES (5001, 1, 'n0')");
+        result = exec("ALTER TABLE t ADD UNIQUE (name)");
+        ASSERT_CONTAINS(result, "duplicate", "Bulk build rejects duplicate unique keys");
+        
+        exec("SET INDEX_FILLFACTOR 90");
+        exec("DROP DATABASE bulkdb");
+        return true;
+    }
+    
+    // 测试大量删除后的索引合并与整理
+    bool testIndexRebalance() {
+        TEST_CASE("Index Rebalance");
+        
+        exec("CREATE DATABASE rebaldb");
+        exec("USE rebaldb");
+        exec("CREATE TABLE t (id INT NOT NULL, v INT, name VARCHAR(40), PRIMARY KEY (id))");
+        exec("ALTER TABLE t ADD INDEX vi (v)");
+        std::string sql = "INSERT INTO t VALUES ";
+        for (int i = 0; i < 8000; i++) {
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + "," + std::to_string(i % 40) + ",'name" + std::to_string(i) + "')";
+        }
+        exec(sql);
+        
+        exec("DELETE FROM t WHERE id >= 400 AND id < 7600");
+        std::string result = exec("SELECT COUNT(*) FROM t WHERE id >= 0");
+        ASSERT_CONTAINS(result, "800", "Range scan after large delete");
+        result = exec("SELECT COUNT(*) FROM t WHERE v = 5");
+        ASSERT_CONTAINS(result, "20", "Secondary index after large delete");
+        result = exec("SELECT name FROM t WHERE id = 7600");
+        ASSERT_CONTAINS(result, "name7600", "Lookup after merges");
+        
+        result = exec("OPTIMIZE INDEX t.vi");
+        ASSERT_CONTAINS(result, "optimized", "Optimize named index");
+        result = exec("OPTIMIZE INDEX t");
+        ASSERT_CONTAINS(result, "optimized", "Optimize all indexes of a table");
+        result = exec("OPTIMIZE INDEX t.nope");
+        ASSERT_CONTAINS(result, "Failed", "Optimize unknown index");
+        result = exec("SELECT COUNT(*) FROM t WHERE v = 5");
+        ASSERT_CONTAINS(result, "20", "Secondary index after optimize");
+        exec("INSERT INTO t VALUES (5000, 5, 'again')");
+        result = exec("SELECT name FROM t WHERE id = 5000");
+        ASSERT_CONTAINS(result, "again", "Insert after optimize");
+        result = exec("INSERT INTO t VALUES (7999, 1, 'dup')");
+        ASSERT_CONTAINS(result, "Duplicate", "Primary key still unique after optimize");
+        
+        exec("DROP DATABASE rebaldb");
+        return true;
+    }
+    
+    // 测试键递增的插入：追加到最右叶子，中间夹杂乱序插入与删除
+    bool testSequentialInsert() {
+        TEST_CASE("Sequential Insert");
+        
+        exec("CREATE DATABASE seqdb");
+        exec("USE seqdb");
+        exec("CREATE TABLE t (id INT NOT NULL, name VARCHAR(24), PRIMARY KEY (id))");
+        exec("ALTER TABLE t ADD INDEX ni (name)");
+        for (int batch = 0; batch < 4; batch++) {
+            std::string sql = "INSERT INTO t VALUES ";
+            for (int i = 0; i < 3000; i++) {
+                int id = batch * 3000 + i;
+                if (i > 0) sql += ",";
+                sql += "(" + std::to_string(id * 2) + ",'key" + std::to_string(100000 + id) + "')";
+            }
+            exec(sql);
+        }
+        
+        std::string result = exec("SELECT COUNT(*) FROM t WHERE id >= 0");
+        ASSERT_CONTAINS(result, "12000", "All ascending rows indexed");
+        result = exec("INSERT INTO t VALUES (23998, 'dup')");
+        ASSERT_CONTAINS(result, "Duplicate", "Duplicate of the last key rejected");
+        exec("INSERT INTO t VALUES (5001, 'key105001')");
+        exec("DELETE FROM t WHERE id > 23000");
+        exec("INSERT INTO t VALUES (23001, 'key999999')");
+        result = exec("SELECT COUNT(*) FROM t WHERE id >= 0");
+        ASSERT_CONTAINS(result, "11503", "Count after out of order insert and tail delete");
+        result = exec("SELECT id FROM t WHERE id >= 0 ORDER BY id DESC LIMIT 2");
+        ASSERT_CONTAINS(result, "23001", "Append after deleting the tail");
+        ASSERT_CONTAINS(result, "23000", "Previous last key kept");
+        result = exec("SELECT id FROM t WHERE name = 'key105001'");
+        ASSERT_CONTAINS(result, "5001", "Secondary index lookup");
+        result = exec("SELECT COUNT(*) FROM t WHERE name >= 'key111000'");
+        ASSERT_CONTAINS(result, "| 502 ", "Secondary index range after appends");
+        
+        exec("DROP DATABASE seqdb");
+        return true;
+    }
+    
+    // 测试索引游标上的 LIMIT 提前结束与 ORDER BY
+    bool testIndexLimitScan() {
+        TEST_CASE("Index Limit Scan");
+        
+        exec("CREATE DATABASE limdb");
+        exec("USE limdb");
+        exec("CREATE TABLE t (id INT NOT NULL, v INT, PRIMARY KEY (id))");
+        exec("ALTER TABLE t ADD INDEX (v)");
+        std::string sql = "INSERT INTO t VALUES ";
+        for (int i = 0; i < 3000; i++) {
+            int k = i * 7 % 3000;
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(k) + "," + std::to_string(k % 100) + ")";
+        }
+        exec(sql);
+        
+        std::string result = exec("SELECT id FROM t WHERE id > 10 ORDER BY id LIMIT 2");
+        ASSERT_CONTAINS(result, "11", "Ascending index scan with LIMIT");
+        ASSERT_NOT_CONTAINS(result, "13", "Scan stops after LIMIT rows");
+        result = exec("SELECT id FROM t ORDER BY id DESC LIMIT 1");
+        ASSERT_CONTAINS(result, "2999", "Descending primary key scan");
+        result = exec("SELECT id FROM t ORDER BY id LIMIT 2 OFFSET 1500");
+        ASSERT_CONTAINS(result, "1501", "OFFSET on index scan");
+        result = exec("SELECT COUNT(*) FROM t WHERE v = 42");
+        ASSERT_CONTAINS(result, "30", "Count through secondary index");
+        result = exec("SELECT id FROM t WHERE v = 42 AND id > 2500 LIMIT 1");
+        ASSERT_CONTAINS(result, "1 row", "Residual filter on index scan");
+        ASSERT_CONTAINS(result, "42 ", "Row from the residual filter");
+        
+        exec("DROP DATABASE limdb");
+        return true;
+    }
+    
+    // 测试 FLOAT / VARCHAR 列上的区间扫描和 LIKE 前缀区间
+    bool testIndexRangeTypes() {
+        TEST_CASE("Index Range Types");
+        
+        exec("CREATE DATABASE rngdb");
+        exec("USE rngdb");
+        exec("CREATE TABLE t (id INT NOT NULL, x FLOAT, s VARCHAR(16), PRIMARY KEY (id))");
+        exec("ALTER TABLE t ADD INDEX (x)");
+        exec("ALTER TABLE t ADD INDEX (s)");
+        std::string sql = "INSERT INTO t VALUES ";
+        for (int i = 0; i < 2000; i++) {
+            int k = i * 7 % 2000;
+            if (i > 0) sql += ",";
+            std::string s = (k % 2 ? "Key" : "key") + std::to_string(10000 + k);
+            sql += "(" + std::to_string(k) + "," + std::to_string(k) + ".25,'" + s + "')";
+        }
+        exec(sql);
+        
+        std::string result = exec("SELECT COUNT(*) FROM t WHERE x > 1990");
+        ASSERT_CONTAINS(result, "10", "FLOAT range with INT constant");
+        result = exec("SELECT id FROM t WHERE x <= 3.25");
+        ASSERT_CONTAINS(result, "4 row(s)", "FLOAT upper bound");
+        result = exec("SELECT COUNT(*) FROM t WHERE s >= 'key11990'");
+        ASSERT_CONTAINS(result, "5", "VARCHAR lower bound is case-sensitive");
+        result = exec("SELECT COUNT(*) FROM t WHERE s LIKE 'KEY1199%'");
+        ASSERT_CONTAINS(result, "10", "LIKE prefix covers both cases");
+        result = exec("SELECT id FROM t WHERE s LIKE 'key1000_'");
+        ASSERT_CONTAINS(result, "10 row(s)", "LIKE prefix with single wildcard");
+        result = exec("SELECT id, s FROM t WHERE s LIKE 'key%' ORDER BY s DESC LIMIT 1");
+        ASSERT_CONTAINS(result, "1998", "LIKE prefix scan in index order");
+        
+        exec("DROP DATABASE rngdb");
+        return true;
+    }
+
+    // 测试长公共前缀的 VARCHAR 索引（变长页、前缀压缩）
+    bool testVarcharPrefixIndex() {
+        TEST_CASE("Varchar Prefix Index");
+
+        exec("CREATE DATABASE prefdb");
+        exec("USE prefdb");
+        exec("CREATE TABLE urls (url VARCHAR(200) NOT NULL, n INT, PRIMARY KEY (url))");
+        std::string prefix = "https://example.com/catalog/products/category/item-";
+        std::string sql = "INSERT INTO urls VALUES ";
+        for (int i = 0; i < 4000; i++) {
+            int k = i * 7 % 4000;
+            if (i > 0) sql += ",";
+            sql += "('" + prefix + std::to_string(10000 + k) + "'," + std::to_string(k) + ")";
+        }
+        exec(sql);
+
+        std::string result = exec("SELECT n FROM urls WHERE url = '" + prefix + "13999'");
+        ASSERT_CONTAINS(result, "3999", "Lookup of the largest key");
+        result = exec("SELECT COUNT(*) FROM urls WHERE url LIKE '" + prefix + "123%'");
+        ASSERT_CONTAINS(result, "10", "LIKE prefix on compressed pages");
+        result = exec("SELECT COUNT(*) FROM urls WHERE url >= '" + prefix + "13990'");
+        ASSERT_CONTAINS(result, "10", "Range on compressed pages");
+        result = exec("INSERT INTO urls VALUES ('" + prefix + "10007', 1)");
+        ASSERT_CONTAINS(result, "Duplicate", "Uniqueness on compressed pages");
+
+        exec("DELETE FROM urls WHERE n >= 500");
+        result = exec("SELECT COUNT(*) FROM urls WHERE url >= 'https'");
+        ASSERT_CONTAINS(result, "500", "Range after large delete");
+        exec("INSERT INTO urls VALUES ('https://other.org/', 1), ('" + prefix + "x', 2)");
+        result = exec("SELECT n FROM urls WHERE url = '" + prefix + "x'");
+        ASSERT_CONTAINS(result, "2", "Insert after merges");
+        result = exec("OPTIMIZE INDEX urls");
+        ASSERT_CONTAINS(result, "optimized", "Optimize VARCHAR index");
+        result = exec("SELECT url FROM urls WHERE url LIKE 'https://o%'");
+        ASSERT_CONTAINS(result, "other.org", "Lookup after optimize");
+        result = exec("SELECT COUNT(*) FROM urls WHERE url > '" + prefix + "10498'");
+        ASSERT_CONTAINS(result, "3", "Range after optimize");
+
+        exec("DROP DATABASE prefdb");
+        return true;
+    }
+
+    // 测试只读索引叶子的查询（覆盖索引），以及键列为 NULL 的行不能漏掉
+    bool testCoveringIndexScan() {
+        TEST_CASE("Covering Index Scan");
+
+        exec("CREATE DATABASE covdb");
+        exec("USE covdb");
+        exec("CREATE TABLE t (id INT NOT NULL, v INT, s VARCHAR(20), PRIMARY KEY (id))");
+        exec("ALTER TABLE t ADD INDEX (v)");
+        exec("CREATE TABLE p (a INT, b VARCHAR(8), c INT)");
+        exec("CREATE INDEX pab ON p (a, b)");
+        std::string sql = "INSERT INTO t VALUES ";
+        std::string psql = "INSERT INTO p VALUES ";
+        for (int i = 0; i < 2000; i++) {
+            if (i > 0) {
+                sql += ",";
+                psql += ",";
+            }
+            std::string v = (i % 10 == 0) ? "NULL" : std::to_string(i % 50);
+            sql += "(" + std::to_string(i) + "," + v + ",'s" + std::to_string(i) + "')";
+            std::string b = (i % 7 == 0) ? "NULL" : "'b" + std::to_string(i % 100) + "'";
+            psql += "(" + std::to_string(i % 10) + "," + b + "," + std::to_string(i) + ")";
+        }
+        exec(sql);
+        exec(psql);
+
+        std::string result = exec("SELECT id FROM t WHERE id >= 10 AND id <= 14");
+        ASSERT_CONTAINS(result, "5 row(s)", "Primary key range from index only");
+        result = exec("SELECT COUNT(*) FROM t WHERE v >= 45");
+        ASSERT_CONTAINS(result, "200", "COUNT(*) over secondary index range");
+        result = exec("SELECT COUNT(v), MIN(v), MAX(v) FROM t");
+        ASSERT_CONTAINS(result, "1800", "COUNT(col) skips NULL keys");
+        ASSERT_CONTAINS(result, "| 1 ", "MIN from index");
+        ASSERT_CONTAINS(result, "49", "MAX from index");
+        result = exec("SELECT COUNT(*) FROM t WHERE v IS NULL");
+        ASSERT_CONTAINS(result, "200", "IS NULL still reads the table");
+        result = exec("SELECT v FROM t WHERE id < 20");
+        ASSERT_CONTAINS(result, "NULL", "Non-key column not taken from index");
+        result = exec("SELECT COUNT(*) FROM p WHERE a = 1");
+        ASSERT_CONTAINS(result, "200", "Composite index not used when key column can be NULL");
+        result = exec("SELECT b FROM p WHERE a = 1 AND b >= 'b9'");
+        ASSERT_CONTAINS(result, "17 row(s)", "Composite index covers both columns");
+
+        exec("DROP DATABASE covdb");
+        return true;
+    }
+
+    // 测试用子树计数求区间 COUNT、用索引两端求 MIN/MAX，以及插入删除后计数仍然准确
+    bool testIndexAggregate() {
+        TEST_CASE("Index Aggregate");
+
+        exec("CREATE DATABASE aggdb");
+        exec("USE aggdb");
+        exec("CREATE TABLE t (id INT NOT NULL, name VARCHAR(16) NOT NULL, PRIMARY KEY (id))");
+        exec("ALTER TABLE t ADD INDEX (name)");
+        std::string sql = "INSERT INTO t VALUES ";
+        for (int i = 0; i < 6000; i++) {
+            int k = i * 7 % 6000;
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(k) + ",'n" + std::to_string(100000 + k) + "')";
+        }
+        exec(sql);
+
+        std::string result = exec("SELECT COUNT(*) FROM t WHERE id >= 1234 AND id < 4567");
+        ASSERT_CONTAINS(result, "3333", "COUNT over primary key range");
+        result = exec("SELECT COUNT(*) FROM t WHERE id > 5990 AND id >= 5000");
+        ASSERT_CONTAINS(result, "9", "Tightest bound wins");
+        result = exec("SELECT COUNT(*) FROM t WHERE id > 100 AND id < 50");
+        ASSERT_CONTAINS(result, "| 0 ", "Empty range");
+        result = exec("SELECT MIN(id), MAX(id) FROM t WHERE id > 2500 AND id <= 3500");
+        ASSERT_CONTAINS(result, "2501", "MIN inside range");
+        ASSERT_CONTAINS(result, "3500", "MAX inside range");
+        result = exec("SELECT COUNT(name), MIN(name), MAX(name) FROM t WHERE name >= 'n102000'");
+        ASSERT_CONTAINS(result, "4000", "COUNT over VARCHAR range");
+        ASSERT_CONTAINS(result, "n102000", "MIN over VARCHAR range");
+        ASSERT_CONTAINS(result, "n105999", "MAX over VARCHAR range");
+
+        exec("DELETE FROM t WHERE id >= 1000 AND id < 3000");
+        result = exec("SELECT COUNT(*) FROM t WHERE id >= 500 AND id < 3500");
+        ASSERT_CONTAINS(result, "1000", "COUNT after deletes merged leaves");
+        result = exec("SELECT MIN(id) FROM t WHERE id >= 1000");
+        ASSERT_CONTAINS(result, "3000", "MIN skips deleted keys");
+        sql = "INSERT INTO t VALUES ";
+        for (int i = 0; i < 1500; i++) {
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(10000 + i) + ",'m" + std::to_string(i) + "')";
+        }
+        exec(sql);
+        result = exec("SELECT COUNT(*) FROM t WHERE id > 5999");
+        ASSERT_CONTAINS(result, "1500", "COUNT after splits");
+        result = exec("SELECT COUNT(*) FROM t WHERE name < 'n'");
+        ASSERT_CONTAINS(result, "1500", "COUNT on VARCHAR index after splits");
+        result = exec("OPTIMIZE INDEX t");
+        ASSERT_CONTAINS(result, "optimized", "Optimize index");
+        result = exec("SELECT COUNT(*) FROM t WHERE id >= 3000 AND id <= 10099");
+        ASSERT_CONTAINS(result, "3100", "COUNT after optimize");
+
+        exec("DROP DATABASE aggdb");
+        return true;
+    }
+
+    // 测试哈希索引：等值查找、重复键、桶分裂，增删改后的维护，主键探测与删除索引
+    bool testHashIndex() {
+        TEST_CASE("Hash Index");
+
+        exec("CREATE DATABASE hashdb");
+        exec("USE hashdb");
+        exec("CREATE TABLE t (id INT NOT NULL, tag VARCHAR(16), score FLOAT, PRIMARY KEY (id))");
+        std::string sql = "INSERT INTO t VALUES ";
+        for (int i = 0; i < 5000; i++) {
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + ",'g" + std::to_string(i % 700) + "'," + std::to_string(i % 3) + ".5)";
+        }
+        exec(sql);
+
+        std::string result = exec("ALTER TABLE t ADD INDEX USING HASH (tag)");
+        ASSERT_CONTAINS(result, "Hash index created", "Create hash index on existing rows");
+        result = exec("ALTER TABLE t ADD INDEX sh USING HASH (score)");
+        ASSERT_CONTAINS(result, "Hash index created", "Create hash index on FLOAT");
+        result = exec("ALTER TABLE t ADD INDEX ih USING HASH (id)");
+        ASSERT_CONTAINS(result, "Hash index created", "Create hash index on primary key");
+        result = exec("ALTER TABLE t ADD INDEX USING HASH (tag)");
+        ASSERT_CONTAINS(result, "Failed", "Duplicate hash index rejected");
+        result = exec("DESC t");
+        ASSERT_CONTAINS(result, "INDEX (tag) USING HASH", "Describe shows hash index");
+
+        result = exec("SELECT COUNT(*) FROM t WHERE tag = 'g123'");
+        ASSERT_CONTAINS(result, "| 7 ", "Equality lookup returns duplicates");
+        result = exec("SELECT id FROM t WHERE tag = 'g699'");
+        ASSERT_CONTAINS(result, "4899", "Last duplicate found");
+        result = exec("SELECT COUNT(*) FROM t WHERE score = 2.5");
+        ASSERT_CONTAINS(result, "1666", "Equality lookup on FLOAT");
+        result = exec("SELECT tag FROM t WHERE id = 4321");
+        ASSERT_CONTAINS(result, "g121", "Primary key lookup");
+
+        result = exec("INSERT INTO t VALUES (4321, 'dup', 0.5)");
+        ASSERT_CONTAINS(result, "Duplicate", "Primary key probe via hash index");
+        exec("INSERT INTO t VALUES (5000, 'g123', 0.5)");
+        exec("UPDATE t SET tag = 'moved' WHERE id = 123");
+        exec("DELETE FROM t WHERE id = 823");
+        result = exec("SELECT COUNT(*) FROM t WHERE tag = 'g123'");
+        ASSERT_CONTAINS(result, "| 6 ", "Hash index follows insert/update/delete");
+        result = exec("SELECT id FROM t WHERE tag = 'moved'");
+        ASSERT_CONTAINS(result, "123", "Updated key found");
+        result = exec("SELECT id FROM t WHERE tag = 'g123' LIMIT 2");
+        ASSERT_CONTAINS(result, "2223", "LIMIT over hash lookup keeps record order");
+        ASSERT_NOT_CONTAINS(result, "2923", "LIMIT stops after two rows");
+
+        result = exec("ALTER TABLE t DROP INDEX t_tag_hash");
+        ASSERT_CONTAINS(result, "dropped", "Drop hash index");
+        result = exec("SELECT COUNT(*) FROM t WHERE tag = 'g123'");
+        ASSERT_CONTAINS(result, "| 6 ", "Scan after dropping hash index");
+
+        exec("DROP DATABASE hashdb");
+        return true;
+    }
+
+    // 测试 FLOAT / VARCHAR 主键索引（需要多次分裂）
+    bool testIndexKeyTypes() {
+        TEST_CASE("Index Key Types");
+        
+        exec("CREATE DATABASE keydb");
+        exec("USE keydb");
+        exec("CREATE TABLE prices (p FLOAT NOT NULL, PRIMARY KEY (p))");
+        exec("CREATE TABLE tags (tag VARCHAR(32) NOT NULL, n INT, PRIMARY KEY (tag))");
+        std::string fsql = "INSERT INTO prices VALUES ";
+        std::string ssql = "INSERT INTO tags VALUES ";
+        for (int i = 0; i < 3000; i++) {
+            int k = i * 7 % 3000;
+            if (i > 0) {
+                fsql += ",";
+                ssql += ",";
+            }
+            fsql += "(" + std::to_string(k) + ".5)";
+            ssql += "('tag" + std::to_string(10000 + k) + "'," + std::to_string(k) + ")";
+        }
+        exec(fsql);
+        exec(ssql);
+        
+        std::string result = exec("SELECT * FROM prices WHERE p = 2999.5");
+        ASSERT_CONTAINS(result, "2999.5", "FLOAT index lookup after splits");
+        result = exec("SELECT n FROM tags WHERE tag = 'tag12345'");
+        ASSERT_CONTAINS(result, "2345", "VARCHAR index lookup after splits");
+        result = exec("INSERT INTO tags VALUES ('tag10007', 1)");
+        ASSERT_CONTAINS(result, "Duplicate", "VARCHAR primary key uniqueness");
+        
+        exec("DROP DATABASE keydb");
+        return true;
+    }
+    
+    // 测试组合键的 memcmp 编码：互为前缀的字符串列
+    bool testCompositeKeyEncoding() {
+        TEST_CASE("Composite Key Encoding");
+        
+        exec("CREATE DATABASE enc");
+        exec("USE enc");
+        exec("CREATE TABLE kv (a INT NOT NULL, s VARCHAR(12) NOT NULL, n INT, PRIMARY KEY (a, s))");
+        std::string sql = "INSERT INTO kv VALUES ";
+        for (int i = 0; i < 738; i++) {
+            if (i > 0) sql += ",";
+            std::string str(1 + i / 41 % 6, 'a' + i / 246 % 3);
+            sql += "(" + std::to_string(i % 41) + ",'" + str + "'," + std::to_string(i) + ")";
+        }
+        exec(sql);
+        
+        std::string result = exec("SELECT COUNT(*) FROM kv WHERE a = 0");
+        ASSERT_CONTAINS(result, "18", "Prefix lookup on first column");
+        result = exec("SELECT COUNT(*) FROM kv WHERE a < 20");
+        ASSERT_CONTAINS(result, "360", "Range on first column");
+        result = exec("SELECT n FROM kv WHERE a = 5 AND s = 'aa'");
+        ASSERT_CONTAINS(result, "46", "Full key lookup");
+        result = exec("INSERT INTO kv VALUES (5, 'aa', 0)");
+        ASSERT_CONTAINS(result, "Duplicate", "Duplicate detected on encoded key");
+        result = exec("INSERT INTO kv VALUES (5, 'aaaaaaa', 0)");
+        ASSERT_NOT_CONTAINS(result, "Error", "Longer string with same prefix is a new key");
+        result = exec("OPTIMIZE INDEX kv");
+        ASSERT_NOT_CONTAINS(result, "Error", "Optimize composite index");
+        result = exec("SELECT COUNT(*) FROM kv WHERE a = 5");
+        ASSERT_CONTAINS(result, "19", "Prefix lookup after optimize");
+        
+        exec("DROP DATABASE enc");
+        return true;
+    }
+    
+    // 测试唯一索引的布隆过滤器：键数超过初始容量后重建，删除的键可以再插入
+    bool testPrimaryKeyFilter() {
+        TEST_CASE("Primary Key Filter");
+        
+        exec("CREATE DATABASE bloomdb");
+        exec("USE bloomdb");
+        exec("CREATE TABLE u (id INT NOT NULL, name VARCHAR(16) NOT NULL, PRIMARY KEY (id))");
+        exec("ALTER TABLE u ADD UNIQUE (name)");
+        for (int batch = 0; batch < 3; batch++) {
+            std::string sql = "INSERT INTO u VALUES ";
+            for (int i = 0; i < 1000; i++) {
+                int id = batch * 1000 + i;
+                if (i > 0) sql += ",";
+                sql += "(" + std::to_string(id) + ",'u" + std::to_string(id) + "')";
+            }
+            exec(sql);
+        }
+        
+        std::string result = exec("SELECT COUNT(*) FROM u");
+        ASSERT_CONTAINS(result, "3000", "All rows inserted");
+        result = exec("INSERT INTO u VALUES (2999, 'fresh')");
+        ASSERT_CONTAINS(result, "Duplicate", "Duplicate primary key after filter growth");
+        result = exec("INSERT INTO u VALUES (5000, 'u17')");
+        ASSERT_CONTAINS(result, "Duplicate", "Duplicate unique value after filter growth");
+        exec("DELETE FROM u WHERE id = 17");
+        result = exec("INSERT INTO u VALUES (17, 'u17')");
+        ASSERT_NOT_CONTAINS(result, "Error", "Deleted key can be inserted again");
+        exec("OPTIMIZE INDEX u");
+        result = exec("INSERT INTO u VALUES (17, 'again')");
+        ASSERT_CONTAINS(result, "Duplicate", "Duplicate detected after optimize");
+        result = exec("SELECT name FROM u WHERE id = 1234");
+        ASSERT_CONTAINS(result, "u1234", "Point lookup through filter");
+        
+        exec("DROP DATABASE bloomdb");
+        return true;
+    }
+    
+    // 测试写优化的索引缓冲
+    bool testBufferedIndex() {
+        TEST_CASE("Buffered Index");
+        
+        exec("CREATE DATABASE lsmdb");
+        exec("USE lsmdb");
+        exec("CREATE TABLE m (id INT NOT NULL, tag VARCHAR(12), grp INT, PRIMARY KEY (id))");
+        exec("ALTER TABLE m ADD INDEX (grp)");
+        exec("ALTER TABLE m ADD INDEX (grp, tag)");
+        std::string result = exec("ALTER TABLE m SET INDEX_MODE BUFFERED");
+        ASSERT_NOT_CONTAINS(result, "Error", "Switch to buffered index mode");
+        for (int batch = 0; batch < 2; batch++) {
+            std::string sql = "INSERT INTO m VALUES ";
+            for (int i = 0; i < 1000; i++) {
+                int id = batch * 1000 + i * 7 % 1000;
+                if (i > 0) sql += ",";
+                sql += "(" + std::to_string(id) + ",'t" + std::to_string(id % 50) + "'," +
+                       std::to_string(id % 10) + ")";
+            }
+            exec(sql);
+        }
+        
+        result = exec("INSERT INTO m VALUES (700, 'dup', 1)");
+        ASSERT_CONTAINS(result, "Duplicate", "Duplicate key found in buffer");
+        result = exec("SELECT tag FROM m WHERE id = 1401");
+        ASSERT_CONTAINS(result, "t1", "Point lookup served from buffer");
+        result = exec("SELECT COUNT(*) FROM m WHERE grp = 3");
+        ASSERT_CONTAINS(result, "200", "Range scan after merging buffer");
+        result = exec("SELECT id FROM m WHERE grp = 4 AND tag = 't14' AND id < 100");
+        ASSERT_CONTAINS(result, "64", "Composite index lookup");
+        exec("DELETE FROM m WHERE id = 1401");
+        exec("INSERT INTO m VALUES (1401, 'back', 9)");
+        result = exec("SELECT tag FROM m WHERE id = 1401");
+        ASSERT_CONTAINS(result, "back", "Reinsert after delete");
+        result = exec("ALTER TABLE m SET INDEX_MODE DIRECT");
+        ASSERT_NOT_CONTAINS(result, "Error", "Switch back to direct index mode");
+        result = exec("SELECT COUNT(*) FROM m WHERE grp = 9");
+        ASSERT_CONTAINS(result, "201", "Index complete after switching back");
+        result = exec("ALTER TABLE m SET INDEX_MODE LAZY");
+        ASSERT_CONTAINS(result, "Usage", "Unknown index mode rejected");
+        
+        exec("DROP DATABASE lsmdb");
+        return true;
+    }
+
+    // 测试索引嵌套循环连接
+    bool testIndexJoin() {
+        TEST_CASE("Index Nested-Loop Join");
+
+        exec("CREATE DATABASE joindb");
+        exec("USE joindb");
+        exec("CREATE TABLE cust (id INT NOT NULL, name VARCHAR(16), PRIMARY KEY (id))");
+        exec("CREATE TABLE ord (oid INT NOT NULL, cid INT, amt INT, PRIMARY KEY (oid))");
+        exec("CREATE TABLE item (iid INT NOT NULL, oid INT, sku VARCHAR(8), PRIMARY KEY (iid))");
+        exec("ALTER TABLE item ADD INDEX USING HASH (oid)");
+        std::string sql = "INSERT INTO cust VALUES ";
+        for (int i = 0; i < 500; i++) {
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + ",'c" + std::to_string(i) + "')";
+        }
+        exec(sql);
+        sql = "INSERT INTO ord VALUES ";
+        for (int i = 0; i < 2000; i++) {
+            if (i > 0) sql += ",";
+            std::string cid = i % 100 == 99 ? "NULL" : std::to_string(i * 7 % 600);
+            sql += "(" + std::to_string(i) + "," + cid + "," + std::to_string(i % 50) + ")";
+        }
+        exec(sql);
+        exec("INSERT INTO item VALUES (1, 3, 'pen'), (2, 3, 'ink'), (3, 4, 'cap')");
+
+        std::string result = exec("SELECT ord.oid, cust.name FROM ord, cust WHERE ord.cid = cust.id AND ord.oid = 3");
+        ASSERT_CONTAINS(result, "c21", "Probe primary key for outer row");
+        result = exec("SELECT COUNT(*) FROM ord, cust WHERE cust.id = ord.cid");
+        ASSERT_CONTAINS(result, "1655", "Dangling and NULL keys not joined");
+        result = exec("SELECT cust.name FROM ord, cust WHERE ord.cid = cust.id AND ord.oid = 72");
+        ASSERT_CONTAINS(result, "0 row", "Dangling key has no match");
+        result = exec("SELECT cust.name, item.sku FROM ord, cust, item "
+                      "WHERE ord.cid = cust.id AND item.oid = ord.oid AND item.sku = 'ink'");
+        ASSERT_CONTAINS(result, "c21", "Three-table join through hash index");
+        ASSERT_NOT_CONTAINS(result, "pen", "Inner filter applied to probed rows");
+
+        exec("DROP DATABASE joindb");
+        return true;
+    }
+
+    // 测试等值条件上的哈希连接（连接列上没有索引）
+    bool testHashJoin() {
+        TEST_CASE("Hash Join");
+
+        exec("CREATE DATABASE hashjoindb");
+        exec("USE hashjoindb");
+        exec("CREATE TABLE dept (code VARCHAR(8), title VARCHAR(16), budget FLOAT)");
+        exec("CREATE TABLE emp (eid INT NOT NULL, dcode VARCHAR(8), level INT, PRIMARY KEY (eid))");
+        exec("INSERT INTO dept VALUES ('rd', 'Research', 3.0), ('ops', 'Operations', 1.0), ('hr', 'People', 2.0)");
+        std::string sql = "INSERT INTO emp VALUES ";
+        for (int i = 0; i < 300; i++) {
+            const char* codes[] = {"'rd'", "'ops'", "'qa'", "NULL"};
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + "," + codes[i % 4] + "," + std::to_string(i % 5) + ")";
+        }
+        exec(sql);
+
+        std::string result = exec("SELECT COUNT(*) FROM emp, dept WHERE emp.dcode = dept.code");
+        ASSERT_CONTAINS(result, "150", "Build on smaller input");
+        result = exec("SELECT COUNT(*) FROM dept, emp WHERE dept.code = emp.dcode AND emp.level = 2");
+        ASSERT_CONTAINS(result, "30", "Probe with larger input");
+        result = exec("SELECT emp.eid, dept.title FROM emp, dept WHERE emp.dcode = dept.code AND emp.eid < 3");
+        ASSERT_CONTAINS(result, "Operations", "Matched row from hash table");
+        ASSERT_NOT_CONTAINS(result, "People", "No match for unjoined key");
+        result = exec("SELECT dept.title FROM dept, emp WHERE dept.budget = emp.level AND emp.eid = 3");
+        ASSERT_CONTAINS(result, "Research", "INT and FLOAT keys hash alike");
+        exec("CREATE TABLE lvl (n FLOAT, label VARCHAR(8))");
+        exec("INSERT INTO lvl VALUES (1.0, 'one'), (2.0, 'two'), (2.0, 'deux')");
+        result = exec("SELECT COUNT(*) FROM emp, dept, lvl WHERE emp.dcode = dept.code AND lvl.n = emp.level");
+        ASSERT_CONTAINS(result, "90", "Three-table left-deep pipeline");
+
+        exec("DROP DATABASE hashjoindb");
+        return true;
+    }
+
+    // 测试排序归并连接：两边连接列都有索引时按索引顺序归并，建表一侧超过 JOIN_HASH_ROWS 时稳定排序后归并；
+    // 两边都有重复键，结果的行和顺序要与嵌套循环相同；连接条件与嵌套循环一样按 compareValues 判等，NULL 与 NULL 配对
+    bool testMergeJoin() {
+        TEST_CASE("Sort-Merge Join");
+
+        exec("CREATE DATABASE mergejoindb");
+        exec("USE mergejoindb");
+        exec("CREATE TABLE pa (id INT NOT NULL, k INT NOT NULL, PRIMARY KEY (id))");
+        exec("CREATE TABLE pb (id INT NOT NULL, k INT NOT NULL, note VARCHAR(8), PRIMARY KEY (id))");
+        exec("ALTER TABLE pa ADD INDEX (k)");
+        exec("ALTER TABLE pb ADD INDEX (k)");
+        std::string sql = "INSERT INTO pa VALUES ";
+        for (int i = 0; i < 300; i++) {
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + "," + std::to_string(i % 100) + ")";
+        }
+        exec(sql);
+        sql = "INSERT INTO pb VALUES ";
+        for (int i = 0; i < 200; i++) {
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + "," + std::to_string(i % 100 + 50) + ",'n" + std::to_string(i) + "')";
+        }
+        exec(sql);
+        std::vector<std::string> expected;
+        for (int a = 0; a < 300; a++) {
+            for (int b = 0; b < 200; b++) {
+                if (a % 100 == b % 100 + 50) expected.push_back(std::to_string(a) + ",n" + std::to_string(b));
+            }
+        }
+
+        std::string result = exec("SELECT pa.id, pb.note FROM pa, pb WHERE pa.k = pb.k");
+        ASSERT_CONTAINS(result, "300 row", "Duplicate runs on both sides");
+        ASSERT_TRUE(resultRows(result) == expected, "Index-ordered merge returns the nested-loop rows in order");
+        result = exec("SELECT COUNT(*) FROM pb, pa WHERE pb.id = pa.id");
+        ASSERT_CONTAINS(result, "200", "Primary key to primary key");
+
+        // 可为 NULL 的连接列、没有索引：压低建表上限后走稳定排序的归并
+        exec("CREATE TABLE qa (id INT NOT NULL, k INT, PRIMARY KEY (id))");
+        exec("CREATE TABLE qb (id INT NOT NULL, k INT, note VARCHAR(8), PRIMARY KEY (id))");
+        std::vector<int> qa(40), qb(30);
+        sql = "INSERT INTO qa VALUES ";
+        for (int i = 0; i < 40; i++) {
+            qa[i] = i % 4 == 0 ? -1 : (i * 7) % 5;
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + "," + (qa[i] < 0 ? "NULL" : std::to_string(qa[i])) + ")";
+        }
+        exec(sql);
+        sql = "INSERT INTO qb VALUES ";
+        for (int i = 0; i < 30; i++) {
+            qb[i] = i % 3 == 0 ? -1 : i % 7;
+            if (i > 0) sql += ",";
+            sql += "(" + std::to_string(i) + "," + (qb[i] < 0 ? "NULL" : std::to_string(qb[i])) + ",'m" +
+                   std::to_string(i) + "')";
+        }
+        exec(sql);
+        expected.clear();
+        for (int a = 0; a < 40; a++) {
+            for (int b = 0; b < 30; b++) {
+                if (qa[a] == qb[b]) expected.push_back(std::to_string(a) + ",m" + std::to_string(b));
+            }
+        }
+        std::string hashed = exec("SELECT qa.id, qb.note FROM qa, qb WHERE qa.k = qb.k");
+        result = exec("SET JOIN_HASH_ROWS 10");
+        ASSERT_CONTAINS(result, "limit 10 rows", "Lower the hash join limit");
+        std::string merged = exec("SELECT qa.id, qb.note FROM qa, qb WHERE qa.k = qb.k");
+        std::string reversed = exec("SELECT qa.id, qb.note FROM qb, qa WHERE qb.k = qa.k");
+        exec("SET JOIN_HASH_ROWS 2097152");
+        ASSERT_TRUE(expected.size() == 190, "Duplicate and NULL keys on both nullable sides");
+        ASSERT_TRUE(resultRows(hashed) == expected, "Hash join pairs NULL keys like the nested loop");
+        ASSERT_TRUE(resultRows(merged) == expected, "Sort-merge join matches the nested-loop rows in order");
+        ASSERT_CONTAINS(merged, std::to_string(expected.size()) + " row", "Sort-merge row count");
+        std::vector<std::string> outerFirst;
+        for (int b = 0; b < 30; b++) {
+            for (int a = 0; a < 40; a++) {
+                if (qa[a] == qb[b]) outerFirst.push_back(std::to_string(a) + ",m" + std::to_string(b));
+            }
+        }
+        ASSERT_TRUE(resultRows(reversed) == outerFirst, "Sort-merge keeps the outer table's order");
+        result = exec("SET JOIN_HASH_ROWS 0");
+        ASSERT_CONTAINS(result, "Usage", "Reject a zero limit");
+
+        exec("DROP DATABASE mergejoindb");
+        return true;
+    }
+    
+    // 测试列式压缩
+    bool testCompressTable() {
+        TEST_CASE("Compress Table");
+        
+        exec("CREATE DATABASE storagedb");
+        exec("USE storagedb");
+        exec("CREATE TABLE events (id INT NOT NULL, kind INT, ts INT, PRIMARY KEY (id))");
+        std::string sql = "INSERT INTO events VALUES ";
+        for (int i = 1; i <= 2000; i++) {
+            if (i > 1) sql += ",";
+            sql += "(" + std::to_string(i) + "," + std::to_string(i % 3) + "," +
+                   std::to_string(1700000000 + i * 10) + ")";
+        }
+        exec(sql);
+        
+        std::string result = exec("COMPRESS TABLE events");
+        ASSERT_CONTAINS(result, "compressed", "Compress table");
+        
+        result = exec("SELECT MIN(ts), MAX(ts), SUM(kind), COUNT(*) FROM events");
+        ASSERT_CONTAINS(result, "1700000010", "MIN on compressed pages");
+        ASSERT_CONTAINS(result, "1700020000", "MAX on compressed pages");
+        ASSERT_CONTAINS(result, "2001", "SUM on compressed pages");
+        
+        exec("DELETE FROM events WHERE id <= 10");
+        result = exec("SELECT * FROM events WHERE id = 10");
+        ASSERT_CONTAINS(result, "0 row", "Delete on compressed page");
+        result = exec("SELECT MIN(ts) FROM events");
+        ASSERT_CONTAINS(result, "1700000110", "MIN after delete");
+        result = exec("SELECT kind, ts FROM events WHERE id = 1234");
+        ASSERT_CONTAINS(result, "1700012340", "Point lookup on compressed page");
+        
+        // 空值位图、VARCHAR 和 FLOAT 的 int 也按列编码，取回的行要与压缩前一致
+        exec("CREATE TABLE notes (id INT NOT NULL, name VARCHAR(20), score FLOAT, PRIMARY KEY (id))");
+        sql = "INSERT INTO notes VALUES ";
+        for (int i = 1; i <= 3000; i++) {
+            if (i > 1) sql += ",";
+            std::string name = i % 5 == 0 ? "NULL" : "'user" + std::to_string(i % 40) + "'";
+            std::string score = i % 7 == 0 ? "NULL" : std::to_string(i % 100) + ".25";
+            sql += "(" + std::to_string(i) + "," + name + "," + score + ")";
+        }
+        exec(sql);
+        std::vector<std::string> before = resultRows(exec("SELECT * FROM notes WHERE id >= 1200 AND id <= 1240"));
+        result = exec("COMPRESS TABLE notes");
+        ASSERT_NOT_CONTAINS(result, "Error", "Compress table with VARCHAR and FLOAT columns");
+        std::vector<std::string> after = resultRows(exec("SELECT * FROM notes WHERE id >= 1200 AND id <= 1240"));
+        ASSERT_TRUE(before.size() == 41 && after == before, "Mixed-type rows unchanged after compression");
+        result = exec("SELECT name, score FROM notes WHERE id = 1225");
+        ASSERT_TRUE(resultRows(result) == std::vector<std::string>(1, "NULL,NULL"), "NULL VARCHAR and FLOAT on compressed page");
+        result = exec("SELECT SUM(id), COUNT(*) FROM notes");
+        ASSERT_CONTAINS(result, "4501500", "SUM next to compressed VARCHAR and FLOAT columns");
+        
+        exec("DROP DATABASE storagedb");
+        return true;
+    }
+    
+    // 测试 VACUUM
+    bool testVacuumTable() {
+        TEST_CASE("Vacuum Table");
+        
+        exec("CREATE DATABASE vacuumdb");
+        exec("USE vacuumdb");
+        exec("CREATE TABLE logs (id INT NOT NULL, level INT, PRIMARY KEY (id))");
+        std::string sql = "INSERT INTO logs VALUES ";
+        for (int i = 1; i <= 3000; i++) {
+            if (i > 1) sql += ",";
+            sql += "(" + std::to_string(i) + "," + std::to_string(i % 5) + ")";
+        }
+        exec(sql);
+        exec("DELETE FROM logs WHERE level < 4");
+        
+        std::string result = exec("VACUUM logs");
+        ASSERT_CONTAINS(result, "2400 deleted records removed", "Vacuum removes deleted records");
+        ASSERT_NOT_CONTAINS(result, " 0 bytes reclaimed", "Vacuum frees pages");
+        
+        result = exec("SELECT COUNT(*) FROM logs");
+        ASSERT_CONTAINS(result, "600", "COUNT(*) after vacuum");
+        result = exec("SELECT level FROM logs WHERE id = 2999");
+        ASSERT_TRUE(resultRows(result) == std::vector<std::string>(1, "4"), "Index lookup after vacuum");
+        ASSERT_CONTAINS(result, "1 row(s) in set", "Index lookup returns one row");
+        result = exec("SELECT level FROM logs WHERE id = 2998");
+        ASSERT_CONTAINS(result, "0 row(s) in set", "Vacuumed row stays deleted");
+        
+        exec("DROP DATABASE vacuumdb");
+        return true;
+    }
+    
+    // 测试按页目录随机访问数据页，并把堆分成几段分别扫描
+    bool testHeapPageRanges() {
+        TEST_CASE("Heap Page Ranges");
+        
+        system(("mkdir -p " + testDir).c_str());
+        std::string path = testDir + "/ranges.dat";
+        FileManager fm;
+        BufPageManager bpm(&fm);
+        fm.createFile(path.c_str());
+        int fileID;
+        fm.openFile(path.c_str(), fileID);
+        RecordManager rm(&fm, &bpm, fileID, false, 0, true);
+        unsigned int data[40];
+        for (int id = 1; id <= 5000; id++) {
+            int len = 4 + id % 30;
+            for (int j = 0; j < len; j++) data[j] = id * 7 + j;
+            rm.insertRecord(id, data, len);
+        }
+        for (int id = 3; id <= 5000; id += 3) rm.deleteRecord(id);
+        
+        std::map<int, std::vector<unsigned int>> all;
+        rm.forEachRecord([&](int rid, const unsigned int* d, int len) { all[rid].assign(d, d + len); });
+        // 分成 4 段，每段各扫一遍
+        int pages = rm.getPageCount();
+        std::map<int, std::vector<unsigned int>> split;
+        int repeated = 0;
+        for (int w = 0; w < 4; w++) {
+            rm.forEachRecordInRange(pages * w / 4, pages * (w + 1) / 4, [&](int rid, const unsigned int* d, int len) {
+                if (split.count(rid)) repeated++;
+                split[rid].assign(d, d + len);
+            });
+        }
+        // 每个目录项的记录数和 recordID 范围与页内的记录一致
+        bool entriesMatch = true;
+        long long live = 0;
+        PageDirEntry entry;
+        for (int n = 0; n < pages; n++) {
+            if (!rm.getPageInfo(n, entry)) entriesMatch = false;
+            int rows = 0;
+            rm.forEachRecordInRange(n, n + 1, [&](int rid, const unsigned int*, int) {
+                rows++;
+                if (rid < entry.minRecordID || rid > entry.maxRecordID) entriesMatch = false;
+            });
+            if (rows != entry.liveRows) entriesMatch = false;
+            live += entry.liveRows;
+        }
+        bool outOfRange = rm.getPageInfo(pages, entry) || rm.getPageInfo(-1, entry);
+        bpm.close();
+        fm.closeFile(fileID);
+        
+        ASSERT_TRUE(pages > 4, "Heap spans several pages");
+        ASSERT_TRUE(all.size() == 3334 && all[4].size() == 8 && all[4][0] == 28, "forEachRecord returns live records");
+        ASSERT_TRUE(split == all && repeated == 0, "Page ranges cover every record exactly once");
+        ASSERT_TRUE(entriesMatch && live == 3334, "getPageInfo matches page contents");
+        ASSERT_TRUE(!outOfRange, "getPageInfo rejects pages outside the chain");
+        return true;
+    }
+    
+    // 测试打开没有页目录的旧格式堆文件：沿链表建目录、补文件头，以及目录项格式升级
+    bool testLegacyHeapUpgrade() {
+        TEST_CASE("Legacy Heap Upgrade");
+        
+        system(("mkdir -p " + testDir).c_str());
+        std::string path = testDir + "/legacy.dat";
+        FileManager fm;
+        BufPageManager bpm(&fm);
+        fm.createFile(path.c_str());
+        int fileID;
+        fm.openFile(path.c_str(), fileID);
+        // 旧格式：数据链表 0 -> 2 -> 1，页 3 在空闲页链表里，页 0 没有目录字段
+        const int chain[3] = {0, 2, 1};
+        unsigned int page[PAGE_INT_NUM];
+        int id = 1;
+        for (int i = 0; i < 3; i++) {
+            memset(page, 0, PAGE_SIZE);
+            int pos = PAGE_DATA_START;
+            for (int r = 0; r < 50; r++, id++) {
+                page[pos] = RECORD_HEADER_SIZE + 3;
+                page[pos + 1] = id;
+                page[pos + 2] = id * 10;
+                page[pos + 3] = id * 10 + 1;
+                page[pos + 4] = id * 10 + 2;
+                pos += RECORD_HEADER_SIZE + 3;
+            }
+            page[PAGE_TYPE_OFFSET] = PAGE_TYPE_DATA;
+            page[PAGE_RECORD_COUNT_OFFSET] = 50;
+            page[PAGE_FREE_START_OFFSET] = pos;
+            page[PAGE_NEXT_PAGE_OFFSET] = i < 2 ? chain[i + 1] : (unsigned int)-1;
+            if (i == 0) page[PAGE_FREE_LIST_OFFSET] = 3;
+            fm.writePage(fileID, chain[i], page, 0);
+        }
+        memset(page, 0, PAGE_SIZE);
+        page[PAGE_TYPE_OFFSET] = PAGE_TYPE_FREE;
+        fm.writePage(fileID, 3, page, 0);
+        
+        RecordManager* rm = new RecordManager(&fm, &bpm, fileID);
+        int index;
+        BufType head = bpm.getPage(fileID, 0, index);
+        // 目录页复用了空闲页 3，文件长度把空闲页也算在内
+        bool headerOk = head[PAGE_DIR_MAGIC_OFFSET] == PAGE_DIR_MAGIC && head[PAGE_DIR_HEAD_OFFSET] == 3 &&
+                        head[PAGE_TAIL_OFFSET] == 1 && head[PAGE_CHAIN_LENGTH_OFFSET] == 3 &&
+                        head[PAGE_FILE_PAGES_OFFSET] == 4 && head[PAGE_FREE_LIST_OFFSET] == 0;
+        PageDirEntry entry;
+        bool dirOk = rm->getPageCount() == 3;
+        for (int n = 0; n < 3 && dirOk; n++) {
+            dirOk = rm->getPageInfo(n, entry) && entry.pageID == chain[n] && entry.liveRows == 50 &&
+                    entry.minRecordID == n * 50 + 1 && entry.maxRecordID == n * 50 + 50;
+        }
+        unsigned int data[8];
+        bool rowsOk = true;
+        for (int rid = 1; rid <= 150; rid++) {
+            int len = rm->getRecord(rid, data, 8);
+            if (len != 3 || (int)data[0] != rid * 10 || (int)data[2] != rid * 10 + 2) rowsOk = false;
+        }
+        int records, pages;
+        rm->getStatistics(records, pages);
+        delete rm;
+        
+        // 上一版的目录项没有 recordID 范围：改回旧标记、清掉范围后重新打开，应按页内记录重建
+        head = bpm.getPage(fileID, 0, index);
+        head[PAGE_DIR_MAGIC_OFFSET] = PAGE_DIR_MAGIC_V1;
+        int dirPage = head[PAGE_DIR_HEAD_OFFSET];
+        bpm.markDirty(index);
+        BufType dir = bpm.getPage(fileID, dirPage, index);
+        for (int n = 0; n < 3; n++) {
+            dir[PAGE_HEADER_SIZE + n * DIR_ENTRY_SIZE + 3] = 0;
+            dir[PAGE_HEADER_SIZE + n * DIR_ENTRY_SIZE + 4] = 0;
+        }
+        bpm.markDirty(index);
+        rm = new RecordManager(&fm, &bpm, fileID);
+        head = bpm.getPage(fileID, 0, index);
+        bool upgraded = head[PAGE_DIR_MAGIC_OFFSET] == PAGE_DIR_MAGIC && rm->getRecord(120, data, 8) == 3 &&
+                        data[0] == 1200 && rm->recordExists(1) && !rm->recordExists(151);
+        delete rm;
+        bpm.close();
+        fm.closeFile(fileID);
+        
+        ASSERT_TRUE(headerOk, "File header gets directory, tail, chain length and page count");
+        ASSERT_TRUE(dirOk, "Directory follows the old page chain");
+        ASSERT_TRUE(rowsOk && records == 150 && pages == 3, "Rows readable after upgrade");
+        ASSERT_TRUE(upgraded, "Directory without recordID ranges is rebuilt");
+        return true;
+    }
+
+    // 测试游标的区间界落在叶子中间、相等的键跨叶子时，整叶免判界的移动不越界也不漏条目
+    bool testCursorLeafBounds() {
+        TEST_CASE("Cursor Leaf Bounds");
+
+        system(("mkdir -p " + testDir).c_str());
+        std::string path = testDir + "/cursor.idx";
+        remove(path.c_str());
+        FileManager fm;
+        BufPageManager bpm(&fm);
+        fm.createFile(path.c_str());
+        int fileID;
+        fm.openFile(path.c_str(), fileID);
+        BPlusTree tree(&fm, &bpm, fileID, KeyType::INT, 0);
+        tree.initialize(false);
+        // 每个键 3 条，先插再删掉一部分，叶子不再是整齐装满的
+        std::multiset<int> ref;
+        for (int i = 0; i < 30000; i++) {
+            tree.insert(i / 3, RID(i / 3, i));
+            ref.insert(i / 3);
+        }
+        for (int i = 0; i < 30000; i += 7) {
+            tree.remove(i / 3, RID(i / 3, i));
+            ref.erase(ref.find(i / 3));
+        }
+        int nodes, records, height;
+        tree.getStatistics(nodes, records, height);
+
+        const int bounds[][2] = {{0, 9999}, {5, 6}, {100, 4000}, {2345, 2345}, {9000, 12000}, {-5, 3}};
+        bool countsMatch = true;
+        bool ordered = true;
+        for (const auto& b : bounds) {
+            for (int flags = 0; flags < 8; flags++) {
+                bool inclLow = flags & 1, inclHigh = flags & 2, backward = flags & 4;
+                long long expected = 0;
+                for (int k : ref) {
+                    if ((inclLow ? k >= b[0] : k > b[0]) && (inclHigh ? k <= b[1] : k < b[1])) expected++;
+                }
+                long long seen = 0;
+                int prev = backward ? INT_MAX : INT_MIN;
+                for (BPlusCursor c = tree.openCursor(&b[0], &b[1], inclLow, inclHigh, backward); c.valid();
+                     c.advance()) {
+                    int k = (int)c.key()[0];
+                    if (backward ? k > prev : k < prev) ordered = false;
+                    if (k != c.rid().pageNum) ordered = false;
+                    prev = k;
+                    seen++;
+                }
+                if (seen != expected) countsMatch = false;
+            }
+        }
+        bpm.close();
+        fm.closeFile(fileID);
+        remove(path.c_str());
+
+        ASSERT_TRUE(nodes > 20 && records == (int)ref.size(), "Tree spans many leaves");
+        ASSERT_TRUE(countsMatch, "Bounded cursors return every entry in range, open and closed, both directions");
+        ASSERT_TRUE(ordered, "Cursor entries are in key order and match their RIDs");
+        return true;
+    }
+
     // 测试删除表
     bool testDropTable() {
         TEST_CASE("Drop Table");
@@ -377,6 +1467,29 @@ public:
         if (testDeleteOperations()) passed++; else failed++;
         if (testJoinOperations()) passed++; else failed++;
         if (testIndexOperations()) passed++; else failed++;
+        if (testIndexKeyTypes()) passed++; else failed++;
+        if (testSecondaryIndex()) passed++; else failed++;
+        if (testCompositeIndex()) passed++; else failed++;
+        if (testCompositeKeyEncoding()) passed++; else failed++;
+        if (testBulkIndexBuild()) passed++; else failed++;
+        if (testIndexRebalance()) passed++; else failed++;
+        if (testSequentialInsert()) passed++; else failed++;
+        if (testIndexLimitScan()) passed++; else failed++;
+        if (testIndexRangeTypes()) passed++; else failed++;
+        if (testVarcharPrefixIndex()) passed++; else failed++;
+        if (testCoveringIndexScan()) passed++; else failed++;
+        if (testIndexAggregate()) passed++; else failed++;
+        if (testHashIndex()) passed++; else failed++;
+        if (testPrimaryKeyFilter()) passed++; else failed++;
+        if (testBufferedIndex()) passed++; else failed++;
+        if (testIndexJoin()) passed++; else failed++;
+        if (testHashJoin()) passed++; else failed++;
+        if (testMergeJoin()) passed++; else failed++;
+        if (testCompressTable()) passed++; else failed++;
+        if (testVacuumTable()) passed++; else failed++;
+        if (testHeapPageRanges()) passed++; else failed++;
+        if (testLegacyHeapUpgrade()) passed++; else failed++;
+        if (testCursorLeafBounds()) passed++; else failed++;
         if (testDropTable()) passed++; else failed++;
         
         std::cout << "\n======================================" << std::endl;